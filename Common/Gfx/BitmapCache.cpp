@@ -0,0 +1,129 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "BitmapCache.h"
+
+namespace {
+
+// Entries are not removed when their GDI+ bitmaps are deleted, so the cache is emptied when it
+// would exceed this size. Bitmaps that are still drawn are uploaded again on their next draw.
+const UINT64 MAX_CACHED_SIZE = 64ULL * 1024ULL * 1024ULL;
+
+}  // namespace
+
+namespace Gfx {
+
+UINT BitmapCache::c_Generation = 0;
+
+BitmapCache::BitmapCache() :
+	m_Size(),
+	m_Stats()
+{
+}
+
+BitmapCache::~BitmapCache()
+{
+}
+
+void BitmapCache::Validate(ID2D1RenderTarget* target)
+{
+	Microsoft::WRL::ComPtr<ID2D1DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID2D1Device> device;
+	if (SUCCEEDED(target->QueryInterface(context.GetAddressOf())))
+	{
+		context->GetDevice(device.GetAddressOf());
+	}
+
+	// Render targets created with CreateWicBitmapRenderTarget may each have their own device, so
+	// the bitmaps are kept and checked by Get().
+	m_Device = device;
+}
+
+void BitmapCache::Clear()
+{
+	m_Bitmaps.clear();
+	m_Size = 0;
+}
+
+Microsoft::WRL::ComPtr<ID2D1Bitmap> BitmapCache::Get(ID2D1RenderTarget* target, Gdiplus::Bitmap* bitmap, UINT generation)
+{
+	auto iter = m_Bitmaps.find(bitmap);
+	if (iter != m_Bitmaps.end())
+	{
+		Entry& entry = iter->second;
+		if (entry.generation == generation)
+		{
+			// Without a device, bitmaps cannot be assumed to work with other targets.
+			if (m_Device && entry.device == m_Device)
+			{
+				++m_Stats.hits;
+				return entry.bitmap;
+			}
+
+			Microsoft::WRL::ComPtr<ID2D1Bitmap> shared;
+			if (SUCCEEDED(target->CreateSharedBitmap(
+				__uuidof(ID2D1Bitmap), entry.bitmap.Get(), nullptr, shared.GetAddressOf())))
+			{
+				entry.bitmap = shared;
+				entry.device = m_Device;
+				++m_Stats.shares;
+				return shared;
+			}
+		}
+
+		m_Size -= entry.size;
+		m_Bitmaps.erase(iter);
+	}
+
+	const UINT w = bitmap->GetWidth();
+	const UINT h = bitmap->GetHeight();
+	const UINT maxSize = target->GetMaximumBitmapSize();
+	if (w == 0 || h == 0 || w > maxSize || h > maxSize) return nullptr;
+
+	const UINT64 size = (UINT64)w * h * 4;
+	if (size > MAX_CACHED_SIZE) return nullptr;
+
+	if (m_Size + size > MAX_CACHED_SIZE)
+	{
+		Clear();
+	}
+
+	Gdiplus::Rect lockRect(0, 0, w, h);
+	Gdiplus::BitmapData data;
+	if (bitmap->LockBits(&lockRect, Gdiplus::ImageLockModeRead, PixelFormat32bppPARGB, &data) != Gdiplus::Ok)
+	{
+		return nullptr;
+	}
+
+	D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
+		D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+	Microsoft::WRL::ComPtr<ID2D1Bitmap> d2dBitmap;
+	HRESULT hr = target->CreateBitmap(
+		D2D1::SizeU(w, h), data.Scan0, (UINT32)data.Stride, props, d2dBitmap.GetAddressOf());
+	bitmap->UnlockBits(&data);
+	if (FAILED(hr)) return nullptr;
+
+	Entry& entry = m_Bitmaps[bitmap];
+	entry.generation = generation;
+	entry.size = size;
+	entry.bitmap = d2dBitmap;
+	entry.device = m_Device;
+	m_Size += size;
+	++m_Stats.uploads;
+
+	return d2dBitmap;
+}
+
+UINT BitmapCache::NewGeneration()
+{
+	// 0 is never used so that it can mean "no generation".
+	if (++c_Generation == 0) ++c_Generation;
+	return c_Generation;
+}
+
+}  // namespace Gfx
@@ -0,0 +1,81 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_GFX_BITMAPCACHE_H_
+#define RM_GFX_BITMAPCACHE_H_
+
+#include <ole2.h>  // For Gdiplus.h.
+#include <GdiPlus.h>
+#include <d2d1_1.h>
+#include <wrl/client.h>
+#include <unordered_map>
+
+namespace Gfx {
+
+// Direct2D copies of the GDI+ bitmaps drawn by a Canvas. A bitmap is uploaded once for each
+// generation so that e.g. the frames of an image strip can be drawn as parts of a single device
+// bitmap without wrapping the GDI+ pixels again for every draw.
+class BitmapCache
+{
+public:
+	BitmapCache();
+	~BitmapCache();
+
+	BitmapCache(const BitmapCache& other) = delete;
+	BitmapCache& operator=(BitmapCache other) = delete;
+
+	struct Stats
+	{
+		UINT hits;		// Returned the cached device bitmap
+		UINT shares;	// Shared a bitmap that was uploaded with another device
+		UINT uploads;	// Copied the pixels to the device
+	};
+
+	// Must be called each time the render target is created. Bitmaps uploaded with another
+	// Direct2D device are shared with |target| when they are next used, or uploaded again if
+	// Direct2D does not support that.
+	void Validate(ID2D1RenderTarget* target);
+
+	void Clear();
+
+	// Returns the device bitmap of |bitmap| or nullptr if it could not be created. |generation|
+	// must be different each time the pixels of |bitmap| change or another bitmap is created at
+	// the same address. Use NewGeneration() to get such values.
+	Microsoft::WRL::ComPtr<ID2D1Bitmap> Get(ID2D1RenderTarget* target, Gdiplus::Bitmap* bitmap, UINT generation);
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	// Returns a generation that has not been returned before. Never returns 0.
+	static UINT NewGeneration();
+
+private:
+	struct Entry
+	{
+		UINT generation;
+		UINT64 size;
+		Microsoft::WRL::ComPtr<ID2D1Bitmap> bitmap;
+
+		// Device that |bitmap| was created with or nullptr if unknown.
+		Microsoft::WRL::ComPtr<ID2D1Device> device;
+	};
+
+	std::unordered_map<Gdiplus::Bitmap*, Entry> m_Bitmaps;
+
+	// Total size of |m_Bitmaps| in bytes.
+	UINT64 m_Size;
+
+	// Device of the current render target.
+	Microsoft::WRL::ComPtr<ID2D1Device> m_Device;
+
+	Stats m_Stats;
+
+	static UINT c_Generation;
+};
+
+}  // namespace Gfx
+
+#endif
@@ -0,0 +1,144 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "BitmapCache.h"
+#include "BrushCache.h"
+#include "../UnitTest.h"
+#include <wincodec.h>
+#include <memory>
+
+namespace Gfx {
+
+// Canvas creates a new WIC render target for each sequence of Direct2D draws, so the caches must
+// be hit across render targets.
+TEST_CLASS(Common_Gfx_BitmapCache_Test)
+{
+public:
+	Common_Gfx_BitmapCache_Test()
+	{
+		CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+		ULONG_PTR gdiplusToken;
+		Gdiplus::GdiplusStartupInput gdiplusStartupInput;
+		Gdiplus::GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, nullptr);
+		m_GdipBitmap.reset(new Gdiplus::Bitmap(8, 8, PixelFormat32bppPARGB));
+
+		D2D1_FACTORY_OPTIONS options = {};
+		D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, __uuidof(ID2D1Factory1), &options,
+			(void**)m_D2DFactory.GetAddressOf());
+
+		Microsoft::WRL::ComPtr<IWICImagingFactory> wicFactory;
+		CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+			IID_PPV_ARGS(wicFactory.GetAddressOf()));
+		wicFactory->CreateBitmap(
+			16, 16, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnDemand, m_WicBitmap.GetAddressOf());
+	}
+
+	TEST_METHOD(TestBitmapAcrossTargets)
+	{
+		BitmapCache cache;
+		const UINT generation = BitmapCache::NewGeneration();
+		for (int i = 0; i < 3; ++i)
+		{
+			auto target = CreateTarget();
+			cache.Validate(target.Get());
+			target->BeginDraw();
+
+			auto bitmap = cache.Get(target.Get(), m_GdipBitmap.get(), generation);
+			Assert::IsNotNull(bitmap.Get());
+			target->DrawBitmap(bitmap.Get(), D2D1::RectF(0.0f, 0.0f, 8.0f, 8.0f));
+
+			// The bitmap must be usable with the target.
+			Assert::IsTrue(SUCCEEDED(target->EndDraw()));
+		}
+
+		// Uploaded once and then used through the same device or shared with the other devices.
+		Assert::AreEqual(1U, cache.GetStats().uploads);
+		Assert::AreEqual(2U, cache.GetStats().hits + cache.GetStats().shares);
+
+		// A new generation is uploaded again.
+		auto target = CreateTarget();
+		cache.Validate(target.Get());
+		Assert::IsNotNull(cache.Get(target.Get(), m_GdipBitmap.get(), BitmapCache::NewGeneration()).Get());
+		Assert::AreEqual(2U, cache.GetStats().uploads);
+	}
+
+	TEST_METHOD(TestBrushAcrossTargets)
+	{
+		BrushCache cache;
+		const D2D1_COLOR_F color = D2D1::ColorF(1.0f, 0.0f, 0.0f);
+
+		auto target1 = CreateTarget();
+		cache.Validate(target1.Get());
+		target1->BeginDraw();
+		auto brush1 = cache.GetSolidBrush(target1.Get(), color);
+		Assert::IsTrue(cache.GetSolidBrush(target1.Get(), color) == brush1);
+		target1->FillRectangle(D2D1::RectF(0.0f, 0.0f, 4.0f, 4.0f), brush1.Get());
+		Assert::IsTrue(SUCCEEDED(target1->EndDraw()));
+		Assert::AreEqual(1U, cache.GetStats().creates);
+		Assert::AreEqual(1U, cache.GetStats().hits);
+
+		const UINT generation = cache.GetGeneration();
+		auto target2 = CreateTarget();
+		cache.Validate(target2.Get());
+		target2->BeginDraw();
+		auto brush2 = cache.GetSolidBrush(target2.Get(), color);
+		target2->FillRectangle(D2D1::RectF(0.0f, 0.0f, 4.0f, 4.0f), brush2.Get());
+		Assert::IsTrue(SUCCEEDED(target2->EndDraw()));
+
+		auto device1 = GetDevice(target1.Get());
+		if (device1 && device1 == GetDevice(target2.Get()))
+		{
+			// Hit across the targets.
+			Assert::IsTrue(brush1 == brush2);
+			Assert::AreEqual(1U, cache.GetStats().creates);
+			Assert::AreEqual(generation, cache.GetGeneration());
+		}
+		else
+		{
+			// Brushes cannot be shared between devices so they are created again.
+			Assert::IsTrue(brush1 != brush2);
+			Assert::AreEqual(2U, cache.GetStats().creates);
+			Assert::AreEqual(1U, cache.GetStats().clears);
+			Assert::AreNotEqual(generation, cache.GetGeneration());
+		}
+	}
+
+private:
+	// Same properties as Canvas::BeginTargetDraw().
+	Microsoft::WRL::ComPtr<ID2D1RenderTarget> CreateTarget()
+	{
+		const D2D1_RENDER_TARGET_PROPERTIES properties = D2D1::RenderTargetProperties(
+			D2D1_RENDER_TARGET_TYPE_DEFAULT,
+			D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+			0.0f,
+			0.0f,
+			D2D1_RENDER_TARGET_USAGE_GDI_COMPATIBLE);
+
+		Microsoft::WRL::ComPtr<ID2D1RenderTarget> target;
+		HRESULT hr = m_D2DFactory->CreateWicBitmapRenderTarget(m_WicBitmap.Get(), properties, target.GetAddressOf());
+		Assert::IsTrue(SUCCEEDED(hr));
+		return target;
+	}
+
+	static Microsoft::WRL::ComPtr<ID2D1Device> GetDevice(ID2D1RenderTarget* target)
+	{
+		Microsoft::WRL::ComPtr<ID2D1DeviceContext> context;
+		Microsoft::WRL::ComPtr<ID2D1Device> device;
+		if (SUCCEEDED(target->QueryInterface(context.GetAddressOf())))
+		{
+			context->GetDevice(device.GetAddressOf());
+		}
+		return device;
+	}
+
+	Microsoft::WRL::ComPtr<ID2D1Factory1> m_D2DFactory;
+	Microsoft::WRL::ComPtr<IWICBitmap> m_WicBitmap;
+	std::unique_ptr<Gdiplus::Bitmap> m_GdipBitmap;
+};
+
+}  // namespace Gfx
@@ -0,0 +1,191 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "BrushCache.h"
+
+namespace {
+
+// Gradients of shapes that are resized or animated create a new brush on each change, so the
+// cache is emptied when it reaches this size. Brushes in use are kept alive by their shapes.
+const size_t MAX_CACHED_BRUSHES = 512;
+
+enum class KeyType : BYTE
+{
+	Solid,
+	LinearGradient,
+	RadialGradient
+};
+
+template <typename T>
+void AppendKey(std::string& key, const T& value)
+{
+	key.append((const char*)&value, sizeof(T));
+}
+
+}  // namespace
+
+namespace Gfx {
+
+BrushCache::BrushCache() :
+	m_Generation(),
+	m_Stats()
+{
+}
+
+BrushCache::~BrushCache()
+{
+}
+
+void BrushCache::Validate(ID2D1RenderTarget* target)
+{
+	Microsoft::WRL::ComPtr<ID2D1DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID2D1Device> device;
+	if (SUCCEEDED(target->QueryInterface(context.GetAddressOf())))
+	{
+		context->GetDevice(device.GetAddressOf());
+	}
+
+	// Without a device, resources cannot be assumed to work with other targets.
+	if (!device || device != m_Device)
+	{
+		if (!m_Brushes.empty() || !m_GradientStopCollections.empty()) ++m_Stats.clears;
+
+		Clear();
+		m_Device = device;
+	}
+}
+
+void BrushCache::Clear()
+{
+	m_Brushes.clear();
+	m_GradientStopCollections.clear();
+	++m_Generation;
+}
+
+Microsoft::WRL::ComPtr<ID2D1Brush> BrushCache::GetSolidBrush(ID2D1RenderTarget* target, const D2D1_COLOR_F& color)
+{
+	std::string key;
+	AppendKey(key, KeyType::Solid);
+	AppendKey(key, color);
+
+	auto iter = m_Brushes.find(key);
+	if (iter != m_Brushes.end())
+	{
+		++m_Stats.hits;
+		return iter->second;
+	}
+
+	Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> solid;
+	HRESULT hr = target->CreateSolidColorBrush(color, solid.GetAddressOf());
+	if (FAILED(hr)) return nullptr;
+
+	AddBrush(key, solid);
+	return solid;
+}
+
+Microsoft::WRL::ComPtr<ID2D1Brush> BrushCache::GetLinearGradientBrush(ID2D1RenderTarget* target,
+	const D2D1_LINEAR_GRADIENT_BRUSH_PROPERTIES& properties,
+	const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma)
+{
+	std::string key;
+	AppendKey(key, KeyType::LinearGradient);
+	AppendKey(key, properties);
+
+	auto collection = GetGradientStopCollection(target, stops, altGamma, key);
+	if (!collection) return nullptr;
+
+	auto iter = m_Brushes.find(key);
+	if (iter != m_Brushes.end())
+	{
+		++m_Stats.hits;
+		return iter->second;
+	}
+
+	Microsoft::WRL::ComPtr<ID2D1LinearGradientBrush> linear;
+	HRESULT hr = target->CreateLinearGradientBrush(properties, collection, linear.GetAddressOf());
+	if (FAILED(hr)) return nullptr;
+
+	AddBrush(key, linear);
+	return linear;
+}
+
+Microsoft::WRL::ComPtr<ID2D1Brush> BrushCache::GetRadialGradientBrush(ID2D1RenderTarget* target,
+	const D2D1_RADIAL_GRADIENT_BRUSH_PROPERTIES& properties,
+	const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma)
+{
+	std::string key;
+	AppendKey(key, KeyType::RadialGradient);
+	AppendKey(key, properties);
+
+	auto collection = GetGradientStopCollection(target, stops, altGamma, key);
+	if (!collection) return nullptr;
+
+	auto iter = m_Brushes.find(key);
+	if (iter != m_Brushes.end())
+	{
+		++m_Stats.hits;
+		return iter->second;
+	}
+
+	Microsoft::WRL::ComPtr<ID2D1RadialGradientBrush> radial;
+	HRESULT hr = target->CreateRadialGradientBrush(properties, collection, radial.GetAddressOf());
+	if (FAILED(hr)) return nullptr;
+
+	AddBrush(key, radial);
+	return radial;
+}
+
+/*
+** Returns the gradient stop collection of |stops| and appends its key to |key|. The returned
+** collection is owned by the cache.
+**
+*/
+ID2D1GradientStopCollection* BrushCache::GetGradientStopCollection(ID2D1RenderTarget* target,
+	const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma, std::string& key)
+{
+	if (stops.empty()) return nullptr;
+
+	std::string stopsKey;
+	AppendKey(stopsKey, altGamma);
+	stopsKey.append((const char*)stops.data(), stops.size() * sizeof(D2D1_GRADIENT_STOP));
+	key += stopsKey;
+
+	auto iter = m_GradientStopCollections.find(stopsKey);
+	if (iter != m_GradientStopCollections.end()) return iter->second.Get();
+
+	Microsoft::WRL::ComPtr<ID2D1GradientStopCollection> collection;
+	HRESULT hr = target->CreateGradientStopCollection(
+		stops.data(),
+		(UINT32)stops.size(),
+		altGamma ? D2D1_GAMMA_1_0 : D2D1_GAMMA_2_2,
+		D2D1_EXTEND_MODE_CLAMP,
+		collection.GetAddressOf());
+	if (FAILED(hr)) return nullptr;
+
+	if (m_GradientStopCollections.size() >= MAX_CACHED_BRUSHES)
+	{
+		m_GradientStopCollections.clear();
+	}
+
+	auto& cached = m_GradientStopCollections[stopsKey];
+	cached = collection;
+	return cached.Get();
+}
+
+void BrushCache::AddBrush(const std::string& key, const Microsoft::WRL::ComPtr<ID2D1Brush>& brush)
+{
+	if (m_Brushes.size() >= MAX_CACHED_BRUSHES)
+	{
+		m_Brushes.clear();
+	}
+
+	m_Brushes[key] = brush;
+	++m_Stats.creates;
+}
+
+}  // namespace Gfx
@@ -0,0 +1,80 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_GFX_BRUSHCACHE_H_
+#define RM_GFX_BRUSHCACHE_H_
+
+#include <d2d1_1.h>
+#include <wrl/client.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Gfx {
+
+// Direct2D brushes and gradient stop collections of a Canvas, keyed by their parameters so that
+// shapes with identical fills share a single device resource.
+class BrushCache
+{
+public:
+	BrushCache();
+	~BrushCache();
+
+	BrushCache(const BrushCache& other) = delete;
+	BrushCache& operator=(BrushCache other) = delete;
+
+	struct Stats
+	{
+		UINT hits;		// Returned a cached brush
+		UINT creates;	// Created a brush
+		UINT clears;	// Released the resources of another device
+	};
+
+	// Must be called each time the render target is created. The cached resources are released if
+	// they cannot be used with |target|, i.e. if |target| belongs to another Direct2D device.
+	// Unlike bitmaps, brushes and gradient stop collections cannot be shared between devices.
+	void Validate(ID2D1RenderTarget* target);
+
+	void Clear();
+
+	// Incremented each time the cache is cleared. Brushes that are kept outside of the cache must
+	// be retrieved again when this changes.
+	UINT GetGeneration() const { return m_Generation; }
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	Microsoft::WRL::ComPtr<ID2D1Brush> GetSolidBrush(ID2D1RenderTarget* target, const D2D1_COLOR_F& color);
+
+	Microsoft::WRL::ComPtr<ID2D1Brush> GetLinearGradientBrush(ID2D1RenderTarget* target,
+		const D2D1_LINEAR_GRADIENT_BRUSH_PROPERTIES& properties,
+		const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma);
+
+	Microsoft::WRL::ComPtr<ID2D1Brush> GetRadialGradientBrush(ID2D1RenderTarget* target,
+		const D2D1_RADIAL_GRADIENT_BRUSH_PROPERTIES& properties,
+		const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma);
+
+private:
+	ID2D1GradientStopCollection* GetGradientStopCollection(ID2D1RenderTarget* target,
+		const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma, std::string& key);
+
+	void AddBrush(const std::string& key, const Microsoft::WRL::ComPtr<ID2D1Brush>& brush);
+
+	// The keys contain the raw bytes of the parameters.
+	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID2D1Brush>> m_Brushes;
+	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID2D1GradientStopCollection>> m_GradientStopCollections;
+
+	// Device of the render targets that the resources were created with.
+	Microsoft::WRL::ComPtr<ID2D1Device> m_Device;
+
+	UINT m_Generation;
+
+	Stats m_Stats;
+};
+
+}  // namespace Gfx
+
+#endif
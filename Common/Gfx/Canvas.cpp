@@ -14,6 +14,98 @@
 #include "Util/WICBitmapLockGDIP.h"
 #include "../../Library/Util.h"
 
+namespace {
+
+// Direct2D bitmap that shares the pixels of a GDI+ bitmap. The GDI+ bitmap is locked for the
+// lifetime of this object.
+class SharedBitmap
+{
+public:
+	SharedBitmap(ID2D1RenderTarget* target, Gdiplus::Bitmap* bitmap, const Gdiplus::Rect& rect) :
+		m_Bitmap(bitmap),
+		m_Lock(new Gfx::Util::WICBitmapLockGDIP()),
+		m_Locked(false)
+	{
+		Gdiplus::Rect lockRect(rect);
+		m_Locked = bitmap->LockBits(
+			&lockRect, Gdiplus::ImageLockModeRead, PixelFormat32bppPARGB, m_Lock->GetBitmapData()) == Gdiplus::Ok;
+		if (m_Locked)
+		{
+			D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
+				D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+			target->CreateSharedBitmap(
+				__uuidof(IWICBitmapLock), m_Lock, &props, m_D2DBitmap.GetAddressOf());
+		}
+	}
+
+	~SharedBitmap()
+	{
+		// D2D will still use the pixel data after this call (at the next Flush() or EndDraw()).
+		if (m_Locked)
+		{
+			m_Bitmap->UnlockBits(m_Lock->GetBitmapData());
+		}
+
+		m_Lock->Release();
+	}
+
+	SharedBitmap(const SharedBitmap& other) = delete;
+	SharedBitmap& operator=(SharedBitmap other) = delete;
+
+	ID2D1Bitmap* Get() { return m_D2DBitmap.Get(); }
+
+private:
+	Gdiplus::Bitmap* m_Bitmap;
+	Gfx::Util::WICBitmapLockGDIP* m_Lock;
+	bool m_Locked;
+	Microsoft::WRL::ComPtr<ID2D1Bitmap> m_D2DBitmap;
+};
+
+// Premultiplied pixels of a GDI+ bitmap for SoftwareCanvas. The GDI+ bitmap is locked for the
+// lifetime of this object.
+class LockedImage
+{
+public:
+	LockedImage(Gdiplus::Bitmap* bitmap) :
+		m_Bitmap(bitmap),
+		m_Locked(false)
+	{
+		Gdiplus::Rect lockRect(0, 0, bitmap->GetWidth(), bitmap->GetHeight());
+		m_Locked = bitmap->LockBits(
+			&lockRect, Gdiplus::ImageLockModeRead, PixelFormat32bppPARGB, &m_Data) == Gdiplus::Ok;
+	}
+
+	~LockedImage()
+	{
+		if (m_Locked)
+		{
+			m_Bitmap->UnlockBits(&m_Data);
+		}
+	}
+
+	LockedImage(const LockedImage& other) = delete;
+	LockedImage& operator=(LockedImage other) = delete;
+
+	bool IsLocked() const { return m_Locked; }
+
+	Gfx::SoftwareCanvas::Image Get() const
+	{
+		return { (const uint32_t*)m_Data.Scan0, (int)m_Data.Width, (int)m_Data.Height, m_Data.Stride / 4 };
+	}
+
+private:
+	Gdiplus::Bitmap* m_Bitmap;
+	Gdiplus::BitmapData m_Data;
+	bool m_Locked;
+};
+
+Gfx::SoftwareCanvas::Rect ToSoftwareRect(const Gdiplus::Rect& rect)
+{
+	return { rect.X, rect.Y, rect.Width, rect.Height };
+}
+
+}  // namespace
+
 namespace Gfx {
 
 UINT Canvas::c_Instances = 0;
@@ -23,9 +115,11 @@ Microsoft::WRL::ComPtr<IDWriteGdiInterop> Canvas::c_DWGDIInterop;
 Microsoft::WRL::ComPtr<IWICImagingFactory> Canvas::c_WICFactory;
 
 Canvas::Canvas() :
+	m_SoftwareRendering(false),
 	m_Bitmap(),
 	m_TextAntiAliasing(false),
-	m_CanUseAxisAlignClip(false)
+	m_CanUseAxisAlignClip(false),
+	m_HasClip(false)
 {
 	Initialize();
 }
@@ -103,6 +197,9 @@ void Canvas::Resize(int w, int h)
 
 	m_GdipBitmap.reset(new Gdiplus::Bitmap(w, h, w * 4, PixelFormat32bppPARGB, m_Bitmap.GetData()));
 	m_GdipGraphics.reset(new Gdiplus::Graphics(m_GdipBitmap.get()));
+	m_HasClip = false;
+
+	m_Software.Attach((uint32_t*)m_Bitmap.GetData(), w, h);
 }
 
 bool Canvas::BeginDraw()
@@ -142,8 +239,17 @@ bool Canvas::BeginTargetDraw()
 	{
 		SetTextAntiAliasing(m_TextAntiAliasing);
 
+		m_BrushCache.Validate(m_Target.Get());
+		m_BitmapCache.Validate(m_Target.Get());
+
 		m_Target->BeginDraw();
 
+		if (m_HasClip)
+		{
+			// The transform of a new target is the identity so the clip is in canvas coordinates.
+			m_Target->PushAxisAlignedClip(Util::ToRectF(m_Clip), D2D1_ANTIALIAS_MODE_ALIASED);
+		}
+
 		// Apply any transforms that occurred before creation of |m_Target|.
 		UpdateTargetTransform();
 
@@ -157,6 +263,11 @@ void Canvas::EndTargetDraw()
 {
 	if (m_Target)
 	{
+		if (m_HasClip)
+		{
+			m_Target->PopAxisAlignedClip();
+		}
+
 		m_Target->EndDraw();
 		m_Target.Reset();
 	}
@@ -216,6 +327,32 @@ void Canvas::UpdateTargetTransform()
 		d2dMatrix._31 == 0.0f && d2dMatrix._32 == 0.0f;
 }
 
+bool Canvas::BeginSoftwareDraw()
+{
+	if (!m_SoftwareRendering) return false;
+
+	// The software draws must follow the Direct2D draws made so far.
+	EndTargetDraw();
+
+	Gdiplus::Matrix gdipMatrix;
+	m_GdipGraphics->GetTransform(&gdipMatrix);
+
+	SoftwareCanvas::Transform transform;
+	gdipMatrix.GetElements((Gdiplus::REAL*)&transform);
+	m_Software.SetTransform(transform);
+
+	if (m_HasClip)
+	{
+		m_Software.SetClip(ToSoftwareRect(m_Clip));
+	}
+	else
+	{
+		m_Software.ResetClip();
+	}
+
+	return true;
+}
+
 void Canvas::SetTransform(const Gdiplus::Matrix& matrix)
 {
 	m_GdipGraphics->SetTransform(&matrix);
@@ -248,6 +385,30 @@ void Canvas::RotateTransform(float angle, float x, float y, float dx, float dy)
 	}
 }
 
+void Canvas::SetClip(const Gdiplus::Rect& rect)
+{
+	// The clip of |m_Target| can only be changed by recreating it.
+	EndTargetDraw();
+
+	Gdiplus::Matrix matrix;
+	m_GdipGraphics->GetTransform(&matrix);
+	m_GdipGraphics->ResetTransform();
+	m_GdipGraphics->SetClip(rect);
+	m_GdipGraphics->SetTransform(&matrix);
+
+	m_Clip = rect;
+	m_HasClip = true;
+}
+
+void Canvas::ResetClip()
+{
+	if (!m_HasClip) return;
+
+	EndTargetDraw();
+	m_GdipGraphics->ResetClip();
+	m_HasClip = false;
+}
+
 void Canvas::SetAntiAliasing(bool enable)
 {
 	// TODO: Set m_Target aliasing?
@@ -271,6 +432,12 @@ void Canvas::SetTextAntiAliasing(bool enable)
 
 void Canvas::Clear(const Gdiplus::Color& color)
 {
+	if (BeginSoftwareDraw())
+	{
+		m_Software.Clear(color.GetValue());
+		return;
+	}
+
 	if (!m_Target)  // Use GDI+ if D2D render target has not been created.
 	{
 		m_GdipGraphics->Clear(color);
@@ -423,8 +590,19 @@ bool Canvas::MeasureTextLinesW(const std::wstring& str, const TextFormat& format
 	return true;
 }
 
-void Canvas::DrawBitmap(Gdiplus::Bitmap* bitmap, const Gdiplus::Rect& dstRect, const Gdiplus::Rect& srcRect)
+void Canvas::DrawBitmap(Gdiplus::Bitmap* bitmap, const Gdiplus::Rect& dstRect, const Gdiplus::Rect& srcRect,
+	UINT generation)
 {
+	if (BeginSoftwareDraw())
+	{
+		LockedImage image(bitmap);
+		if (image.IsLocked())
+		{
+			m_Software.DrawBitmap(image.Get(), ToSoftwareRect(dstRect), ToSoftwareRect(srcRect));
+		}
+		return;
+	}
+
 	if (srcRect.Width != dstRect.Width || srcRect.Height != dstRect.Height)
 	{
 		// If the bitmap needs to be scaled, get rid of the D2D target and use the GDI+ code path
@@ -440,116 +618,129 @@ void Canvas::DrawBitmap(Gdiplus::Bitmap* bitmap, const Gdiplus::Rect& dstRect, c
 		return;
 	}
 
-	// The D2D DrawBitmap seems to perform exactly like Gdiplus::Graphics::DrawImage since we are
-	// not using a hardware accelerated render target. Nevertheless, we will use it to avoid
-	// the EndDraw() call needed for GDI+ drawing.
-	Util::WICBitmapLockGDIP* bitmapLock = new Util::WICBitmapLockGDIP();
-	Gdiplus::Rect lockRect(0, 0, bitmap->GetWidth(), bitmap->GetHeight());
-	Gdiplus::Status status = bitmap->LockBits(
-		&lockRect, Gdiplus::ImageLockModeRead, PixelFormat32bppPARGB, bitmapLock->GetBitmapData());
-	if (status == Gdiplus::Ok)
-	{
-		D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
-			D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
-		Microsoft::WRL::ComPtr<ID2D1Bitmap> d2dBitmap;
-		HRESULT hr = m_Target->CreateSharedBitmap(
-			__uuidof(IWICBitmapLock), bitmapLock, &props, d2dBitmap.GetAddressOf());
-		if (SUCCEEDED(hr))
+	auto rDst = Util::ToRectF(dstRect);
+	auto rSrc = Util::ToRectF(srcRect);
+
+	if (generation != 0)
+	{
+		auto d2dBitmap = m_BitmapCache.Get(m_Target.Get(), bitmap, generation);
+		if (d2dBitmap)
 		{
-			auto rDst = Util::ToRectF(dstRect);
-			auto rSrc = Util::ToRectF(srcRect);
 			m_Target->DrawBitmap(d2dBitmap.Get(), rDst, 1.0F, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, rSrc);
+			return;
 		}
-
-		// D2D will still use the pixel data after this call (at the next Flush() or EndDraw()).
-		bitmap->UnlockBits(bitmapLock->GetBitmapData());
 	}
 
-	bitmapLock->Release();
+	// The D2D DrawBitmap seems to perform exactly like Gdiplus::Graphics::DrawImage since we are
+	// not using a hardware accelerated render target. Nevertheless, we will use it to avoid
+	// the EndDraw() call needed for GDI+ drawing.
+	SharedBitmap shared(m_Target.Get(), bitmap, Gdiplus::Rect(0, 0, bitmap->GetWidth(), bitmap->GetHeight()));
+	if (shared.Get())
+	{
+		m_Target->DrawBitmap(shared.Get(), rDst, 1.0F, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, rSrc);
+	}
 }
 
 void Canvas::DrawMaskedBitmap(Gdiplus::Bitmap* bitmap, Gdiplus::Bitmap* maskBitmap, const Gdiplus::Rect& dstRect,
-	const Gdiplus::Rect& srcRect, const Gdiplus::Rect& srcRect2)
+	const Gdiplus::Rect& srcRect, const Gdiplus::Rect& srcRect2, UINT generation, UINT maskGeneration)
 {
+	if (BeginSoftwareDraw())
+	{
+		LockedImage image(bitmap);
+		LockedImage mask(maskBitmap);
+		if (image.IsLocked() && mask.IsLocked())
+		{
+			m_Software.DrawMaskedBitmap(image.Get(), mask.Get(), ToSoftwareRect(dstRect),
+				ToSoftwareRect(srcRect), ToSoftwareRect(srcRect2));
+		}
+		return;
+	}
+
 	if (!BeginTargetDraw()) return;
 
 	auto rDst = Util::ToRectF(dstRect);
 	auto rSrc = Util::ToRectF(srcRect);
 
-	Util::WICBitmapLockGDIP* bitmapLock = new Util::WICBitmapLockGDIP();
-	Gdiplus::Rect lockRect(srcRect2);
-	Gdiplus::Status status = bitmap->LockBits(
-		&lockRect, Gdiplus::ImageLockModeRead, PixelFormat32bppPARGB, bitmapLock->GetBitmapData());
-	if (status == Gdiplus::Ok)
-	{
-		D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
-			D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
-		Microsoft::WRL::ComPtr<ID2D1Bitmap> d2dBitmap;
-		HRESULT hr = m_Target->CreateSharedBitmap(
-			__uuidof(IWICBitmapLock), bitmapLock, &props, d2dBitmap.GetAddressOf());
-		if (SUCCEEDED(hr))
-		{
-			// Create bitmap brush from original |bitmap|.
-			Microsoft::WRL::ComPtr<ID2D1BitmapBrush> brush;
-			D2D1_BITMAP_BRUSH_PROPERTIES propertiesXClampYClamp = D2D1::BitmapBrushProperties(
-				D2D1_EXTEND_MODE_CLAMP,
-				D2D1_EXTEND_MODE_CLAMP,
-				D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
-
-			// "Move" and "scale" the |bitmap| to match the destination.
-			D2D1_MATRIX_3X2_F translate = D2D1::Matrix3x2F::Translation(rDst.left, rDst.top);
-			D2D1_MATRIX_3X2_F scale = D2D1::Matrix3x2F::Scale(
-				D2D1::SizeF((rDst.right - rDst.left) / (float)srcRect2.Width, (rDst.bottom - rDst.top) / (float)srcRect2.Height));
-			D2D1_BRUSH_PROPERTIES brushProps = D2D1::BrushProperties(1.0F, scale * translate);
-
-			hr = m_Target->CreateBitmapBrush(
-				d2dBitmap.Get(),
-				propertiesXClampYClamp,
-				brushProps,
-				brush.GetAddressOf());
-
-			// Load the |maskBitmap| and use the bitmap brush to "fill" its contents.
-			// Note: The image must be aliased when applying the opacity mask.
-			if (SUCCEEDED(hr))
-			{
-				Util::WICBitmapLockGDIP* maskBitmapLock = new Util::WICBitmapLockGDIP();
-				Gdiplus::Rect maskLockRect(0, 0, maskBitmap->GetWidth(), maskBitmap->GetHeight());
-				status = maskBitmap->LockBits(
-					&maskLockRect, Gdiplus::ImageLockModeRead, PixelFormat32bppPARGB, maskBitmapLock->GetBitmapData());
-				if (status == Gdiplus::Ok)
-				{
-					D2D1_BITMAP_PROPERTIES maskProps = D2D1::BitmapProperties(
-						D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
-					Microsoft::WRL::ComPtr<ID2D1Bitmap> d2dMaskBitmap;
-					hr = m_Target->CreateSharedBitmap(
-						__uuidof(IWICBitmapLock), maskBitmapLock, &props, d2dMaskBitmap.GetAddressOf());
-					if (SUCCEEDED(hr))
-					{
-						m_Target->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED); // required
-						m_Target->FillOpacityMask(
-							d2dMaskBitmap.Get(),
-							brush.Get(),
-							D2D1_OPACITY_MASK_CONTENT_GRAPHICS,
-							&rDst,
-							&rSrc);
-						m_Target->SetAntialiasMode(D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
-					}
-
-					maskBitmap->UnlockBits(bitmapLock->GetBitmapData());
-				}
-
-				maskBitmapLock->Release();
-			}
-		}
+	// Without a generation, only |srcRect2| of |bitmap| is shared with D2D. The device copy from
+	// the cache contains the whole bitmap, so it is moved to place |srcRect2| at the origin.
+	std::unique_ptr<SharedBitmap> shared;
+	Microsoft::WRL::ComPtr<ID2D1Bitmap> d2dBitmap;
+	D2D1_MATRIX_3X2_F origin = D2D1::Matrix3x2F::Identity();
+	if (generation != 0)
+	{
+		d2dBitmap = m_BitmapCache.Get(m_Target.Get(), bitmap, generation);
+		origin = D2D1::Matrix3x2F::Translation(-(FLOAT)srcRect2.X, -(FLOAT)srcRect2.Y);
+	}
+
+	if (!d2dBitmap)
+	{
+		shared.reset(new SharedBitmap(m_Target.Get(), bitmap, srcRect2));
+		d2dBitmap = shared->Get();
+		origin = D2D1::Matrix3x2F::Identity();
+	}
 
-		bitmap->UnlockBits(bitmapLock->GetBitmapData());
+	if (!d2dBitmap) return;
+
+	std::unique_ptr<SharedBitmap> sharedMask;
+	Microsoft::WRL::ComPtr<ID2D1Bitmap> d2dMaskBitmap;
+	if (maskGeneration != 0)
+	{
+		d2dMaskBitmap = m_BitmapCache.Get(m_Target.Get(), maskBitmap, maskGeneration);
 	}
 
-	bitmapLock->Release();
+	if (!d2dMaskBitmap)
+	{
+		sharedMask.reset(new SharedBitmap(
+			m_Target.Get(), maskBitmap, Gdiplus::Rect(0, 0, maskBitmap->GetWidth(), maskBitmap->GetHeight())));
+		d2dMaskBitmap = sharedMask->Get();
+	}
+
+	if (!d2dMaskBitmap) return;
+
+	// Create bitmap brush from original |bitmap|.
+	Microsoft::WRL::ComPtr<ID2D1BitmapBrush> brush;
+	D2D1_BITMAP_BRUSH_PROPERTIES propertiesXClampYClamp = D2D1::BitmapBrushProperties(
+		D2D1_EXTEND_MODE_CLAMP,
+		D2D1_EXTEND_MODE_CLAMP,
+		D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
+
+	// "Move" and "scale" the |bitmap| to match the destination.
+	D2D1_MATRIX_3X2_F translate = D2D1::Matrix3x2F::Translation(rDst.left, rDst.top);
+	D2D1_MATRIX_3X2_F scale = D2D1::Matrix3x2F::Scale(
+		D2D1::SizeF((rDst.right - rDst.left) / (float)srcRect2.Width, (rDst.bottom - rDst.top) / (float)srcRect2.Height));
+	D2D1_BRUSH_PROPERTIES brushProps = D2D1::BrushProperties(1.0F, origin * scale * translate);
+
+	HRESULT hr = m_Target->CreateBitmapBrush(
+		d2dBitmap.Get(),
+		propertiesXClampYClamp,
+		brushProps,
+		brush.GetAddressOf());
+
+	// Use the bitmap brush to "fill" the contents of |maskBitmap|.
+	// Note: The image must be aliased when applying the opacity mask.
+	if (SUCCEEDED(hr))
+	{
+		m_Target->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED); // required
+		m_Target->FillOpacityMask(
+			d2dMaskBitmap.Get(),
+			brush.Get(),
+			D2D1_OPACITY_MASK_CONTENT_GRAPHICS,
+			&rDst,
+			&rSrc);
+		m_Target->SetAntialiasMode(D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
+	}
 }
 
 void Canvas::FillRectangle(Gdiplus::Rect& rect, const Gdiplus::SolidBrush& brush)
 {
+	if (BeginSoftwareDraw())
+	{
+		Gdiplus::Color color;
+		brush.GetColor(&color);
+		m_Software.FillRectangle(ToSoftwareRect(rect), color.GetValue());
+		return;
+	}
+
 	if (!m_Target)  // Use GDI+ if D2D render target has not been created.
 	{
 		m_GdipGraphics->FillRectangle(&brush, rect);
@@ -569,6 +760,13 @@ void Canvas::FillRectangle(Gdiplus::Rect& rect, const Gdiplus::SolidBrush& brush
 
 void Canvas::DrawGeometry(Shape& shape, int xPos, int yPos)
 {
+	// Gradients and stroke styles are only drawn by Direct2D.
+	if (SoftwareCanvas::CanDrawGeometry(shape) && BeginSoftwareDraw())
+	{
+		m_Software.DrawGeometry(shape, xPos, yPos);
+		return;
+	}
+
 	if (!BeginTargetDraw()) return;
 
 	D2D1_MATRIX_3X2_F worldTransform;
@@ -581,18 +779,21 @@ void Canvas::DrawGeometry(Shape& shape, int xPos, int yPos)
 
 	if (shape.m_FillColor.a > 0.0f)
 	{
-		auto brush = shape.GetFillBrush(m_Target.Get());
-		m_Target->FillGeometry(shape.m_Shape.Get(), brush.Get());
+		auto brush = shape.GetFillBrush(m_Target.Get(), m_BrushCache);
+		if (brush) m_Target->FillGeometry(shape.m_Shape.Get(), brush.Get());
 	}
 
 	if (shape.m_StrokeColor.a > 0.0f && shape.m_StrokeWidth > 0.0f)
 	{
-		auto brush = shape.GetStrokeFillBrush(m_Target.Get());
-		m_Target->DrawGeometry(
-			shape.m_Shape.Get(),
-			brush.Get(),
-			shape.m_StrokeWidth,
-			shape.m_StrokeStyle.Get());
+		auto brush = shape.GetStrokeFillBrush(m_Target.Get(), m_BrushCache);
+		if (brush)
+		{
+			m_Target->DrawGeometry(
+				shape.m_Shape.Get(),
+				brush.Get(),
+				shape.m_StrokeWidth,
+				shape.m_StrokeStyle.Get());
+		}
 	}
 
 	m_Target->SetTransform(worldTransform);
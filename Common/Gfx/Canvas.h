@@ -8,8 +8,11 @@
 #ifndef RM_GFX_CANVAS_H_
 #define RM_GFX_CANVAS_H_
 
+#include "BitmapCache.h"
+#include "BrushCache.h"
 #include "FontCollectionD2D.h"
 #include "Shape.h"
+#include "SoftwareCanvas.h"
 #include "TextFormatD2D.h"
 #include "Util/WICBitmapDIB.h"
 #include <memory>
@@ -39,6 +42,11 @@ public:
 
 	void SetAccurateText(bool option) { m_AccurateText = option; }
 
+	// If |true|, Clear(), FillRectangle(), DrawBitmap(), DrawMaskedBitmap() and DrawGeometry()
+	// are drawn with SoftwareCanvas instead of Direct2D and GDI+. Text and the shapes that
+	// SoftwareCanvas::CanDrawGeometry() rejects are still drawn with DirectWrite and Direct2D.
+	void SetSoftwareRendering(bool option) { m_SoftwareRendering = option; }
+
 	// Resize the draw area of the Canvas. This function must not be called if BeginDraw() has been
 	// called and has not yet been matched by a correspoding call to EndDraw.
 	void Resize(int w, int h);
@@ -61,6 +69,11 @@ public:
 	void ResetTransform();
 	void RotateTransform(float angle, float x, float y, float dx, float dy);
 
+	// Restricts drawing (including Clear()) to |rect| in canvas coordinates until ResetClip() is
+	// called. The clip is not affected by the transformation.
+	void SetClip(const Gdiplus::Rect& rect);
+	void ResetClip();
+
 	void SetAntiAliasing(bool enable);
 	void SetTextAntiAliasing(bool enable);
 
@@ -71,9 +84,13 @@ public:
 	bool MeasureTextW(const std::wstring& srcStr, const TextFormat& format, Gdiplus::RectF& rect);
 	bool MeasureTextLinesW(const std::wstring& srcStr, const TextFormat& format, Gdiplus::RectF& rect, UINT& lines);
 
-	void DrawBitmap(Gdiplus::Bitmap* bitmap, const Gdiplus::Rect& dstRect, const Gdiplus::Rect& srcRect);
+	// If |generation| is not 0, |bitmap| is uploaded to the device once and then reused for as long
+	// as it is drawn with the same |generation| (see BitmapCache::Get()). Otherwise the pixels are
+	// shared with the device for the duration of the draw.
+	void DrawBitmap(Gdiplus::Bitmap* bitmap, const Gdiplus::Rect& dstRect, const Gdiplus::Rect& srcRect,
+		UINT generation = 0);
 	void DrawMaskedBitmap(Gdiplus::Bitmap* bitmap, Gdiplus::Bitmap* maskBitmap, const Gdiplus::Rect& dstRect,
-		const Gdiplus::Rect& srcRect, const Gdiplus::Rect& srcRect2);
+		const Gdiplus::Rect& srcRect, const Gdiplus::Rect& srcRect2, UINT generation = 0, UINT maskGeneration = 0);
 
 	void FillRectangle(Gdiplus::Rect& rect, const Gdiplus::SolidBrush& brush);
 
@@ -103,6 +120,10 @@ private:
 	// Sets the |m_Target| transformation to be equal to that of |m_GdipGraphics|.
 	void UpdateTargetTransform();
 
+	// Returns |false| if software rendering is disabled. Otherwise ends the Direct2D draws and sets
+	// the transformation and clip of |m_Software| to those of |m_GdipGraphics|.
+	bool BeginSoftwareDraw();
+
 	int m_W;
 	int m_H;
 
@@ -114,8 +135,19 @@ private:
 	// non-typographic GDI+.
 	bool m_AccurateText;
 
+	bool m_SoftwareRendering;
+
+	// Draws to the pixel data of m_Bitmap when |m_SoftwareRendering| is set.
+	SoftwareCanvas m_Software;
+
 	Microsoft::WRL::ComPtr<ID2D1RenderTarget> m_Target;
 
+	// Brushes of the shapes drawn with DrawGeometry().
+	BrushCache m_BrushCache;
+
+	// Device copies of the bitmaps drawn with DrawBitmap() and DrawMaskedBitmap().
+	BitmapCache m_BitmapCache;
+
 	// Underlying pixel data shared by both m_Target and m_GdipBitmap.
 	Util::WICBitmapDIB m_Bitmap;
 
@@ -128,6 +160,10 @@ private:
 	// |true| if PushAxisAlignedClip()/PopAxisAlignedClip() can be used.
 	bool m_CanUseAxisAlignClip;
 
+	// Set with SetClip(). Pushed onto |m_Target| each time it is created.
+	Gdiplus::Rect m_Clip;
+	bool m_HasClip;
+
 	static UINT c_Instances;
 	static Microsoft::WRL::ComPtr<ID2D1Factory1> c_D2DFactory;
 	static Microsoft::WRL::ComPtr<IDWriteFactory1> c_DWFactory;
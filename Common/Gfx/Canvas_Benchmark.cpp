@@ -0,0 +1,154 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "Canvas.h"
+#include "Shapes/Ellipse.h"
+#include "../Timer.h"
+#include "../UnitTest.h"
+#include <cmath>
+#include <cstdlib>
+
+namespace Gfx {
+
+// Draws the same meters through a Canvas with and without SetSoftwareRendering(). The platform
+// neutral part of the software backend is benchmarked by SoftwareCanvas_Portable.cpp.
+TEST_CLASS(Common_Gfx_Canvas_Benchmark)
+{
+public:
+	Common_Gfx_Canvas_Benchmark()
+	{
+		CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+		ULONG_PTR gdiplusToken;
+		Gdiplus::GdiplusStartupInput gdiplusStartupInput;
+		Gdiplus::GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, nullptr);
+	}
+
+	TEST_METHOD(BenchmarkDashboard)
+	{
+		const int width = 1920;
+		const int height = 1080;
+		const int frames = 100;
+
+		Gdiplus::Bitmap icon(64, 64, PixelFormat32bppPARGB);
+		for (int y = 0; y < 64; ++y)
+		{
+			for (int x = 0; x < 64; ++x)
+			{
+				icon.SetPixel(x, y, Gdiplus::Color((BYTE)(x * 4), 0, (BYTE)(y * 4), (BYTE)(255 - y * 4)));
+			}
+		}
+		const UINT iconGeneration = BitmapCache::NewGeneration();
+
+		Canvas target;
+		target.Resize(width, height);
+		Canvas software;
+		software.Resize(width, height);
+		software.SetSoftwareRendering(true);
+
+		// Shapes are created with the factory of the canvases.
+		Ellipse gauge(0.0f, 0.0f, 120.0f, 120.0f);
+		gauge.SetFill(Gdiplus::Color(192, 240, 128, 48));
+		gauge.SetStrokeFill(Gdiplus::Color(96, 255, 255, 255));
+		gauge.SetStrokeWidth(16.0f);
+
+		const double targetTime = DrawFrames(target, &icon, iconGeneration, gauge, frames);
+		const double softwareTime = DrawFrames(software, &icon, iconGeneration, gauge, frames);
+
+		// Opaque fills must match exactly. Antialiased edges and filtered images may differ.
+		int differences = 0;
+		HDC targetDC = target.GetDC();
+		HDC softwareDC = software.GetDC();
+		const DWORD* targetPixels = GetPixels(targetDC);
+		const DWORD* softwarePixels = GetPixels(softwareDC);
+		Assert::IsNotNull(targetPixels);
+		Assert::IsNotNull(softwarePixels);
+		Assert::AreEqual(targetPixels[10 * width + 10], softwarePixels[10 * width + 10]);
+		Assert::AreEqual(targetPixels[44 * width + 44], softwarePixels[44 * width + 44]);
+		for (int i = 0; i < width * height; ++i)
+		{
+			if (GetDifference(targetPixels[i], softwarePixels[i]) > 8) ++differences;
+		}
+		target.ReleaseDC(targetDC);
+		software.ReleaseDC(softwareDC);
+
+		WCHAR buffer[256];
+		_snwprintf_s(buffer, _TRUNCATE,
+			L"Canvas: %i frames of %ix%i. Direct2D: %.2f ms/frame, software: %.2f ms/frame (%.1fx). %.2f%% of the pixels differ.\n",
+			frames, width, height, targetTime / frames, softwareTime / frames, targetTime / softwareTime,
+			differences * 100.0 / (width * height));
+		Logger::WriteMessage(buffer);
+	}
+
+private:
+	// Draws like MeterBar, MeterHistogram, MeterImage and MeterShape. The rotation is applied like
+	// MeterString does for Angle.
+	static double DrawFrames(Canvas& canvas, Gdiplus::Bitmap* icon, UINT iconGeneration, Shape& gauge, int frames)
+	{
+		Gdiplus::SolidBrush barBack(Gdiplus::Color(64, 255, 255, 255));
+		Gdiplus::SolidBrush bar(Gdiplus::Color(255, 48, 128, 240));
+		Gdiplus::SolidBrush histogram(Gdiplus::Color(192, 96, 224, 96));
+		const Gdiplus::Rect iconRect(0, 0, 64, 64);
+
+		Timer timer;
+		timer.Start();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			canvas.BeginDraw();
+			canvas.Clear(Gdiplus::Color(255, 32, 32, 32));
+
+			for (int i = 0; i < 16; ++i)
+			{
+				Gdiplus::Rect backRect(40, 40 + i * 24, 400, 16);
+				canvas.FillRectangle(backRect, barBack);
+				Gdiplus::Rect barRect(40, 40 + i * 24, (frame * 7 + i * 37) % 400, 16);
+				canvas.FillRectangle(barRect, bar);
+			}
+
+			for (int x = 0; x < 800; ++x)
+			{
+				const int value = (int)(100.0 + 90.0 * std::sin((x + frame * 4) * 0.05));
+				Gdiplus::Rect histogramRect(520 + x, 440 - value, 1, value);
+				canvas.FillRectangle(histogramRect, histogram);
+			}
+
+			for (int i = 0; i < 8; ++i)
+			{
+				canvas.DrawBitmap(icon, Gdiplus::Rect(40 + i * 72, 500, 64, 64), iconRect, iconGeneration);
+				canvas.DrawBitmap(icon, Gdiplus::Rect(40 + i * 72, 600, 48, 48), iconRect, iconGeneration);
+			}
+
+			canvas.RotateTransform(frame * 3.6f, 1200.0f, 800.0f, -1200.0f, -800.0f);
+			canvas.DrawBitmap(icon, Gdiplus::Rect(1104, 704, 192, 192), iconRect, iconGeneration);
+			canvas.ResetTransform();
+
+			canvas.DrawGeometry(gauge, 1600, 300);
+			canvas.EndDraw();
+		}
+		timer.Stop();
+		return timer.GetElapsed();
+	}
+
+	static const DWORD* GetPixels(HDC dc)
+	{
+		DIBSECTION dib = {};
+		GetObject(GetCurrentObject(dc, OBJ_BITMAP), sizeof(dib), &dib);
+		return (const DWORD*)dib.dsBm.bmBits;
+	}
+
+	static int GetDifference(DWORD pixel1, DWORD pixel2)
+	{
+		int difference = 0;
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			difference = max(difference, abs((int)((pixel1 >> shift) & 0xFF) - (int)((pixel2 >> shift) & 0xFF)));
+		}
+		return difference;
+	}
+};
+
+}  // namespace Gfx
@@ -7,6 +7,7 @@
 
 #include "StdAfx.h"
 #include "Shape.h"
+#include "BrushCache.h"
 #include "Canvas.h"
 #include "Gfx/Util/D2DUtil.h"
 
@@ -44,7 +45,8 @@ Shape::Shape(ShapeType type) :
 	m_StrokeRadialGradientCenter(D2D1::Point2F(0.0f, 0.0f)),
 	m_StrokeRadialGradientRadius(D2D1::Point2F(0.0f, 0.0f)),
 	m_StrokeGradientAltGamma(false),
-	m_HasStrokeBrushChanged(true)
+	m_HasStrokeBrushChanged(true),
+	m_BrushGeneration(0U)
 {
 	// Make sure the stroke width is exact, not altered by other
 	// transforms like Scale or Rotation
@@ -315,33 +317,24 @@ void Shape::SetStrokeFill(D2D1_POINT_2F offset, D2D1_POINT_2F center, D2D1_POINT
 	m_HasStrokeBrushChanged = true;
 }
 
-Microsoft::WRL::ComPtr<ID2D1Brush> Shape::GetFillBrush(ID2D1RenderTarget* target)
+Microsoft::WRL::ComPtr<ID2D1Brush> Shape::GetFillBrush(ID2D1RenderTarget* target, BrushCache& cache)
 {
 	// If the brush hasn't changed, return current fill brush
+	ValidateBrushes(cache);
 	if (!m_HasFillBrushChanged) return m_FillBrush;
 
 	switch (m_FillBrushType)
 	{
 	case BrushType::Solid:
-		{
-			CreateSolidBrush(target, m_FillBrush, m_FillColor);
-		}
+		m_FillBrush = cache.GetSolidBrush(target, m_FillColor);
 		break;
 
 	case BrushType::LinearGradient:
-		{
-			auto collection = CreateGradientStopCollection(target, m_FillGradientStops, m_FillGradientAltGamma);
-			CreateLinearGradient(target, collection, m_FillBrush, m_FillLinearGradientAngle);
-			if (collection) collection->Release();
-		}
+		m_FillBrush = CreateLinearGradient(target, cache, m_FillGradientStops, m_FillGradientAltGamma, m_FillLinearGradientAngle);
 		break;
 
 	case BrushType::RadialGradient:
-		{
-			auto collection = CreateGradientStopCollection(target, m_FillGradientStops, m_FillGradientAltGamma);
-			CreateRadialGradient(target, collection, m_FillBrush, false);
-			if (collection) collection->Release();
-		}
+		m_FillBrush = CreateRadialGradient(target, cache, m_FillGradientStops, m_FillGradientAltGamma, false);
 		break;
 
 	default:
@@ -352,33 +345,24 @@ Microsoft::WRL::ComPtr<ID2D1Brush> Shape::GetFillBrush(ID2D1RenderTarget* target
 	return m_FillBrush;
 }
 
-Microsoft::WRL::ComPtr<ID2D1Brush> Shape::GetStrokeFillBrush(ID2D1RenderTarget* target)
+Microsoft::WRL::ComPtr<ID2D1Brush> Shape::GetStrokeFillBrush(ID2D1RenderTarget* target, BrushCache& cache)
 {
 	// If the brush hasn't changed, return current stroke brush
+	ValidateBrushes(cache);
 	if (!m_HasStrokeBrushChanged) return m_StrokeBrush;
 
 	switch (m_StrokeBrushType)
 	{
 	case BrushType::Solid:
-		{
-			CreateSolidBrush(target, m_StrokeBrush, m_StrokeColor);
-		}
+		m_StrokeBrush = cache.GetSolidBrush(target, m_StrokeColor);
 		break;
 
 	case BrushType::LinearGradient:
-		{
-			auto collection = CreateGradientStopCollection(target, m_StrokeGradientStops, m_StrokeGradientAltGamma);
-			CreateLinearGradient(target, collection, m_StrokeBrush, m_StrokeLinearGradientAngle);
-			if (collection) collection->Release();
-		}
+		m_StrokeBrush = CreateLinearGradient(target, cache, m_StrokeGradientStops, m_StrokeGradientAltGamma, m_StrokeLinearGradientAngle);
 		break;
 
 	case BrushType::RadialGradient:
-		{
-			auto collection = CreateGradientStopCollection(target, m_StrokeGradientStops, m_StrokeGradientAltGamma);
-			CreateRadialGradient(target, collection, m_StrokeBrush, true);
-			if (collection) collection->Release();
-		}
+		m_StrokeBrush = CreateRadialGradient(target, cache, m_StrokeGradientStops, m_StrokeGradientAltGamma, true);
 		break;
 
 	default:
@@ -389,34 +373,18 @@ Microsoft::WRL::ComPtr<ID2D1Brush> Shape::GetStrokeFillBrush(ID2D1RenderTarget*
 	return m_StrokeBrush;
 }
 
-ID2D1GradientStopCollection* Shape::CreateGradientStopCollection(ID2D1RenderTarget* target,
-	std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma)
-{
-	if (stops.empty()) return nullptr;
-
-	ID2D1GradientStopCollection* collection;
-	HRESULT hr = target->CreateGradientStopCollection(
-		&stops[0],
-		(UINT32)stops.size(),
-		altGamma ? D2D1_GAMMA_1_0 : D2D1_GAMMA_2_2,
-		D2D1_EXTEND_MODE_CLAMP,
-		&collection);
-	if (FAILED(hr)) return nullptr;
-
-	return collection;
-}
-
-void Shape::CreateSolidBrush(ID2D1RenderTarget* target, Microsoft::WRL::ComPtr<ID2D1Brush>& brush,
-	const D2D1_COLOR_F& color)
+void Shape::ValidateBrushes(const BrushCache& cache)
 {
-	Microsoft::WRL::ComPtr<ID2D1SolidColorBrush> solid;
-	HRESULT hr = target->CreateSolidColorBrush(color, solid.GetAddressOf());
-
-	if (SUCCEEDED(hr)) solid.CopyTo(brush.ReleaseAndGetAddressOf());
+	if (m_BrushGeneration != cache.GetGeneration())
+	{
+		m_BrushGeneration = cache.GetGeneration();
+		m_HasFillBrushChanged = true;
+		m_HasStrokeBrushChanged = true;
+	}
 }
 
-void Shape::CreateLinearGradient(ID2D1RenderTarget* target, ID2D1GradientStopCollection* collection,
-	Microsoft::WRL::ComPtr<ID2D1Brush>& brush, const FLOAT angle)
+Microsoft::WRL::ComPtr<ID2D1Brush> Shape::CreateLinearGradient(ID2D1RenderTarget* target, BrushCache& cache,
+	const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma, const FLOAT angle)
 {
 	auto bounds = GetBounds(false);
 	D2D1_POINT_2F start = Util::FindEdgePoint(angle,
@@ -424,17 +392,15 @@ void Shape::CreateLinearGradient(ID2D1RenderTarget* target, ID2D1GradientStopCol
 	D2D1_POINT_2F end = Util::FindEdgePoint(angle + 180.0f,
 		bounds.left, bounds.top, bounds.right - bounds.left, bounds.bottom - bounds.top);
 
-	Microsoft::WRL::ComPtr<ID2D1LinearGradientBrush> linear;
-	HRESULT hr = target->CreateLinearGradientBrush(
+	return cache.GetLinearGradientBrush(
+		target,
 		D2D1::LinearGradientBrushProperties(start, end),
-		collection,
-		linear.GetAddressOf());
-
-	if (SUCCEEDED(hr)) linear.CopyTo(brush.ReleaseAndGetAddressOf());
+		stops,
+		altGamma);
 }
 
-void Shape::CreateRadialGradient(ID2D1RenderTarget* target, ID2D1GradientStopCollection* collection,
-	Microsoft::WRL::ComPtr<ID2D1Brush>& brush, bool isStroke)
+Microsoft::WRL::ComPtr<ID2D1Brush> Shape::CreateRadialGradient(ID2D1RenderTarget* target, BrushCache& cache,
+	const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma, bool isStroke)
 {
 	auto swapIfNotDefined = [](D2D1_POINT_2F& pt1, const D2D1_POINT_2F pt2) -> void
 	{
@@ -454,17 +420,15 @@ void Shape::CreateRadialGradient(ID2D1RenderTarget* target, ID2D1GradientStopCol
 	swapIfNotDefined(offset, isStroke ? m_StrokeRadialGradientOffset : m_FillRadialGradientOffset);
 	swapIfNotDefined(radius, isStroke ? m_StrokeRadialGradientRadius : m_FillRadialGradientRadius);
 
-	Microsoft::WRL::ComPtr<ID2D1RadialGradientBrush> radial;
-	HRESULT hr = target->CreateRadialGradientBrush(
+	return cache.GetRadialGradientBrush(
+		target,
 		D2D1::RadialGradientBrushProperties(
 			center,
 			offset,
 			radius.x,
 			radius.y),
-		collection,
-		radial.GetAddressOf());
-
-	if (SUCCEEDED(hr)) radial.CopyTo(brush.ReleaseAndGetAddressOf());
+		stops,
+		altGamma);
 }
 
 bool Shape::AddToTransformOrder(TransformType type)
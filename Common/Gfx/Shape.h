@@ -16,6 +16,7 @@
 
 namespace Gfx {
 
+class BrushCache;
 class Canvas;
 
 enum class ShapeType : BYTE
@@ -69,7 +70,7 @@ public:
 	bool ContainsPoint(D2D1_POINT_2F point, const Gdiplus::Matrix* transformationMatrix);
 
 	bool IsCombined() { return m_IsCombined; }
-	void SetCombined() { m_IsCombined = true; }
+	void SetCombined(bool combined = true) { m_IsCombined = combined; }
 	bool CombineWith(Shape* otherShape, D2D1_COMBINE_MODE mode);
 
 	void SetOffset(FLOAT x, FLOAT y) { m_Offset = D2D1::SizeF(x, y); }
@@ -90,12 +91,12 @@ public:
 	void SetFill(Gdiplus::Color color);
 	void SetFill(FLOAT angle, std::vector<D2D1_GRADIENT_STOP> stops, bool altGamma);
 	void SetFill(D2D1_POINT_2F offset, D2D1_POINT_2F center, D2D1_POINT_2F radius, std::vector<D2D1_GRADIENT_STOP> stops, bool altGamma);
-	Microsoft::WRL::ComPtr<ID2D1Brush> GetFillBrush(ID2D1RenderTarget* target);
+	Microsoft::WRL::ComPtr<ID2D1Brush> GetFillBrush(ID2D1RenderTarget* target, BrushCache& cache);
 
 	void SetStrokeFill(Gdiplus::Color color);
 	void SetStrokeFill(FLOAT angle, std::vector<D2D1_GRADIENT_STOP> stops, bool altGamma);
 	void SetStrokeFill(D2D1_POINT_2F offset, D2D1_POINT_2F center, D2D1_POINT_2F radius, std::vector<D2D1_GRADIENT_STOP> stops, bool altGamma);
-	Microsoft::WRL::ComPtr<ID2D1Brush> GetStrokeFillBrush(ID2D1RenderTarget* target);
+	Microsoft::WRL::ComPtr<ID2D1Brush> GetStrokeFillBrush(ID2D1RenderTarget* target, BrushCache& cache);
 
 	void ResetTransformOrder() { m_TransformOrder.clear(); }
 	bool AddToTransformOrder(TransformType type);
@@ -108,14 +109,15 @@ protected:
 
 private:
 	friend class Canvas;
+	friend class SoftwareCanvas;
 
-	void CreateSolidBrush(ID2D1RenderTarget* target, Microsoft::WRL::ComPtr<ID2D1Brush>& brush, const D2D1_COLOR_F& color);
-	ID2D1GradientStopCollection* CreateGradientStopCollection(
-		ID2D1RenderTarget* target, std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma);
-	void CreateLinearGradient(ID2D1RenderTarget* target, ID2D1GradientStopCollection* collection,
-		Microsoft::WRL::ComPtr<ID2D1Brush>& brush, const FLOAT angle);
-	void CreateRadialGradient(ID2D1RenderTarget* target, ID2D1GradientStopCollection* collection,
-		Microsoft::WRL::ComPtr<ID2D1Brush>& brush, bool isStroke);
+	// Marks the brushes as changed if they were retrieved before |cache| was last cleared.
+	void ValidateBrushes(const BrushCache& cache);
+
+	Microsoft::WRL::ComPtr<ID2D1Brush> CreateLinearGradient(ID2D1RenderTarget* target, BrushCache& cache,
+		const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma, const FLOAT angle);
+	Microsoft::WRL::ComPtr<ID2D1Brush> CreateRadialGradient(ID2D1RenderTarget* target, BrushCache& cache,
+		const std::vector<D2D1_GRADIENT_STOP>& stops, bool altGamma, bool isStroke);
 
 	ShapeType m_ShapeType;
 	bool m_IsCombined;
@@ -165,6 +167,9 @@ private:
 	bool m_StrokeGradientAltGamma;
 	Microsoft::WRL::ComPtr<ID2D1Brush> m_StrokeBrush;
 	bool m_HasStrokeBrushChanged;
+
+	// BrushCache::GetGeneration() when the brushes were last retrieved.
+	UINT m_BrushGeneration;
 };
 
 } // Gfx
@@ -0,0 +1,874 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+// This file does not use the precompiled header so that it can be built on other platforms.
+
+#include "SoftwareCanvas.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#include <d2d1_1.h>
+#include <d2d1_1helper.h>
+#include "Shape.h"
+#endif
+
+namespace Gfx {
+
+namespace {
+
+uint32_t Premultiply(uint32_t color)
+{
+	const uint32_t a = color >> 24;
+	if (a == 255) return color;
+
+	const uint32_t r = (((color >> 16) & 0xFF) * a + 127) / 255;
+	const uint32_t g = (((color >> 8) & 0xFF) * a + 127) / 255;
+	const uint32_t b = ((color & 0xFF) * a + 127) / 255;
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Multiplies all four channels of |color| by |scale| / 255. Two channels are processed at once
+// in the 0x00FF00FF lanes.
+inline uint32_t ScaleColor(uint32_t color, uint32_t scale)
+{
+	uint32_t rb = (color & 0x00FF00FF) * scale;
+	uint32_t ag = ((color >> 8) & 0x00FF00FF) * scale;
+	rb = ((rb + ((rb >> 8) & 0x00FF00FF) + 0x00800080) >> 8) & 0x00FF00FF;
+	ag = (ag + ((ag >> 8) & 0x00FF00FF) + 0x00800080) & 0xFF00FF00;
+	return rb | ag;
+}
+
+// Source-over blending of premultiplied colors.
+inline uint32_t Blend(uint32_t dst, uint32_t src)
+{
+	return src + ScaleColor(dst, 255 - (src >> 24));
+}
+
+// Interpolates between |a| and |b| with |weight| in [0, 256].
+inline uint32_t Lerp(uint32_t a, uint32_t b, uint32_t weight)
+{
+	const uint32_t rb = (((a & 0x00FF00FF) * (256 - weight) + (b & 0x00FF00FF) * weight) >> 8) & 0x00FF00FF;
+	const uint32_t ag = (((a >> 8) & 0x00FF00FF) * (256 - weight) + ((b >> 8) & 0x00FF00FF) * weight) & 0xFF00FF00;
+	return rb | ag;
+}
+
+void BlendSpan(uint32_t* dst, int count, uint32_t color)
+{
+	if ((color >> 24) == 255)
+	{
+		std::fill(dst, dst + count, color);
+	}
+	else if (color != 0)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			dst[i] = Blend(dst[i], color);
+		}
+	}
+}
+
+bool Intersect(SoftwareCanvas::Rect& rect, const SoftwareCanvas::Rect& other)
+{
+	const int left = std::max(rect.x, other.x);
+	const int top = std::max(rect.y, other.y);
+	const int right = std::min(rect.x + rect.w, other.x + other.w);
+	const int bottom = std::min(rect.y + rect.h, other.y + other.h);
+	rect = { left, top, std::max(right - left, 0), std::max(bottom - top, 0) };
+	return rect.w > 0 && rect.h > 0;
+}
+
+// Returns the bilinearly filtered color at (|u|, |v|) with the samples clamped to |rect|.
+uint32_t Sample(const SoftwareCanvas::Image& image, const SoftwareCanvas::Rect& rect, float u, float v)
+{
+	u -= 0.5f;
+	v -= 0.5f;
+	const float uFloor = std::floor(u);
+	const float vFloor = std::floor(v);
+	const uint32_t wu = (uint32_t)((u - uFloor) * 256.0f);
+	const uint32_t wv = (uint32_t)((v - vFloor) * 256.0f);
+
+	const int right = rect.x + rect.w - 1;
+	const int bottom = rect.y + rect.h - 1;
+	const int x0 = std::min(std::max((int)uFloor, rect.x), right);
+	const int x1 = std::min(std::max((int)uFloor + 1, rect.x), right);
+	const int y0 = std::min(std::max((int)vFloor, rect.y), bottom);
+	const int y1 = std::min(std::max((int)vFloor + 1, rect.y), bottom);
+
+	const uint32_t* row0 = image.pixels + y0 * image.stride;
+	const uint32_t* row1 = image.pixels + y1 * image.stride;
+	return Lerp(Lerp(row0[x0], row0[x1], wu), Lerp(row1[x0], row1[x1], wu), wv);
+}
+
+}  // namespace
+
+SoftwareCanvas::Transform SoftwareCanvas::Transform::Rotation(float angle, float x, float y)
+{
+	const float radians = angle * 3.14159265358979f / 180.0f;
+	const float cosine = std::cos(radians);
+	const float sine = std::sin(radians);
+	const Transform rotation = { cosine, sine, -sine, cosine, 0.0f, 0.0f };
+	return Translation(-x, -y).Then(rotation).Then(Translation(x, y));
+}
+
+SoftwareCanvas::Transform SoftwareCanvas::Transform::Then(const Transform& other) const
+{
+	return {
+		m11 * other.m11 + m12 * other.m21,
+		m11 * other.m12 + m12 * other.m22,
+		m21 * other.m11 + m22 * other.m21,
+		m21 * other.m12 + m22 * other.m22,
+		dx * other.m11 + dy * other.m21 + other.dx,
+		dx * other.m12 + dy * other.m22 + other.dy
+	};
+}
+
+bool SoftwareCanvas::Transform::Invert(Transform& inverse) const
+{
+	const float det = m11 * m22 - m12 * m21;
+	if (det == 0.0f) return false;
+
+	inverse = {
+		m22 / det,
+		-m12 / det,
+		-m21 / det,
+		m11 / det,
+		(m21 * dy - m22 * dx) / det,
+		(m12 * dx - m11 * dy) / det
+	};
+	return true;
+}
+
+SoftwareCanvas::SoftwareCanvas() :
+	m_W(0),
+	m_H(0),
+	m_Data(),
+	m_Transform(Transform::Identity()),
+	m_Clip(),
+	m_CoverageStride(0)
+{
+}
+
+SoftwareCanvas::~SoftwareCanvas()
+{
+}
+
+void SoftwareCanvas::Resize(int w, int h)
+{
+	m_W = std::max(w, 0);
+	m_H = std::max(h, 0);
+	m_Pixels.assign((size_t)m_W * m_H, 0);
+	m_Data = m_Pixels.data();
+	ResetClip();
+}
+
+void SoftwareCanvas::Attach(uint32_t* pixels, int w, int h)
+{
+	m_W = pixels ? std::max(w, 0) : 0;
+	m_H = pixels ? std::max(h, 0) : 0;
+	m_Pixels.clear();
+	m_Data = pixels;
+	ResetClip();
+}
+
+void SoftwareCanvas::SetClip(const Rect& rect)
+{
+	m_Clip = rect;
+	Intersect(m_Clip, { 0, 0, m_W, m_H });
+}
+
+void SoftwareCanvas::ResetClip()
+{
+	m_Clip = { 0, 0, m_W, m_H };
+}
+
+void SoftwareCanvas::Clear(uint32_t color)
+{
+	color = Premultiply(color);
+	for (int y = m_Clip.y; y < m_Clip.y + m_Clip.h; ++y)
+	{
+		uint32_t* row = &m_Data[y * m_W + m_Clip.x];
+		std::fill(row, row + m_Clip.w, color);
+	}
+}
+
+void SoftwareCanvas::FillRectangle(const Rect& rect, uint32_t color)
+{
+	if (rect.w <= 0 || rect.h <= 0) return;
+
+	if (m_Transform.IsTranslation() &&
+		m_Transform.dx == std::floor(m_Transform.dx) && m_Transform.dy == std::floor(m_Transform.dy))
+	{
+		Rect r = { rect.x + (int)m_Transform.dx, rect.y + (int)m_Transform.dy, rect.w, rect.h };
+		if (!Intersect(r, m_Clip)) return;
+
+		color = Premultiply(color);
+		for (int y = r.y; y < r.y + r.h; ++y)
+		{
+			BlendSpan(&m_Data[y * m_W + r.x], r.w, color);
+		}
+		return;
+	}
+
+	const float left = (float)rect.x;
+	const float top = (float)rect.y;
+	const float right = (float)(rect.x + rect.w);
+	const float bottom = (float)(rect.y + rect.h);
+	const std::vector<Figure> figures(1, Figure{ { { left, top }, { right, top }, { right, bottom }, { left, bottom } }, true });
+	FillFigures(figures, FillRule::NonZero, color);
+}
+
+void SoftwareCanvas::DrawBitmap(const Image& image, const Rect& dstRect, const Rect& srcRect)
+{
+	DrawImage(image, dstRect, srcRect, nullptr, nullptr);
+}
+
+void SoftwareCanvas::DrawMaskedBitmap(const Image& image, const Image& mask, const Rect& dstRect,
+	const Rect& srcRect, const Rect& srcRect2)
+{
+	DrawImage(image, dstRect, srcRect2, &mask, &srcRect);
+}
+
+void SoftwareCanvas::DrawImage(const Image& image, const Rect& dstRect, const Rect& srcRect,
+	const Image* mask, const Rect* maskRect)
+{
+	Rect src = srcRect;
+	if (dstRect.w <= 0 || dstRect.h <= 0 ||
+		!Intersect(src, { 0, 0, image.width, image.height }) ||
+		src.w != srcRect.w || src.h != srcRect.h)
+	{
+		return;
+	}
+
+	Rect bounds;
+	if (!GetDeviceBounds((float)dstRect.x, (float)dstRect.y,
+		(float)(dstRect.x + dstRect.w), (float)(dstRect.y + dstRect.h), bounds))
+	{
+		return;
+	}
+
+	// Maps |rect| of an image to |dstRect| on the canvas.
+	auto getImageTransform = [&](const Rect& rect)
+	{
+		return Transform::Translation((float)-rect.x, (float)-rect.y)
+			.Then(Transform::Scale((float)dstRect.w / rect.w, (float)dstRect.h / rect.h))
+			.Then(Transform::Translation((float)dstRect.x, (float)dstRect.y))
+			.Then(m_Transform);
+	};
+
+	const Transform transform = getImageTransform(src);
+
+	if (!mask && transform.IsTranslation() &&
+		transform.dx == std::floor(transform.dx) && transform.dy == std::floor(transform.dy))
+	{
+		// Copy the pixels without filtering.
+		const int offsetX = (int)transform.dx;
+		const int offsetY = (int)transform.dy;
+		for (int y = bounds.y; y < bounds.y + bounds.h; ++y)
+		{
+			const uint32_t* srcRow = image.pixels + (y - offsetY) * image.stride - offsetX;
+			uint32_t* dstRow = &m_Data[y * m_W];
+			for (int x = bounds.x; x < bounds.x + bounds.w; ++x)
+			{
+				const uint32_t color = srcRow[x];
+				const uint32_t alpha = color >> 24;
+				if (alpha == 255)
+				{
+					dstRow[x] = color;
+				}
+				else if (alpha != 0)
+				{
+					dstRow[x] = Blend(dstRow[x], color);
+				}
+			}
+		}
+		return;
+	}
+
+	Transform inverse;
+	if (!transform.Invert(inverse)) return;
+
+	Transform maskInverse = Transform::Identity();
+	if (mask)
+	{
+		Rect maskSrc = *maskRect;
+		if (!Intersect(maskSrc, { 0, 0, mask->width, mask->height }) ||
+			maskSrc.w != maskRect->w || maskSrc.h != maskRect->h ||
+			!getImageTransform(maskSrc).Invert(maskInverse))
+		{
+			return;
+		}
+	}
+
+	const float right = (float)(src.x + src.w);
+	const float bottom = (float)(src.y + src.h);
+	for (int y = bounds.y; y < bounds.y + bounds.h; ++y)
+	{
+		// Map the center of the first pixel of the row to the image and step along the row.
+		const float px = bounds.x + 0.5f;
+		const float py = y + 0.5f;
+		float u = px * inverse.m11 + py * inverse.m21 + inverse.dx;
+		float v = px * inverse.m12 + py * inverse.m22 + inverse.dy;
+		float mu = px * maskInverse.m11 + py * maskInverse.m21 + maskInverse.dx;
+		float mv = px * maskInverse.m12 + py * maskInverse.m22 + maskInverse.dy;
+
+		uint32_t* dstRow = &m_Data[y * m_W];
+		for (int x = bounds.x; x < bounds.x + bounds.w; ++x)
+		{
+			if (u >= src.x && u < right && v >= src.y && v < bottom)
+			{
+				uint32_t color = Sample(image, src, u, v);
+				if (mask)
+				{
+					color = ScaleColor(color, Sample(*mask, *maskRect, mu, mv) >> 24);
+				}
+
+				if (color != 0)
+				{
+					dstRow[x] = Blend(dstRow[x], color);
+				}
+			}
+
+			u += inverse.m11;
+			v += inverse.m12;
+			mu += maskInverse.m11;
+			mv += maskInverse.m12;
+		}
+	}
+}
+
+void SoftwareCanvas::FillFigures(const std::vector<Figure>& figures, FillRule rule, uint32_t color)
+{
+	std::vector<Edge> edges;
+	for (const auto& figure : figures)
+	{
+		const size_t count = figure.points.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Point& p0 = figure.points[i];
+			const Point& p1 = figure.points[(i + 1) % count];
+			edges.push_back({ Map(p0.x, p0.y), Map(p1.x, p1.y) });
+		}
+	}
+
+	FillEdges(edges, rule, color);
+}
+
+void SoftwareCanvas::StrokeFigures(const std::vector<Figure>& figures, float width, uint32_t color,
+	LineJoin join, float miterLimit)
+{
+	if (width <= 0.0f) return;
+
+	// The stroke is the union of a quad for each segment and two triangles for each join. The
+	// polygons are all given the same orientation so that they do not cancel each other out.
+	std::vector<Edge> edges;
+	auto addPolygon = [&](const Point* points, int count)
+	{
+		float area = 0.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			const Point& p0 = points[i];
+			const Point& p1 = points[(i + 1) % count];
+			area += p0.x * p1.y - p1.x * p0.y;
+		}
+
+		if (area == 0.0f) return;
+
+		for (int i = 0; i < count; ++i)
+		{
+			const Point& p0 = points[i];
+			const Point& p1 = points[(i + 1) % count];
+			if (area < 0.0f)
+			{
+				edges.push_back({ Map(p0.x, p0.y), Map(p1.x, p1.y) });
+			}
+			else
+			{
+				edges.push_back({ Map(p1.x, p1.y), Map(p0.x, p0.y) });
+			}
+		}
+	};
+
+	const float halfWidth = width / 2.0f;
+	struct Segment
+	{
+		Point p0, p1;
+		Point normal;
+	};
+	std::vector<Segment> segments;
+
+	for (const auto& figure : figures)
+	{
+		segments.clear();
+
+		const size_t count = figure.points.size();
+		const size_t segmentCount = figure.closed ? count : count - 1;
+		for (size_t i = 0; count > 1 && i < segmentCount; ++i)
+		{
+			const Point& p0 = figure.points[i];
+			const Point& p1 = figure.points[(i + 1) % count];
+			const float dx = p1.x - p0.x;
+			const float dy = p1.y - p0.y;
+			const float length = std::sqrt(dx * dx + dy * dy);
+			if (length == 0.0f) continue;
+
+			const Point normal = { -dy / length * halfWidth, dx / length * halfWidth };
+			segments.push_back({ p0, p1, normal });
+
+			const Point quad[] =
+			{
+				{ p0.x + normal.x, p0.y + normal.y },
+				{ p1.x + normal.x, p1.y + normal.y },
+				{ p1.x - normal.x, p1.y - normal.y },
+				{ p0.x - normal.x, p0.y - normal.y }
+			};
+			addPolygon(quad, 4);
+		}
+
+		for (size_t i = 0; i < segments.size(); ++i)
+		{
+			if (i + 1 == segments.size() && !figure.closed) break;
+
+			const Segment& s0 = segments[i];
+			const Segment& s1 = segments[(i + 1) % segments.size()];
+			const Point& p = s0.p1;
+			const Point outer[] =
+			{
+				p,
+				{ p.x + s0.normal.x, p.y + s0.normal.y },
+				{ p.x + s1.normal.x, p.y + s1.normal.y }
+			};
+			addPolygon(outer, 3);
+
+			const Point inner[] =
+			{
+				p,
+				{ p.x - s0.normal.x, p.y - s0.normal.y },
+				{ p.x - s1.normal.x, p.y - s1.normal.y }
+			};
+			addPolygon(inner, 3);
+
+			// The miter extends the bevel on the outer side of the turn to the point where the
+			// outer edges of the segments meet.
+			const float cross = (s0.p1.x - s0.p0.x) * (s1.p1.y - s1.p0.y) - (s0.p1.y - s0.p0.y) * (s1.p1.x - s1.p0.x);
+			const Point sum = { s0.normal.x + s1.normal.x, s0.normal.y + s1.normal.y };
+			const float sumLength = std::sqrt(sum.x * sum.x + sum.y * sum.y);
+			if (join != LineJoin::Bevel && cross != 0.0f && sumLength > 0.0f)
+			{
+				const float side = (cross > 0.0f) ? -1.0f : 1.0f;
+				const Point a = { p.x + side * s0.normal.x, p.y + side * s0.normal.y };
+				const Point b = { p.x + side * s1.normal.x, p.y + side * s1.normal.y };
+
+				// Distances from |p| along the bisector relative to half of the width.
+				const float miterRatio = 2.0f * halfWidth / sumLength;
+				const float bevelRatio = 1.0f / miterRatio;
+				const float scale = miterRatio * halfWidth / sumLength;
+				const Point m = { p.x + side * sum.x * scale, p.y + side * sum.y * scale };
+
+				if (miterRatio <= miterLimit)
+				{
+					const Point miter[] = { p, a, m, b };
+					addPolygon(miter, 4);
+				}
+				else if (join == LineJoin::Miter && miterLimit > bevelRatio)
+				{
+					const float t = (miterLimit - bevelRatio) / (miterRatio - bevelRatio);
+					const Point clipped[] =
+					{
+						p,
+						a,
+						{ a.x + (m.x - a.x) * t, a.y + (m.y - a.y) * t },
+						{ b.x + (m.x - b.x) * t, b.y + (m.y - b.y) * t },
+						b
+					};
+					addPolygon(clipped, 5);
+				}
+			}
+		}
+	}
+
+	FillEdges(edges, FillRule::NonZero, color);
+}
+
+/*
+** Fills the area enclosed by |edges| (in canvas coordinates). The signed area covered by each
+** edge is accumulated into |m_Coverage| and the running sum of each row is the coverage of the
+** pixels.
+**
+*/
+void SoftwareCanvas::FillEdges(const std::vector<Edge>& edges, FillRule rule, uint32_t color)
+{
+	if (edges.empty() || (color >> 24) == 0) return;
+
+	float left = edges[0].p0.x, top = edges[0].p0.y, right = left, bottom = top;
+	for (const auto& edge : edges)
+	{
+		left = std::min(left, std::min(edge.p0.x, edge.p1.x));
+		top = std::min(top, std::min(edge.p0.y, edge.p1.y));
+		right = std::max(right, std::max(edge.p0.x, edge.p1.x));
+		bottom = std::max(bottom, std::max(edge.p0.y, edge.p1.y));
+	}
+
+	if (!(left < right && top < bottom)) return;  // Also false for NaN.
+
+	Rect bounds;
+	bounds.x = (int)std::max(std::floor(left), (float)m_Clip.x);
+	bounds.y = (int)std::max(std::floor(top), (float)m_Clip.y);
+	bounds.w = (int)std::min(std::ceil(right), (float)(m_Clip.x + m_Clip.w)) - bounds.x;
+	bounds.h = (int)std::min(std::ceil(bottom), (float)(m_Clip.y + m_Clip.h)) - bounds.y;
+	if (bounds.w <= 0 || bounds.h <= 0) return;
+
+	// One extra column on the right for the area beyond the last pixel.
+	m_CoverageStride = bounds.w + 2;
+	m_Coverage.assign((size_t)m_CoverageStride * bounds.h, 0.0f);
+
+	for (const auto& edge : edges)
+	{
+		const Point p0 = { edge.p0.x - bounds.x, edge.p0.y - bounds.y };
+		const Point p1 = { edge.p1.x - bounds.x, edge.p1.y - bounds.y };
+		AccumulateLine(p0, p1, 0, 0, bounds.w, bounds.h);
+	}
+
+	color = Premultiply(color);
+	for (int y = 0; y < bounds.h; ++y)
+	{
+		const float* coverage = &m_Coverage[y * m_CoverageStride];
+		uint32_t* dst = &m_Data[(bounds.y + y) * m_W + bounds.x];
+		float sum = 0.0f;
+		for (int x = 0; x < bounds.w; ++x)
+		{
+			sum += coverage[x];
+
+			float value = std::fabs(sum);
+			if (rule == FillRule::EvenOdd)
+			{
+				value = std::fmod(value, 2.0f);
+				if (value > 1.0f) value = 2.0f - value;
+			}
+			else if (value > 1.0f)
+			{
+				value = 1.0f;
+			}
+
+			const uint32_t alpha = (uint32_t)(value * 255.0f + 0.5f);
+			if (alpha == 255)
+			{
+				dst[x] = Blend(dst[x], color);
+			}
+			else if (alpha != 0)
+			{
+				dst[x] = Blend(dst[x], ScaleColor(color, alpha));
+			}
+		}
+	}
+}
+
+/*
+** Adds the signed area to the right of the line from |p0| to |p1| to |m_Coverage|. The line is
+** clipped to the rows [|y|, |h|) and split at the columns |x| and |w| so that the parts outside of
+** the columns can be moved onto them without changing the coverage of the pixels in between.
+**
+*/
+void SoftwareCanvas::AccumulateLine(Point p0, Point p1, int x, int y, int w, int h)
+{
+	if (p0.y == p1.y) return;
+
+	float direction = 1.0f;
+	if (p0.y > p1.y)
+	{
+		std::swap(p0, p1);
+		direction = -1.0f;
+	}
+
+	if (p1.y <= y || p0.y >= h) return;
+
+	const float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+	if (p0.y < y)
+	{
+		p0.x += (y - p0.y) * dxdy;
+		p0.y = (float)y;
+	}
+
+	if (p1.y > h)
+	{
+		p1.x -= (p1.y - h) * dxdy;
+		p1.y = (float)h;
+	}
+
+	// Split at the left and right edges.
+	float splits[2];
+	int splitCount = 0;
+	for (const float edge : { (float)x, (float)w })
+	{
+		if ((p0.x < edge && p1.x > edge) || (p0.x > edge && p1.x < edge))
+		{
+			splits[splitCount++] = p0.y + (edge - p0.x) / dxdy;
+		}
+	}
+
+	if (splitCount == 2 && splits[0] > splits[1])
+	{
+		std::swap(splits[0], splits[1]);
+	}
+
+	Point start = p0;
+	for (int i = 0; i <= splitCount; ++i)
+	{
+		Point end = p1;
+		if (i < splitCount)
+		{
+			end.y = splits[i];
+			end.x = p0.x + (end.y - p0.y) * dxdy;
+		}
+
+		const float x0 = std::min(std::max(start.x, (float)x), (float)w);
+		const float x1 = std::min(std::max(end.x, (float)x), (float)w);
+		const float y0 = start.y;
+		const float y1 = end.y;
+		start = end;
+
+		if (y1 <= y0) continue;
+
+		// Walk the rows covered by the piece from (x0, y0) to (x1, y1).
+		const float pieceDxdy = (x1 - x0) / (y1 - y0);
+		float rowX = x0;
+		const int rowEnd = std::min(h, (int)std::ceil(y1));
+		for (int row = (int)y0; row < rowEnd; ++row)
+		{
+			float* coverage = &m_Coverage[row * m_CoverageStride];
+			const float dy = std::min((float)(row + 1), y1) - std::max((float)row, y0);
+			const float nextX = std::min(std::max(rowX + pieceDxdy * dy, (float)x), (float)w);
+			const float d = dy * direction;
+
+			const float left = std::min(rowX, nextX);
+			const float right = std::max(rowX, nextX);
+			const float leftFloor = std::floor(left);
+			const int leftIndex = (int)leftFloor;
+			const float rightCeil = std::ceil(right);
+			const int rightIndex = (int)rightCeil;
+
+			if (rightIndex <= leftIndex + 1)
+			{
+				// Within a single pixel: split by the midpoint of the line.
+				const float mid = 0.5f * (rowX + nextX) - leftFloor;
+				coverage[leftIndex] += d - d * mid;
+				coverage[leftIndex + 1] += d * mid;
+			}
+			else
+			{
+				const float slope = 1.0f / (right - left);
+				const float leftFraction = left - leftFloor;
+				const float a0 = 0.5f * slope * (1.0f - leftFraction) * (1.0f - leftFraction);
+				const float rightFraction = right - rightCeil + 1.0f;
+				const float am = 0.5f * slope * rightFraction * rightFraction;
+
+				coverage[leftIndex] += d * a0;
+				if (rightIndex == leftIndex + 2)
+				{
+					coverage[leftIndex + 1] += d * (1.0f - a0 - am);
+				}
+				else
+				{
+					const float a1 = slope * (1.5f - leftFraction);
+					coverage[leftIndex + 1] += d * (a1 - a0);
+					for (int i = leftIndex + 2; i < rightIndex - 1; ++i)
+					{
+						coverage[i] += d * slope;
+					}
+
+					const float a2 = a1 + (rightIndex - leftIndex - 3) * slope;
+					coverage[rightIndex - 1] += d * (1.0f - a2 - am);
+				}
+
+				coverage[rightIndex] += d * am;
+			}
+
+			rowX = nextX;
+		}
+	}
+}
+
+SoftwareCanvas::Point SoftwareCanvas::Map(float x, float y) const
+{
+	return {
+		x * m_Transform.m11 + y * m_Transform.m21 + m_Transform.dx,
+		x * m_Transform.m12 + y * m_Transform.m22 + m_Transform.dy
+	};
+}
+
+bool SoftwareCanvas::GetDeviceBounds(float left, float top, float right, float bottom, Rect& bounds) const
+{
+	const Point points[] = { Map(left, top), Map(right, top), Map(left, bottom), Map(right, bottom) };
+
+	float minX = points[0].x, minY = points[0].y, maxX = minX, maxY = minY;
+	for (const auto& point : points)
+	{
+		minX = std::min(minX, point.x);
+		minY = std::min(minY, point.y);
+		maxX = std::max(maxX, point.x);
+		maxY = std::max(maxY, point.y);
+	}
+
+	if (!(minX < maxX && minY < maxY)) return false;
+
+	bounds.x = (int)std::max(std::floor(minX), (float)m_Clip.x);
+	bounds.y = (int)std::max(std::floor(minY), (float)m_Clip.y);
+	bounds.w = (int)std::min(std::ceil(maxX), (float)(m_Clip.x + m_Clip.w)) - bounds.x;
+	bounds.h = (int)std::min(std::ceil(maxY), (float)(m_Clip.y + m_Clip.h)) - bounds.y;
+	return bounds.w > 0 && bounds.h > 0;
+}
+
+void SoftwareCanvas::WritePPM(std::ostream& stream) const
+{
+	stream << "P6\n" << m_W << ' ' << m_H << "\n255\n";
+
+	std::vector<char> row((size_t)m_W * 3);
+	for (int y = 0; y < m_H; ++y)
+	{
+		const uint32_t* pixels = &m_Data[y * m_W];
+		for (int x = 0; x < m_W; ++x)
+		{
+			row[x * 3] = (char)(pixels[x] >> 16);
+			row[x * 3 + 1] = (char)(pixels[x] >> 8);
+			row[x * 3 + 2] = (char)pixels[x];
+		}
+
+		stream.write(row.data(), row.size());
+	}
+}
+
+#ifdef _WIN32
+namespace {
+
+// Collects the polylines of a geometry simplified with D2D1_GEOMETRY_SIMPLIFICATION_OPTION_LINES.
+class FigureSink : public ID2D1SimplifiedGeometrySink
+{
+public:
+	FigureSink(std::vector<SoftwareCanvas::Figure>& figures) :
+		m_Figures(figures),
+		m_FillMode(D2D1_FILL_MODE_ALTERNATE)
+	{
+	}
+
+	D2D1_FILL_MODE GetFillMode() const { return m_FillMode; }
+
+	// The sink lives on the stack so reference counting is not needed.
+	ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+	ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(IID const& riid, void** ppvObject) override
+	{
+		if (riid == IID_IUnknown ||
+			riid == __uuidof(ID2D1SimplifiedGeometrySink))
+		{
+			*ppvObject = this;
+			return S_OK;
+		}
+
+		*ppvObject = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	void STDMETHODCALLTYPE SetFillMode(D2D1_FILL_MODE fillMode) override { m_FillMode = fillMode; }
+	void STDMETHODCALLTYPE SetSegmentFlags(D2D1_PATH_SEGMENT vertexFlags) override {}
+
+	void STDMETHODCALLTYPE BeginFigure(D2D1_POINT_2F startPoint, D2D1_FIGURE_BEGIN figureBegin) override
+	{
+		m_Figures.push_back(SoftwareCanvas::Figure{ { { startPoint.x, startPoint.y } }, false });
+	}
+
+	void STDMETHODCALLTYPE AddLines(const D2D1_POINT_2F* points, UINT32 pointsCount) override
+	{
+		auto& figure = m_Figures.back();
+		for (UINT32 i = 0; i < pointsCount; ++i)
+		{
+			figure.points.push_back({ points[i].x, points[i].y });
+		}
+	}
+
+	void STDMETHODCALLTYPE AddBeziers(const D2D1_BEZIER_SEGMENT* beziers, UINT32 beziersCount) override
+	{
+		// Not used since the geometry is flattened.
+	}
+
+	void STDMETHODCALLTYPE EndFigure(D2D1_FIGURE_END figureEnd) override
+	{
+		m_Figures.back().closed = figureEnd == D2D1_FIGURE_END_CLOSED;
+	}
+
+	HRESULT STDMETHODCALLTYPE Close() override { return S_OK; }
+
+private:
+	std::vector<SoftwareCanvas::Figure>& m_Figures;
+	D2D1_FILL_MODE m_FillMode;
+};
+
+uint32_t ToARGB(const D2D1_COLOR_F& color)
+{
+	auto toByte = [](float value) { return (uint32_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+	return (toByte(color.a) << 24) | (toByte(color.r) << 16) | (toByte(color.g) << 8) | toByte(color.b);
+}
+
+}  // namespace
+
+bool SoftwareCanvas::CanDrawGeometry(const Shape& shape)
+{
+	const D2D1_STROKE_STYLE_PROPERTIES1& stroke = shape.m_StrokeProperties;
+	return shape.m_FillBrushType == BrushType::Solid &&
+		shape.m_StrokeBrushType == BrushType::Solid &&
+		shape.m_StrokeCustomDashes.empty() &&
+		stroke.dashStyle == D2D1_DASH_STYLE_SOLID &&
+		stroke.startCap == D2D1_CAP_STYLE_FLAT &&
+		stroke.endCap == D2D1_CAP_STYLE_FLAT &&
+		stroke.lineJoin != D2D1_LINE_JOIN_ROUND;
+}
+
+void SoftwareCanvas::DrawGeometry(Shape& shape, int x, int y)
+{
+	if (!shape.m_Shape) return;
+
+	const Transform worldTransform = m_Transform;
+	const D2D1_MATRIX_3X2_F shapeMatrix = shape.GetShapeMatrix();
+	const Transform transform =
+		Transform{ shapeMatrix._11, shapeMatrix._12, shapeMatrix._21, shapeMatrix._22, shapeMatrix._31, shapeMatrix._32 }
+		.Then(Transform::Translation((float)x, (float)y))
+		.Then(worldTransform);
+
+	// Flatten in canvas coordinates since the stroke width is not transformed
+	// (D2D1_STROKE_TRANSFORM_TYPE_FIXED).
+	const D2D1_MATRIX_3X2_F matrix = D2D1::Matrix3x2F(
+		transform.m11, transform.m12, transform.m21, transform.m22, transform.dx, transform.dy);
+	std::vector<Figure> figures;
+	FigureSink sink(figures);
+	HRESULT hr = shape.m_Shape->Simplify(
+		D2D1_GEOMETRY_SIMPLIFICATION_OPTION_LINES, &matrix, D2D1_DEFAULT_FLATTENING_TOLERANCE, &sink);
+	if (SUCCEEDED(hr))
+	{
+		m_Transform = Transform::Identity();
+
+		if (shape.m_FillColor.a > 0.0f)
+		{
+			const FillRule rule = sink.GetFillMode() == D2D1_FILL_MODE_WINDING ? FillRule::NonZero : FillRule::EvenOdd;
+			FillFigures(figures, rule, ToARGB(shape.m_FillColor));
+		}
+
+		if (shape.m_StrokeColor.a > 0.0f && shape.m_StrokeWidth > 0.0f)
+		{
+			const D2D1_STROKE_STYLE_PROPERTIES1& stroke = shape.m_StrokeProperties;
+			const LineJoin join =
+				(stroke.lineJoin == D2D1_LINE_JOIN_MITER) ? LineJoin::Miter :
+				(stroke.lineJoin == D2D1_LINE_JOIN_MITER_OR_BEVEL) ? LineJoin::MiterOrBevel :
+				LineJoin::Bevel;
+			StrokeFigures(figures, shape.m_StrokeWidth, ToARGB(shape.m_StrokeColor), join, stroke.miterLimit);
+		}
+	}
+
+	m_Transform = worldTransform;
+}
+#endif
+
+}  // namespace Gfx
@@ -0,0 +1,178 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_GFX_SOFTWARECANVAS_H_
+#define RM_GFX_SOFTWARECANVAS_H_
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Gfx {
+
+class Shape;
+
+// CPU rasterizer with the drawing operations of Canvas. Pixels are premultiplied 32-bit ARGB
+// (the memory layout of PixelFormat32bppPARGB and DXGI_FORMAT_B8G8R8A8_UNORM) and processed in
+// horizontal spans. Apart from DrawGeometry(), this class does not depend on Windows so that
+// rendering can be benchmarked and compared pixel by pixel on any platform.
+class SoftwareCanvas
+{
+public:
+	// Affine transformation with the element order of Gdiplus::Matrix and D2D1_MATRIX_3X2_F:
+	// x' = x * m11 + y * m21 + dx, y' = x * m12 + y * m22 + dy.
+	struct Transform
+	{
+		float m11, m12, m21, m22, dx, dy;
+
+		static Transform Identity() { return { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f }; }
+		static Transform Translation(float x, float y) { return { 1.0f, 0.0f, 0.0f, 1.0f, x, y }; }
+		static Transform Scale(float x, float y) { return { x, 0.0f, 0.0f, y, 0.0f, 0.0f }; }
+
+		// Clockwise rotation by |angle| degrees around (|x|, |y|).
+		static Transform Rotation(float angle, float x, float y);
+
+		// Returns the transformation that applies |this| and then |other|.
+		Transform Then(const Transform& other) const;
+
+		bool Invert(Transform& inverse) const;
+		bool IsTranslation() const { return m11 == 1.0f && m12 == 0.0f && m21 == 0.0f && m22 == 1.0f; }
+	};
+
+	struct Point
+	{
+		float x, y;
+	};
+
+	// Polyline of a flattened geometry.
+	struct Figure
+	{
+		std::vector<Point> points;
+		bool closed;
+	};
+
+	enum class FillRule
+	{
+		NonZero,
+		EvenOdd
+	};
+
+	enum class LineJoin
+	{
+		Bevel,
+		Miter,
+		MiterOrBevel
+	};
+
+	// Premultiplied pixels that are not owned by the canvas. |stride| is in pixels.
+	struct Image
+	{
+		const uint32_t* pixels;
+		int width;
+		int height;
+		int stride;
+	};
+
+	struct Rect
+	{
+		int x, y, w, h;
+	};
+
+	SoftwareCanvas();
+	~SoftwareCanvas();
+
+	SoftwareCanvas(const SoftwareCanvas& other) = delete;
+	SoftwareCanvas& operator=(SoftwareCanvas other) = delete;
+
+	int GetW() const { return m_W; }
+	int GetH() const { return m_H; }
+
+	// Resizing clears the pixels and the clip.
+	void Resize(int w, int h);
+
+	// Draws to the |w| x |h| top-down |pixels| of e.g. a Canvas bitmap instead of pixels owned by
+	// the canvas. The pixels are not cleared and must remain valid until the next call to Resize()
+	// or Attach(). Resets the clip.
+	void Attach(uint32_t* pixels, int w, int h);
+
+	const uint32_t* GetPixels() const { return m_Data; }
+	uint32_t GetPixel(int x, int y) const { return m_Data[y * m_W + x]; }
+	Image GetImage() const { return { m_Data, m_W, m_H, m_W }; }
+
+	const Transform& GetTransform() const { return m_Transform; }
+	void SetTransform(const Transform& transform) { m_Transform = transform; }
+	void ResetTransform() { m_Transform = Transform::Identity(); }
+
+	// Restricts drawing to |rect| in canvas coordinates. Unlike the transform, the clip also
+	// applies to Clear().
+	void SetClip(const Rect& rect);
+	void ResetClip();
+
+	// Colors are non-premultiplied ARGB as in Gdiplus::Color::GetValue().
+	void Clear(uint32_t color = 0);
+	void FillRectangle(const Rect& rect, uint32_t color);
+
+	// Draws |srcRect| of |image| into |dstRect| with bilinear filtering. The image is copied as is
+	// when it is neither scaled nor transformed.
+	void DrawBitmap(const Image& image, const Rect& dstRect, const Rect& srcRect);
+
+	// Draws |srcRect2| of |image| into |dstRect| using the alpha of |srcRect| of |mask| as opacity.
+	void DrawMaskedBitmap(const Image& image, const Image& mask, const Rect& dstRect,
+		const Rect& srcRect, const Rect& srcRect2);
+
+	// Fills the figures with antialiasing. Open figures are closed implicitly.
+	void FillFigures(const std::vector<Figure>& figures, FillRule rule, uint32_t color);
+
+	// Strokes the figures with butt caps. Like Direct2D, miters that are longer than |miterLimit|
+	// times half of the |width| are clipped with LineJoin::Miter and beveled with
+	// LineJoin::MiterOrBevel.
+	void StrokeFigures(const std::vector<Figure>& figures, float width, uint32_t color,
+		LineJoin join = LineJoin::Bevel, float miterLimit = 10.0f);
+
+#ifdef _WIN32
+	// Returns false if |shape| uses gradients, dashes, caps or round joins. These are only drawn
+	// by Direct2D.
+	static bool CanDrawGeometry(const Shape& shape);
+
+	// Draws |shape| like Canvas::DrawGeometry(). Must only be used if CanDrawGeometry() is true.
+	void DrawGeometry(Shape& shape, int x, int y);
+#endif
+
+	// Writes the pixels as binary PPM. The alpha channel is dropped, which is the same as
+	// compositing the premultiplied pixels over black.
+	void WritePPM(std::ostream& stream) const;
+
+private:
+	struct Edge
+	{
+		Point p0, p1;
+	};
+
+	void DrawImage(const Image& image, const Rect& dstRect, const Rect& srcRect,
+		const Image* mask, const Rect* maskRect);
+	void FillEdges(const std::vector<Edge>& edges, FillRule rule, uint32_t color);
+	void AccumulateLine(Point p0, Point p1, int x, int y, int w, int h);
+
+	Point Map(float x, float y) const;
+	bool GetDeviceBounds(float left, float top, float right, float bottom, Rect& bounds) const;
+
+	int m_W;
+	int m_H;
+	std::vector<uint32_t> m_Pixels;
+	uint32_t* m_Data;	// |m_Pixels| or the attached pixels
+
+	Transform m_Transform;
+	Rect m_Clip;
+
+	// Signed coverage of the path being filled. Reused to avoid allocating for each fill.
+	std::vector<float> m_Coverage;
+	int m_CoverageStride;
+};
+
+}  // namespace Gfx
+
+#endif
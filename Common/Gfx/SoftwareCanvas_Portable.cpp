@@ -0,0 +1,159 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+// Standalone benchmark for SoftwareCanvas. It only uses the standard library so that the software
+// rasterizer can be profiled on any platform. It is not part of the Visual Studio solution, where
+// Canvas_Benchmark compares the software backend of Canvas with Direct2D. To build and run it:
+//
+//   c++ -std=c++14 -O2 -o SoftwareCanvas_Portable SoftwareCanvas.cpp SoftwareCanvas_Portable.cpp
+//   ./SoftwareCanvas_Portable [frame.ppm]
+//
+// The frame draws the same operations as the meters of a skin: bars, a histogram, images, a
+// rotated image and shapes. The last frame is written to the given path. The exit code is non-zero
+// if a check fails.
+
+#include "SoftwareCanvas.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+using Gfx::SoftwareCanvas;
+
+int g_Failures = 0;
+
+void Check(bool condition, const char* expression, int line)
+{
+	if (!condition)
+	{
+		fprintf(stderr, "SoftwareCanvas_Portable.cpp(%i): Check failed: %s\n", line, expression);
+		++g_Failures;
+	}
+}
+
+#define CHECK(expression) Check(!!(expression), #expression, __LINE__)
+
+std::vector<SoftwareCanvas::Figure> CreatePie(int frame)
+{
+	std::vector<SoftwareCanvas::Figure> figures(1);
+	figures[0].closed = true;
+	figures[0].points.push_back({ 0.0f, 0.0f });
+
+	const int steps = frame % 100 + 1;
+	for (int i = 0; i <= steps; ++i)
+	{
+		const float angle = -1.5708f + i * 6.2832f / 100.0f;
+		figures[0].points.push_back({ 100.0f * std::cos(angle), 100.0f * std::sin(angle) });
+	}
+	return figures;
+}
+
+void DrawFrame(SoftwareCanvas& canvas, const SoftwareCanvas::Image& icon,
+	const std::vector<SoftwareCanvas::Figure>& gauge, int frame)
+{
+	canvas.ResetTransform();
+	canvas.Clear(0xFF202020);
+
+	// MeterBar
+	for (int i = 0; i < 16; ++i)
+	{
+		const int value = (frame * 7 + i * 37) % 400;
+		canvas.FillRectangle({ 40, 40 + i * 24, 400, 16 }, 0x40FFFFFF);
+		canvas.FillRectangle({ 40, 40 + i * 24, value, 16 }, 0xFF3080F0);
+	}
+
+	// MeterHistogram
+	for (int x = 0; x < 800; ++x)
+	{
+		const int value = (int)(100.0 + 90.0 * std::sin((x + frame * 4) * 0.05));
+		canvas.FillRectangle({ 520 + x, 440 - value, 1, value }, 0xC060E060);
+	}
+
+	// MeterImage, scaled and rotated like MeterRotator
+	for (int i = 0; i < 8; ++i)
+	{
+		canvas.DrawBitmap(icon, { 40 + i * 72, 500, 64, 64 }, { 0, 0, 64, 64 });
+		canvas.DrawBitmap(icon, { 40 + i * 72, 600, 48, 48 }, { 0, 0, 64, 64 });
+	}
+	canvas.SetTransform(SoftwareCanvas::Transform::Rotation(frame * 3.6f, 1200.0f, 800.0f));
+	canvas.DrawBitmap(icon, { 1104, 704, 192, 192 }, { 0, 0, 64, 64 });
+
+	// MeterShape and MeterRoundLine
+	canvas.SetTransform(SoftwareCanvas::Transform::Translation(1600.5f, 300.5f));
+	canvas.StrokeFigures(gauge, 16.0f, 0x60FFFFFF);
+	canvas.FillFigures(CreatePie(frame), SoftwareCanvas::FillRule::NonZero, 0xC0F08030);
+}
+
+void BenchmarkDashboard(const char* path)
+{
+	const int width = 1920;
+	const int height = 1080;
+	const int frames = 100;
+
+	std::vector<uint32_t> iconPixels(64 * 64);
+	for (int y = 0; y < 64; ++y)
+	{
+		for (int x = 0; x < 64; ++x)
+		{
+			const uint32_t alpha = (uint32_t)(x * 4);
+			iconPixels[y * 64 + x] = (alpha << 24) | ((alpha * y / 64) << 8) | (alpha * (63 - y) / 64);
+		}
+	}
+	const SoftwareCanvas::Image icon = { iconPixels.data(), 64, 64, 64 };
+
+	std::vector<SoftwareCanvas::Figure> gauge(1);
+	gauge[0].closed = false;
+	for (int i = 0; i <= 64; ++i)
+	{
+		const float angle = 2.3562f + i * 4.7124f / 64.0f;
+		gauge[0].points.push_back({ 120.0f * std::cos(angle), 120.0f * std::sin(angle) });
+	}
+
+	SoftwareCanvas canvas;
+	canvas.Resize(width, height);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		DrawFrame(canvas, icon, gauge, frame);
+	}
+	const double elapsed =
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// Drawing to attached pixels, like the Canvas backend does, gives the same result.
+	std::vector<uint32_t> attachedPixels((size_t)width * height);
+	SoftwareCanvas attached;
+	attached.Attach(attachedPixels.data(), width, height);
+	DrawFrame(attached, icon, gauge, frames - 1);
+	CHECK(attachedPixels == std::vector<uint32_t>(canvas.GetPixels(), canvas.GetPixels() + attachedPixels.size()));
+
+	CHECK(canvas.GetPixel(40, 40) == 0xFF3080F0);
+	CHECK(canvas.GetPixel(10, 10) == 0xFF202020);
+
+	if (path)
+	{
+		std::ofstream file(path, std::ios::binary);
+		canvas.WritePPM(file);
+		CHECK(file.good());
+	}
+
+	printf("SoftwareCanvas: %i frames of %ix%i. %.2f ms/frame.%s%s\n",
+		frames, width, height, elapsed / frames, path ? " Last frame: " : "", path ? path : "");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	BenchmarkDashboard(argc > 1 ? argv[1] : nullptr);
+
+	printf("SoftwareCanvas: %s\n", g_Failures == 0 ? "all checks passed" : "FAILED");
+	return g_Failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "SoftwareCanvas.h"
+#include "../UnitTest.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Gfx {
+
+TEST_CLASS(Common_Gfx_SoftwareCanvas_Test)
+{
+public:
+	TEST_METHOD(TestFillRectangle)
+	{
+		SoftwareCanvas canvas;
+		canvas.Resize(8, 8);
+		canvas.Clear(0xFF000000);
+		canvas.FillRectangle({ 2, 2, 4, 4 }, 0xFFFF0000);
+		Assert::AreEqual(0xFFFF0000u, canvas.GetPixel(2, 2));
+		Assert::AreEqual(0xFF000000u, canvas.GetPixel(1, 1));
+
+		// Half transparent white over red and black.
+		canvas.FillRectangle({ 0, 0, 8, 8 }, 0x80FFFFFF);
+		Assert::AreEqual(0xFFFF8080u, canvas.GetPixel(2, 2));
+		Assert::AreEqual(0xFF808080u, canvas.GetPixel(0, 0));
+	}
+
+	TEST_METHOD(TestAttach)
+	{
+		uint32_t pixels[4 * 2] = { 0xFF0000FF, 0xFF0000FF, 0xFF0000FF, 0xFF0000FF };
+		SoftwareCanvas canvas;
+		canvas.Attach(pixels, 4, 2);
+		Assert::AreEqual(0xFF0000FFu, canvas.GetPixel(0, 0));
+
+		canvas.FillRectangle({ 1, 1, 2, 1 }, 0xFFFF0000);
+		Assert::AreEqual(0xFFFF0000u, pixels[1 * 4 + 1]);
+		Assert::AreEqual(0xFFFF0000u, pixels[1 * 4 + 2]);
+		Assert::AreEqual(0x00000000u, pixels[1 * 4 + 3]);
+	}
+
+	TEST_METHOD(TestClip)
+	{
+		SoftwareCanvas canvas;
+		canvas.Resize(4, 4);
+		canvas.Clear(0xFFFFFFFF);
+		canvas.SetClip({ 0, 0, 2, 2 });
+		canvas.Clear();
+		Assert::AreEqual(0x00000000u, canvas.GetPixel(1, 1));
+		Assert::AreEqual(0xFFFFFFFFu, canvas.GetPixel(2, 2));
+
+		canvas.ResetClip();
+		canvas.FillRectangle({ 0, 0, 4, 4 }, 0xFF0000FF);
+		Assert::AreEqual(0xFF0000FFu, canvas.GetPixel(1, 1));
+	}
+
+	TEST_METHOD(TestFillFigures)
+	{
+		// Pixel edges at half a pixel are covered by half.
+		SoftwareCanvas canvas;
+		canvas.Resize(10, 10);
+		std::vector<SoftwareCanvas::Figure> figures =
+		{
+			{ { { 1.5f, 1.0f }, { 4.5f, 1.0f }, { 4.5f, 3.0f }, { 1.5f, 3.0f } }, true }
+		};
+		canvas.FillFigures(figures, SoftwareCanvas::FillRule::NonZero, 0xFFFFFFFF);
+		Assert::AreEqual(0x80808080u, canvas.GetPixel(1, 1));
+		Assert::AreEqual(0xFFFFFFFFu, canvas.GetPixel(2, 1));
+		Assert::AreEqual(0x80808080u, canvas.GetPixel(4, 2));
+		Assert::AreEqual(0x00000000u, canvas.GetPixel(2, 0));
+		Assert::AreEqual(0x00000000u, canvas.GetPixel(2, 3));
+
+		// The orientation of the figure does not matter.
+		std::reverse(figures[0].points.begin(), figures[0].points.end());
+		canvas.Clear();
+		canvas.FillFigures(figures, SoftwareCanvas::FillRule::EvenOdd, 0xFFFFFFFF);
+		Assert::AreEqual(0x80808080u, canvas.GetPixel(1, 1));
+		Assert::AreEqual(0xFFFFFFFFu, canvas.GetPixel(2, 2));
+
+		// Overlapping figures of the same orientation leave a hole only with EvenOdd.
+		std::reverse(figures[0].points.begin(), figures[0].points.end());
+		figures.push_back({ { { 2.0f, 1.0f }, { 4.0f, 1.0f }, { 4.0f, 3.0f }, { 2.0f, 3.0f } }, true });
+		canvas.Clear();
+		canvas.FillFigures(figures, SoftwareCanvas::FillRule::EvenOdd, 0xFFFFFFFF);
+		Assert::AreEqual(0x00000000u, canvas.GetPixel(2, 2));
+		canvas.Clear();
+		canvas.FillFigures(figures, SoftwareCanvas::FillRule::NonZero, 0xFFFFFFFF);
+		Assert::AreEqual(0xFFFFFFFFu, canvas.GetPixel(2, 2));
+	}
+
+	TEST_METHOD(TestFillCircle)
+	{
+		const std::vector<SoftwareCanvas::Figure> figures = { CreateCircle(50.0f, 50.0f, 40.0f) };
+		const double area = 3.14159265 * 40.0 * 40.0;
+
+		SoftwareCanvas canvas;
+		canvas.Resize(100, 100);
+		canvas.FillFigures(figures, SoftwareCanvas::FillRule::NonZero, 0xFFFFFFFF);
+		Assert::AreEqual(area, GetCoverage(canvas), area * 0.001);
+
+		// Only the top left quarter is within the canvas.
+		canvas.Resize(50, 50);
+		canvas.FillFigures(figures, SoftwareCanvas::FillRule::NonZero, 0xFFFFFFFF);
+		Assert::AreEqual(area / 4.0, GetCoverage(canvas), area * 0.001);
+
+		canvas.Resize(100, 100);
+		canvas.StrokeFigures(figures, 4.0f, 0xFFFFFFFF);
+		const double strokeArea = 2.0 * 3.14159265 * 40.0 * 4.0;
+		Assert::AreEqual(strokeArea, GetCoverage(canvas), strokeArea * 0.02);
+		Assert::AreEqual(0x00000000u, canvas.GetPixel(50, 50));
+	}
+
+	TEST_METHOD(TestStrokeJoins)
+	{
+		const std::vector<SoftwareCanvas::Figure> figures =
+		{
+			{ { { 10.0f, 10.0f }, { 50.0f, 10.0f }, { 50.0f, 50.0f }, { 10.0f, 50.0f } }, true }
+		};
+
+		auto getCorner = [&](SoftwareCanvas::LineJoin join, float miterLimit)
+		{
+			SoftwareCanvas canvas;
+			canvas.Resize(60, 60);
+			canvas.StrokeFigures(figures, 8.0f, 0xFFFFFFFF, join, miterLimit);
+			Assert::AreEqual(0xFFFFFFFFu, canvas.GetPixel(8, 30));
+			return canvas.GetPixel(6, 6);
+		};
+
+		// The outer corner of the square is cut off by bevels and by miters that are clipped or
+		// beveled at a limit below sqrt(2).
+		Assert::AreEqual(0x00000000u, getCorner(SoftwareCanvas::LineJoin::Bevel, 10.0f));
+		Assert::AreEqual(0xFFFFFFFFu, getCorner(SoftwareCanvas::LineJoin::Miter, 10.0f));
+		Assert::AreEqual(0xFFFFFFFFu, getCorner(SoftwareCanvas::LineJoin::MiterOrBevel, 10.0f));
+		Assert::AreEqual(0x00000000u, getCorner(SoftwareCanvas::LineJoin::Miter, 1.0f));
+		Assert::AreEqual(0x00000000u, getCorner(SoftwareCanvas::LineJoin::MiterOrBevel, 1.0f));
+	}
+
+	TEST_METHOD(TestDrawBitmap)
+	{
+		uint32_t pixels[16];
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			pixels[i] = 0xFF000000 | (i * 16);
+		}
+		const SoftwareCanvas::Image image = { pixels, 4, 4, 4 };
+
+		SoftwareCanvas canvas;
+		canvas.Resize(8, 8);
+		canvas.DrawBitmap(image, { 2, 2, 4, 4 }, { 0, 0, 4, 4 });
+		Assert::AreEqual(pixels[0], canvas.GetPixel(2, 2));
+		Assert::AreEqual(pixels[15], canvas.GetPixel(5, 5));
+		Assert::AreEqual(0x00000000u, canvas.GetPixel(1, 1));
+
+		canvas.Clear();
+		canvas.DrawBitmap(image, { 0, 0, 8, 8 }, { 0, 0, 4, 4 });
+		Assert::AreEqual(pixels[0], canvas.GetPixel(0, 0));
+		Assert::AreEqual(pixels[15], canvas.GetPixel(7, 7));
+
+		// Rotated clockwise, the bottom left pixel ends up at the top left.
+		canvas.Clear();
+		canvas.SetTransform(SoftwareCanvas::Transform::Rotation(90.0f, 4.0f, 4.0f));
+		canvas.DrawBitmap(image, { 2, 2, 4, 4 }, { 0, 0, 4, 4 });
+		Assert::AreEqual(pixels[12], canvas.GetPixel(2, 2));
+		canvas.ResetTransform();
+
+		uint32_t maskPixels[16];
+		std::fill_n(maskPixels, 16, 0x80000000);
+		const SoftwareCanvas::Image mask = { maskPixels, 4, 4, 4 };
+		canvas.Clear();
+		canvas.DrawMaskedBitmap(image, mask, { 0, 0, 4, 4 }, { 0, 0, 4, 4 }, { 0, 0, 4, 4 });
+		Assert::AreEqual(0x80000028u, canvas.GetPixel(1, 1));
+	}
+
+	static SoftwareCanvas::Figure CreateCircle(float x, float y, float radius)
+	{
+		SoftwareCanvas::Figure figure;
+		figure.closed = true;
+		for (int i = 0; i < 256; ++i)
+		{
+			const float angle = i * 6.2831853f / 256.0f;
+			figure.points.push_back({ x + radius * std::cos(angle), y + radius * std::sin(angle) });
+		}
+		return figure;
+	}
+
+	// Returns the number of fully covered pixels that the alpha channel adds up to.
+	static double GetCoverage(const SoftwareCanvas& canvas)
+	{
+		double coverage = 0.0;
+		for (int y = 0; y < canvas.GetH(); ++y)
+		{
+			for (int x = 0; x < canvas.GetW(); ++x)
+			{
+				coverage += (canvas.GetPixel(x, y) >> 24) / 255.0;
+			}
+		}
+		return coverage;
+	}
+};
+
+}  // namespace Gfx
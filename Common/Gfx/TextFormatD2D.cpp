@@ -30,9 +30,27 @@
 #include "../../Library/pcre/pcre.h"
 #include <ole2.h>  // For Gdiplus.h.
 #include <GdiPlus.h>
+#include <algorithm>
 
 namespace {
 
+// Number of layouts kept by each text format. Measuring and drawing a string typically use two
+// layouts with different sizes.
+const size_t MAX_CACHED_LAYOUTS = 8;
+
+// FNV-1a hash of the first |strLen| characters of |str|.
+UINT32 HashString(const WCHAR* str, UINT32 strLen)
+{
+	UINT32 hash = 2166136261U;
+	for (UINT32 i = 0; i < strLen; ++i)
+	{
+		hash ^= (UINT32)str[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
 int Clamp(int value, int _min, int _max)
 {
 	if (value < _min || value > _max)
@@ -48,13 +66,15 @@ int Clamp(int value, int _min, int _max)
 
 namespace Gfx {
 
+UINT64 TextFormatD2D::c_LayoutCacheHits = 0ULL;
+UINT64 TextFormatD2D::c_LayoutCacheMisses = 0ULL;
+
 TextFormatD2D::TextFormatD2D() :
 	m_FontWeight(-1),
-	m_HasWeightChanged(false),
 	m_ExtraHeight(),
 	m_LineGap(),
 	m_Trimming(),
-	m_HasInlineOptionsChanged(false)
+	m_InlineOptionsVersion()
 {
 }
 
@@ -67,6 +87,7 @@ void TextFormatD2D::Dispose()
 {
 	m_TextFormat.Reset();
 	m_TextLayout.Reset();
+	m_Layouts.clear();
 	m_InlineEllipsis.Reset();
 
 	m_ExtraHeight = 0.0f;
@@ -75,17 +96,6 @@ void TextFormatD2D::Dispose()
 
 bool TextFormatD2D::CreateLayout(ID2D1RenderTarget* target, const std::wstring& srcStr, float maxW, float maxH, bool gdiEmulation)
 {
-	UINT32 strLen = (UINT32)srcStr.length();
-	const WCHAR* str = srcStr.c_str();
-
-	bool strChanged = false;
-	if (strLen != m_LastString.length() ||
-		memcmp(str, m_LastString.c_str(), (strLen + 1) * sizeof(WCHAR)) != 0)
-	{
-		strChanged = true;
-		m_LastString.assign(str, strLen);
-	}
-
 	// The width and height of a DirectWrite layout must be non-negative.
 	maxW = max(0.0f, maxW);
 	maxH = max(0.0f, maxH);
@@ -100,11 +110,15 @@ bool TextFormatD2D::CreateLayout(ID2D1RenderTarget* target, const std::wstring&
 		maxH += 2.0f;
 	}
 
-	// Inline gradients need to be created/recreated not only when the text changes,
-	// but also when the dimensions of the meter changes.
-	auto CreateGradientBrushes = [&]()
+	IDWriteTextLayout* textLayout = GetLayout(srcStr.c_str(), (UINT32)srcStr.length(), maxW, maxH, gdiEmulation);
+	if (!textLayout) return false;
+
+	if (textLayout != m_TextLayout.Get())
 	{
-		// Build gradient brushes (if any)
+		m_TextLayout = textLayout;
+
+		// Inline gradients depend on the dimensions of the layout, so they need to be
+		// recreated whenever a different layout is drawn.
 		for (const auto& fmt : m_TextInlineFormat)
 		{
 			if (fmt->GetType() == Gfx::InlineType::GradientColor)
@@ -113,82 +127,94 @@ bool TextFormatD2D::CreateLayout(ID2D1RenderTarget* target, const std::wstring&
 				option->BuildGradientBrushes(target, m_TextLayout.Get());
 			}
 		}
+	}
 
-		// Because the text layout can be created without any changes to any
-		// 'color' inline options, we need a way to update any color changes
-		// at drawing time. 
-		m_HasInlineOptionsChanged = true;
-	};
-
-	if (m_TextLayout && !strChanged && !m_HasInlineOptionsChanged && !m_HasWeightChanged)
-	{
-		bool hasChanged = false;
-		if (maxW != m_TextLayout->GetMaxWidth())
-		{
-			m_TextLayout->SetMaxWidth(maxW);
-			hasChanged = true;
-		}
+	return true;
+}
 
-		if (maxH != m_TextLayout->GetMaxHeight())
+IDWriteTextLayout* TextFormatD2D::GetLayout(const WCHAR* str, UINT32 strLen, float maxW, float maxH, bool gdiEmulation)
+{
+	const UINT32 hash = HashString(str, strLen);
+	const DWRITE_WORD_WRAPPING wordWrapping = m_TextFormat->GetWordWrapping();
+	for (auto iter = m_Layouts.begin(); iter != m_Layouts.end(); ++iter)
+	{
+		const CachedLayout& cached = *iter;
+		if (cached.hash == hash &&
+			cached.maxW == maxW &&
+			cached.maxH == maxH &&
+			cached.gdiEmulation == gdiEmulation &&
+			cached.wordWrapping == wordWrapping &&
+			cached.inlineOptionsVersion == m_InlineOptionsVersion &&
+			cached.str.length() == strLen &&
+			wmemcmp(cached.str.c_str(), str, strLen) == 0)
 		{
-			m_TextLayout->SetMaxHeight(maxH);
-			hasChanged = true;
-		}
+			++c_LayoutCacheHits;
 
-		if (hasChanged)
-		{
-			// Meter dimensions have changed, so recreate any inline gradient brushes
-			CreateGradientBrushes();
+			// Move to the front to keep the layouts ordered by use.
+			std::rotate(m_Layouts.begin(), iter, iter + 1);
+			return m_Layouts.front().layout.Get();
 		}
 	}
-	else
-	{
-		Canvas::c_DWFactory->CreateTextLayout(
-			str, strLen, m_TextFormat.Get(), maxW, maxH, m_TextLayout.ReleaseAndGetAddressOf());
-		if (!m_TextLayout) return false;
 
-		// Set the font weight if valid
-		const DWRITE_TEXT_RANGE range = { 0, strLen };
-		if (m_FontWeight > 0 && m_FontWeight < 1000)
-		{
-			m_TextLayout->SetFontWeight((DWRITE_FONT_WEIGHT)m_FontWeight, range);
-			m_HasWeightChanged = false;
-		}
+	++c_LayoutCacheMisses;
 
-		if (gdiEmulation)
-		{
-			Microsoft::WRL::ComPtr<IDWriteTextLayout1> textLayout1;
-			m_TextLayout.As(&textLayout1);
+	Microsoft::WRL::ComPtr<IDWriteTextLayout> textLayout;
+	HRESULT hr = Canvas::c_DWFactory->CreateTextLayout(
+		str, strLen, m_TextFormat.Get(), maxW, maxH, textLayout.GetAddressOf());
+	if (FAILED(hr)) return nullptr;
 
-			const float xOffset = m_TextFormat->GetFontSize() / 6.0f;
-			const float emOffset = xOffset / 24.0f;
-			textLayout1->SetCharacterSpacing(emOffset, emOffset, 0.0f, range);
-		}
+	// Set the font weight if valid
+	const DWRITE_TEXT_RANGE range = { 0, strLen };
+	if (m_FontWeight > 0 && m_FontWeight < 1000)
+	{
+		textLayout->SetFontWeight((DWRITE_FONT_WEIGHT)m_FontWeight, range);
+	}
+
+	if (gdiEmulation)
+	{
+		Microsoft::WRL::ComPtr<IDWriteTextLayout1> textLayout1;
+		textLayout.As(&textLayout1);
+
+		const float xOffset = m_TextFormat->GetFontSize() / 6.0f;
+		const float emOffset = xOffset / 24.0f;
+		textLayout1->SetCharacterSpacing(emOffset, emOffset, 0.0f, range);
+	}
 
-		ApplyInlineFormatting(m_TextLayout.Get());
+	ApplyInlineFormatting(textLayout.Get());
 
-		UINT32 lineCount = 0;
-		DWRITE_LINE_METRICS lineMetrics[2];
-		HRESULT hr = m_TextLayout->GetLineMetrics(lineMetrics, _countof(lineMetrics), &lineCount);
-		if (SUCCEEDED(hr))
+	UINT32 lineCount = 0;
+	DWRITE_LINE_METRICS lineMetrics[2];
+	hr = textLayout->GetLineMetrics(lineMetrics, _countof(lineMetrics), &lineCount);
+	if (SUCCEEDED(hr))
+	{
+		// If only one line is visible, disable wrapping so that as much text as possible is shown
+		// after trimming.
+		// TODO: Fix this for when more than one line is visible.
+		if (lineCount >= 2 &&
+			lineMetrics[0].isTrimmed &&
+			lineMetrics[1].isTrimmed &&
+			lineMetrics[1].height == 0.0f)
 		{
-			// If only one line is visible, disable wrapping so that as much text as possible is shown
-			// after trimming.
-			// TODO: Fix this for when more than one line is visible.
-			if (lineCount >= 2 &&
-				lineMetrics[0].isTrimmed &&
-				lineMetrics[1].isTrimmed &&
-				lineMetrics[1].height == 0.0f)
-			{
-				m_TextLayout->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP);
-			}
+			textLayout->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP);
 		}
+	}
 
-		// Create any inline gradients
-		CreateGradientBrushes();
+	if (m_Layouts.size() >= MAX_CACHED_LAYOUTS)
+	{
+		m_Layouts.pop_back();
 	}
 
-	return true;
+	CachedLayout cached;
+	cached.hash = hash;
+	cached.str.assign(str, strLen);
+	cached.maxW = maxW;
+	cached.maxH = maxH;
+	cached.gdiEmulation = gdiEmulation;
+	cached.wordWrapping = wordWrapping;
+	cached.inlineOptionsVersion = m_InlineOptionsVersion;
+	cached.layout = std::move(textLayout);
+	m_Layouts.insert(m_Layouts.begin(), std::move(cached));
+	return m_Layouts.front().layout.Get();
 }
 
 void TextFormatD2D::SetProperties(
@@ -330,7 +356,7 @@ void TextFormatD2D::SetFontWeight(int weight)
 	m_FontWeight = weight;
 
 	// Signal to recreate the layout
-	m_HasWeightChanged = true;
+	++m_InlineOptionsVersion;
 }
 
 DWRITE_TEXT_METRICS TextFormatD2D::GetMetrics(const std::wstring& srcStr, bool gdiEmulation, float maxWidth)
@@ -352,36 +378,10 @@ DWRITE_TEXT_METRICS TextFormatD2D::GetMetrics(const std::wstring& srcStr, bool g
 	}
 
 	DWRITE_TEXT_METRICS metrics = {0};
-	Microsoft::WRL::ComPtr<IDWriteTextLayout> textLayout;
-	HRESULT hr = Canvas::c_DWFactory->CreateTextLayout(
-		str,
-		strLen,
-		m_TextFormat.Get(),
-		maxWidth,
-		10000,
-		textLayout.GetAddressOf());
-	if (SUCCEEDED(hr))
+	IDWriteTextLayout* textLayout = GetLayout(str, strLen, maxWidth, 10000.0f, gdiEmulation);
+	if (textLayout)
 	{
-		// Set the font weight if valid
-		if (m_FontWeight > 0 && m_FontWeight < 1000)
-		{
-			const DWRITE_TEXT_RANGE range = { 0, strLen };
-			textLayout->SetFontWeight((DWRITE_FONT_WEIGHT)m_FontWeight, range);
-		}
-
-		ApplyInlineFormatting(textLayout.Get());
-
 		const float xOffset = m_TextFormat->GetFontSize() / 6.0f;
-		if (gdiEmulation)
-		{
-			Microsoft::WRL::ComPtr<IDWriteTextLayout1> textLayout1;
-			textLayout.As(&textLayout1);
-
-			const float emOffset = xOffset / 24.0f;
-			const DWRITE_TEXT_RANGE range = {0, strLen};
-			textLayout1->SetCharacterSpacing(emOffset, emOffset, 0.0f, range);
-		}
-
 		textLayout->GetMetrics(&metrics);
 		if (metrics.width > 0.0f)
 		{
@@ -420,6 +420,12 @@ DWRITE_TEXT_METRICS TextFormatD2D::GetMetrics(const std::wstring& srcStr, bool g
 
 void TextFormatD2D::SetTrimming(bool trim)
 {
+	if (trim != m_Trimming)
+	{
+		// The layouts copy the trimming of the format when they are created.
+		++m_InlineOptionsVersion;
+	}
+
 	m_Trimming = trim;
 	IDWriteInlineObject* inlineObject = nullptr;
 	DWRITE_TRIMMING trimming = {};
@@ -443,6 +449,7 @@ void TextFormatD2D::SetTrimming(bool trim)
 
 void TextFormatD2D::SetHorizontalAlignment(HorizontalAlignment alignment)
 {
+	if (alignment != GetHorizontalAlignment()) ++m_InlineOptionsVersion;
 	__super::SetHorizontalAlignment(alignment);
 
 	if (m_TextFormat)
@@ -456,6 +463,7 @@ void TextFormatD2D::SetHorizontalAlignment(HorizontalAlignment alignment)
 
 void TextFormatD2D::SetVerticalAlignment(VerticalAlignment alignment)
 {
+	if (alignment != GetVerticalAlignment()) ++m_InlineOptionsVersion;
 	__super::SetVerticalAlignment(alignment);
 	
 	if (m_TextFormat)
@@ -497,7 +505,7 @@ void TextFormatD2D::ReadInlineOptions(ConfigParser& parser, const WCHAR* section
 	// Remove any previous options that do not exist anymore
 	if (i <= m_TextInlineFormat.size())
 	{
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 		m_TextInlineFormat.erase(m_TextInlineFormat.begin() + (i - 1), m_TextInlineFormat.end());
 	}
 }
@@ -601,7 +609,7 @@ bool TextFormatD2D::CreateInlineOption(const size_t index, const std::wstring pa
 		{
 			// Special case to delete a specific index while keeping the rest of the options
 			m_TextInlineFormat.erase(m_TextInlineFormat.begin() + index);
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 
 		return true;
@@ -774,20 +782,20 @@ void TextFormatD2D::UpdateInlineCase(const size_t& index, const std::wstring pat
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Case(pattern, type));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Case)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Case*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, type))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Case(pattern, type));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -800,7 +808,7 @@ void TextFormatD2D::UpdateInlineCharacterSpacing(const size_t& index, const std:
 		// 'CharacterSpacing' object (in place) at the end of the array.
 
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_CharacterSpacing(pattern, leading, trailing, advanceWidth));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::CharacterSpacing)
 	{
@@ -810,7 +818,7 @@ void TextFormatD2D::UpdateInlineCharacterSpacing(const size_t& index, const std:
 		auto option = dynamic_cast<TextInlineFormat_CharacterSpacing*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, leading, trailing, advanceWidth))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
@@ -819,7 +827,7 @@ void TextFormatD2D::UpdateInlineCharacterSpacing(const size_t& index, const std:
 		// the previous object and replace it with a new 'CharacterSpacing' object.
 
 		m_TextInlineFormat[index].reset(new TextInlineFormat_CharacterSpacing(pattern, leading, trailing, advanceWidth));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -828,20 +836,20 @@ void TextFormatD2D::UpdateInlineColor(const size_t& index, const std::wstring pa
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Color(pattern, color));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Color)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Color*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, color))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Color(pattern, color));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -850,20 +858,20 @@ void TextFormatD2D::UpdateInlineFace(const size_t& index, const std::wstring pat
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Face(pattern, face));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Face)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Face*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, face))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Face(pattern, face));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -900,20 +908,20 @@ void TextFormatD2D::UpdateInlineGradientColor(const size_t& index, const std::ws
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_GradientColor(pattern, angle, stops, altGamma));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::GradientColor)
 	{
 		auto option = dynamic_cast<TextInlineFormat_GradientColor*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, angle, stops, altGamma))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_GradientColor(pattern, angle, stops, altGamma));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -922,20 +930,20 @@ void TextFormatD2D::UpdateInlineItalic(const size_t& index, const std::wstring p
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Italic(pattern));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Italic)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Italic*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Italic(pattern));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -944,20 +952,20 @@ void TextFormatD2D::UpdateInlineOblique(const size_t& index, const std::wstring
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Oblique(pattern));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Oblique)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Oblique*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Oblique(pattern));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -967,20 +975,20 @@ void TextFormatD2D::UpdateInlineShadow(const size_t& index, const std::wstring p
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Shadow(pattern, blur, offset, color));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Shadow)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Shadow*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, blur, offset, color))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Shadow(pattern, blur, offset, color));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -989,20 +997,20 @@ void TextFormatD2D::UpdateInlineSize(const size_t& index, const std::wstring pat
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Size(pattern, size));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Size)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Size*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, size))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Size(pattern, size));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -1011,20 +1019,20 @@ void TextFormatD2D::UpdateInlineStretch(const size_t& index, const std::wstring
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Stretch(pattern, stretch));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Stretch)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Stretch*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, stretch))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Stretch(pattern, stretch));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -1033,20 +1041,20 @@ void TextFormatD2D::UpdateInlineStrikethrough(const size_t& index, const std::ws
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Strikethrough(pattern));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Strikethrough)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Strikethrough*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Strikethrough(pattern));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -1056,20 +1064,20 @@ void TextFormatD2D::UpdateInlineTypography(const size_t& index, const std::wstri
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Typography(pattern, tag, parameter));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Typography)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Typography*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, tag, parameter))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Typography(pattern, tag, parameter));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -1078,20 +1086,20 @@ void TextFormatD2D::UpdateInlineUnderline(const size_t& index, const std::wstrin
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Underline(pattern));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Underline)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Underline*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Underline(pattern));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -1100,20 +1108,20 @@ void TextFormatD2D::UpdateInlineWeight(const size_t& index, const std::wstring p
 	if (index >= m_TextInlineFormat.size())
 	{
 		m_TextInlineFormat.emplace_back(new TextInlineFormat_Weight(pattern, weight));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 	else if (m_TextInlineFormat[index]->GetType() == Gfx::InlineType::Weight)
 	{
 		auto option = dynamic_cast<TextInlineFormat_Weight*>(m_TextInlineFormat[index].get());
 		if (option->CompareAndUpdateProperties(pattern, weight))
 		{
-			m_HasInlineOptionsChanged = true;
+			++m_InlineOptionsVersion;
 		}
 	}
 	else
 	{
 		m_TextInlineFormat[index].reset(new TextInlineFormat_Weight(pattern, weight));
-		m_HasInlineOptionsChanged = true;
+		++m_InlineOptionsVersion;
 	}
 }
 
@@ -1148,11 +1156,6 @@ void TextFormatD2D::ApplyInlineColoring(ID2D1RenderTarget* target, const D2D1_PO
 			option->ApplyInlineFormat(m_TextLayout.Get(), point);
 		}
 	}
-
-	// Because it is expensive to recreate the text layout, we need some sort of way
-	// to tell the 'format' that the inline options have changed. Here, we reset that
-	// flag to false because the coloring of the text happen just before drawing.
-	m_HasInlineOptionsChanged = false;
 }
 
 void TextFormatD2D::ApplyInlineCase(std::wstring& str)
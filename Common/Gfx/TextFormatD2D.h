@@ -12,6 +12,7 @@
 #include "TextFormat.h"
 #include <memory>
 #include <string>
+#include <vector>
 #include <dwrite_1.h>
 #include <wrl/client.h>
 
@@ -45,18 +46,40 @@ public:
 	virtual void ReadInlineOptions(ConfigParser& parser, const WCHAR* section) override;
 	virtual void FindInlineRanges(const std::wstring& str) override;
 
+	// Number of layouts that were reused from the layout caches of all text formats and the number
+	// that had to be created.
+	static UINT64 GetLayoutCacheHits() { return c_LayoutCacheHits; }
+	static UINT64 GetLayoutCacheMisses() { return c_LayoutCacheMisses; }
+
 private:
 	friend class Canvas;
 
 	friend class Common_Gfx_TextFormatD2D_Test;
 
+	// DirectWrite text layout of a string along with the arguments it was created with.
+	struct CachedLayout
+	{
+		UINT32 hash;
+		std::wstring str;
+		float maxW;
+		float maxH;
+		bool gdiEmulation;
+		DWRITE_WORD_WRAPPING wordWrapping;
+		UINT inlineOptionsVersion;
+		Microsoft::WRL::ComPtr<IDWriteTextLayout> layout;
+	};
+
 	void Dispose();
 
-	// Creates a new DirectWrite text layout if |str| has changed since last call. Since creating
-	// the layout is costly, it is more efficient to keep reusing the text layout until the text
-	// changes. Returns true if the layout is valid for use.
+	// Sets |m_TextLayout| to the layout of |srcStr| for drawing. Returns true if the layout is valid
+	// for use.
 	bool CreateLayout(ID2D1RenderTarget* target, const std::wstring& srcStr, float maxW, float maxH, bool gdiEmulation);
 
+	// Returns the layout of the first |strLen| characters of |str| from the layout cache. Since
+	// creating the layout is costly, layouts are kept until they are the least recently used of the
+	// cache or until the inline options change.
+	IDWriteTextLayout* GetLayout(const WCHAR* str, UINT32 strLen, float maxW, float maxH, bool gdiEmulation);
+
 	DWRITE_TEXT_METRICS GetMetrics(const std::wstring& srcStr, bool gdiEmulation, float maxWidth = 10000.0f);
 
 	// These functions create/modify any inline options.
@@ -88,13 +111,15 @@ private:
 	void ResetInlineColoring(ID2D1SolidColorBrush* solidColor, const UINT32 strLen);
 
 	Microsoft::WRL::ComPtr<IDWriteTextFormat> m_TextFormat;
-	Microsoft::WRL::ComPtr<IDWriteTextLayout> m_TextLayout;
 	Microsoft::WRL::ComPtr<IDWriteInlineObject> m_InlineEllipsis;
 
-	std::wstring m_LastString;
+	// Layout of the last CreateLayout() call.
+	Microsoft::WRL::ComPtr<IDWriteTextLayout> m_TextLayout;
+
+	// Layouts shared by CreateLayout() and GetMetrics(), most recently used first.
+	std::vector<CachedLayout> m_Layouts;
 
 	int m_FontWeight;
-	bool m_HasWeightChanged;
 
 	// Used to emulate GDI+ behaviour.
 	float m_ExtraHeight;
@@ -105,7 +130,13 @@ private:
 
 	// Contains all the inline options for the layout.
 	std::vector<std::unique_ptr<TextInlineFormat>> m_TextInlineFormat;
-	bool m_HasInlineOptionsChanged;
+
+	// Incremented when the inline options or any other property that is applied to the layouts
+	// changes so that the cached layouts are no longer used.
+	UINT m_InlineOptionsVersion;
+
+	static UINT64 c_LayoutCacheHits;
+	static UINT64 c_LayoutCacheMisses;
 };
 
 }  // namespace Gfx
@@ -17,9 +17,12 @@ TEST_CLASS(Common_Gfx_TextFormatD2D_Test)
 public:
 	std::unique_ptr<Canvas> m_D2D;
 
-	Common_Gfx_TextFormatD2D_Test() :
-		m_D2D(Canvas::Create(Gfx::Renderer::D2D))
+	Common_Gfx_TextFormatD2D_Test()
 	{
+		// The WIC factory of Canvas is created with CoCreateInstance().
+		CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+		m_D2D.reset(new Canvas());
+
 		// TODO: Handle this in CanvasD2D.
 		ULONG_PTR gdiplusToken;
 		Gdiplus::GdiplusStartupInput gdiplusStartupInput;
@@ -36,11 +39,11 @@ public:
 
 		DWRITE_TEXT_METRICS metrics;
 
-		metrics = textFormat->GetMetrics(L"test", 4, true);
+		metrics = textFormat->GetMetrics(L"test", true);
 		Assert::AreEqual(26, (int)metrics.width);
 		Assert::AreEqual(16, (int)metrics.height);
 
-		metrics = textFormat->GetMetrics(L"test", 4, false);
+		metrics = textFormat->GetMetrics(L"test", false);
 		Assert::AreEqual(21, (int)metrics.width);
 		Assert::AreEqual(14, (int)metrics.height);
 	}
@@ -52,21 +55,52 @@ public:
 
 		DWRITE_TEXT_METRICS metrics;
 		
-		metrics = textFormat->GetMetrics(L"test\n", 5, false);
+		metrics = textFormat->GetMetrics(L"test\n", false);
 		Assert::AreEqual(15, (int)metrics.height);
-		metrics = textFormat->GetMetrics(L"test\r\n", 6, false);
+		metrics = textFormat->GetMetrics(L"test\r\n", false);
 		Assert::AreEqual(15, (int)metrics.height);
 
-		metrics = textFormat->GetMetrics(L"test\n ", 6, false);
+		metrics = textFormat->GetMetrics(L"test\n ", false);
 		Assert::AreEqual(30, (int)metrics.height);
-		metrics = textFormat->GetMetrics(L"test\r\n ", 7, false);
+		metrics = textFormat->GetMetrics(L"test\r\n ", false);
 		Assert::AreEqual(30, (int)metrics.height);
 
-		metrics = textFormat->GetMetrics(L"test\n\n", 6, false);
+		metrics = textFormat->GetMetrics(L"test\n\n", false);
 		Assert::AreEqual(30, (int)metrics.height);
-		metrics = textFormat->GetMetrics(L"test\r\n\r\n", 8, false);
+		metrics = textFormat->GetMetrics(L"test\r\n\r\n", false);
 		Assert::AreEqual(30, (int)metrics.height);
 	}
+
+	TEST_METHOD(TestLayoutCache)
+	{
+		std::unique_ptr<TextFormatD2D> textFormat((TextFormatD2D*)m_D2D->CreateTextFormat());
+		textFormat->SetProperties(L"Arial", 10, false, false, nullptr);
+
+		const UINT64 hits = TextFormatD2D::GetLayoutCacheHits();
+		const UINT64 misses = TextFormatD2D::GetLayoutCacheMisses();
+
+		IDWriteTextLayout* layout = textFormat->GetLayout(L"test", 4, 100.0f, 20.0f, false);
+		Assert::IsNotNull(layout);
+		Assert::IsTrue(layout == textFormat->GetLayout(L"test", 4, 100.0f, 20.0f, false));
+		Assert::AreEqual(hits + 1, TextFormatD2D::GetLayoutCacheHits());
+		Assert::AreEqual(misses + 1, TextFormatD2D::GetLayoutCacheMisses());
+
+		// Each string, size and emulation mode has its own layout.
+		Assert::IsTrue(layout != textFormat->GetLayout(L"test2", 5, 100.0f, 20.0f, false));
+		Assert::IsTrue(layout != textFormat->GetLayout(L"test", 4, 50.0f, 20.0f, false));
+		Assert::IsTrue(layout != textFormat->GetLayout(L"test", 4, 100.0f, 20.0f, true));
+		Assert::IsTrue(layout == textFormat->GetLayout(L"test", 4, 100.0f, 20.0f, false));
+		Assert::AreEqual(misses + 4, TextFormatD2D::GetLayoutCacheMisses());
+
+		// Measuring and drawing with the same size share the layout.
+		textFormat->CreateLayout(nullptr, L"test", 100.0f, 20.0f, false);
+		Assert::IsTrue(layout == textFormat->m_TextLayout.Get());
+
+		// Changing the weight invalidates the cached layouts.
+		textFormat->SetFontWeight(700);
+		Assert::IsTrue(layout != textFormat->GetLayout(L"test", 4, 100.0f, 20.0f, false));
+		Assert::AreEqual(misses + 5, TextFormatD2D::GetLayoutCacheMisses());
+	}
 };
 
 }  // namespace Gfx
@@ -0,0 +1,70 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "IniReader.h"
+#include "FileUtil.h"
+#include "StringUtil.h"
+
+IniReader::IniReader()
+{
+}
+
+IniReader::~IniReader()
+{
+}
+
+bool IniReader::ReadFile(const std::wstring& path)
+{
+	size_t size = 0;
+	auto data = FileUtil::ReadFullFile(path, &size);
+	if (!data)
+	{
+		m_Text.clear();
+		m_Tokenizer.Tokenize(m_Text.c_str(), 0);
+		return false;
+	}
+
+	Parse(data.get(), size);
+	return true;
+}
+
+void IniReader::Parse(const BYTE* data, size_t size)
+{
+	ParseText(Decode(data, size));
+}
+
+void IniReader::ParseText(std::wstring text)
+{
+	m_Text.swap(text);
+	m_Tokenizer.Tokenize(m_Text.c_str(), m_Text.length());
+}
+
+std::wstring IniReader::Decode(const BYTE* data, size_t size)
+{
+	std::wstring text;
+	if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE)
+	{
+		// UTF-16LE. Assemble the units manually so that this does not depend on sizeof(WCHAR).
+		const size_t length = (size - 2) / 2;
+		text.resize(length);
+		for (size_t i = 0; i < length; ++i)
+		{
+			const BYTE* unit = data + 2 + i * 2;
+			text[i] = (WCHAR)(unit[0] | (unit[1] << 8));
+		}
+	}
+	else if (size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF)
+	{
+		text = StringUtil::WidenUTF8((const char*)data + 3, (int)(size - 3));
+	}
+	else if (size > 0)
+	{
+		text = StringUtil::Widen((const char*)data, (int)size);
+	}
+	return text;
+}
@@ -0,0 +1,52 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_COMMON_INIREADER_H_
+#define RM_COMMON_INIREADER_H_
+
+#include <Windows.h>
+#include <string>
+#include "IniTokenizer.h"
+
+// Reads and decodes an ini file in a single pass and tokenizes it with IniTokenizer.
+class IniReader
+{
+public:
+	typedef IniTokenizer::Key Key;
+	typedef IniTokenizer::Section Section;
+
+	IniReader();
+	~IniReader();
+
+	IniReader(const IniReader& other) = delete;
+	IniReader& operator=(IniReader other) = delete;
+
+	// Returns false if the file could not be read.
+	bool ReadFile(const std::wstring& path);
+
+	// Parses the contents of a file. UTF-16LE and UTF-8 files must start with a BOM. Other files
+	// are decoded using the ANSI code page.
+	void Parse(const BYTE* data, size_t size);
+
+	void ParseText(std::wstring text);
+
+	const std::vector<Section>& GetSections() const { return m_Tokenizer.GetSections(); }
+	const Key& GetKey(size_t index) const { return m_Tokenizer.GetKey(index); }
+
+	// Returns the first section with the name (case insensitive) or nullptr if not found.
+	const Section* FindSection(const WCHAR* name) const { return m_Tokenizer.FindSection(name); }
+
+	static std::wstring Decode(const BYTE* data, size_t size);
+
+private:
+	// Names and values point to this.
+	std::wstring m_Text;
+
+	IniTokenizer m_Tokenizer;
+};
+
+#endif
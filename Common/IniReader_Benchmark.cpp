@@ -0,0 +1,118 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "IniReader.h"
+#include "StringUtil.h"
+#include "Timer.h"
+#include "UnitTest.h"
+#include <unordered_set>
+
+TEST_CLASS(Common_IniReader_Benchmark)
+{
+public:
+	TEST_METHOD(BenchmarkProfileVersusReader)
+	{
+		// The profile functions look in the Windows folder unless given a full path.
+		WCHAR folder[MAX_PATH];
+		GetFullPathName(L"..\\..\\..\\Build\\Skins\\", _countof(folder), folder, nullptr);
+
+		std::vector<std::wstring> files;
+		FindIniFiles(folder, files);
+		Assert::IsFalse(files.empty());
+
+		const int iterations = 50;
+		std::vector<WCHAR> names(65536);
+		std::vector<WCHAR> items(65536);
+		size_t profileKeys = 0;
+		size_t readerKeys = 0;
+
+		// Same calls as ConfigParser::ReadIniFile used to make: one pass over the file for the
+		// section names and another for each section.
+		Timer timer;
+		timer.Start();
+		for (int n = 0; n < iterations; ++n)
+		{
+			profileKeys = 0;
+			for (const auto& file : files)
+			{
+				std::unordered_set<std::wstring> unique;
+				GetPrivateProfileSectionNames(names.data(), (DWORD)names.size(), file.c_str());
+				for (const WCHAR* name = names.data(); *name; name += wcslen(name) + 1)
+				{
+					std::wstring upper = name;
+					StringUtil::ToUpperCase(upper);
+					if (!unique.insert(upper).second) continue;
+
+					GetPrivateProfileSection(name, items.data(), (DWORD)items.size(), file.c_str());
+					for (const WCHAR* item = items.data(); *item; item += wcslen(item) + 1)
+					{
+						const WCHAR* sep = wcschr(item, L'=');
+						if (*item != L';' && sep && sep != item) ++profileKeys;
+					}
+				}
+			}
+		}
+		timer.Stop();
+		const double profileTime = timer.GetElapsed();
+
+		timer.Start();
+		for (int n = 0; n < iterations; ++n)
+		{
+			readerKeys = 0;
+			for (const auto& file : files)
+			{
+				IniReader reader;
+				Assert::IsTrue(reader.ReadFile(file));
+				for (const auto& section : reader.GetSections())
+				{
+					const std::wstring name(section.name, section.nameLength);
+					if (reader.FindSection(name.c_str()) == &section) readerKeys += section.keyCount;
+				}
+			}
+		}
+		timer.Stop();
+		const double readerTime = timer.GetElapsed();
+
+		Assert::AreEqual((int)profileKeys, (int)readerKeys);
+
+		WCHAR buffer[256];
+		_snwprintf_s(buffer, _TRUNCATE,
+			L"IniReader: %i files, %i keys. Profile API: %.2f ms, IniReader: %.2f ms (%.1fx)\n",
+			(int)files.size(), (int)readerKeys, profileTime, readerTime, profileTime / readerTime);
+		Logger::WriteMessage(buffer);
+	}
+
+	static void FindIniFiles(const std::wstring& folder, std::vector<std::wstring>& files)
+	{
+		WIN32_FIND_DATA fd;
+		HANDLE hSearch = FindFirstFile((folder + L'*').c_str(), &fd);
+		if (hSearch == INVALID_HANDLE_VALUE) return;
+
+		do
+		{
+			const WCHAR* name = fd.cFileName;
+			if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				if (wcscmp(name, L".") != 0 && wcscmp(name, L"..") != 0)
+				{
+					FindIniFiles(folder + name + L'\\', files);
+				}
+			}
+			else
+			{
+				const size_t length = wcslen(name);
+				if (length > 4 && _wcsicmp(name + length - 4, L".ini") == 0)
+				{
+					files.push_back(folder + name);
+				}
+			}
+		}
+		while (FindNextFile(hSearch, &fd));
+
+		FindClose(hSearch);
+	}
+};
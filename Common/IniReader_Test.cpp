@@ -0,0 +1,90 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "IniReader.h"
+#include "UnitTest.h"
+
+TEST_CLASS(Common_IniReader_Test)
+{
+public:
+	TEST_METHOD(TestParse)
+	{
+		IniReader reader;
+		reader.ParseText(
+			L"Ignored=before first section\r\n"
+			L"[Section1]\r\n"
+			L"Key1=Value1\r\n"
+			L"  Key2  =  Value 2  \r\n"
+			L"; Comment=ignored\r\n"
+			L"NoValue\r\n"
+			L"=NoName\r\n"
+			L"Key3=\r\n"
+			L"Key4=a=b\n"
+			L"\r\n"
+			L"  [Section]2] ; Comment\r\n"
+			L"[Unterminated=value\r\n"
+			L"[section1]\r\n"
+			L"Key1=Duplicate");
+
+		const auto& sections = reader.GetSections();
+		Assert::AreEqual(3, (int)sections.size());
+
+		Assert::AreEqual(L"Section1", GetName(sections[0]).c_str());
+		Assert::AreEqual(4, (int)sections[0].keyCount);
+		AssertKey(reader, sections[0], 0, L"Key1", L"Value1");
+		AssertKey(reader, sections[0], 1, L"Key2", L"Value 2");
+		AssertKey(reader, sections[0], 2, L"Key3", L"");
+		AssertKey(reader, sections[0], 3, L"Key4", L"a=b");
+
+		Assert::AreEqual(L"Section]2", GetName(sections[1]).c_str());
+		Assert::AreEqual(1, (int)sections[1].keyCount);
+		AssertKey(reader, sections[1], 0, L"[Unterminated", L"value");
+
+		Assert::AreEqual(L"section1", GetName(sections[2]).c_str());
+		AssertKey(reader, sections[2], 0, L"Key1", L"Duplicate");
+
+		// The first section with the name is used like GetPrivateProfileSection does.
+		Assert::IsTrue(reader.FindSection(L"SECTION1") == &sections[0]);
+		Assert::IsTrue(reader.FindSection(L"Section") == nullptr);
+	}
+
+	TEST_METHOD(TestEncodings)
+	{
+		const BYTE utf16[] = { 0xFF, 0xFE, '[', 0, 'A', 0, ']', 0, '\n', 0, 'K', 0, '=', 0, 0x22, 0x04 };
+		const BYTE utf8[] = { 0xEF, 0xBB, 0xBF, '[', 'A', ']', '\n', 'K', '=', 0xD0, 0xA2 };
+		const BYTE ansi[] = { '[', 'A', ']', '\n', 'K', '=', 'v' };
+
+		IniReader reader;
+		reader.Parse(utf16, sizeof(utf16));
+		Assert::AreEqual(1, (int)reader.GetSections().size());
+		AssertKey(reader, reader.GetSections()[0], 0, L"K", L"\x0422");
+
+		reader.Parse(utf8, sizeof(utf8));
+		Assert::AreEqual(1, (int)reader.GetSections().size());
+		AssertKey(reader, reader.GetSections()[0], 0, L"K", L"\x0422");
+
+		reader.Parse(ansi, sizeof(ansi));
+		Assert::AreEqual(1, (int)reader.GetSections().size());
+		AssertKey(reader, reader.GetSections()[0], 0, L"K", L"v");
+
+		reader.Parse(ansi, 0);
+		Assert::IsTrue(reader.GetSections().empty());
+	}
+
+	static std::wstring GetName(const IniReader::Section& section)
+	{
+		return std::wstring(section.name, section.nameLength);
+	}
+
+	static void AssertKey(const IniReader& reader, const IniReader::Section& section, size_t index, const WCHAR* name, const WCHAR* value)
+	{
+		Assert::IsTrue(index < section.keyCount);
+		const IniReader::Key& key = reader.GetKey(section.firstKey + index);
+		Assert::AreEqual(name, std::wstring(key.name, key.nameLength).c_str());
+		Assert::AreEqual(value, std::wstring(key.value, key.valueLength).c_str());
+	}
+};
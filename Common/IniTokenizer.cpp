@@ -0,0 +1,94 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "IniTokenizer.h"
+#include <algorithm>
+#include <cwchar>
+#include <cwctype>
+
+namespace {
+
+// Same as the profile functions: 0x1A (end of file) is treated as whitespace.
+bool IsSpace(wchar_t ch)
+{
+	return ch == L' ' || (ch >= L'\t' && ch <= L'\r') || ch == 0x1A;
+}
+
+}  // namespace
+
+IniTokenizer::IniTokenizer()
+{
+}
+
+IniTokenizer::~IniTokenizer()
+{
+}
+
+void IniTokenizer::Tokenize(const wchar_t* text, size_t length)
+{
+	m_Sections.clear();
+	m_Keys.clear();
+
+	const wchar_t* pos = text;
+	const wchar_t* const end = text + length;
+	while (pos < end)
+	{
+		const wchar_t* lineStart = pos;
+		const wchar_t* lineEnd = std::find(pos, end, L'\n');
+		pos = (lineEnd < end) ? lineEnd + 1 : end;
+
+		while (lineStart < lineEnd && IsSpace(*lineStart)) ++lineStart;
+		while (lineEnd > lineStart && IsSpace(lineEnd[-1])) --lineEnd;
+		if (lineStart == lineEnd) continue;
+
+		if (*lineStart == L'[')
+		{
+			const wchar_t* nameEnd = lineEnd - 1;
+			while (nameEnd > lineStart && *nameEnd != L']') --nameEnd;
+			if (nameEnd > lineStart)
+			{
+				Section section = { lineStart + 1, (size_t)(nameEnd - lineStart - 1), m_Keys.size(), 0 };
+				m_Sections.push_back(section);
+				continue;
+			}
+
+			// Otherwise handled as a key line.
+		}
+
+		if (m_Sections.empty() || *lineStart == L';') continue;
+
+		const wchar_t* sep = std::find(lineStart, lineEnd, L'=');
+		if (sep == lineEnd) continue;
+
+		const wchar_t* nameEnd = sep;
+		while (nameEnd > lineStart && IsSpace(nameEnd[-1])) --nameEnd;
+		if (nameEnd == lineStart) continue;
+
+		const wchar_t* value = sep + 1;
+		while (value < lineEnd && IsSpace(*value)) ++value;
+
+		Key key = { lineStart, (size_t)(nameEnd - lineStart), value, (size_t)(lineEnd - value) };
+		m_Keys.push_back(key);
+		++m_Sections.back().keyCount;
+	}
+}
+
+const IniTokenizer::Section* IniTokenizer::FindSection(const wchar_t* name) const
+{
+	const size_t nameLength = wcslen(name);
+	for (const auto& section : m_Sections)
+	{
+		if (section.nameLength == nameLength &&
+			std::equal(name, name + nameLength, section.name,
+				[](wchar_t ch1, wchar_t ch2) { return towupper(ch1) == towupper(ch2); }))
+		{
+			return &section;
+		}
+	}
+
+	return nullptr;
+}
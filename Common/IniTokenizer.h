@@ -0,0 +1,63 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_COMMON_INITOKENIZER_H_
+#define RM_COMMON_INITOKENIZER_H_
+
+#include <cstddef>
+#include <vector>
+
+// Splits decoded ini text into sections and keys. Lines are interpreted the same way as by
+// GetPrivateProfileSectionNames and GetPrivateProfileSection:
+//   - Lines are trimmed. Empty lines and lines starting with ';' are ignored.
+//   - A line starting with '[' that contains ']' starts a section. The name ends at the last ']'.
+//   - Whitespace around the first '=' of a key line is removed. Lines without '=' or without a
+//     key name are ignored, as are lines before the first section.
+// Duplicate sections and keys are kept in file order. The caller decides which one is used.
+//
+// This only uses the standard library so that it can be tested and benchmarked on any platform.
+// See IniTokenizer_Portable.cpp. Reading and decoding files is done by IniReader.
+class IniTokenizer
+{
+public:
+	struct Key
+	{
+		const wchar_t* name;
+		size_t nameLength;
+		const wchar_t* value;
+		size_t valueLength;
+	};
+
+	struct Section
+	{
+		const wchar_t* name;
+		size_t nameLength;
+		size_t firstKey;	// Index for GetKey()
+		size_t keyCount;
+	};
+
+	IniTokenizer();
+	~IniTokenizer();
+
+	IniTokenizer(const IniTokenizer& other) = delete;
+	IniTokenizer& operator=(IniTokenizer other) = delete;
+
+	// Names and values point into |text|, which must outlive the results.
+	void Tokenize(const wchar_t* text, size_t length);
+
+	const std::vector<Section>& GetSections() const { return m_Sections; }
+	const Key& GetKey(size_t index) const { return m_Keys[index]; }
+
+	// Returns the first section with the name (case insensitive) or nullptr if not found.
+	const Section* FindSection(const wchar_t* name) const;
+
+private:
+	std::vector<Section> m_Sections;
+	std::vector<Key> m_Keys;
+};
+
+#endif
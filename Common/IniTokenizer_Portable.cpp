@@ -0,0 +1,223 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+// Standalone test and benchmark for IniTokenizer. It only uses the standard library so that the
+// tokenizer can be checked on any platform. It is not part of the Visual Studio solution, which
+// runs the IniReader tests through Common_Test instead. To build and run it:
+//
+//   c++ -std=c++14 -O2 -o IniTokenizer_Portable IniTokenizer.cpp IniTokenizer_Portable.cpp
+//   ./IniTokenizer_Portable ../Build/Skins/illustro/*/*.ini
+//
+// The unit tests always run. Each file given on the command line is added to the benchmark
+// corpus. The exit code is non-zero if a test fails.
+
+#include "IniTokenizer.h"
+#include <chrono>
+#include <cstdio>
+#include <cwctype>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+int g_Failures = 0;
+
+void Check(bool condition, const char* expression, int line)
+{
+	if (!condition)
+	{
+		fprintf(stderr, "IniTokenizer_Portable.cpp(%i): Check failed: %s\n", line, expression);
+		++g_Failures;
+	}
+}
+
+#define CHECK(expression) Check(!!(expression), #expression, __LINE__)
+
+std::wstring GetName(const IniTokenizer::Section& section)
+{
+	return std::wstring(section.name, section.nameLength);
+}
+
+bool HasKey(const IniTokenizer& tokenizer, const IniTokenizer::Section& section, size_t index, const wchar_t* name, const wchar_t* value)
+{
+	if (index >= section.keyCount) return false;
+
+	const IniTokenizer::Key& key = tokenizer.GetKey(section.firstKey + index);
+	return std::wstring(key.name, key.nameLength) == name &&
+		std::wstring(key.value, key.valueLength) == value;
+}
+
+void TestTokenize()
+{
+	const std::wstring text =
+		L"Ignored=before first section\r\n"
+		L"[Section1]\r\n"
+		L"Key1=Value1\r\n"
+		L"  Key2  =  Value 2  \r\n"
+		L"; Comment=ignored\r\n"
+		L"NoValue\r\n"
+		L"=NoName\r\n"
+		L"Key3=\r\n"
+		L"Key4=a=b\n"
+		L"\r\n"
+		L"  [Section]2] ; Comment\r\n"
+		L"[Unterminated=value\r\n"
+		L"[section1]\r\n"
+		L"Key1=Duplicate\x1A";
+
+	IniTokenizer tokenizer;
+	tokenizer.Tokenize(text.c_str(), text.length());
+
+	const auto& sections = tokenizer.GetSections();
+	CHECK(sections.size() == 3);
+	if (sections.size() != 3) return;
+
+	CHECK(GetName(sections[0]) == L"Section1");
+	CHECK(sections[0].keyCount == 4);
+	CHECK(HasKey(tokenizer, sections[0], 0, L"Key1", L"Value1"));
+	CHECK(HasKey(tokenizer, sections[0], 1, L"Key2", L"Value 2"));
+	CHECK(HasKey(tokenizer, sections[0], 2, L"Key3", L""));
+	CHECK(HasKey(tokenizer, sections[0], 3, L"Key4", L"a=b"));
+
+	CHECK(GetName(sections[1]) == L"Section]2");
+	CHECK(sections[1].keyCount == 1);
+	CHECK(HasKey(tokenizer, sections[1], 0, L"[Unterminated", L"value"));
+
+	CHECK(GetName(sections[2]) == L"section1");
+	CHECK(HasKey(tokenizer, sections[2], 0, L"Key1", L"Duplicate"));
+
+	// The first section with the name is used like GetPrivateProfileSection does.
+	CHECK(tokenizer.FindSection(L"SECTION1") == &sections[0]);
+	CHECK(tokenizer.FindSection(L"Section") == nullptr);
+
+	// Results only point into the last text.
+	tokenizer.Tokenize(text.c_str(), 0);
+	CHECK(tokenizer.GetSections().empty());
+
+	const std::wstring noNewline = L"[A]\nK=V";
+	tokenizer.Tokenize(noNewline.c_str(), noNewline.length());
+	CHECK(tokenizer.GetSections().size() == 1);
+	CHECK(HasKey(tokenizer, tokenizer.GetSections()[0], 0, L"K", L"V"));
+}
+
+// Decodes UTF-16LE files with a BOM. Other files are widened byte by byte, which is enough for
+// the ASCII skins used as the corpus. IniReader::Decode handles the other encodings on Windows.
+std::wstring ReadCorpusFile(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	std::wstring text;
+	if (data.size() >= 2 && (unsigned char)data[0] == 0xFF && (unsigned char)data[1] == 0xFE)
+	{
+		for (size_t i = 2; i + 1 < data.size(); i += 2)
+		{
+			text += (wchar_t)((unsigned char)data[i] | ((unsigned char)data[i + 1] << 8));
+		}
+	}
+	else
+	{
+		for (char ch : data) text += (wchar_t)(unsigned char)ch;
+	}
+	return text;
+}
+
+// Counts the keys that ConfigParser would use: the first section with each name.
+size_t CountKeys(const IniTokenizer& tokenizer)
+{
+	size_t keys = 0;
+	for (const auto& section : tokenizer.GetSections())
+	{
+		const std::wstring name(section.name, section.nameLength);
+		if (tokenizer.FindSection(name.c_str()) == &section) keys += section.keyCount;
+	}
+	return keys;
+}
+
+double GetElapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Compares a single pass over each file with the profile function pattern that ConfigParser used
+// to have: one pass for the section names and another pass over the whole file for each section.
+void BenchmarkTokenize(const std::vector<std::wstring>& corpus)
+{
+	const int iterations = 200;
+	size_t bytes = 0;
+	for (const auto& text : corpus) bytes += text.length() * sizeof(wchar_t);
+
+	size_t perSectionKeys = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int n = 0; n < iterations; ++n)
+	{
+		perSectionKeys = 0;
+		for (const auto& text : corpus)
+		{
+			IniTokenizer names;
+			names.Tokenize(text.c_str(), text.length());
+
+			std::unordered_set<std::wstring> unique;
+			for (const auto& section : names.GetSections())
+			{
+				std::wstring upper(section.name, section.nameLength);
+				for (auto& ch : upper) ch = towupper(ch);
+				if (!unique.insert(upper).second) continue;
+
+				IniTokenizer items;
+				items.Tokenize(text.c_str(), text.length());
+				perSectionKeys += items.FindSection(upper.c_str())->keyCount;
+			}
+		}
+	}
+	const double perSectionTime = GetElapsed(start);
+
+	size_t singlePassKeys = 0;
+	start = std::chrono::steady_clock::now();
+	for (int n = 0; n < iterations; ++n)
+	{
+		singlePassKeys = 0;
+		for (const auto& text : corpus)
+		{
+			IniTokenizer tokenizer;
+			tokenizer.Tokenize(text.c_str(), text.length());
+			singlePassKeys += CountKeys(tokenizer);
+		}
+	}
+	const double singlePassTime = GetElapsed(start);
+
+	CHECK(perSectionKeys == singlePassKeys);
+
+	printf("IniTokenizer: %i files, %i keys, %.1f KB. Per section: %.2f ms, single pass: %.2f ms (%.1fx, %.1f MB/s)\n",
+		(int)corpus.size(), (int)singlePassKeys, bytes / 1024.0, perSectionTime, singlePassTime,
+		perSectionTime / singlePassTime, bytes * iterations / (singlePassTime * 1000.0));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	TestTokenize();
+
+	std::vector<std::wstring> corpus;
+	for (int i = 1; i < argc; ++i)
+	{
+		corpus.push_back(ReadCorpusFile(argv[i]));
+		CHECK(!corpus.back().empty());
+	}
+
+	if (!corpus.empty())
+	{
+		BenchmarkTokenize(corpus);
+	}
+
+	printf("IniTokenizer: %s\n", g_Failures == 0 ? "all checks passed" : "FAILED");
+	return g_Failures == 0 ? 0 : 1;
+}
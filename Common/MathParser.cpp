@@ -202,19 +202,40 @@ static CharType GetCharType(WCHAR ch);
 static BYTE GetFunctionIndex(const WCHAR* str, BYTE len);
 static Operator GetOperator(const WCHAR* str);
 
+// Instruction types used in compiled programs in addition to the Operator values.
+static const BYTE INSTR_NUMBER = (BYTE)Operator::Invalid + 1;
+static const BYTE INSTR_VARIABLE = (BYTE)Operator::Invalid + 2;
+static const BYTE INSTR_BOUND = (BYTE)Operator::Invalid + 3;
+
+// Value produced by the compiler at parse time. |codeStart| is the index of the first instruction
+// that contributes to the value so that constant subexpressions can be folded into a single
+// instruction.
+struct Operand
+{
+	size_t codeStart;
+	bool constant;
+	double num;
+};
+
 struct Parser
 {
 	Operation opStack[96];
-	double numStack[64];
+	Operand numStack[64];
 	char opTop;
 	char valTop;
 	int obrDist;
 
-	Parser() : opTop(0), valTop(-1), obrDist(2) { opStack[0].type = Operator::OpeningBracket; }
+	std::vector<Program::Instruction>& code;
+
+	Parser(std::vector<Program::Instruction>& code) : opTop(0), valTop(-1), obrDist(2), code(code)
+	{
+		opStack[0].type = Operator::OpeningBracket;
+	}
 };
 
 static const WCHAR* CalcToObr(Parser& parser);
 static const WCHAR* Calc(Parser& parser);
+static const WCHAR* Execute(const Program::Instruction& instr, double* args, double* result);
 
 struct Lexer
 {
@@ -276,27 +297,56 @@ const WCHAR* CheckedParse(const WCHAR* formula, double* result)
 	return error;
 }
 
+
+Program::Program() :
+	m_Formula(),
+	m_Code(),
+	m_GetBoundValue()
+{
+}
+
+void Program::Clear()
+{
+	m_Formula.clear();
+	m_Code.clear();
+	m_GetBoundValue = nullptr;
+}
+
 const WCHAR* Parse(
 	const WCHAR* formula, double* result, GetValueFunc getValue, void* getValueContext)
 {
-	static WCHAR errorBuffer[128];
+	Program program;
+	const WCHAR* error = Compile(formula, &program);
+	if (!error)
+	{
+		error = Evaluate(program, result, getValue, getValueContext);
+	}
+	return error;
+}
+
+const WCHAR* Compile(const WCHAR* formula, Program* program)
+{
+	program->Clear();
+	program->m_Formula = formula;
 
 	if (!*formula)
 	{
-		*result = 0.0;
 		return nullptr;
 	}
 
-	Parser parser;
-	Lexer lexer(formula);
+	// Lex the stored copy so that variable names can refer to it by offset.
+	const WCHAR* source = program->m_Formula.c_str();
+	Parser parser(program->m_Code);
+	Lexer lexer(source);
 
-	const WCHAR* error;
+	const WCHAR* error = nullptr;
 	for (;;)
 	{
 		if ((parser.opTop == _countof(parser.opStack) - 2) ||
 			(parser.valTop == _countof(parser.numStack) - 2))
 		{
-			return eInternal;
+			error = eInternal;
+			break;
 		}
 
 		Token token = GetNextToken(lexer);
@@ -304,27 +354,34 @@ const WCHAR* Parse(
 		switch (token)
 		{
 		case Token::Error:
-			return eSyntax;
+			error = eSyntax;
+			break;
 
 		case Token::Final:
-			if ((error = CalcToObr(parser)) != nullptr)
+			if ((error = CalcToObr(parser)) == nullptr &&
+				(parser.opTop != -1 || parser.valTop != 0))
 			{
-				return error;
+				error = eInternal;
 			}
-			else if (parser.opTop != -1 || parser.valTop != 0)
-			{
-				return eInternal;
-			}
-			else
+
+			if (!error)
 			{
 				// Done!
-				*result = parser.numStack[0];
 				return nullptr;
 			}
 			break;
 
 		case Token::Number:
-			parser.numStack[++parser.valTop] = lexer.value.num;
+			{
+				Program::Instruction instr = { INSTR_NUMBER };
+				instr.num = lexer.value.num;
+
+				Operand& operand = parser.numStack[++parser.valTop];
+				operand.codeStart = parser.code.size();
+				operand.constant = true;
+				operand.num = instr.num;
+				parser.code.push_back(instr);
+			}
 			break;
 
 		case Token::Operator:
@@ -339,14 +396,14 @@ const WCHAR* Parse(
 
 			case Operator::ClosingBracket:
 				{
-					if ((error = CalcToObr(parser)) != nullptr) return error;
+					error = CalcToObr(parser);
 				}
 				break;
 
 			case Operator::Comma:
 				{
-					if ((error = CalcToObr(parser)) != nullptr) return error;
-						
+					if ((error = CalcToObr(parser)) != nullptr) break;
+
 					if (parser.opStack[parser.opTop].type == Operator::MultiArgFunction)
 					{
 						parser.opStack[++parser.opTop] = g_BrOp;
@@ -354,7 +411,7 @@ const WCHAR* Parse(
 					}
 					else
 					{
-						return eSyntax;
+						error = eSyntax;
 					}
 				}
 				break;
@@ -391,9 +448,13 @@ const WCHAR* Parse(
 
 					while (g_OpPriorities[(int)op.type] <= g_OpPriorities[(int)parser.opStack[parser.opTop].type])
 					{
-						if ((error = Calc(parser)) != nullptr) return error;
+						if ((error = Calc(parser)) != nullptr) break;
+					}
+
+					if (!error)
+					{
+						parser.opStack[++parser.opTop] = op;
 					}
-					parser.opStack[++parser.opTop] = op;
 				}
 				break;
 			}
@@ -408,11 +469,17 @@ const WCHAR* Parse(
 					switch (op.funcIndex)
 					{
 					case FUNC_E:
-						parser.numStack[++parser.valTop] = M_E;
-						break;
-
 					case FUNC_PI:
-						parser.numStack[++parser.valTop] = M_PI;
+						{
+							Program::Instruction instr = { INSTR_NUMBER };
+							instr.num = (op.funcIndex == FUNC_E) ? M_E : M_PI;
+
+							Operand& operand = parser.numStack[++parser.valTop];
+							operand.codeStart = parser.code.size();
+							operand.constant = true;
+							operand.num = instr.num;
+							parser.code.push_back(instr);
+						}
 						break;
 
 					case FUNC_ATAN2:
@@ -433,74 +500,250 @@ const WCHAR* Parse(
 				}
 				else
 				{
-					double dblval;
-					if (getValue && getValue(lexer.name, (int)lexer.nameLen, &dblval, getValueContext))
-					{
-						parser.numStack[++parser.valTop] = dblval;
-						break;
-					}
-
-					const std::wstring name(lexer.name, lexer.nameLen);
-					_snwprintf_s(errorBuffer, _TRUNCATE, eUnknFunc, name.c_str());
-					return errorBuffer;
+					// Resolved through GetValueFunc when the program is evaluated.
+					Program::Instruction instr = { INSTR_VARIABLE };
+					instr.name.start = (UINT)(lexer.name - source);
+					instr.name.length = (UINT)lexer.nameLen;
+
+					Operand& operand = parser.numStack[++parser.valTop];
+					operand.codeStart = parser.code.size();
+					operand.constant = false;
+					operand.num = 0.0;
+					parser.code.push_back(instr);
 				}
 				break;
 			}
 
 		default:
-			return eSyntax;
+			error = eSyntax;
+			break;
+		}
+
+		if (error) break;
+	}
+
+	program->m_Code.clear();
+	return error;
+}
+
+const WCHAR* Evaluate(
+	const Program& program, double* result, GetValueFunc getValue, void* getValueContext)
+{
+	static WCHAR errorBuffer[128];
+
+	if (program.m_Code.empty())
+	{
+		*result = 0.0;
+		return nullptr;
+	}
+
+	// The compiler guarantees that the stack depth never exceeds that of the parser.
+	double numStack[64];
+	int valTop = -1;
+
+	for (const auto& instr : program.m_Code)
+	{
+		int argCount;
+		switch (instr.type)
+		{
+		case INSTR_NUMBER:
+			numStack[++valTop] = instr.num;
+			continue;
+
+		case INSTR_VARIABLE:
+			{
+				const WCHAR* name = program.m_Formula.c_str() + instr.name.start;
+				if (getValue && getValue(name, (int)instr.name.length, &numStack[valTop + 1], getValueContext))
+				{
+					++valTop;
+					continue;
+				}
+
+				const std::wstring nameStr(name, instr.name.length);
+				_snwprintf_s(errorBuffer, _TRUNCATE, eUnknFunc, nameStr.c_str());
+				return errorBuffer;
+			}
+
+		case INSTR_BOUND:
+			numStack[++valTop] = program.m_GetBoundValue(instr.handle);
+			continue;
+
+		case (BYTE)Operator::MultiArgFunction:
+			argCount = instr.paramCount;
+			break;
+
+		case (BYTE)Operator::SingleArgFunction:
+		case (BYTE)Operator::BitwiseNOT:
+			argCount = 1;
+			break;
+
+		case (BYTE)Operator::ConditionalSeparator:
+			argCount = 3;
+			break;
+
+		default:
+			argCount = 2;
+			break;
+		}
+
+		valTop -= argCount - 1;
+		const WCHAR* error = Execute(instr, &numStack[valTop], &numStack[valTop]);
+		if (error) return error;
+	}
+
+	*result = numStack[0];
+	return nullptr;
+}
+
+void Bind(Program* program, BindFunc bind, GetBoundValueFunc getBoundValue, void* bindContext)
+{
+	const WCHAR* source = program->m_Formula.c_str();
+	for (auto& instr : program->m_Code)
+	{
+		if (instr.type == INSTR_VARIABLE)
+		{
+			void* handle = bind(source + instr.name.start, (int)instr.name.length, bindContext);
+			if (handle)
+			{
+				instr.type = INSTR_BOUND;
+				instr.handle = handle;
+			}
 		}
 	}
+
+	program->m_GetBoundValue = getBoundValue;
 }
 
+/*
+** Emits the instruction for the operation on top of the operator stack. If all operands are
+** constant, the operation is executed right away and replaced with its result.
+*/
 static const WCHAR* Calc(Parser& parser)
 {
-	double res;
 	Operation op = parser.opStack[parser.opTop--];
 
+	Program::Instruction instr = { (BYTE)op.type, op.funcIndex };
+	int argCount;
+
 	// Multi-argument function
 	if (op.type == Operator::Conditional)
 	{
-		return nullptr; 
+		return nullptr;
 	}
 	else if (op.type == Operator::MultiArgFunction)
 	{
-		int paramcnt = parser.valTop - op.prevTop;
-
-		parser.valTop = op.prevTop;
-		const WCHAR* error = (*(MultiArgFunction)g_Functions[op.funcIndex].proc)(paramcnt, &parser.numStack[parser.valTop + 1], &res);
-		if (error) return error;
+		argCount = parser.valTop - op.prevTop;
+		if (argCount < 0) return eInvPrmCnt;
 
-		parser.numStack[++parser.valTop] = res;
-		return nullptr;
+		instr.paramCount = (BYTE)argCount;
 	}
 	else if (parser.valTop < 0)
 	{
 		return eExtraOp;
 	}
+	else if (op.type == Operator::BitwiseNOT || op.type == Operator::SingleArgFunction)
+	{
+		// One arg operations
+		argCount = 1;
+	}
+	else if (parser.valTop < 1)
+	{
+		return eExtraOp;
+	}
+	else if (op.type == Operator::ConditionalSeparator)
+	{
+		// Needs three arguments
+		if (parser.opTop < 0 || parser.opStack[parser.opTop--].type != Operator::Conditional ||
+			parser.valTop < 2)
+		{
+			return eLogicErr;
+		}
+		argCount = 3;
+	}
+	else
+	{
+		argCount = 2;
+	}
 
-	// Right arg
-	double right = parser.numStack[parser.valTop--];
+	const int first = parser.valTop - argCount + 1;
+	Operand& result = parser.numStack[first];
+	const size_t codeStart = (argCount > 0) ? result.codeStart : parser.code.size();
 
-	// One arg operations
-	if (op.type == Operator::BitwiseNOT)
+	bool constant = true;
+	double args[_countof(parser.numStack)];
+	for (int i = 0; i < argCount; ++i)
 	{
-		res = (double)(~((long long)right));
+		const Operand& operand = parser.numStack[first + i];
+		constant = constant && operand.constant;
+		args[i] = operand.num;
 	}
-	else if (op.type == Operator::SingleArgFunction)
+
+	parser.valTop = first;
+	result.codeStart = codeStart;
+	result.constant = constant;
+
+	if (constant)
 	{
-		res = (*(SingleArgFunction)g_Functions[op.funcIndex].proc)(right);
+		const WCHAR* error = Execute(instr, args, &result.num);
+		if (error) return error;
+
+		instr.type = INSTR_NUMBER;
+		instr.num = result.num;
+		parser.code.resize(codeStart);
 	}
 	else
 	{
-		if (parser.valTop < 0)
-		{
-			return eExtraOp;
-		}
+		result.num = 0.0;
+	}
 
-		// Left arg
-		double left = parser.numStack[parser.valTop--];
-		switch (op.type)
+	parser.code.push_back(instr);
+	return nullptr;
+}
+
+static const WCHAR* CalcToObr(Parser& parser)
+{
+	while (parser.opStack[parser.opTop].type != Operator::OpeningBracket)
+	{
+		const WCHAR* error = Calc(parser);
+		if (error) return error;
+	}
+	--parser.opTop;
+	return nullptr;
+}
+
+/*
+** Executes a single operation instruction. |args| contains the operands in the order they were
+** pushed and may alias |result|.
+*/
+static const WCHAR* Execute(const Program::Instruction& instr, double* args, double* result)
+{
+	double res;
+	const Operator type = (Operator)instr.type;
+
+	if (type == Operator::MultiArgFunction)
+	{
+		const WCHAR* error =
+			(*(MultiArgFunction)g_Functions[instr.funcIndex].proc)(instr.paramCount, args, &res);
+		if (error) return error;
+
+		*result = res;
+		return nullptr;
+	}
+
+	// One arg operations
+	if (type == Operator::BitwiseNOT)
+	{
+		res = (double)(~((long long)args[0]));
+	}
+	else if (type == Operator::SingleArgFunction)
+	{
+		res = (*(SingleArgFunction)g_Functions[instr.funcIndex].proc)(args[0]);
+	}
+	else
+	{
+		const double left = args[0];
+		const double right = args[1];
+		switch (type)
 		{
 		case Operator::ShiftLeft:
 			res = (double)((long long)left << (long long)right);
@@ -601,14 +844,8 @@ static const WCHAR* Calc(Parser& parser)
 			break;
 
 		case Operator::ConditionalSeparator:
-			{
-				// Needs three arguments
-				if (parser.opTop < 0 || parser.opStack[parser.opTop--].type != Operator::Conditional)
-				{
-					return eLogicErr;
-				}
-				res = parser.numStack[parser.valTop--] ? left : right;
-			}
+			// args[0] is the condition, args[1] and args[2] are the branches.
+			res = args[0] ? args[1] : args[2];
 			break;
 
 		default:
@@ -616,18 +853,7 @@ static const WCHAR* Calc(Parser& parser)
 		}
 	}
 
-	parser.numStack[++parser.valTop] = res;
-	return nullptr;
-}
-
-static const WCHAR* CalcToObr(Parser& parser)
-{
-	while (parser.opStack[parser.opTop].type != Operator::OpeningBracket)
-	{
-		const WCHAR* error = Calc(parser);
-		if (error) return error;
-	}
-	--parser.opTop;
+	*result = res;
 	return nullptr;
 }
 
@@ -11,10 +11,55 @@
 #define RM_COMMON_MATHPARSER_H_
 
 #include <Windows.h>
+#include <string>
+#include <vector>
 
 namespace MathParser
 {
 	typedef bool (*GetValueFunc)(const WCHAR* str, int len, double* value, void* context);
+	typedef void* (*BindFunc)(const WCHAR* str, int len, void* context);
+	typedef double (*GetBoundValueFunc)(void* handle);
+
+	// A formula compiled into postfix form by Compile(). Built-in functions are resolved and
+	// constant subexpressions are folded at compile time. Other names are looked up through the
+	// GetValueFunc passed to Evaluate() unless they have been bound to handles with Bind().
+	class Program
+	{
+	public:
+		Program();
+
+		const std::wstring& GetFormula() const { return m_Formula; }
+
+		struct Instruction
+		{
+			BYTE type;
+			BYTE funcIndex;
+			BYTE paramCount;
+			union
+			{
+				double num;
+				struct
+				{
+					UINT start;
+					UINT length;
+				} name;
+				void* handle;
+			};
+		};
+
+	private:
+		friend const WCHAR* Compile(const WCHAR* formula, Program* program);
+		friend const WCHAR* Evaluate(
+			const Program& program, double* result, GetValueFunc getValue, void* getValueContext);
+		friend void Bind(
+			Program* program, BindFunc bind, GetBoundValueFunc getBoundValue, void* bindContext);
+
+		void Clear();
+
+		std::wstring m_Formula;
+		std::vector<Instruction> m_Code;
+		GetBoundValueFunc m_GetBoundValue;
+	};
 
 	const WCHAR* Check(const WCHAR* formula);
 	const WCHAR* CheckedParse(const WCHAR* formula, double* result);
@@ -22,6 +67,16 @@ namespace MathParser
 		const WCHAR* formula, double* result,
 		GetValueFunc getValue = nullptr, void* getValueContext = nullptr);
 
+	const WCHAR* Compile(const WCHAR* formula, Program* program);
+	const WCHAR* Evaluate(
+		const Program& program, double* result,
+		GetValueFunc getValue = nullptr, void* getValueContext = nullptr);
+
+	// Resolves the names in |program| to handles once so that Evaluate() reads the value of a
+	// bound name with |getBoundValue| instead of looking it up by name. Names for which |bind|
+	// returns nullptr are still passed to GetValueFunc.
+	void Bind(Program* program, BindFunc bind, GetBoundValueFunc getBoundValue, void* bindContext);
+
 	bool IsDelimiter(WCHAR ch);
 };
 
@@ -0,0 +1,92 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "MathParser.h"
+#include "Timer.h"
+#include "UnitTest.h"
+
+namespace MathParser {
+
+TEST_CLASS(Common_MathParser_Benchmark)
+{
+public:
+	TEST_METHOD(BenchmarkParseVersusCompile)
+	{
+		// Typical Calc measure and IfCondition formulas.
+		const WCHAR* formulas[] =
+		{
+			L"(MeasureCPU + MeasureRAM) / 2",
+			L"clamp(round(MeasureCPU * 100 / 255, 2), 0, 100)",
+			L"MeasureCPU > 50 ? (MeasureCPU - 50) * 2 : 0",
+			L"(MeasureRAM % 60) < 10 && (3600 * 24 / 2) > MeasureCPU",
+			L"sin(rad(MeasureCPU * 3.6)) * 50 + 50"
+		};
+		const int iterations = 100000;
+
+		double parseTotal = 0.0;
+		double compiledTotal = 0.0;
+
+		Timer timer;
+		timer.Start();
+		for (int i = 0; i < iterations; ++i)
+		{
+			for (const WCHAR* formula : formulas)
+			{
+				double value;
+				Parse(formula, &value, GetValueHelper);
+				parseTotal += value;
+			}
+		}
+		timer.Stop();
+		const double parseTime = timer.GetElapsed();
+
+		Program programs[_countof(formulas)];
+		for (size_t i = 0; i < _countof(formulas); ++i)
+		{
+			Assert::IsNull(Compile(formulas[i], &programs[i]));
+		}
+
+		timer.Start();
+		for (int i = 0; i < iterations; ++i)
+		{
+			for (const auto& program : programs)
+			{
+				double value;
+				Evaluate(program, &value, GetValueHelper);
+				compiledTotal += value;
+			}
+		}
+		timer.Stop();
+		const double compiledTime = timer.GetElapsed();
+
+		Assert::AreEqual(parseTotal, compiledTotal);
+
+		WCHAR buffer[256];
+		_snwprintf_s(buffer, _TRUNCATE,
+			L"MathParser: %i evaluations. Parse: %.2f ms, Compile once: %.2f ms (%.1fx)\n",
+			iterations * (int)_countof(formulas), parseTime, compiledTime, parseTime / compiledTime);
+		Logger::WriteMessage(buffer);
+	}
+
+	static bool GetValueHelper(const WCHAR* str, int len, double* value, void* context)
+	{
+		if (len == 10 && wcsncmp(str, L"MeasureCPU", len) == 0)
+		{
+			*value = 42.0;
+			return true;
+		}
+		else if (len == 10 && wcsncmp(str, L"MeasureRAM", len) == 0)
+		{
+			*value = 73.0;
+			return true;
+		}
+
+		return false;
+	}
+};
+
+}  // namespace MathParser
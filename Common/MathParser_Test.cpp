@@ -86,6 +86,79 @@ public:
 		Assert::AreEqual(30.0, value);
 	}
 
+	TEST_METHOD(TestCompile)
+	{
+		Program program;
+		double value = 0.0;
+
+		// Compiled programs must evaluate to the same result as Parse.
+		Assert::IsNull(Compile(L"-sin((25 + 25) * 2)", &program));
+		Assert::IsNull(Evaluate(program, &value));
+		Assert::AreEqual(-sin(100.0), value);
+
+		Assert::IsNull(Compile(L"clamp(a * 2, 0, bbb) + max(a, 1)", &program));
+		Assert::IsNull(Evaluate(program, &value, GetValueHelper));
+		Assert::AreEqual(30.0, value);
+
+		Assert::IsNull(Compile(L"a ? bbb : (3 * 2)", &program));
+		Assert::IsNull(Evaluate(program, &value, GetValueHelper));
+		Assert::AreEqual(20.0, value);
+
+		// The same program can be evaluated repeatedly with different contexts.
+		Assert::IsNull(Compile(L"(ccc_) + 1", &program));
+		Assert::IsNotNull(Evaluate(program, &value, GetValueHelper));
+		Assert::IsNull(Evaluate(program, &value, GetValueHelper, (void*)1));
+		Assert::AreEqual(31.0, value);
+
+		// Names are resolved at evaluation time.
+		Assert::IsNull(Compile(L"a", &program));
+		Assert::IsNotNull(Evaluate(program, &value));
+		Assert::AreEqual(std::wstring(L"a"), program.GetFormula());
+
+		Assert::IsNull(Compile(L"", &program));
+		Assert::IsNull(Evaluate(program, &value));
+		Assert::AreEqual(0.0, value);
+
+		Assert::IsNotNull(Compile(L"((1)", &program));
+		Assert::IsNotNull(Compile(L"1 / (2 - 2)", &program));
+		Assert::IsNotNull(Compile(L"1 ? 0 ? 4 : 5 : 3", &program));
+	}
+
+	TEST_METHOD(TestBind)
+	{
+		Program program;
+		double value = 0.0;
+
+		// Bound names no longer go through GetValueFunc.
+		double boundValue = 5.0;
+		Assert::IsNull(Compile(L"a + bbb * 2", &program));
+		Bind(&program, BindHelper, GetBoundValueHelper, &boundValue);
+		Assert::IsNull(Evaluate(program, &value, GetValueHelper));
+		Assert::AreEqual(20.0, value);
+
+		boundValue = 6.0;
+		Assert::IsNull(Evaluate(program, &value, GetValueHelper));
+		Assert::AreEqual(22.0, value);
+
+		// Unbound names still need a GetValueFunc.
+		Assert::IsNotNull(Evaluate(program, &value));
+
+		Assert::IsNull(Compile(L"bbb", &program));
+		Bind(&program, BindHelper, GetBoundValueHelper, &boundValue);
+		Assert::IsNull(Evaluate(program, &value));
+		Assert::AreEqual(6.0, value);
+	}
+
+	static void* BindHelper(const WCHAR* str, int len, void* context)
+	{
+		return (len == 3 && wcsncmp(str, L"bbb", len) == 0) ? context : nullptr;
+	}
+
+	static double GetBoundValueHelper(void* handle)
+	{
+		return *(double*)handle;
+	}
+
 	static bool GetValueHelper(const WCHAR* str, int len, double* value, void* context)
 	{
 		if (wcsncmp(str, L"a", len) == 0)
@@ -63,6 +63,22 @@ std::wstring Widen(const char* str, int strLen, int cp)
 	return wideStr;
 }
 
+void Widen(const char* str, int strLen, int cp, std::wstring& wideStr)
+{
+	// A byte is never converted into more than one UTF-16 code unit except for the 4-byte
+	// sequences of UTF-8 and GB18030, which are converted into two.
+	wideStr.resize(strLen);
+	int len = strLen > 0 ? MultiByteToWideChar(cp, 0, str, strLen, &wideStr[0], strLen) : 0;
+	if (len == 0 && strLen > 0 && GetLastError() == ERROR_INSUFFICIENT_BUFFER)
+	{
+		len = MultiByteToWideChar(cp, 0, str, strLen, nullptr, 0);
+		wideStr.resize(len);
+		MultiByteToWideChar(cp, 0, str, strLen, &wideStr[0], len);
+	}
+
+	wideStr.resize(len);
+}
+
 void ToLowerCase(std::wstring& str)
 {
 	WCHAR* srcAndDest = &str[0];
@@ -37,6 +37,10 @@ inline std::string NarrowUTF8(const std::wstring& str) { return Narrow(str.c_str
 std::wstring Widen(const char* str, int strLen = -1, int cp = CP_ACP);
 inline std::wstring Widen(const std::string& str, int cp = CP_ACP) { return Widen(str.c_str(), (int)str.length(), cp); }
 
+// Converts |strLen| bytes of |str| into |wideStr| with a single conversion pass. Unlike Widen(),
+// the length is not computed in advance and the buffer of |wideStr| is reused if large enough.
+void Widen(const char* str, int strLen, int cp, std::wstring& wideStr);
+
 inline std::wstring WidenUTF8(const char* str, int strLen = -1) { return Widen(str, strLen, CP_UTF8); }
 inline std::wstring WidenUTF8(const std::string& str) { return Widen(str.c_str(), (int)str.length(), CP_UTF8); }
 
@@ -19,6 +19,12 @@ public:
 		Assert::AreEqual(L"te", Widen("test", 2).c_str());
 		Assert::AreEqual(L"\u0422\u0114st", WidenUTF8("\xd0\xa2\xc4\x94st").c_str());
 		Assert::AreEqual(L"\u0422", WidenUTF8("\xd0\xa2\xc4\x94st", 2).c_str());
+
+		std::wstring wideStr = L"previous";
+		Widen("\xd0\xa2\xc4\x94st\xf0\x9f\x98\x80", 10, CP_UTF8, wideStr);
+		Assert::AreEqual(L"\u0422\u0114st\U0001F600", wideStr.c_str());
+		Widen("", 0, CP_UTF8, wideStr);
+		Assert::AreEqual(L"", wideStr.c_str());
 	}
 
 	TEST_METHOD(TestNarrow)
@@ -0,0 +1,111 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "AtomTable.h"
+
+const AtomTable::Atom AtomTable::Invalid;
+
+AtomTable::AtomTable()
+{
+}
+
+AtomTable::~AtomTable()
+{
+}
+
+void AtomTable::Clear()
+{
+	m_Entries.clear();
+	m_Buckets.clear();
+}
+
+/*
+** Case insensitive FNV-1a hash.
+**
+*/
+size_t AtomTable::Hash(const WCHAR* str, size_t length)
+{
+	size_t hash = (sizeof(size_t) == 8) ? (size_t)14695981039346656037ULL : (size_t)2166136261U;
+	const size_t prime = (sizeof(size_t) == 8) ? (size_t)1099511628211ULL : (size_t)16777619U;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= (size_t)Fold(str[i]);
+		hash *= prime;
+	}
+	return hash;
+}
+
+bool AtomTable::IsEqual(const Entry& entry, const WCHAR* str, size_t length) const
+{
+	if (entry.name.length() != length) return false;
+
+	const WCHAR* name = entry.name.c_str();
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (name[i] != Fold(str[i])) return false;
+	}
+	return true;
+}
+
+AtomTable::Atom AtomTable::Find(const WCHAR* str, size_t length) const
+{
+	if (m_Buckets.empty()) return Invalid;
+
+	const size_t hash = Hash(str, length);
+	const size_t mask = m_Buckets.size() - 1;
+	for (size_t i = hash & mask; ; i = (i + 1) & mask)
+	{
+		const Atom atom = m_Buckets[i];
+		if (atom == Invalid) return Invalid;
+
+		const Entry& entry = m_Entries[atom - 1];
+		if (entry.hash == hash && IsEqual(entry, str, length)) return atom;
+	}
+}
+
+AtomTable::Atom AtomTable::Add(const WCHAR* str, size_t length)
+{
+	Atom atom = Find(str, length);
+	if (atom != Invalid) return atom;
+
+	// Keep the load factor under 1/2.
+	if ((m_Entries.size() + 1) * 2 > m_Buckets.size())
+	{
+		Rehash(m_Buckets.empty() ? 64 : m_Buckets.size() * 2);
+	}
+
+	Entry entry;
+	entry.name.reserve(length);
+	for (size_t i = 0; i < length; ++i)
+	{
+		entry.name += Fold(str[i]);
+	}
+	entry.hash = Hash(str, length);
+	m_Entries.push_back(std::move(entry));
+	atom = (Atom)m_Entries.size();
+
+	const size_t mask = m_Buckets.size() - 1;
+	size_t i = m_Entries.back().hash & mask;
+	while (m_Buckets[i] != Invalid) i = (i + 1) & mask;
+	m_Buckets[i] = atom;
+
+	return atom;
+}
+
+void AtomTable::Rehash(size_t bucketCount)
+{
+	m_Buckets.assign(bucketCount, Invalid);
+
+	const size_t mask = bucketCount - 1;
+	for (size_t j = 0; j < m_Entries.size(); ++j)
+	{
+		size_t i = m_Entries[j].hash & mask;
+		while (m_Buckets[i] != Invalid) i = (i + 1) & mask;
+		m_Buckets[i] = (Atom)(j + 1);
+	}
+}
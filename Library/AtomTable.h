@@ -0,0 +1,64 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_ATOMTABLE_H_
+#define RM_LIBRARY_ATOMTABLE_H_
+
+#include <windows.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Maps names to small integer handles (atoms). Names that differ only in case map to the same
+// atom so that maps keyed by atoms can be searched without building uppercase copies of the names.
+class AtomTable
+{
+public:
+	typedef UINT Atom;
+	static const Atom Invalid = 0;
+
+	AtomTable();
+	~AtomTable();
+
+	AtomTable(const AtomTable& other) = delete;
+	AtomTable& operator=(AtomTable other) = delete;
+
+	// Returns the atom of |str| or Invalid if it has not been added. Never allocates.
+	Atom Find(const WCHAR* str, size_t length) const;
+	Atom Find(const WCHAR* str) const { return Find(str, wcslen(str)); }
+	Atom Find(const std::wstring& str) const { return Find(str.c_str(), str.length()); }
+
+	// Returns the atom of |str|, adding it if needed.
+	Atom Add(const WCHAR* str, size_t length);
+	Atom Add(const WCHAR* str) { return Add(str, wcslen(str)); }
+	Atom Add(const std::wstring& str) { return Add(str.c_str(), str.length()); }
+
+	// Returns the uppercase form of the name. The reference stays valid until Clear() is called.
+	const std::wstring& GetString(Atom atom) const { return m_Entries[atom - 1].name; }
+
+	size_t GetCount() const { return m_Entries.size(); }
+
+	void Clear();
+
+	static WCHAR Fold(WCHAR ch) { return (ch < 0x80) ? ((ch >= L'a' && ch <= L'z') ? ch - (L'a' - L'A') : ch) : (WCHAR)towupper(ch); }
+	static size_t Hash(const WCHAR* str, size_t length);
+
+private:
+	struct Entry
+	{
+		std::wstring name;
+		size_t hash;
+	};
+
+	bool IsEqual(const Entry& entry, const WCHAR* str, size_t length) const;
+	void Rehash(size_t bucketCount);
+
+	std::deque<Entry> m_Entries;		// Indexed by atom - 1
+	std::vector<Atom> m_Buckets;		// Open addressing with linear probing
+};
+
+#endif
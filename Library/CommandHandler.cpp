@@ -92,7 +92,8 @@ const BangInfo s_Bangs[] =
 	{ Bang::UnpauseMeasureGroup, L"UnpauseMeasureGroup", 1 },
 	{ Bang::TogglePauseMeasureGroup, L"TogglePauseMeasureGroup", 1 },
 	{ Bang::UpdateMeasureGroup, L"UpdateMeasureGroup", 1 },
-	{ Bang::SkinCustomMenu, L"SkinCustomMenu", 0 }
+	{ Bang::SkinCustomMenu, L"SkinCustomMenu", 0 },
+	{ Bang::ProfileDump, L"ProfileDump", 0 }
 };
 
 // Bangs that are to be handled with DoGroupBang().
@@ -100,6 +100,7 @@ enum class Bang
 	Manage,
 	SkinMenu,
 	SkinCustomMenu,
+	ProfileDump,
 	TrayMenu,
 	ResetStats,
 	Log,
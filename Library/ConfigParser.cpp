@@ -6,6 +6,7 @@
  * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
 
 #include "StdAfx.h"
+#include "../Common/IniReader.h"
 #include "../Common/MathParser.h"
 #include "../Common/PathUtil.h"
 #include "ConfigParser.h"
@@ -40,16 +41,62 @@ const std::unordered_map<PairedPunctuation, PairInfo> s_PairedPunct =
 	{ PairedPunctuation::Guillemet,   { L'<', L'>' } }
 };
 
+// While a template is compiled, resolved references are substituted with Unicode noncharacters
+// so that they can be told apart from the literal text. Unlike private use characters (e.g. icon
+// fonts), noncharacters are not used in text. Values with more references are not templated.
+const WCHAR c_FirstPlaceholder = 0xFDD0;
+const WCHAR c_LastPlaceholder = 0xFDEF;
+
+// Templates are kept for at most this many keys so that skins that read many different keys do
+// not keep a copy of each value.
+const size_t MAX_TEMPLATES = 4096;
+
+bool IsPlaceholder(WCHAR ch)
+{
+	return ch >= c_FirstPlaceholder && ch <= c_LastPlaceholder;
+}
+
+// Parsed skin files. See ConfigParser::SaveParsedSkin().
+const UINT32 PARSED_SKIN_MAGIC = 0x53504D52;	// "RMPS"
+const UINT32 PARSED_SKIN_VERSION = 1;
+const UINT32 MAX_FILE_ARRAY_SIZE = 64 * 1024 * 1024;
+
+// Writes the element count followed by the elements of a string or vector of trivial types.
+template<typename T>
+bool WriteArray(FILE* file, const T& array)
+{
+	const UINT32 size = (UINT32)array.size();
+	return fwrite(&size, sizeof(size), 1, file) == 1 &&
+		(size == 0 || fwrite(&array[0], sizeof(array[0]), size, file) == size);
+}
+
+template<typename T>
+bool ReadArray(FILE* file, T& array)
+{
+	UINT32 size;
+	if (fread(&size, sizeof(size), 1, file) != 1 || size > MAX_FILE_ARRAY_SIZE / sizeof(array[0])) return false;
+
+	array.resize(size);
+	return size == 0 || fread(&array[0], sizeof(array[0]), size, file) == size;
+}
+
 }  // namespace
 
 std::unordered_map<std::wstring, std::wstring> ConfigParser::c_MonitorVariables;
 std::unordered_map<ConfigParser::VariableType, WCHAR> ConfigParser::c_VariableMap;
+UINT ConfigParser::c_MonitorVariablesVersion = 0;
+std::unordered_map<std::wstring, ConfigParser::ParsedSkin> ConfigParser::c_ParsedSkins;
+std::wstring ConfigParser::c_ParsedSkinDirectory;
 
 ConfigParser::ConfigParser() :
 	m_LastReplaced(false),
 	m_LastDefaultUsed(false),
 	m_LastValueDefined(false),
 	m_CurrentSection(),
+	m_StringKeyLookup(false),
+	m_CompilingTemplate(),
+	m_ReadFailed(false),
+	m_Dependencies(),
 	m_Skin()
 {
 	if (c_VariableMap.empty())
@@ -74,6 +121,12 @@ void ConfigParser::Initialize(const std::wstring& filename, Skin* skin, LPCTSTR
 	m_Values.clear();
 	m_BuiltInVariables.clear();
 	m_Variables.clear();
+	m_Templates[0].clear();
+	m_Templates[1].clear();
+	m_VariableVersions.clear();
+	m_SectionVersions.clear();
+	m_Dependencies = nullptr;
+	m_Atoms.Clear();
 
 	m_StyleTemplate.clear();
 	m_LastReplaced = false;
@@ -87,14 +140,32 @@ void ConfigParser::Initialize(const std::wstring& filename, Skin* skin, LPCTSTR
 	SetBuiltInVariables(filename, resourcePath, skin);
 	ResetMonitorVariables(skin);
 
-	System::UpdateIniFileMappingList();
+	// The result of reading the files only depends on the files and the variables set above. Only
+	// skins (which have a resources path) are kept. Rainmeter.ini and layouts change too often.
+	const bool storeParsed = (skinSection == nullptr && resourcePath != nullptr);
+	std::wstring key;
+	if (storeParsed)
+	{
+		key = GetParsedSkinKey(filename);
+	}
+
+	if (!storeParsed || !RestoreParsedSkin(filename, key))
+	{
+		m_ReadFiles.clear();
+		m_ReadFailed = false;
+		ReadIniFile(filename, skinSection);
 
-	ReadIniFile(filename, skinSection);
+		if (storeParsed)
+		{
+			StoreParsedSkin(key);
+		}
+	}
 	ReadVariables();
 
 	// Clear and minimize
 	m_FoundSections.clear();
 	m_ListVariables.clear();
+	m_ReadFiles.clear();
 	m_SectionInsertPos = m_Sections.end();
 }
 
@@ -102,7 +173,7 @@ void ConfigParser::SetBuiltInVariables(const std::wstring& filename, const std::
 {
 	auto insertVariable = [&](const WCHAR* name, std::wstring value)
 	{
-		return m_BuiltInVariables.insert(std::make_pair(name, value));
+		return m_BuiltInVariables.insert(std::make_pair(m_Atoms.Add(name), value));
 	};
 
 	insertVariable(L"PROGRAMPATH", GetRainmeter().GetPath());
@@ -148,13 +219,95 @@ void ConfigParser::ReadVariables()
 
 void ConfigParser::SetVariable(std::wstring strVariable, const std::wstring& strValue)
 {
-	StrToUpperC(strVariable);
-	m_Variables[strVariable] = strValue;
+	const AtomTable::Atom atom = m_Atoms.Add(strVariable);
+	auto result = m_Variables.insert(std::make_pair(atom, strValue));
+	if (!result.second)
+	{
+		if (result.first->second == strValue) return;
+		result.first->second = strValue;
+	}
+
+	UpdateVersion(m_VariableVersions, atom);
 }
 
 void ConfigParser::SetBuiltInVariable(const std::wstring& strVariable, const std::wstring& strValue)
 {
-	m_BuiltInVariables[strVariable] = strValue;
+	const AtomTable::Atom atom = m_Atoms.Add(strVariable);
+	auto result = m_BuiltInVariables.insert(std::make_pair(atom, strValue));
+	if (!result.second)
+	{
+		if (result.first->second == strValue) return;
+		result.first->second = strValue;
+	}
+
+	UpdateVersion(m_VariableVersions, atom);
+}
+
+/*
+** Starts recording the variables, measures and sections read into |dependencies|. Recording
+** stops when EndDependencies is called.
+**
+*/
+void ConfigParser::BeginDependencies(Dependencies& dependencies)
+{
+	dependencies.variables.clear();
+	dependencies.sections.clear();
+	dependencies.measures.clear();
+	dependencies.monitorVersion = c_MonitorVariablesVersion;
+	dependencies.isVolatile = false;
+
+	m_Dependencies = &dependencies;
+}
+
+/*
+** Returns true if anything recorded in |dependencies| has changed since it was recorded.
+**
+*/
+bool ConfigParser::HasChanged(const Dependencies& dependencies)
+{
+	if (dependencies.isVolatile || dependencies.monitorVersion != c_MonitorVariablesVersion)
+	{
+		return true;
+	}
+
+	for (const auto& version : dependencies.variables)
+	{
+		if (*version.current != version.value) return true;
+	}
+
+	for (const auto& version : dependencies.sections)
+	{
+		if (*version.current != version.value) return true;
+	}
+
+	for (const auto& measure : dependencies.measures)
+	{
+		const WCHAR* value = measure.measure->GetStringOrFormattedValue(AUTOSCALE_OFF, 1.0, -1, false);
+		if (wcscmp(value, measure.value.c_str()) != 0) return true;
+	}
+
+	return false;
+}
+
+void ConfigParser::AddDependency(std::vector<Dependencies::Version>& versions, std::unordered_map<AtomTable::Atom, UINT>& map, AtomTable::Atom atom)
+{
+	const UINT* current = &map[atom];
+	for (const auto& version : versions)
+	{
+		if (version.current == current) return;
+	}
+
+	Dependencies::Version version = { current, *current };
+	versions.push_back(version);
+}
+
+void ConfigParser::UpdateVersion(std::unordered_map<AtomTable::Atom, UINT>& map, AtomTable::Atom atom)
+{
+	auto iter = map.find(atom);
+	if (iter != map.end())
+	{
+		++(*iter).second;
+	}
 }
 
 /*
@@ -163,24 +316,43 @@ void ConfigParser::SetBuiltInVariable(const std::wstring& strVariable, const std
 */
 const std::wstring* ConfigParser::GetVariable(const std::wstring& strVariable)
 {
-	const std::wstring strTmp = StrToUpper(strVariable);
+	return FindVariable(strVariable);
+}
+
+/*
+** Same as GetVariable.
+**
+*/
+const std::wstring* ConfigParser::FindVariable(const std::wstring& strVariable)
+{
+	// Variables that do not exist yet are interned as well so that defining them later is noticed.
+	const AtomTable::Atom atom = m_Dependencies ? m_Atoms.Add(strVariable) : m_Atoms.Find(strVariable);
+	if (m_Dependencies)
+	{
+		AddDependency(m_Dependencies->variables, m_VariableVersions, atom);
+	}
 
 	// #1: Built-in variables
-	std::unordered_map<std::wstring, std::wstring>::const_iterator iter = m_BuiltInVariables.find(strTmp);
+	std::unordered_map<AtomTable::Atom, std::wstring>::const_iterator iter = m_BuiltInVariables.find(atom);
 	if (iter != m_BuiltInVariables.end())
 	{
 		return &(*iter).second;
 	}
 
-	// #2: Monitor variables
-	iter = c_MonitorVariables.find(strTmp);
-	if (iter != c_MonitorVariables.end())
+	// #2: Monitor variables. These are shared between all skins and are keyed by the uppercase name.
+	std::unordered_map<std::wstring, std::wstring>::const_iterator mIter = (atom != AtomTable::Invalid) ?
+		c_MonitorVariables.find(m_Atoms.GetString(atom)) : c_MonitorVariables.find(StrToUpper(strVariable));
+	if (mIter != c_MonitorVariables.end())
 	{
-		return &(*iter).second;
+		if (atom == AtomTable::Invalid)
+		{
+			m_Atoms.Add(strVariable);  // Avoid the conversion the next time.
+		}
+		return &(*mIter).second;
 	}
 
 	// #3: User-defined variables
-	iter = m_Variables.find(strTmp);
+	iter = m_Variables.find(atom);
 	if (iter != m_Variables.end())
 	{
 		return &(*iter).second;
@@ -203,6 +375,9 @@ bool ConfigParser::GetSectionVariable(std::wstring& strVariable, std::wstring& s
 		return false;
 	}
 
+	// Section variables can change without notice (e.g. the position of a meter).
+	AddVolatileDependency();
+
 	const std::wstring selector = strVariable.substr(colonPos + 1);
 	const WCHAR* selectorSz = selector.c_str();
 	strVariable.resize(colonPos);
@@ -461,6 +636,8 @@ void ConfigParser::ResetMonitorVariables(Skin* skin)
 */
 void ConfigParser::SetMultiMonitorVariables(bool reset)
 {
+	++c_MonitorVariablesVersion;
+
 	auto setMonitorVariable = [&](const WCHAR* variable, const WCHAR* value)
 	{
 		c_MonitorVariables[variable] = value;
@@ -676,12 +853,15 @@ bool ConfigParser::ReplaceVariables(std::wstring& result, bool isNewStyle)
 			start = result.find(strVariable, start);
 			if (start != std::wstring::npos)
 			{
-				const std::wstring* value = GetVariable(L"CURRENTSECTION");
+				static const std::wstring s_CurrentSection = L"CURRENTSECTION";
+				const std::wstring* value = GetVariable(s_CurrentSection);
+				if (m_CompilingTemplate) value = AddTemplateVariable(s_CurrentSection, value);
+
 				if (value)
 				{
 					// Variable found, replace it with the value
 					result.replace(start, length, *value);
-					start += length;
+					start += (*value).length();
 					replaced = true;
 				}
 			}
@@ -706,6 +886,8 @@ bool ConfigParser::ReplaceVariables(std::wstring& result, bool isNewStyle)
 			end = result.find(L'#', si);
 			if (end != std::wstring::npos)
 			{
+				if (m_CompilingTemplate) CheckTemplateRange(result, start, end);
+
 				size_t ei = end - 1;
 				if (si != ei && result[si] == L'*' && result[ei] == L'*')
 				{
@@ -717,6 +899,8 @@ bool ConfigParser::ReplaceVariables(std::wstring& result, bool isNewStyle)
 				{
 					std::wstring strVariable = result.substr(si, end - si);
 					const std::wstring* value = GetVariable(strVariable);
+					if (m_CompilingTemplate) value = AddTemplateVariable(strVariable, value);
+
 					if (value)
 					{
 						// Variable found, replace it with the value
@@ -769,6 +953,8 @@ bool ConfigParser::ReplaceMeasures(std::wstring& result)
 		size_t next = result.find(L'[', si);
 		if (next == std::wstring::npos || end < next)
 		{
+			if (m_CompilingTemplate) CheckTemplateRange(result, start, end);
+
 			size_t ei = end - 1;
 			if (si != ei && result[si] == L'*' && result[ei] == L'*')
 			{
@@ -783,7 +969,8 @@ bool ConfigParser::ReplaceMeasures(std::wstring& result)
 				Measure* measure = GetMeasure(var);
 				if (measure)
 				{
-					const WCHAR* value = measure->GetStringOrFormattedValue(AUTOSCALE_OFF, 1.0, -1, false);
+					const WCHAR* value = m_CompilingTemplate ?
+						AddTemplateMeasure(measure) : GetMeasureValue(measure);
 					size_t valueLen = wcslen(value);
 
 					// Measure found, replace it with the value
@@ -794,7 +981,7 @@ bool ConfigParser::ReplaceMeasures(std::wstring& result)
 				else
 				{
 					std::wstring value;
-					if (GetSectionVariable(var, value))
+					if (m_CompilingTemplate ? AddTemplateSectionVariable(var, value) : GetSectionVariable(var, value))
 					{
 						// Replace section variable with the value.
 						result.replace(start, end - start + 1, value);
@@ -838,6 +1025,8 @@ bool ConfigParser::ParseVariables(std::wstring& result, const VariableType type,
 		start = result.rfind(L'[', ei);
 		if (start != std::wstring::npos)
 		{
+			if (m_CompilingTemplate) CheckTemplateRange(result, start, end);
+
 			size_t si = start + 2;  // Check for escaped variable 'names'
 			if (si != ei && result[si] == L'*' && result[ei] == L'*')
 			{
@@ -853,7 +1042,19 @@ bool ConfigParser::ParseVariables(std::wstring& result, const VariableType type,
 
 				// Avoid self references
 				std::wstring original = result.substr(si, end - si).c_str();
-				if (prevStart == start &&
+				if (m_CompilingTemplate)
+				{
+					// If the values substituted in between are empty, this would be a self reference.
+					if (prevStart <= start &&
+						std::all_of(result.begin() + prevStart, result.begin() + start, IsPlaceholder) &&
+						_wcsicmp(original.c_str(), prevVar.c_str()) == 0)
+					{
+						m_CompilingTemplate->dynamic = true;
+						start = end + 1;
+						continue;
+					}
+				}
+				else if (prevStart == start &&
 					_wcsicmp(original.c_str(), prevVar.c_str()) == 0)
 				{
 					LogErrorF(m_Skin, L"Error: Cannot replace variable with itself \"%s\"", original.c_str());
@@ -905,7 +1106,8 @@ bool ConfigParser::ParseVariables(std::wstring& result, const VariableType type,
 							Measure* measure = GetMeasure(val);
 							if (measure)
 							{
-								const WCHAR* value = measure->GetStringOrFormattedValue(AUTOSCALE_OFF, 1.0, -1, false);
+								const WCHAR* value = m_CompilingTemplate ?
+									AddTemplateMeasure(measure) : GetMeasureValue(measure);
 								size_t valueLen = wcslen(value);
 
 								// Measure found, replace it with the value
@@ -916,7 +1118,7 @@ bool ConfigParser::ParseVariables(std::wstring& result, const VariableType type,
 							else
 							{
 								std::wstring value;
-								if (GetSectionVariable(val, value))
+								if (m_CompilingTemplate ? AddTemplateSectionVariable(val, value) : GetSectionVariable(val, value))
 								{
 									// Replace section variable with the value
 									result.replace(start, end - start + 1, value);
@@ -932,6 +1134,8 @@ bool ConfigParser::ParseVariables(std::wstring& result, const VariableType type,
 							// Assign current section if available
 							if (meter) m_CurrentSection->assign(meter->GetName());
 							const std::wstring* value = GetVariable(val);
+							if (m_CompilingTemplate) value = AddTemplateVariable(val, value);
+
 							if (value)
 							{
 								// Variable found, replace it with the value
@@ -1042,175 +1246,526 @@ std::wstring ConfigParser::GetMouseVariable(const std::wstring& variable, Meter*
 	return result;
 }
 
-const std::wstring& ConfigParser::ReadString(LPCTSTR section, LPCTSTR key, LPCTSTR defValue, bool bReplaceMeasures)
+/*
+** Replaces variables and (optionally) measures in an option value. Returns true if something was
+** replaced.
+**
+*/
+bool ConfigParser::ReplaceValue(std::wstring& result, bool isVariablesSection, bool bReplaceMeasures)
 {
-	static std::wstring result;
+	bool replaced = false;
 
-	// Clear last status
-	m_LastReplaced = false;
-	m_LastDefaultUsed = false;
-	m_LastValueDefined = false;
+	if (result.find(L'#') != std::wstring::npos)
+	{
+		// Make sure new-style variables are processed for the [Variables] section
+		replaced = ReplaceVariables(result, isVariablesSection);
+	}
+	else
+	{
+		PathUtil::ExpandEnvironmentVariables(result);
+	}
+
+	if (bReplaceMeasures && ReplaceMeasures(result))
+	{
+		replaced = true;
+	}
+
+	return replaced;
+}
 
-	const std::wstring strSection = section;
-	const std::wstring strKey = key;
-	const std::wstring strDefault = defValue;
+/*
+** Splits tmpl.raw into literal text and references. This runs the regular substitution with each
+** resolved reference replaced by a placeholder so that the template produces exactly the same
+** result as ReplaceValue. If that cannot be guaranteed (e.g. a reference is nested within
+** another reference), the template is marked as dynamic.
+**
+*/
+void ConfigParser::CompileTemplate(Template& tmpl, bool isVariablesSection, bool bReplaceMeasures)
+{
+	tmpl.compiled = true;
+	tmpl.dynamic = false;
+	tmpl.parts.clear();
+	tmpl.guards.clear();
 
-	const std::wstring& strValue = GetValue(strSection, strKey, strDefault);
-	if (&strValue == &strDefault)
+	// Literal text with a placeholder character could not be told apart from a reference.
+	if (std::find_if(tmpl.raw.begin(), tmpl.raw.end(), IsPlaceholder) != tmpl.raw.end())
 	{
-		bool foundStyleValue = false;
+		tmpl.dynamic = true;
+		return;
+	}
 
-		// If the template is defined read the value from there.
-		std::vector<std::wstring>::const_reverse_iterator iter = m_StyleTemplate.rbegin();
-		for ( ; iter != m_StyleTemplate.rend(); ++iter)
-		{
-			const std::wstring& strStyleValue = GetValue((*iter), strKey, strDefault);
+	// The parts are first collected in the order they are resolved.
+	std::wstring result = tmpl.raw;
+	m_CompilingTemplate = &tmpl;
+	tmpl.replaced = ReplaceValue(result, isVariablesSection, bReplaceMeasures);
+	m_CompilingTemplate = nullptr;
+
+	if (tmpl.dynamic)
+	{
+		tmpl.parts.clear();
+		tmpl.guards.clear();
+		return;
+	}
 
-			//LogDebugF(L"StyleTemplate: [%s] %s (from [%s]) : strDefault=%s (0x%p), strStyleValue=%s (0x%p)",
-			//	section, key, (*iter).c_str(), strDefault.c_str(), &strDefault, strStyleValue.c_str(), &strStyleValue);
+	std::vector<Template::Part> references;
+	references.swap(tmpl.parts);
+	std::vector<bool> used(references.size(), false);
 
-			if (&strStyleValue != &strDefault)
+	const WCHAR* str = result.c_str();
+	size_t literalStart = 0;
+	for (size_t i = 0, isize = result.size(); i <= isize; ++i)
+	{
+		const size_t index = (i < isize) ? (size_t)(str[i] - c_FirstPlaceholder) : 0;
+		const bool isReference = i < isize && index < references.size();
+		if (isReference || i == isize)
+		{
+			if (i > literalStart)
 			{
-				result = strStyleValue;
-				foundStyleValue = true;
-				break;
+				Template::Part literal = { Template::PartType::Literal };
+				literal.text.assign(str + literalStart, i - literalStart);
+				tmpl.parts.push_back(literal);
 			}
-		}
 
-		if (!foundStyleValue)
-		{
-			result = strDefault;
-			m_LastDefaultUsed = true;
-			return result;
+			if (isReference)
+			{
+				if (used[index])
+				{
+					// Literal text that looks like a placeholder.
+					tmpl.dynamic = true;
+					break;
+				}
+
+				used[index] = true;
+				tmpl.parts.push_back(references[index]);
+			}
+
+			literalStart = i + 1;
 		}
 	}
-	else
+
+	if (tmpl.dynamic || std::find(used.begin(), used.end(), false) != used.end())
 	{
-		result = strValue;
+		tmpl.dynamic = true;
+		tmpl.parts.clear();
+		tmpl.guards.clear();
 	}
+}
 
-	if (!result.empty())
+/*
+** Renders a compiled template into result. Returns false if the template cannot be used with
+** the current variables and measures, in which case the value must be substituted with
+** ReplaceValue.
+**
+*/
+bool ConfigParser::RenderTemplate(const Template& tmpl, bool isVariablesSection, std::wstring& result)
+{
+	// Values that contain brackets would have been scanned again by ReplaceValue. The [Variables]
+	// section also scans for old-style variables after the new-style ones are replaced.
+	const WCHAR* special = isVariablesSection ? L"[]#" : L"[]";
+
+	for (const auto& guard : tmpl.guards)
 	{
-		m_CurrentSection->assign(strSection);  // Set temporarily
-		m_LastValueDefined = true;
+		if (guard.type == Template::PartType::MissingVariable)
+		{
+			if (FindVariable(guard.text)) return false;
+		}
+		else
+		{
+			if (GetMeasure(guard.text)) return false;
 
-		if (result.size() >= 3)
+			std::wstring strVariable = guard.text;
+			std::wstring strValue;
+			if (GetSectionVariable(strVariable, strValue)) return false;
+		}
+	}
+
+	result.clear();
+	for (const auto& part : tmpl.parts)
+	{
+		switch (part.type)
 		{
-			if (result.find(L'#') != std::wstring::npos)
+		case Template::PartType::Literal:
+			result += part.text;
+			break;
+
+		case Template::PartType::Variable:
 			{
-				// Make sure new-style variables are processed for the [Variables] section
-				bool runNewStyle = strSection == L"Variables" ? true : false;
-				if (ReplaceVariables(result, runNewStyle))
-				{
-					m_LastReplaced = true;
-				}
+				const std::wstring* value = FindVariable(part.text);
+				if (!value || value->find_first_of(special) != std::wstring::npos) return false;
+
+				result += *value;
 			}
-			else
+			break;
+
+		case Template::PartType::Measure:
 			{
-				PathUtil::ExpandEnvironmentVariables(result);
+				const WCHAR* value = GetMeasureValue(part.measure);
+				if (wcspbrk(value, special)) return false;
+
+				result += value;
 			}
+			break;
 
-			if (bReplaceMeasures && ReplaceMeasures(result))
+		case Template::PartType::SectionVariable:
 			{
-				m_LastReplaced = true;
+				std::wstring strVariable = part.text;
+				std::wstring strValue;
+				if (!GetSectionVariable(strVariable, strValue) ||
+					strValue.find_first_of(special) != std::wstring::npos)
+				{
+					return false;
+				}
+
+				result += strValue;
 			}
+			break;
 		}
-		m_CurrentSection->clear();  // Reset
 	}
 
-	return result;
+	return true;
 }
 
-bool ConfigParser::IsKeyDefined(LPCTSTR section, LPCTSTR key)
+/*
+** Marks the template being compiled as dynamic if the reference at [start, end] contains the
+** value of another reference.
+**
+*/
+void ConfigParser::CheckTemplateRange(const std::wstring& result, size_t start, size_t end)
 {
-	ReadString(section, key, L"", false);
-	return !m_LastDefaultUsed;
+	for (size_t i = start; i <= end; ++i)
+	{
+		if (IsPlaceholder(result[i]))
+		{
+			m_CompilingTemplate->dynamic = true;
+			break;
+		}
+	}
 }
 
-bool ConfigParser::IsValueDefined(LPCTSTR section, LPCTSTR key)
+/*
+** Records a variable reference for the template being compiled. Returns the placeholder to
+** substitute, or nullptr if the variable does not exist.
+**
+*/
+const std::wstring* ConfigParser::AddTemplateVariable(const std::wstring& strVariable, const std::wstring* value)
 {
-	ReadString(section, key, L"", false);
-	return m_LastValueDefined;
-}
+	static std::wstring s_Placeholder(1, c_FirstPlaceholder);
 
-void ConfigParser::AddMeasure(Measure* pMeasure)
-{
-	if (pMeasure)
+	Template& tmpl = *m_CompilingTemplate;
+	Template::Part part = { value ? Template::PartType::Variable : Template::PartType::MissingVariable, StrToUpper(strVariable) };
+	if (!value)
 	{
-		m_Measures[StrToUpper(pMeasure->GetOriginalName())] = pMeasure;
+		tmpl.guards.push_back(part);
+		return nullptr;
 	}
-}
 
-Measure* ConfigParser::GetMeasure(const std::wstring& name)
-{
-	std::unordered_map<std::wstring, Measure*>::const_iterator iter = m_Measures.find(StrToUpper(name));
-	if (iter != m_Measures.end())
+	if (tmpl.parts.size() > (size_t)(c_LastPlaceholder - c_FirstPlaceholder))
 	{
-		return (*iter).second;
+		tmpl.dynamic = true;
 	}
 
-	return nullptr;
+	s_Placeholder[0] = (WCHAR)(c_FirstPlaceholder + tmpl.parts.size());
+	tmpl.parts.push_back(part);
+	return &s_Placeholder;
 }
 
-std::vector<Gdiplus::REAL> ConfigParser::ReadFloats(LPCTSTR section, LPCTSTR key)
+/*
+** Records a measure reference for the template being compiled. Returns the placeholder to
+** substitute.
+**
+*/
+const WCHAR* ConfigParser::AddTemplateMeasure(Measure* measure)
 {
-	std::vector<Gdiplus::REAL> result;
-	const std::wstring& str = ReadString(section, key, L"");
-	if (!str.empty())
-	{
-		// Tokenize and parse the floats
-		const WCHAR delimiter = L';';
-		size_t lastPos, pos = 0;
-		do
-		{
-			lastPos = str.find_first_not_of(delimiter, pos);
-			if (lastPos == std::wstring::npos) break;
+	static WCHAR s_Placeholder[2] = {};
 
-			pos = str.find_first_of(delimiter, lastPos + 1);
+	Template& tmpl = *m_CompilingTemplate;
+	if (tmpl.parts.size() > (size_t)(c_LastPlaceholder - c_FirstPlaceholder))
+	{
+		tmpl.dynamic = true;
+	}
 
-			result.push_back((Gdiplus::REAL)ParseDouble(str.substr(lastPos, pos - lastPos).c_str(), 0.0));  // (pos != std::wstring::npos) ? pos - lastPos : pos
-			if (pos == std::wstring::npos) break;
+	Template::Part part = { Template::PartType::Measure };
+	part.measure = measure;
 
-			++pos;
-		}
-		while (true);
-	}
-	return result;
+	s_Placeholder[0] = (WCHAR)(c_FirstPlaceholder + tmpl.parts.size());
+	tmpl.parts.push_back(part);
+	return s_Placeholder;
 }
 
-int ConfigParser::ReadInt(LPCTSTR section, LPCTSTR key, int defValue)
+/*
+** Records a section variable reference for the template being compiled. Returns true and sets
+** strValue to the placeholder to substitute if the section variable exists.
+**
+*/
+bool ConfigParser::AddTemplateSectionVariable(std::wstring& strVariable, std::wstring& strValue)
 {
-	const std::wstring& result = ReadString(section, key, L"");
+	Template& tmpl = *m_CompilingTemplate;
+	if (tmpl.dynamic) return false;
 
-	if (!m_LastDefaultUsed)
+	// Script and plugin section variables call into the script or plugin, which must happen exactly
+	// once for each substitution.
+	const size_t colonPos = strVariable.find_last_of(L':', strVariable.find_first_of(L'('));
+	if (colonPos != std::wstring::npos)
 	{
-		const WCHAR* string = result.c_str();
-		if (*string == L'(')
-		{
-			double dblValue;
-			const WCHAR* errMsg = MathParser::CheckedParse(string, &dblValue);
-			if (!errMsg)
-			{
-				return (int)dblValue;
-			}
-
-			LogErrorF(m_Skin, L"Formula: %s in key \"%s\" in [%s]", errMsg, key, section);
-		}
-		else if (*string)
+		Measure* measure = GetMeasure(strVariable.substr(0, colonPos));
+		if (measure &&
+			(measure->GetTypeID() == TypeID<MeasureScript>() || measure->GetTypeID() == TypeID<MeasurePlugin>()))
 		{
-			errno = 0;
-			int intValue = wcstol(string, nullptr, 10);
-			if (errno != ERANGE)
-			{
-				return intValue;
-			}
+			tmpl.dynamic = true;
+			return false;
 		}
 	}
 
-	return defValue;
-}
+	Template::Part part = { Template::PartType::SectionVariable, strVariable };
+	if (!GetSectionVariable(strVariable, strValue))
+	{
+		part.type = Template::PartType::MissingSection;
+		tmpl.guards.push_back(part);
+		return false;
+	}
 
-uint32_t ConfigParser::ReadUInt(LPCTSTR section, LPCTSTR key, uint32_t defValue)
+	if (tmpl.parts.size() > (size_t)(c_LastPlaceholder - c_FirstPlaceholder))
+	{
+		tmpl.dynamic = true;
+	}
+
+	strValue.assign(1, (WCHAR)(c_FirstPlaceholder + tmpl.parts.size()));
+	tmpl.parts.push_back(part);
+	return true;
+}
+
+const std::wstring& ConfigParser::ReadString(LPCTSTR section, LPCTSTR key, LPCTSTR defValue, bool bReplaceMeasures)
+{
+	static std::wstring result;
+
+	// Clear last status
+	m_LastReplaced = false;
+	m_LastDefaultUsed = false;
+	m_LastValueDefined = false;
+
+	// The section and key are looked up by atom so that reading an option does not allocate.
+	AtomTable::Atom sectionAtom = m_Atoms.Find(section);
+	const AtomTable::Atom keyAtom = m_Atoms.Find(key);
+
+	if (m_Dependencies)
+	{
+		if (sectionAtom == AtomTable::Invalid) sectionAtom = m_Atoms.Add(section);
+		AddDependency(m_Dependencies->sections, m_SectionVersions, sectionAtom);
+		for (const auto& style : m_StyleTemplate)
+		{
+			AddDependency(m_Dependencies->sections, m_SectionVersions, m_Atoms.Add(style));
+		}
+	}
+
+	const std::wstring* value = m_StringKeyLookup ?
+		FindStringValue(section, key) : FindValue(sectionAtom, keyAtom);
+	if (!value)
+	{
+		// If the template is defined read the value from there.
+		std::vector<std::wstring>::const_reverse_iterator iter = m_StyleTemplate.rbegin();
+		for ( ; iter != m_StyleTemplate.rend(); ++iter)
+		{
+			value = m_StringKeyLookup ?
+				FindStringValue(*iter, key) : FindValue(m_Atoms.Find(*iter), keyAtom);
+
+			//LogDebugF(L"StyleTemplate: [%s] %s (from [%s]) : defValue=%s, value=%s",
+			//	section, key, (*iter).c_str(), defValue, value ? value->c_str() : L"");
+
+			if (value) break;
+		}
+
+		if (!value)
+		{
+			result = defValue;
+			m_LastDefaultUsed = true;
+			return result;
+		}
+	}
+
+	result = *value;
+
+	if (!result.empty())
+	{
+		m_CurrentSection->assign(section);  // Set temporarily
+		m_LastValueDefined = true;
+
+		if (result.size() >= 3)
+		{
+			const bool isVariablesSection = wcscmp(section, L"Variables") == 0;
+			bool rendered = false;
+
+			if (result.find_first_of(L"#[") != std::wstring::npos)
+			{
+				// Values that are read more than once are split into a template so that they do not
+				// need to be scanned again. The value may come from a style, so the section may not
+				// have an atom yet.
+				if (sectionAtom == AtomTable::Invalid) sectionAtom = m_Atoms.Add(section);
+
+				auto& templates = m_Templates[bReplaceMeasures ? 1 : 0];
+				const uint64_t templateKey = MakeValueKey(sectionAtom, keyAtom);
+				auto iter = templates.find(templateKey);
+				if (iter == templates.end())
+				{
+					if (templates.size() >= MAX_TEMPLATES) templates.clear();
+					iter = templates.emplace(templateKey, Template()).first;
+				}
+
+				Template& tmpl = iter->second;
+				if (tmpl.raw != result)
+				{
+					tmpl = Template();
+					tmpl.raw = result;
+				}
+				else if (!tmpl.compiled)
+				{
+					CompileTemplate(tmpl, isVariablesSection, bReplaceMeasures);
+				}
+
+				static std::wstring buffer;
+				if (tmpl.compiled && !tmpl.dynamic)
+				{
+					if (!RenderTemplate(tmpl, isVariablesSection, buffer))
+					{
+						// Variables or measures have changed since the template was compiled.
+						CompileTemplate(tmpl, isVariablesSection, bReplaceMeasures);
+						if (!tmpl.dynamic && !RenderTemplate(tmpl, isVariablesSection, buffer))
+						{
+							tmpl.dynamic = true;
+						}
+					}
+
+					if (!tmpl.dynamic)
+					{
+						result.swap(buffer);
+						m_LastReplaced = tmpl.replaced;
+						rendered = true;
+					}
+				}
+			}
+
+			if (!rendered && ReplaceValue(result, isVariablesSection, bReplaceMeasures))
+			{
+				m_LastReplaced = true;
+			}
+		}
+		m_CurrentSection->clear();  // Reset
+	}
+
+	return result;
+}
+
+bool ConfigParser::IsKeyDefined(LPCTSTR section, LPCTSTR key)
+{
+	ReadString(section, key, L"", false);
+	return !m_LastDefaultUsed;
+}
+
+bool ConfigParser::IsValueDefined(LPCTSTR section, LPCTSTR key)
+{
+	ReadString(section, key, L"", false);
+	return m_LastValueDefined;
+}
+
+void ConfigParser::AddMeasure(Measure* pMeasure)
+{
+	if (pMeasure)
+	{
+		m_Measures[m_Atoms.Add(pMeasure->GetOriginalName())] = pMeasure;
+	}
+}
+
+/*
+** Returns the value of the measure as used for substitution.
+**
+*/
+const WCHAR* ConfigParser::GetMeasureValue(Measure* measure)
+{
+	const WCHAR* value = measure->GetStringOrFormattedValue(AUTOSCALE_OFF, 1.0, -1, false);
+	if (m_Dependencies)
+	{
+		auto& measures = m_Dependencies->measures;
+		auto iter = std::find_if(measures.cbegin(), measures.cend(),
+			[&](const Dependencies::MeasureValue& item) { return item.measure == measure; });
+		if (iter == measures.cend())
+		{
+			Dependencies::MeasureValue item = { measure, value };
+			measures.push_back(item);
+		}
+	}
+
+	return value;
+}
+
+Measure* ConfigParser::GetMeasure(const std::wstring& name)
+{
+	std::unordered_map<AtomTable::Atom, Measure*>::const_iterator iter = m_Measures.find(m_Atoms.Find(name));
+	if (iter != m_Measures.end())
+	{
+		return (*iter).second;
+	}
+
+	return nullptr;
+}
+
+std::vector<Gdiplus::REAL> ConfigParser::ReadFloats(LPCTSTR section, LPCTSTR key)
+{
+	std::vector<Gdiplus::REAL> result;
+	const std::wstring& str = ReadString(section, key, L"");
+	if (!str.empty())
+	{
+		// Tokenize and parse the floats
+		const WCHAR delimiter = L';';
+		size_t lastPos, pos = 0;
+		do
+		{
+			lastPos = str.find_first_not_of(delimiter, pos);
+			if (lastPos == std::wstring::npos) break;
+
+			pos = str.find_first_of(delimiter, lastPos + 1);
+
+			result.push_back((Gdiplus::REAL)ParseDouble(str.substr(lastPos, pos - lastPos).c_str(), 0.0));  // (pos != std::wstring::npos) ? pos - lastPos : pos
+			if (pos == std::wstring::npos) break;
+
+			++pos;
+		}
+		while (true);
+	}
+	return result;
+}
+
+int ConfigParser::ReadInt(LPCTSTR section, LPCTSTR key, int defValue)
+{
+	const std::wstring& result = ReadString(section, key, L"");
+
+	if (!m_LastDefaultUsed)
+	{
+		const WCHAR* string = result.c_str();
+		if (*string == L'(')
+		{
+			double dblValue;
+			const WCHAR* errMsg = MathParser::CheckedParse(string, &dblValue);
+			if (!errMsg)
+			{
+				return (int)dblValue;
+			}
+
+			LogErrorF(m_Skin, L"Formula: %s in key \"%s\" in [%s]", errMsg, key, section);
+		}
+		else if (*string)
+		{
+			errno = 0;
+			int intValue = wcstol(string, nullptr, 10);
+			if (errno != ERANGE)
+			{
+				return intValue;
+			}
+		}
+	}
+
+	return defValue;
+}
+
+uint32_t ConfigParser::ReadUInt(LPCTSTR section, LPCTSTR key, uint32_t defValue)
 {
 	const std::wstring& result = ReadString(section, key, L"");
 
@@ -1735,86 +2290,54 @@ void ConfigParser::ReadIniFile(const std::wstring& iniFile, LPCTSTR skinSection,
 	if (depth > 100)	// Is 100 enough to assume the include loop never ends?
 	{
 		GetRainmeter().ShowMessage(nullptr, GetString(ID_STR_INCLUDEINFINITELOOP), MB_OK | MB_ICONERROR);
+		m_ReadFailed = true;
 		return;
 	}
 
 	// Verify whether the file exists
-	if (_waccess(iniFile.c_str(), 0) == -1)
+	ParsedSkin::File file;
+	if (_waccess(iniFile.c_str(), 0) == -1 || !GetFileStamp(iniFile, file))
 	{
 		LogErrorF(m_Skin, L"Unable to read file: %s", iniFile.c_str());
+		m_ReadFailed = true;
 		return;
 	}
 
-	// Avoid "IniFileMapping"
-	std::wstring iniRead = System::GetTemporaryFile(iniFile);
-	bool temporary = (!iniRead.empty() && (iniRead.size() != 1 || iniRead[0] != L'?'));
+	if (GetRainmeter().GetDebug()) LogDebugF(m_Skin, L"Reading file: %s", iniFile.c_str());
 
-	if (temporary)
+	// The whole file is parsed once instead of once per section by GetPrivateProfileSection.
+	IniReader reader;
+	if (!reader.ReadFile(iniFile))
 	{
-		if (GetRainmeter().GetDebug()) LogDebugF(m_Skin, L"Reading file: %s (Temp: %s)", iniFile.c_str(), iniRead.c_str());
-	}
-	else
-	{
-		if (GetRainmeter().GetDebug()) LogDebugF(m_Skin, L"Reading file: %s", iniFile.c_str());
-		iniRead = iniFile;
+		LogErrorF(m_Skin, L"Unable to read file: %s", iniFile.c_str());
+		m_ReadFailed = true;
+		return;
 	}
 
+	// Stamped before reading so that a change while reading is noticed on the next refresh.
+	m_ReadFiles.push_back(std::move(file));
+
 	// Get all the sections (i.e. different meters)
-	std::list<std::wstring> sections;
+	std::list<std::pair<std::wstring, const IniReader::Section*>> sections;
 	std::unordered_set<std::wstring> unique;
 	std::wstring key, value;  // buffer
 
-	DWORD itemsSize = MAX_LINE_LENGTH;
-	WCHAR* items = new WCHAR[itemsSize];
-	WCHAR* pos = nullptr;
-	WCHAR* epos = nullptr;
-
 	if (skinSection == nullptr)
 	{
-		// Get all the sections
-		do
+		// Get all the sections. The keys of duplicate sections are ignored.
+		for (const auto& section : reader.GetSections())
 		{
-			items[0] = 0;
-			DWORD res = GetPrivateProfileSectionNames(items, itemsSize, iniRead.c_str());
-			if (res == 0)		// File not found
-			{
-				delete [] items;
-				if (temporary) System::RemoveFile(iniRead);
-				return;
-			}
-			if (res < itemsSize - 2)		// Fits in the buffer
-			{
-				epos = items + res;
-				break;
-			}
-
-			delete [] items;
-			itemsSize *= 2;
-			items = new WCHAR[itemsSize];
-		}
-		while (true);
+			if (section.nameLength == 0) continue;
 
-		// Read the sections
-		pos = items;
-		while (pos < epos)
-		{
-			if (*pos)
+			value.assign(section.name, section.nameLength);  // section name
+			StrToUpperC(key.assign(value));
+			if (unique.insert(key).second)
 			{
-				value = pos;  // section name
-				StrToUpperC(key.assign(value));
-				if (unique.insert(key).second)
+				if (m_FoundSections.insert(key).second)
 				{
-					if (m_FoundSections.insert(key).second)
-					{
-						m_Sections.insert(m_SectionInsertPos, value);
-					}
-					sections.push_back(value);
+					m_Sections.insert(m_SectionInsertPos, value);
 				}
-				pos += value.size() + 1;
-			}
-			else  // Empty string
-			{
-				++pos;
+				sections.emplace_back(value, &section);
 			}
 		}
 	}
@@ -1824,8 +2347,8 @@ void ConfigParser::ReadIniFile(const std::wstring& iniFile, LPCTSTR skinSection,
 		const std::wstring strRainmeter = L"Rainmeter";
 		const std::wstring strFolder = skinSection;
 
-		sections.push_back(strRainmeter);
-		sections.push_back(strFolder);
+		sections.emplace_back(strRainmeter, reader.FindSection(strRainmeter.c_str()));
+		sections.emplace_back(strFolder, reader.FindSection(strFolder.c_str()));
 
 		if (depth == 0)  // Add once
 		{
@@ -1837,120 +2360,505 @@ void ConfigParser::ReadIniFile(const std::wstring& iniFile, LPCTSTR skinSection,
 	// Read the keys and values
 	for (auto it = sections.cbegin(); it != sections.cend(); ++it)
 	{
+		const IniReader::Section* section = (*it).second;
+		if (!section) continue;
+
 		unique.clear();
 
-		const WCHAR* sectionName = (*it).c_str();
+		const WCHAR* sectionName = (*it).first.c_str();
 		bool isVariables = (_wcsicmp(sectionName, L"Variables") == 0);
 		bool isMetadata = (skinSection == nullptr && !isVariables && _wcsicmp(sectionName, L"Metadata") == 0);
 		bool resetInsertPos = true;
 
-		// Read all "key=value" from the section
-		do
+		for (size_t i = 0; i < section->keyCount; ++i)
 		{
-			items[0] = 0;
-			DWORD res = GetPrivateProfileSection(sectionName, items, itemsSize, iniRead.c_str());
-			if (res < itemsSize - 2)		// Fits in the buffer
-			{
-				epos = items + res;
-				break;
-			}
-
-			delete [] items;
-			itemsSize *= 2;
-			items = new WCHAR[itemsSize];
-		}
-		while (true);
+			const IniReader::Key& iniKey = reader.GetKey(section->firstKey + i);
 
-		pos = items;
-		while (pos < epos)
-		{
-			if (*pos)
+			StrToUpperC(key.assign(iniKey.name, iniKey.nameLength));
+			if (unique.insert(key).second)
 			{
-				size_t len = wcslen(pos);
-				WCHAR* sep = wmemchr(pos, L'=', len);
-				if (sep != nullptr && sep != pos)
+				const WCHAR* sep = iniKey.value;
+				size_t clen = iniKey.valueLength;  // value's length
+
+				// Trim surrounded quotes from value
+				if (clen >= 2 && (sep[0] == L'"' || sep[0] == L'\'') && sep[clen - 1] == sep[0])
 				{
-					size_t clen = sep - pos;  // key's length
+					clen -= 2;
+					++sep;
+				}
 
-					StrToUpperC(key.assign(pos, clen));
-					if (unique.insert(key).second)
+				if (wcsncmp(key.c_str(), L"@INCLUDE", 8) == 0)
+				{
+					if (clen > 0)
 					{
-						++sep;
-						clen = len - (clen + 1);  // value's length
-
-						// Trim surrounded quotes from value
-						if (clen >= 2 && (sep[0] == L'"' || sep[0] == L'\'') && sep[clen - 1] == sep[0])
+						value.assign(sep, clen);
+						ReadVariables();
+						ReplaceVariables(value, true);
+						if (!PathUtil::IsAbsolute(value))
 						{
-							clen -= 2;
-							++sep;
+							// Relative to the ini folder
+							value.insert(0, PathUtil::GetFolderFromFilePath(iniFile));
 						}
 
-						if (wcsncmp(key.c_str(), L"@INCLUDE", 8) == 0)
+						if (resetInsertPos)
 						{
-							if (clen > 0)
+							auto jt = it;
+							if (++jt == sections.end())  // Special case: @include was used in the last section of the current file
 							{
-								value.assign(sep, clen);
-								ReadVariables();
-								ReplaceVariables(value, true);
-								if (!PathUtil::IsAbsolute(value))
-								{
-									// Relative to the ini folder
-									value.insert(0, PathUtil::GetFolderFromFilePath(iniFile));
-								}
-
-								if (resetInsertPos)
+								// Set the insertion place to the last
+								m_SectionInsertPos = m_Sections.end();
+								resetInsertPos = false;
+							}
+							else
+							{
+								// Find the appropriate insertion place
+								for (auto kt = m_Sections.cbegin(); kt != m_Sections.cend(); ++kt)
 								{
-									auto jt = it;
-									if (++jt == sections.end())  // Special case: @include was used in the last section of the current file
+									if (_wcsicmp((*kt).c_str(), sectionName) == 0)
 									{
-										// Set the insertion place to the last
-										m_SectionInsertPos = m_Sections.end();
+										m_SectionInsertPos = ++kt;
 										resetInsertPos = false;
-									}
-									else
-									{
-										// Find the appropriate insertion place
-										for (jt = m_Sections.cbegin(); jt != m_Sections.cend(); ++jt)
-										{
-											if (_wcsicmp((*jt).c_str(), sectionName) == 0)
-											{
-												m_SectionInsertPos = ++jt;
-												resetInsertPos = false;
-												break;
-											}
-										}
+										break;
 									}
 								}
-
-								ReadIniFile(value, skinSection, depth + 1);
 							}
 						}
-						else
-						{
-							if (!isMetadata)  // Uncache Metadata's key-value pair in the skin
-							{
-								value.assign(sep, clen);
-								SetValue((*it), key, value);
 
-								if (isVariables)
-								{
-									m_ListVariables.push_back(key);
-								}
-							}
+						ReadIniFile(value, skinSection, depth + 1);
+					}
+				}
+				else
+				{
+					if (!isMetadata)  // Uncache Metadata's key-value pair in the skin
+					{
+						value.assign(sep, clen);
+						SetValue((*it).first, key, value);
+
+						if (isVariables)
+						{
+							m_ListVariables.push_back(key);
 						}
 					}
 				}
-				pos += len + 1;
 			}
-			else  // Empty string
+		}
+	}
+}
+
+/*
+** Restores the sections and values of the skin if it was read before and none of the files it
+** read have changed since. Returns false if the files must be read again.
+**
+*/
+bool ConfigParser::RestoreParsedSkin(const std::wstring& iniFile, const std::wstring& key)
+{
+	auto iter = c_ParsedSkins.find(key);
+	if (iter == c_ParsedSkins.end())
+	{
+		// Not yet read in this session, e.g. when the skins are loaded at logon.
+		ParsedSkin parsed;
+		if (!LoadParsedSkin(key, parsed)) return false;
+
+		iter = c_ParsedSkins.insert(std::make_pair(key, std::move(parsed))).first;
+	}
+
+	const ParsedSkin& parsed = (*iter).second;
+	ParsedSkin::File file;
+	for (const auto& readFile : parsed.files)
+	{
+		if (!GetFileStamp(readFile.path, file) ||
+			file.size != readFile.size || file.writeTime != readFile.writeTime)
+		{
+			return false;
+		}
+	}
+
+	if (GetRainmeter().GetDebug()) LogDebugF(m_Skin, L"Reading file: %s (unchanged)", iniFile.c_str());
+
+	const WCHAR* strings = parsed.strings.c_str();
+	for (UINT section : parsed.sections)
+	{
+		m_Sections.emplace_back(strings + section);
+	}
+
+	m_Values.reserve(parsed.values.size());
+	for (const auto& value : parsed.values)
+	{
+		const AtomTable::Atom section = m_Atoms.Add(strings + value.section);
+		m_Values[MakeValueKey(section, m_Atoms.Add(strings + value.key))] = strings + value.value;
+	}
+
+	for (UINT variable : parsed.listVariables)
+	{
+		m_ListVariables.emplace_back(strings + variable);
+	}
+
+	return true;
+}
+
+/*
+** Stores the sections and values read by ReadIniFile for RestoreParsedSkin.
+**
+*/
+void ConfigParser::StoreParsedSkin(const std::wstring& key)
+{
+	if (m_ReadFailed)
+	{
+		// Read again next time so that the errors are logged again.
+		c_ParsedSkins.erase(key);
+		if (!c_ParsedSkinDirectory.empty())
+		{
+			DeleteFile(GetParsedSkinPath(key).c_str());
+		}
+		return;
+	}
+
+	ParsedSkin& parsed = c_ParsedSkins[key];
+	parsed.files.swap(m_ReadFiles);
+	parsed.strings.clear();
+	parsed.sections.clear();
+	parsed.values.clear();
+	parsed.listVariables.clear();
+
+	// Each distinct string is stored once.
+	std::unordered_map<std::wstring, UINT> offsets;
+	auto addString = [&](const std::wstring& str)
+	{
+		auto result = offsets.insert(std::make_pair(str, (UINT)parsed.strings.size()));
+		if (result.second)
+		{
+			parsed.strings.append(str.c_str(), str.size() + 1);
+		}
+		return (*result.first).second;
+	};
+
+	parsed.sections.reserve(m_Sections.size());
+	for (const auto& section : m_Sections)
+	{
+		parsed.sections.push_back(addString(section));
+	}
+
+	parsed.values.reserve(m_Values.size());
+	for (const auto& value : m_Values)
+	{
+		ParsedSkin::Value parsedValue;
+		parsedValue.section = addString(m_Atoms.GetString((AtomTable::Atom)(value.first >> 32)));
+		parsedValue.key = addString(m_Atoms.GetString((AtomTable::Atom)value.first));
+		parsedValue.value = addString(value.second);
+		parsed.values.push_back(parsedValue);
+	}
+
+	for (const auto& variable : m_ListVariables)
+	{
+		parsed.listVariables.push_back(addString(variable));
+	}
+
+	parsed.strings.shrink_to_fit();
+
+	SaveParsedSkin(key, parsed);
+}
+
+/*
+** Returns the uppercase path of |iniFile| followed by the built-in, user-defined and monitor
+** variables, which can all be used in @Include paths.
+**
+*/
+std::wstring ConfigParser::GetParsedSkinKey(const std::wstring& iniFile)
+{
+	std::vector<std::wstring> variables;
+	auto addVariable = [&](WCHAR type, const std::wstring& name, const std::wstring& value)
+	{
+		std::wstring str(1, type);
+		str += name;
+		str += L'=';
+		str += value;
+		variables.push_back(std::move(str));
+	};
+
+	for (const auto& variable : m_BuiltInVariables)
+	{
+		addVariable(L'B', m_Atoms.GetString(variable.first), variable.second);
+	}
+
+	for (const auto& variable : m_Variables)
+	{
+		addVariable(L'V', m_Atoms.GetString(variable.first), variable.second);
+	}
+
+	for (const auto& variable : c_MonitorVariables)
+	{
+		addVariable(L'M', variable.first, variable.second);
+	}
+
+	std::sort(variables.begin(), variables.end());
+
+	std::wstring key = StrToUpper(iniFile);
+	key += L'\0';
+	for (const auto& variable : variables)
+	{
+		key.append(variable.c_str(), variable.size() + 1);
+	}
+	return key;
+}
+
+bool ConfigParser::GetFileStamp(const std::wstring& path, ParsedSkin::File& file)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data)) return false;
+
+	file.path = path;
+	file.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	file.writeTime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+void ConfigParser::SetParsedSkinDirectory(const std::wstring& directory, uint64_t maxSize)
+{
+	c_ParsedSkinDirectory = directory;
+	if (!c_ParsedSkinDirectory.empty())
+	{
+		if (c_ParsedSkinDirectory.back() != L'\\')
+		{
+			c_ParsedSkinDirectory += L'\\';
+		}
+
+		TrimParsedSkinDirectory(maxSize);
+	}
+}
+
+/*
+** Deletes the files left by interrupted writes and the least recently used parsed skins until the
+** directory is no larger than |maxSize|.
+**
+*/
+void ConfigParser::TrimParsedSkinDirectory(uint64_t maxSize)
+{
+	struct CacheFile
+	{
+		std::wstring name;
+		uint64_t size;
+		uint64_t writeTime;
+	};
+	std::vector<CacheFile> files;
+
+	WIN32_FIND_DATA findData;
+	HANDLE find = FindFirstFile((c_ParsedSkinDirectory + L'*').c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE) return;
+
+	do
+	{
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+
+		const size_t length = wcslen(findData.cFileName);
+		if (length > 4 && _wcsicmp(findData.cFileName + length - 4, L".bin") == 0)
+		{
+			CacheFile cacheFile;
+			cacheFile.name = findData.cFileName;
+			cacheFile.size = ((uint64_t)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+			cacheFile.writeTime = ((uint64_t)findData.ftLastWriteTime.dwHighDateTime << 32) | findData.ftLastWriteTime.dwLowDateTime;
+			files.push_back(std::move(cacheFile));
+		}
+		else
+		{
+			DeleteFile((c_ParsedSkinDirectory + findData.cFileName).c_str());
+		}
+	}
+	while (FindNextFile(find, &findData));
+	FindClose(find);
+
+	// Newest first. LoadParsedSkin() updates the write time of the files that are used.
+	std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b)
+	{
+		return a.writeTime > b.writeTime;
+	});
+
+	uint64_t size = 0;
+	for (const auto& cacheFile : files)
+	{
+		size += cacheFile.size;
+		if (size > maxSize)
+		{
+			DeleteFile((c_ParsedSkinDirectory + cacheFile.name).c_str());
+		}
+	}
+}
+
+void ConfigParser::RemoveParsedSkin(const std::wstring& iniFile)
+{
+	// The key starts with the path. See GetParsedSkinKey().
+	std::wstring prefix = StrToUpper(iniFile);
+	prefix += L'\0';
+
+	for (auto iter = c_ParsedSkins.begin(); iter != c_ParsedSkins.end(); )
+	{
+		if ((*iter).first.compare(0, prefix.size(), prefix) == 0)
+		{
+			iter = c_ParsedSkins.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+/*
+** Returns the path of the file of |key|. The file name is the hash of the skin file followed by the
+** hash of the whole key, so the key is also stored in the file.
+**
+*/
+std::wstring ConfigParser::GetParsedSkinPath(const std::wstring& key)
+{
+	// The key starts with the null-terminated path. See GetParsedSkinKey().
+	const std::wstring iniFile = key.c_str();
+
+	WCHAR buffer[32];
+	_snwprintf_s(buffer, _TRUNCATE, L"%08x-%08x.bin",
+		(UINT)std::hash<std::wstring>()(iniFile), (UINT)std::hash<std::wstring>()(key));
+	return c_ParsedSkinDirectory + buffer;
+}
+
+/*
+** Returns the FindFirstFile pattern that matches the files of all keys of the skin file of |key|.
+**
+*/
+std::wstring ConfigParser::GetParsedSkinPattern(const std::wstring& key)
+{
+	const std::wstring iniFile = key.c_str();
+
+	WCHAR buffer[32];
+	_snwprintf_s(buffer, _TRUNCATE, L"%08x-*.bin", (UINT)std::hash<std::wstring>()(iniFile));
+	return c_ParsedSkinDirectory + buffer;
+}
+
+bool ConfigParser::LoadParsedSkin(const std::wstring& key, ParsedSkin& parsed)
+{
+	if (c_ParsedSkinDirectory.empty()) return false;
+
+	const std::wstring path = GetParsedSkinPath(key);
+	FILE* file = _wfopen(path.c_str(), L"rb");
+	if (!file) return false;
+
+	std::wstring fileKey;
+	UINT32 header[2];
+	UINT32 fileCount;
+	bool valid =
+		fread(header, sizeof(header), 1, file) == 1 &&
+		header[0] == PARSED_SKIN_MAGIC && header[1] == PARSED_SKIN_VERSION &&
+		ReadArray(file, fileKey) && fileKey == key &&
+		fread(&fileCount, sizeof(fileCount), 1, file) == 1 && fileCount <= MAX_FILE_ARRAY_SIZE;
+
+	if (valid)
+	{
+		parsed.files.resize(fileCount);
+		for (auto& readFile : parsed.files)
+		{
+			if (!ReadArray(file, readFile.path) ||
+				fread(&readFile.size, sizeof(readFile.size), 1, file) != 1 ||
+				fread(&readFile.writeTime, sizeof(readFile.writeTime), 1, file) != 1)
 			{
-				++pos;
+				valid = false;
+				break;
 			}
 		}
 	}
 
-	delete [] items;
-	if (temporary) System::RemoveFile(iniRead);
+	valid = valid &&
+		ReadArray(file, parsed.strings) &&
+		ReadArray(file, parsed.sections) &&
+		ReadArray(file, parsed.values) &&
+		ReadArray(file, parsed.listVariables);
+
+	fclose(file);
+
+	// All offsets must point to null-terminated strings.
+	const UINT size = (UINT)parsed.strings.size();
+	auto isValid = [size](UINT offset) { return offset < size; };
+	valid = valid && size > 0 && parsed.strings.back() == L'\0' &&
+		std::all_of(parsed.sections.cbegin(), parsed.sections.cend(), isValid) &&
+		std::all_of(parsed.listVariables.cbegin(), parsed.listVariables.cend(), isValid) &&
+		std::all_of(parsed.values.cbegin(), parsed.values.cend(), [&](const ParsedSkin::Value& value)
+		{
+			return isValid(value.section) && isValid(value.key) && isValid(value.value);
+		});
+
+	if (valid)
+	{
+		// Mark the file as recently used for TrimParsedSkinDirectory().
+		HANDLE handle = CreateFile(path.c_str(), FILE_WRITE_ATTRIBUTES, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		if (handle != INVALID_HANDLE_VALUE)
+		{
+			FILETIME now;
+			GetSystemTimeAsFileTime(&now);
+			SetFileTime(handle, nullptr, nullptr, &now);
+			CloseHandle(handle);
+		}
+	}
+	else
+	{
+		DeleteFile(path.c_str());
+	}
+
+	return valid;
+}
+
+void ConfigParser::SaveParsedSkin(const std::wstring& key, const ParsedSkin& parsed)
+{
+	if (c_ParsedSkinDirectory.empty()) return;
+
+	SHCreateDirectoryEx(nullptr, c_ParsedSkinDirectory.c_str(), nullptr);
+
+	// Write to a temporary file first so that a partially written file is never loaded.
+	const std::wstring path = GetParsedSkinPath(key);
+	const std::wstring tempPath = path + L".tmp";
+	FILE* file = _wfopen(tempPath.c_str(), L"wb");
+	if (!file) return;
+
+	const UINT32 header[2] = { PARSED_SKIN_MAGIC, PARSED_SKIN_VERSION };
+	const UINT32 fileCount = (UINT32)parsed.files.size();
+	bool written =
+		fwrite(header, sizeof(header), 1, file) == 1 &&
+		WriteArray(file, key) &&
+		fwrite(&fileCount, sizeof(fileCount), 1, file) == 1;
+
+	for (const auto& readFile : parsed.files)
+	{
+		written = written &&
+			WriteArray(file, readFile.path) &&
+			fwrite(&readFile.size, sizeof(readFile.size), 1, file) == 1 &&
+			fwrite(&readFile.writeTime, sizeof(readFile.writeTime), 1, file) == 1;
+	}
+
+	written = written &&
+		WriteArray(file, parsed.strings) &&
+		WriteArray(file, parsed.sections) &&
+		WriteArray(file, parsed.values) &&
+		WriteArray(file, parsed.listVariables);
+	fclose(file);
+
+	if (!written || !MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFile(tempPath.c_str());
+		return;
+	}
+
+	// Only the last parsed form of the skin file is kept on disk so that a file is not left behind
+	// every time a variable used in the key changes.
+	WIN32_FIND_DATA findData;
+	HANDLE find = FindFirstFile(GetParsedSkinPattern(key).c_str(), &findData);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			const std::wstring otherPath = c_ParsedSkinDirectory + findData.cFileName;
+			if (_wcsicmp(otherPath.c_str(), path.c_str()) != 0)
+			{
+				DeleteFile(otherPath.c_str());
+			}
+		}
+		while (FindNextFile(find, &findData));
+		FindClose(find);
+	}
 }
 
 /*
@@ -1961,13 +2869,10 @@ void ConfigParser::SetValue(const std::wstring& strSection, const std::wstring&
 {
 	// LogDebugF(L"[%s] %s=%s (size: %i)", strSection.c_str(), strKey.c_str(), strValue.c_str(), (int)m_Values.size());
 
-	std::wstring strTmp;
-	strTmp.reserve(strSection.size() + 1 + strKey.size());
-	strTmp = strSection;
-	strTmp += L'~';
-	strTmp += strKey;
+	const AtomTable::Atom section = m_Atoms.Add(strSection);
+	m_Values[MakeValueKey(section, m_Atoms.Add(strKey))] = strValue;
 
-	m_Values[StrToUpperC(strTmp)] = strValue;
+	UpdateVersion(m_SectionVersions, section);
 }
 
 /*
@@ -1976,16 +2881,16 @@ void ConfigParser::SetValue(const std::wstring& strSection, const std::wstring&
 */
 void ConfigParser::DeleteValue(const std::wstring& strSection, const std::wstring& strKey)
 {
-	std::wstring strTmp;
-	strTmp.reserve(strSection.size() + 1 + strKey.size());
-	strTmp = strSection;
-	strTmp += L'~';
-	strTmp += strKey;
+	const AtomTable::Atom section = m_Atoms.Find(strSection);
+	const AtomTable::Atom key = m_Atoms.Find(strKey);
+	if (section == AtomTable::Invalid || key == AtomTable::Invalid) return;
 
-	std::unordered_map<std::wstring, std::wstring>::const_iterator iter = m_Values.find(StrToUpperC(strTmp));
+	std::unordered_map<uint64_t, std::wstring>::const_iterator iter = m_Values.find(MakeValueKey(section, key));
 	if (iter != m_Values.end())
 	{
 		m_Values.erase(iter);
+
+		UpdateVersion(m_SectionVersions, section);
 	}
 }
 
@@ -1994,6 +2899,42 @@ void ConfigParser::DeleteValue(const std::wstring& strSection, const std::wstrin
 **
 */
 const std::wstring& ConfigParser::GetValue(const std::wstring& strSection, const std::wstring& strKey, const std::wstring& strDefault)
+{
+	const std::wstring* value = FindValue(m_Atoms.Find(strSection), m_Atoms.Find(strKey));
+	return value ? *value : strDefault;
+}
+
+const std::wstring* ConfigParser::FindValue(AtomTable::Atom section, AtomTable::Atom key)
+{
+	if (section == AtomTable::Invalid || key == AtomTable::Invalid) return nullptr;
+
+	std::unordered_map<uint64_t, std::wstring>::const_iterator iter = m_Values.find(MakeValueKey(section, key));
+	return (iter != m_Values.end()) ? &(*iter).second : nullptr;
+}
+
+void ConfigParser::SetStringKeyLookup(bool enable)
+{
+	m_StringKeyLookup = enable;
+	m_StringValues.clear();
+
+	if (enable)
+	{
+		for (const auto& value : m_Values)
+		{
+			std::wstring strTmp = m_Atoms.GetString((AtomTable::Atom)(value.first >> 32));
+			strTmp += L'~';
+			strTmp += m_Atoms.GetString((AtomTable::Atom)value.first);
+			m_StringValues[strTmp] = value.second;
+		}
+	}
+}
+
+/*
+** Same as FindValue, but builds and uppercases the key like ConfigParser did before the names were
+** interned. See SetStringKeyLookup().
+**
+*/
+const std::wstring* ConfigParser::FindStringValue(const std::wstring& strSection, const std::wstring& strKey)
 {
 	std::wstring strTmp;
 	strTmp.reserve(strSection.size() + 1 + strKey.size());
@@ -2001,6 +2942,6 @@ const std::wstring& ConfigParser::GetValue(const std::wstring& strSection, const
 	strTmp += L'~';
 	strTmp += strKey;
 
-	std::unordered_map<std::wstring, std::wstring>::const_iterator iter = m_Values.find(StrToUpperC(strTmp));
-	return (iter != m_Values.end()) ? (*iter).second : strDefault;
+	std::unordered_map<std::wstring, std::wstring>::const_iterator iter = m_StringValues.find(StrToUpperC(strTmp));
+	return (iter != m_StringValues.end()) ? &(*iter).second : nullptr;
 }
@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <ole2.h>  // For Gdiplus.h.
 #include <gdiplus.h>
+#include "AtomTable.h"
 
 class Rainmeter;
 class Skin;
@@ -47,6 +48,31 @@ public:
 		CharacterReference					// Not available.                     [\8364], [\x20AC], [\X20AC], etc.
 	};
 
+	// Variables, measures and sections that the options of a section were read from. Used to read
+	// the options again only when one of them has changed.
+	struct Dependencies
+	{
+		struct Version
+		{
+			const UINT* current;
+			UINT value;
+		};
+
+		struct MeasureValue
+		{
+			Measure* measure;
+			std::wstring value;
+		};
+
+		Dependencies() : monitorVersion(), isVolatile(true) {}
+
+		std::vector<Version> variables;
+		std::vector<Version> sections;
+		std::vector<MeasureValue> measures;
+		UINT monitorVersion;
+		bool isVolatile;	// Options must be read every time.
+	};
+
 	ConfigParser();
 	~ConfigParser();
 
@@ -62,12 +88,18 @@ public:
 	void SetVariable(std::wstring strVariable, const std::wstring& strValue);
 	void SetBuiltInVariable(const std::wstring& strVariable, const std::wstring& strValue);
 
-	const std::unordered_map<std::wstring, std::wstring>& GetVariables() { return m_Variables; }
+	const std::unordered_map<AtomTable::Atom, std::wstring>& GetVariables() { return m_Variables; }
+	const std::wstring& GetVariableName(AtomTable::Atom atom) const { return m_Atoms.GetString(atom); }
 
 	const std::wstring& GetValue(const std::wstring& strSection, const std::wstring& strKey, const std::wstring& strDefault);
 	void SetValue(const std::wstring& strSection, const std::wstring& strKey, const std::wstring& strValue);
 	void DeleteValue(const std::wstring& strSection, const std::wstring& strKey);
 
+	// If |true|, ReadString looks up the values by an uppercase "SECTION~KEY" string like it did
+	// before the names were interned. Only used to benchmark the atom lookup. The values that are
+	// set while it is enabled are not seen.
+	void SetStringKeyLookup(bool enable);
+
 	void SetStyleTemplate(const std::wstring& strStyle) { static const std::wstring delim(1, L'|'); Tokenize(strStyle, delim).swap(m_StyleTemplate); }
 	void ClearStyleTemplate() { m_StyleTemplate.clear(); }
 
@@ -95,6 +127,11 @@ public:
 
 	const std::list<std::wstring>& GetSections() { return m_Sections; }
 
+	void BeginDependencies(Dependencies& dependencies);
+	void EndDependencies() { m_Dependencies = nullptr; }
+	void AddVolatileDependency() { if (m_Dependencies) m_Dependencies->isVolatile = true; }
+	bool HasChanged(const Dependencies& dependencies);
+
 	bool ReplaceVariables(std::wstring& result, bool isNewStyle = false);
 	bool ReplaceMeasures(std::wstring& result);
 
@@ -112,20 +149,115 @@ public:
 	static Gdiplus::Rect ParseRect(LPCTSTR string);
 	static RECT ParseRECT(LPCTSTR string);
 
-	static void ClearMultiMonitorVariables() { c_MonitorVariables.clear(); }
+	static void ClearMultiMonitorVariables() { c_MonitorVariables.clear(); ++c_MonitorVariablesVersion; }
 	static void UpdateWorkareaVariables() { SetMultiMonitorVariables(false); }
 	static bool IsVariableKey(const WCHAR ch) { for (auto& k : c_VariableMap) { if (k.second == ch) return true; } return false; }
 
+	// Parsed skins are also written to |directory| so that they can be restored after a restart.
+	// Empty to keep them in memory only. Only the last parsed form of each skin file is written and
+	// the least recently used files are deleted when the directory is larger than |maxSize| bytes.
+	static void SetParsedSkinDirectory(const std::wstring& directory, uint64_t maxSize = 16 * 1024 * 1024);
+
+	// Removes the parsed forms of |iniFile| from memory, e.g. when the skin is unloaded.
+	static void RemoveParsedSkin(const std::wstring& iniFile);
+
 private:
+	// Option value split into literal text and the references that were substituted into it so
+	// that the value can be rendered again without scanning it. See CompileTemplate().
+	struct Template
+	{
+		enum class PartType : BYTE
+		{
+			Literal,
+			Variable,			// #Var#, [#Var]
+			Measure,			// [Measure], [&Measure]
+			SectionVariable,	// [Meter:X], [&Measure:MaxValue], etc.
+			MissingVariable,	// Unresolved variable, only used as a guard.
+			MissingSection		// Unresolved measure or section variable, only used as a guard.
+		};
+
+		struct Part
+		{
+			PartType type;
+			std::wstring text;	// Literal text or the reference name.
+			Measure* measure;
+		};
+
+		Template() : compiled(false), dynamic(false), replaced(false) {}
+
+		std::wstring raw;
+		bool compiled;
+		bool dynamic;		// Value must be substituted by scanning it every time.
+		bool replaced;
+		std::vector<Part> parts;
+		std::vector<Part> guards;
+	};
+
+	// Result of ReadIniFile for a skin and the files it included. The names and values are stored
+	// in a single string so that a refresh of an unchanged skin restores them without reading the
+	// files again. Keyed by the path and the variables that were set before reading, since
+	// @Include paths can use variables (see GetParsedSkinKey()).
+	struct ParsedSkin
+	{
+		struct File
+		{
+			std::wstring path;
+			uint64_t size;
+			uint64_t writeTime;
+		};
+
+		struct Value
+		{
+			UINT section;		// Offsets in strings
+			UINT key;
+			UINT value;
+		};
+
+		std::vector<File> files;
+		std::wstring strings;		// Null-terminated names and values
+		std::vector<UINT> sections;
+		std::vector<Value> values;
+		std::vector<UINT> listVariables;
+	};
+
 	void SetBuiltInVariables(const std::wstring& filename, const std::wstring* resourcePath, Skin* skin);
 
 	void ReadVariables();
 
 	void ReadIniFile(const std::wstring& iniFile, LPCTSTR skinSection = nullptr, int depth = 0);
 
+	bool RestoreParsedSkin(const std::wstring& iniFile, const std::wstring& key);
+	void StoreParsedSkin(const std::wstring& key);
+	std::wstring GetParsedSkinKey(const std::wstring& iniFile);
+	static bool GetFileStamp(const std::wstring& path, ParsedSkin::File& file);
+	static std::wstring GetParsedSkinPath(const std::wstring& key);
+	static std::wstring GetParsedSkinPattern(const std::wstring& key);
+	static void TrimParsedSkinDirectory(uint64_t maxSize);
+	static bool LoadParsedSkin(const std::wstring& key, ParsedSkin& parsed);
+	static void SaveParsedSkin(const std::wstring& key, const ParsedSkin& parsed);
+
 	void SetAutoSelectedMonitorVariables(Skin* skin);
 
 	bool GetSectionVariable(std::wstring& strVariable, std::wstring& strValue);
+	const std::wstring* FindVariable(const std::wstring& strVariable);
+	const WCHAR* GetMeasureValue(Measure* measure);
+
+	void AddDependency(std::vector<Dependencies::Version>& versions, std::unordered_map<AtomTable::Atom, UINT>& map, AtomTable::Atom atom);
+	static void UpdateVersion(std::unordered_map<AtomTable::Atom, UINT>& map, AtomTable::Atom atom);
+
+	// Values are keyed by the atoms of the section and the key.
+	static uint64_t MakeValueKey(AtomTable::Atom section, AtomTable::Atom key) { return ((uint64_t)section << 32) | key; }
+	const std::wstring* FindValue(AtomTable::Atom section, AtomTable::Atom key);
+	const std::wstring* FindStringValue(const std::wstring& strSection, const std::wstring& strKey);
+
+	bool ReplaceValue(std::wstring& result, bool isVariablesSection, bool bReplaceMeasures);
+
+	void CompileTemplate(Template& tmpl, bool isVariablesSection, bool bReplaceMeasures);
+	bool RenderTemplate(const Template& tmpl, bool isVariablesSection, std::wstring& result);
+	void CheckTemplateRange(const std::wstring& result, size_t start, size_t end);
+	const std::wstring* AddTemplateVariable(const std::wstring& strVariable, const std::wstring* value);
+	const WCHAR* AddTemplateMeasure(Measure* measure);
+	bool AddTemplateSectionVariable(std::wstring& strVariable, std::wstring& strValue);
 
 	static void SetVariable(std::unordered_map<std::wstring, std::wstring>& variables, const std::wstring& strVariable, const std::wstring& strValue);
 	static void SetVariable(std::unordered_map<std::wstring, std::wstring>& variables, const WCHAR* strVariable, const WCHAR* strValue);
@@ -137,7 +269,9 @@ private:
 	static std::wstring StrToUpper(const WCHAR* str) { std::wstring strTmp(str); StrToUpperC(strTmp); return strTmp; }
 	static std::wstring& StrToUpperC(std::wstring& str) { _wcsupr(&str[0]); return str; }
 
-	std::unordered_map<std::wstring, Measure*> m_Measures;
+	AtomTable m_Atoms;
+
+	std::unordered_map<AtomTable::Atom, Measure*> m_Measures;
 
 	std::vector<std::wstring> m_StyleTemplate;
 
@@ -148,18 +282,38 @@ private:
 	std::wstring* m_CurrentSection;
 
 	std::list<std::wstring> m_Sections;		// Ordered section
-	std::unordered_map<std::wstring, std::wstring> m_Values;
+	std::unordered_map<uint64_t, std::wstring> m_Values;
+
+	// See SetStringKeyLookup().
+	bool m_StringKeyLookup;
+	std::unordered_map<std::wstring, std::wstring> m_StringValues;
 
 	std::unordered_set<std::wstring> m_FoundSections;
 	std::list<std::wstring> m_ListVariables;
 	std::list<std::wstring>::const_iterator m_SectionInsertPos;
 
-	std::unordered_map<std::wstring, std::wstring> m_BuiltInVariables;
-	std::unordered_map<std::wstring, std::wstring> m_Variables;
+	// Files read by ReadIniFile and whether some file could not be read.
+	std::vector<ParsedSkin::File> m_ReadFiles;
+	bool m_ReadFailed;
+
+	std::unordered_map<AtomTable::Atom, std::wstring> m_BuiltInVariables;
+	std::unordered_map<AtomTable::Atom, std::wstring> m_Variables;
+
+	std::unordered_map<uint64_t, Template> m_Templates[2];	// Indexed by bReplaceMeasures
+	Template* m_CompilingTemplate;
+
+	// Incremented when the variable or the values in the section change. Only contains the names
+	// that some section depends on.
+	std::unordered_map<AtomTable::Atom, UINT> m_VariableVersions;
+	std::unordered_map<AtomTable::Atom, UINT> m_SectionVersions;
+	Dependencies* m_Dependencies;
 
 	Skin* m_Skin;
 
 	static std::unordered_map<std::wstring, std::wstring> c_MonitorVariables;
+	static UINT c_MonitorVariablesVersion;
+	static std::unordered_map<std::wstring, ParsedSkin> c_ParsedSkins;	// Keyed by GetParsedSkinKey()
+	static std::wstring c_ParsedSkinDirectory;
 	static std::unordered_map<VariableType, WCHAR> c_VariableMap;
 };
 
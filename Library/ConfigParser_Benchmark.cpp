@@ -0,0 +1,124 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "ConfigParser.h"
+#include "MeasureCalc.h"
+#include "MeasureLoop.h"
+#include "MeasureString.h"
+#include "../Common/Timer.h"
+#include "../Common/UnitTest.h"
+
+TEST_CLASS(Library_ConfigParser_Benchmark)
+{
+public:
+	TEST_METHOD(BenchmarkReadOptions)
+	{
+		// Large skin with String, Calc and Loop measures. Meters are not included because their
+		// ReadOptions needs a Skin. The measures are created without one and read all of their
+		// options like Skin::ReadSkin does. A style is applied like Meter::ReadOptions does so that
+		// the keys that are not defined are looked up twice.
+		const int measureCount = 1000;
+
+		WCHAR path[MAX_PATH];
+		GetTempPath(_countof(path), path);
+		GetTempFileName(path, L"rm", 0, path);
+
+		FILE* file;
+		Assert::AreEqual(0, (int)_wfopen_s(&file, path, L"w, ccs=UTF-16LE"));
+		fwprintf(file, L"[Variables]\nPrefix=Value\n\n[MeasureStyle]\nMinValue=0\nMaxValue=1000\n\n");
+		for (int i = 0; i < measureCount; ++i)
+		{
+			fwprintf(file, L"[Measure%i]\n", i);
+			switch (i % 3)
+			{
+			case 0:
+				fwprintf(file, L"Measure=String\nString=#Prefix# %i\n", i);
+				break;
+
+			case 1:
+				fwprintf(file, L"Measure=Calc\nFormula=(%i * 2 + 1)\n", i);
+				break;
+
+			case 2:
+				fwprintf(file, L"Measure=Loop\nStartValue=%i\nEndValue=%i\nIncrement=2\n", i, i + 100);
+				break;
+			}
+		}
+		fclose(file);
+
+		ConfigParser parser;
+		parser.Initialize(path);
+		DeleteFile(path);
+
+		std::vector<Measure*> measures;
+		WCHAR buffer[256];
+		for (int i = 0; i < measureCount; ++i)
+		{
+			_snwprintf_s(buffer, _TRUNCATE, L"Measure%i", i);
+			switch (i % 3)
+			{
+			case 0: measures.push_back(new MeasureString(nullptr, buffer)); break;
+			case 1: measures.push_back(new MeasureCalc(nullptr, buffer)); break;
+			case 2: measures.push_back(new MeasureLoop(nullptr, buffer)); break;
+			}
+		}
+
+		const int iterations = 10;
+
+		parser.SetStringKeyLookup(true);
+		const double stringTime = ReadMeasures(parser, measures, iterations);
+		std::vector<std::wstring> stringValues = GetValues(measures);
+
+		parser.SetStringKeyLookup(false);
+		const double atomTime = ReadMeasures(parser, measures, iterations);
+		std::vector<std::wstring> atomValues = GetValues(measures);
+
+		Assert::IsTrue(stringValues == atomValues);
+		Assert::AreEqual(L"Value 0", atomValues[0].c_str());
+		Assert::AreEqual(L"3", atomValues[1].c_str());
+
+		for (Measure* measure : measures)
+		{
+			delete measure;
+		}
+
+		_snwprintf_s(buffer, _TRUNCATE,
+			L"ConfigParser: ReadOptions of %i measures, %i times. String keys: %.2f ms, Atoms: %.2f ms (%.1fx)\n",
+			measureCount, iterations, stringTime, atomTime, stringTime / atomTime);
+		Logger::WriteMessage(buffer);
+	}
+
+private:
+	static double ReadMeasures(ConfigParser& parser, const std::vector<Measure*>& measures, int iterations)
+	{
+		Timer timer;
+		timer.Start();
+		parser.SetStyleTemplate(L"MeasureStyle");
+		for (int n = 0; n < iterations; ++n)
+		{
+			for (Measure* measure : measures)
+			{
+				measure->ReadOptions(parser);
+			}
+		}
+		parser.ClearStyleTemplate();
+		timer.Stop();
+		return timer.GetElapsed();
+	}
+
+	static std::vector<std::wstring> GetValues(const std::vector<Measure*>& measures)
+	{
+		std::vector<std::wstring> values;
+		for (Measure* measure : measures)
+		{
+			measure->Update();
+			values.push_back(measure->GetStringOrFormattedValue(AUTOSCALE_OFF, 1.0, 0, false));
+		}
+		return values;
+	}
+};
@@ -7,6 +7,7 @@
 
 #include "StdAfx.h"
 #include "ConfigParser.h"
+#include "../Common/Timer.h"
 #include "../Common/UnitTest.h"
 
 TEST_CLASS(Library_ConfigParser_Test)
@@ -20,6 +21,7 @@ public:
 		parser.SetValue(L"A", L"String", L"abc");
 		Assert::AreEqual(parser.ReadString(L"A", L"String", L"").c_str(), L"abc");
 		Assert::AreEqual(parser.ReadString(L"A", L"StringNA", L"def").c_str(), L"def");
+		Assert::AreEqual(parser.ReadString(L"a", L"STRING", L"").c_str(), L"abc");
 
 		parser.SetValue(L"A", L"Number", L"2");
 		Assert::AreEqual(parser.ReadInt(L"A", L"Number", 0), 2);
@@ -99,4 +101,331 @@ public:
 		parser.SetValue(L"A", L"String", L"#Var#");
 		Assert::AreNotEqual(parser.ReadString(L"A", L"String", L"").c_str(), L"BuiltIn");
 	}
+
+	TEST_METHOD(TestTemplates)
+	{
+		ConfigParser parser;
+		parser.Initialize(L"");  // TODO: Better way to initialize without file.
+
+		const WCHAR* values[] =
+		{
+			L"#A# and [#B] and text",
+			L"[#Var[#Idx]] [#Var#Idx#]",
+			L"[#*A*] #*A*# [*A*] [#A*]",
+			L"[#A][#A]#A##A#",
+			L"[\\65][\\x5B]#A#]",
+			L"[#A[#B]] [[#A]]",
+			L"#Missing# [#Missing] [Missing]"
+		};
+
+		// Templates must give the same result as the full substitution as the variables change.
+		const WCHAR* variables[][2] =
+		{
+			{ L"A", L"1" },
+			{ L"B", L"" },
+			{ L"Idx", L"2" },
+			{ L"A", L"" },
+			{ L"Missing", L"found" },
+			{ L"B", L"[#Idx]" },
+			{ L"A", L"#B#" },
+			{ L"A", L"*" }
+		};
+
+		parser.SetVariable(L"A", L"abc");
+		parser.SetVariable(L"B", L"def");
+		parser.SetVariable(L"Idx", L"1");
+		parser.SetVariable(L"Var1", L"first");
+		parser.SetVariable(L"Var2", L"second");
+
+		for (const WCHAR* value : values)
+		{
+			parser.SetValue(L"A", L"String", value);
+			for (const auto& variable : variables)
+			{
+				// Read twice so that the second read uses the template.
+				for (int i = 0; i < 2; ++i)
+				{
+					std::wstring expected = value;
+					const bool expectedReplaced = ReplaceAll(parser, expected);
+					const std::wstring& result = parser.ReadString(L"A", L"String", L"");
+					Assert::AreEqual(expected.c_str(), result.c_str());
+					Assert::AreEqual(expectedReplaced, parser.GetLastReplaced());
+				}
+
+				parser.SetVariable(variable[0], variable[1]);
+			}
+		}
+	}
+
+	TEST_METHOD(TestTemplateCurrentSection)
+	{
+		ConfigParser parser;
+		parser.Initialize(L"");  // TODO: Better way to initialize without file.
+		parser.SetVariable(L"A", L"abc");
+
+		// The value is read through the style from both sections.
+		parser.SetValue(L"Style", L"Action", L"[!SetOption [#CURRENTSECTION] X #A#]");
+		parser.SetStyleTemplate(L"Style");
+		for (int i = 0; i < 2; ++i)
+		{
+			Assert::AreEqual(L"[!SetOption M1 X abc]", parser.ReadString(L"M1", L"Action", L"").c_str());
+			Assert::AreEqual(L"[!SetOption M2 X abc]", parser.ReadString(L"M2", L"Action", L"").c_str());
+		}
+		parser.ClearStyleTemplate();
+
+		// Icon font text in the private use area is kept as is.
+		parser.SetValue(L"M1", L"Text", L"\uE000 #A# \uF8FF");
+		for (int i = 0; i < 2; ++i)
+		{
+			Assert::AreEqual(L"\uE000 abc \uF8FF", parser.ReadString(L"M1", L"Text", L"").c_str());
+		}
+	}
+
+	TEST_METHOD(TestDependencies)
+	{
+		ConfigParser parser;
+		parser.Initialize(L"");  // TODO: Better way to initialize without file.
+
+		parser.SetVariable(L"A", L"1");
+		parser.SetVariable(L"B", L"2");
+		parser.SetValue(L"Style", L"Y", L"#B#");
+		parser.SetValue(L"A", L"X", L"#A# [#Missing]");
+
+		ConfigParser::Dependencies dependencies;
+		Assert::IsTrue(parser.HasChanged(dependencies));
+
+		parser.BeginDependencies(dependencies);
+		parser.ReadString(L"A", L"X", L"");
+		parser.EndDependencies();
+		Assert::IsFalse(parser.HasChanged(dependencies));
+
+		// Setting a variable to the same value or changing unrelated variables does not matter.
+		parser.SetVariable(L"A", L"1");
+		parser.SetVariable(L"B", L"3");
+		parser.SetValue(L"B", L"X", L"");
+		Assert::IsFalse(parser.HasChanged(dependencies));
+
+		parser.SetVariable(L"A", L"2");
+		Assert::IsTrue(parser.HasChanged(dependencies));
+
+		// Variables that did not exist when the option was read are tracked as well.
+		parser.BeginDependencies(dependencies);
+		parser.ReadString(L"A", L"X", L"");
+		parser.EndDependencies();
+		parser.SetVariable(L"Missing", L"found");
+		Assert::IsTrue(parser.HasChanged(dependencies));
+
+		// Options that are not found are read from the style section.
+		parser.SetStyleTemplate(L"Style");
+		parser.BeginDependencies(dependencies);
+		parser.ReadString(L"A", L"Y", L"");
+		parser.EndDependencies();
+		parser.ClearStyleTemplate();
+		Assert::IsFalse(parser.HasChanged(dependencies));
+
+		parser.SetVariable(L"B", L"4");
+		Assert::IsTrue(parser.HasChanged(dependencies));
+
+		parser.BeginDependencies(dependencies);
+		parser.ReadString(L"A", L"Y", L"");
+		parser.EndDependencies();
+		parser.SetValue(L"A", L"Y", L"5");
+		Assert::IsTrue(parser.HasChanged(dependencies));
+	}
+
+	TEST_METHOD(TestParsedSkin)
+	{
+		WCHAR folder[MAX_PATH];
+		GetTempPath(_countof(folder), folder);
+		const std::wstring skinFile = std::wstring(folder) + L"RainmeterParsedSkin.ini";
+		const std::wstring includeFile = std::wstring(folder) + L"RainmeterParsedSkin.inc";
+		const std::wstring parsedFolder = std::wstring(folder) + L"RainmeterParsedSkins\\";
+		const std::wstring resources = std::wstring(folder) + L"@Resources\\";
+		const std::wstring otherResources = std::wstring(folder) + L"@OtherResources\\";
+		ConfigParser::SetParsedSkinDirectory(parsedFolder);
+
+		WriteIniFile(skinFile, L"[Variables]\nFile=RainmeterParsedSkin.inc\n[A]\n@Include=#File#\nX=1\n");
+		WriteIniFile(includeFile, L"[B]\nY=2\n");
+
+		// Only skins, which are read with a resources path, are kept.
+		auto readY = [&](const std::wstring* resourcePath)
+		{
+			ConfigParser parser;
+			parser.Initialize(skinFile, nullptr, nullptr, resourcePath);
+			return parser.ReadString(L"B", L"Y", L"");
+		};
+
+		{
+			ConfigParser parser;
+			parser.Initialize(skinFile, nullptr, nullptr, &resources);
+			Assert::AreEqual(3, (int)parser.GetSections().size());
+			Assert::AreEqual(L"2", parser.ReadString(L"B", L"Y", L"").c_str());
+		}
+
+		{
+			ConfigParser parser;
+			parser.Initialize(skinFile, nullptr, nullptr, &resources);
+			Assert::AreEqual(3, (int)parser.GetSections().size());
+			Assert::AreEqual(L"B", parser.GetSections().back().c_str());
+			Assert::AreEqual(L"1", parser.ReadString(L"A", L"X", L"").c_str());
+			Assert::AreEqual(L"2", parser.ReadString(L"B", L"Y", L"").c_str());
+			Assert::AreEqual(L"RainmeterParsedSkin.inc", parser.GetVariable(L"File")->c_str());
+		}
+
+		// An edit that keeps both the size and the write time is not noticed. This shows that the
+		// files are not read again, neither from memory nor from the parsed skin folder after the
+		// skin has been unloaded.
+		const FILETIME writeTime = GetWriteTime(includeFile);
+		WriteIniFile(includeFile, L"[B]\nY=3\n");
+		SetWriteTime(includeFile, writeTime, 0);
+		Assert::AreEqual(L"2", readY(&resources).c_str());
+		ConfigParser::RemoveParsedSkin(skinFile);
+		Assert::AreEqual(L"2", readY(&resources).c_str());
+		Assert::AreEqual(L"3", readY(nullptr).c_str());
+
+		// Edits of the same size are noticed by the write time, e.g. when an editor saves the file
+		// two seconds later.
+		WriteIniFile(includeFile, L"[B]\nY=4\n");
+		SetWriteTime(includeFile, writeTime, 2);
+		Assert::AreEqual(L"4", readY(&resources).c_str());
+
+		// Different variables, e.g. from a parse without a skin, are kept separately instead of
+		// replacing the parsed skin.
+		Assert::AreEqual(L"4", readY(&otherResources).c_str());
+		WriteIniFile(includeFile, L"[B]\nY=5\n");
+		SetWriteTime(includeFile, writeTime, 2);
+		Assert::AreEqual(L"4", readY(&resources).c_str());
+
+		// Edits that change the size are noticed.
+		WriteIniFile(includeFile, L"[B]\nY=22\n");
+		Assert::AreEqual(L"22", readY(&resources).c_str());
+
+		// Only the last parsed form of the skin file is kept on disk.
+		Assert::AreEqual(1, CountFiles(parsedFolder));
+
+		// Files left by interrupted writes and files over the size limit are deleted on startup.
+		WriteIniFile(parsedFolder + L"RainmeterParsedSkin.bin.tmp", L"");
+		ConfigParser::SetParsedSkinDirectory(parsedFolder);
+		Assert::AreEqual(1, CountFiles(parsedFolder));
+		ConfigParser::SetParsedSkinDirectory(parsedFolder, 0);
+		Assert::AreEqual(0, CountFiles(parsedFolder));
+
+		ConfigParser::RemoveParsedSkin(skinFile);
+		ConfigParser::SetParsedSkinDirectory(L"");
+		DeleteFolder(parsedFolder);
+		DeleteFile(includeFile.c_str());
+		DeleteFile(skinFile.c_str());
+	}
+
+	TEST_METHOD(TestTemplateThroughput)
+	{
+		ConfigParser parser;
+		parser.Initialize(L"");  // TODO: Better way to initialize without file.
+
+		parser.SetVariable(L"Color", L"255,255,255");
+		parser.SetVariable(L"Width", L"200");
+		parser.SetVariable(L"Label", L"CPU");
+
+		const WCHAR* value = L"[#Label]: #Width# px, color [#Color], #*escaped*#";
+		parser.SetValue(L"A", L"String", value);
+
+		const int iterations = 100000;
+
+		Timer timer;
+		timer.Start();
+		for (int i = 0; i < iterations; ++i)
+		{
+			std::wstring result = value;
+			ReplaceAll(parser, result);
+		}
+		timer.Stop();
+		const double scanTime = timer.GetElapsed();
+
+		timer.Start();
+		for (int i = 0; i < iterations; ++i)
+		{
+			parser.ReadString(L"A", L"String", L"");
+		}
+		timer.Stop();
+		const double templateTime = timer.GetElapsed();
+
+		Assert::AreEqual(parser.ReadString(L"A", L"String", L"").c_str(), L"CPU: 200 px, color 255,255,255, #escaped#");
+
+		WCHAR buffer[256];
+		_snwprintf_s(buffer, _TRUNCATE,
+			L"ConfigParser: %i reads. Scan: %.2f ms, Template: %.2f ms (%.1fx)\n",
+			iterations, scanTime, templateTime, scanTime / templateTime);
+		Logger::WriteMessage(buffer);
+	}
+
+	// Substitutes the value the same way as ReadString without templates.
+	static bool ReplaceAll(ConfigParser& parser, std::wstring& value)
+	{
+		const bool replaced = value.find(L'#') != std::wstring::npos && parser.ReplaceVariables(value);
+		return parser.ReplaceMeasures(value) || replaced;
+	}
+
+	static void WriteIniFile(const std::wstring& path, const WCHAR* text)
+	{
+		FILE* file;
+		Assert::AreEqual(0, (int)_wfopen_s(&file, path.c_str(), L"w, ccs=UTF-16LE"));
+		fputws(text, file);
+		fclose(file);
+	}
+
+	static FILETIME GetWriteTime(const std::wstring& path)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		Assert::IsTrue(GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data) != FALSE);
+		return data.ftLastWriteTime;
+	}
+
+	// Sets the write time of |path| to |writeTime| plus |seconds|.
+	static void SetWriteTime(const std::wstring& path, FILETIME writeTime, int seconds)
+	{
+		ULARGE_INTEGER time;
+		time.LowPart = writeTime.dwLowDateTime;
+		time.HighPart = writeTime.dwHighDateTime;
+		time.QuadPart += seconds * 10000000ULL;
+		writeTime.dwLowDateTime = time.LowPart;
+		writeTime.dwHighDateTime = time.HighPart;
+
+		HANDLE file = CreateFile(path.c_str(), FILE_WRITE_ATTRIBUTES, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		Assert::IsTrue(file != INVALID_HANDLE_VALUE);
+		Assert::IsTrue(SetFileTime(file, nullptr, nullptr, &writeTime) != FALSE);
+		CloseHandle(file);
+	}
+
+	static int CountFiles(const std::wstring& folder)
+	{
+		int count = 0;
+		WIN32_FIND_DATA findData;
+		HANDLE find = FindFirstFile((folder + L'*').c_str(), &findData);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) ++count;
+			}
+			while (FindNextFile(find, &findData));
+			FindClose(find);
+		}
+		return count;
+	}
+
+	static void DeleteFolder(const std::wstring& folder)
+	{
+		WIN32_FIND_DATA findData;
+		HANDLE find = FindFirstFile((folder + L'*').c_str(), &findData);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				DeleteFile((folder + findData.cFileName).c_str());
+			}
+			while (FindNextFile(find, &findData));
+			FindClose(find);
+		}
+		RemoveDirectory(folder.c_str());
+	}
 };
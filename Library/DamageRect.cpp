@@ -0,0 +1,54 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "DamageRect.h"
+
+using namespace Gdiplus;
+
+DamageRect::DamageRect() :
+	m_Rect(),
+	m_Full(false)
+{
+}
+
+void DamageRect::AddMeter(bool damaged, const Rect& drawnBounds, const Rect& bounds, bool drawnWithinBounds)
+{
+	if (!damaged && bounds.Equals(drawnBounds)) return;
+
+	if (!drawnWithinBounds)
+	{
+		m_Full = true;
+		return;
+	}
+
+	// Both the old and the new area need to be painted again.
+	Add(drawnBounds);
+	Add(bounds);
+}
+
+Rect DamageRect::GetRect(int w, int h) const
+{
+	// Damage outside of the window can be ignored.
+	Rect rect = m_Rect;
+	rect.Intersect(Rect(0, 0, w, h));
+	return rect;
+}
+
+void DamageRect::Add(const Rect& rect)
+{
+	if (rect.IsEmptyArea()) return;
+
+	if (m_Rect.IsEmptyArea())
+	{
+		m_Rect = rect;
+	}
+	else
+	{
+		Rect::Union(m_Rect, m_Rect, rect);
+	}
+}
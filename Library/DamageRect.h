@@ -0,0 +1,39 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_DAMAGERECT_H_
+#define RM_LIBRARY_DAMAGERECT_H_
+
+#include <windows.h>
+#include <ole2.h>  // For Gdiplus.h.
+#include <gdiplus.h>
+
+// Area of a skin that needs to be drawn again after an update. See Skin::RedrawDamaged().
+class DamageRect
+{
+public:
+	DamageRect();
+
+	// Adds the area of a meter that was last drawn within |drawnBounds| and now draws within
+	// |bounds|. Nothing is added if the meter is not |damaged| and has not moved. If the meter
+	// changed and is not |drawnWithinBounds|, the whole skin needs to be drawn again.
+	void AddMeter(bool damaged, const Gdiplus::Rect& drawnBounds, const Gdiplus::Rect& bounds, bool drawnWithinBounds);
+
+	// Returns true if the area cannot be determined.
+	bool IsFull() const { return m_Full; }
+
+	// Returns the union of the added areas within a |w|x|h| window.
+	Gdiplus::Rect GetRect(int w, int h) const;
+
+private:
+	void Add(const Gdiplus::Rect& rect);
+
+	Gdiplus::Rect m_Rect;
+	bool m_Full;
+};
+
+#endif
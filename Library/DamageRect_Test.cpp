@@ -0,0 +1,61 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "DamageRect.h"
+#include "../Common/UnitTest.h"
+
+using namespace Gdiplus;
+
+TEST_CLASS(Library_DamageRect_Test)
+{
+public:
+	TEST_METHOD(TestUnchangedMeter)
+	{
+		// A clock skin: the seconds changed, the unchanged date and background did not.
+		const Rect background(0, 0, 200, 100);
+		const Rect date(10, 10, 180, 20);
+		const Rect seconds(150, 50, 40, 20);
+
+		DamageRect damage;
+		damage.AddMeter(false, background, background, true);
+		damage.AddMeter(false, date, date, true);
+		Assert::IsFalse(damage.IsFull());
+		Assert::IsTrue(damage.GetRect(200, 100).IsEmptyArea());
+
+		damage.AddMeter(true, seconds, seconds, true);
+		Assert::IsFalse(damage.IsFull());
+		Assert::IsTrue(damage.GetRect(200, 100).Equals(seconds));
+	}
+
+	TEST_METHOD(TestMovedMeter)
+	{
+		// The old and the new area are damaged, even if the meter itself did not change, e.g. when
+		// it is hidden or moved.
+		DamageRect damage;
+		damage.AddMeter(false, Rect(0, 0, 10, 10), Rect(20, 0, 10, 10), true);
+		Assert::IsTrue(damage.GetRect(100, 100).Equals(Rect(0, 0, 30, 10)));
+
+		damage.AddMeter(false, Rect(0, 40, 10, 10), Rect(), true);
+		Assert::IsTrue(damage.GetRect(100, 100).Equals(Rect(0, 0, 30, 50)));
+
+		// Damage outside of the window is ignored.
+		damage.AddMeter(true, Rect(90, 90, 20, 20), Rect(90, 90, 20, 20), true);
+		Assert::IsTrue(damage.GetRect(100, 100).Equals(Rect(0, 0, 100, 100)));
+	}
+
+	TEST_METHOD(TestUnboundedMeter)
+	{
+		// Meters that may paint outside of their bounds only cause a full redraw when they change.
+		DamageRect damage;
+		damage.AddMeter(false, Rect(0, 0, 10, 10), Rect(0, 0, 10, 10), false);
+		Assert::IsFalse(damage.IsFull());
+
+		damage.AddMeter(true, Rect(0, 0, 10, 10), Rect(0, 0, 10, 10), false);
+		Assert::IsTrue(damage.IsFull());
+	}
+};
@@ -7,11 +7,14 @@
 
 #include "StdAfx.h"
 #include "../Common/MenuTemplate.h"
+#include "../Common/Gfx/Canvas.h"
 #include "Rainmeter.h"
+#include "ImageCachePool.h"
 #include "Skin.h"
 #include "System.h"
 #include "TrayIcon.h"
 #include "Measure.h"
+#include "Profiler.h"
 #include "resource.h"
 #include "DialogAbout.h"
 #include "../Version.h"
@@ -72,14 +75,18 @@ void DialogAbout::Open(const WCHAR* name)
 		{
 			tab = 1;
 		}
-		else if (_wcsicmp(name, L"Plugins") == 0)
+		else if (_wcsicmp(name, L"Profiler") == 0)
 		{
 			tab = 2;
 		}
-		else if (_wcsicmp(name, L"Version") == 0)
+		else if (_wcsicmp(name, L"Plugins") == 0)
 		{
 			tab = 3;
 		}
+		else if (_wcsicmp(name, L"Version") == 0)
+		{
+			tab = 4;
+		}
 	}
 
 	Open(tab);
@@ -111,6 +118,11 @@ void DialogAbout::UpdateSkins()
 	{
 		c_Dialog->m_TabSkins.UpdateSkinList();
 	}
+
+	if (c_Dialog && c_Dialog->m_TabProfiler.IsInitialized())
+	{
+		c_Dialog->m_TabProfiler.UpdateSkinList();
+	}
 }
 
 void DialogAbout::UpdateMeasures(Skin* skin)
@@ -119,6 +131,11 @@ void DialogAbout::UpdateMeasures(Skin* skin)
 	{
 		c_Dialog->m_TabSkins.UpdateMeasureList(skin);
 	}
+
+	if (c_Dialog && c_Dialog->m_TabProfiler.IsInitialized())
+	{
+		c_Dialog->m_TabProfiler.UpdateProfileList(skin);
+	}
 }
 
 Dialog::Tab& DialogAbout::GetActiveTab()
@@ -133,10 +150,14 @@ Dialog::Tab& DialogAbout::GetActiveTab()
 		return m_TabSkins;
 	}
 	else if (sel == 2)
+	{
+		return m_TabProfiler;
+	}
+	else if (sel == 3)
 	{
 		return m_TabPlugins;
 	}
-	else // if (sel == 3)
+	else // if (sel == 4)
 	{
 		return m_TabVersion;
 	}
@@ -185,6 +206,7 @@ INT_PTR DialogAbout::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 				h -= 100;
 				m_TabLog.Resize(w, h);
 				m_TabSkins.Resize(w, h);
+				m_TabProfiler.Resize(w, h);
 				m_TabPlugins.Resize(w, h);
 				m_TabVersion.Resize(w, h);
 			}
@@ -225,6 +247,7 @@ INT_PTR DialogAbout::OnInitDialog(WPARAM wParam, LPARAM lParam)
 	HWND item = GetControl(Id_Tab);
 	m_TabLog.Create(m_Window);
 	m_TabSkins.Create(m_Window);
+	m_TabProfiler.Create(m_Window);
 	m_TabPlugins.Create(m_Window);
 	m_TabVersion.Create(m_Window);
 
@@ -234,10 +257,12 @@ INT_PTR DialogAbout::OnInitDialog(WPARAM wParam, LPARAM lParam)
 	TabCtrl_InsertItem(item, 0, &tci);
 	tci.pszText = GetString(ID_STR_SKINS);
 	TabCtrl_InsertItem(item, 1, &tci);
-	tci.pszText = GetString(ID_STR_PLUGINS);
+	tci.pszText = GetString(ID_STR_PROFILER);
 	TabCtrl_InsertItem(item, 2, &tci);
-	tci.pszText = GetString(ID_STR_VERSION);
+	tci.pszText = GetString(ID_STR_PLUGINS);
 	TabCtrl_InsertItem(item, 3, &tci);
+	tci.pszText = GetString(ID_STR_VERSION);
+	TabCtrl_InsertItem(item, 4, &tci);
 
 	HICON hIcon = GetIcon(IDI_RAINMETER);
 	SendMessage(m_Window, WM_SETICON, ICON_SMALL, (LPARAM)hIcon);
@@ -249,6 +274,8 @@ INT_PTR DialogAbout::OnInitDialog(WPARAM wParam, LPARAM lParam)
 	SetWindowTheme(item, L"explorer", nullptr);
 	item = m_TabSkins.GetControl(TabSkins::Id_SkinsListView);
 	SetWindowTheme(item, L"explorer", nullptr);
+	item = m_TabProfiler.GetControl(TabProfiler::Id_ProfileListView);
+	SetWindowTheme(item, L"explorer", nullptr);
 	item = m_TabPlugins.GetControl(TabPlugins::Id_PluginsListView);
 	SetWindowTheme(item, L"explorer", nullptr);
 
@@ -288,6 +315,7 @@ INT_PTR DialogAbout::OnNotify(WPARAM wParam, LPARAM lParam)
 			// Disable all tab windows first
 			EnableWindow(m_TabLog.GetWindow(), FALSE);
 			EnableWindow(m_TabSkins.GetWindow(), FALSE);
+			EnableWindow(m_TabProfiler.GetWindow(), FALSE);
 			EnableWindow(m_TabPlugins.GetWindow(), FALSE);
 			EnableWindow(m_TabVersion.GetWindow(), FALSE);
 
@@ -929,10 +957,12 @@ void DialogAbout::TabSkins::UpdateMeasureList(Skin* skin)
 	}
 
 	lvi.iGroupId = 1;
-	const auto& variables = m_SkinWindow->GetParser().GetVariables();
+	ConfigParser& parser = m_SkinWindow->GetParser();
+	const auto& variables = parser.GetVariables();
 	for (auto iter = variables.cbegin(); iter != variables.cend(); ++iter)
 	{
-		const WCHAR* name = (*iter).first.c_str();
+		const std::wstring& variable = parser.GetVariableName((*iter).first);
+		const WCHAR* name = variable.c_str();
 		lvi.lParam = (LPARAM)name;
 
 		if (wcscmp(name, L"@") == 0)
@@ -941,7 +971,7 @@ void DialogAbout::TabSkins::UpdateMeasureList(Skin* skin)
 			continue;
 		}
 
-		std::wstring tmpStr = (*iter).first;
+		std::wstring tmpStr = variable;
 		_wcslwr(&tmpStr[0]);
 		lvi.pszText = (WCHAR*)tmpStr.c_str();
 
@@ -1258,6 +1288,291 @@ INT_PTR DialogAbout::TabSkins::OnCustomDraw(WPARAM wParam, LPARAM lParam)
 	return FALSE;
 }
 
+// -----------------------------------------------------------------------------------------------
+//
+//                                Profiler tab
+//
+// -----------------------------------------------------------------------------------------------
+
+DialogAbout::TabProfiler::TabProfiler() : Tab(),
+	m_SkinWindow()
+{
+}
+
+void DialogAbout::TabProfiler::Create(HWND owner)
+{
+	Tab::CreateTabWindow(15, 30, 570, 188, owner);
+
+	static const ControlTemplate::Control s_Controls[] =
+	{
+		CT_LISTBOX(Id_SkinsListBox, 0,
+			0, 0, 120, 188,
+			WS_VISIBLE | WS_TABSTOP | LBS_NOTIFY | LBS_HASSTRINGS | LBS_NOINTEGRALHEIGHT | WS_VSCROLL | WS_HSCROLL, WS_EX_CLIENTEDGE),
+		CT_LISTVIEW(Id_ProfileListView, 0,
+			125, 0, 442, 188,
+			WS_VISIBLE | WS_TABSTOP | WS_BORDER | LVS_REPORT | LVS_SINGLESEL | LVS_NOSORTHEADER, 0)
+	};
+
+	CreateControls(s_Controls, _countof(s_Controls), c_Dialog->m_Font, GetString);
+}
+
+void DialogAbout::TabProfiler::Initialize()
+{
+	// Add columns to the list view
+	HWND item = GetControl(Id_ProfileListView);
+	ListView_SetExtendedListViewStyleEx(item, 0, LVS_EX_LABELTIP | LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+
+	LVCOLUMN lvc;
+	lvc.mask = LVCF_FMT | LVCF_WIDTH | LVCF_TEXT | LVCF_SUBITEM;
+	lvc.fmt = LVCFMT_LEFT;
+	lvc.iSubItem = 0;
+	lvc.cx = 120;  // Resized later
+	lvc.pszText = GetString(ID_STR_NAME);
+	ListView_InsertColumn(item, 0, &lvc);
+	lvc.iSubItem = 1;
+	lvc.cx = 80;
+	lvc.pszText = GetString(ID_STR_ACTIVITY);
+	ListView_InsertColumn(item, 1, &lvc);
+	lvc.fmt = LVCFMT_RIGHT;
+	lvc.iSubItem = 2;
+	lvc.cx = 60;
+	lvc.pszText = GetString(ID_STR_COUNT);
+	ListView_InsertColumn(item, 2, &lvc);
+	lvc.iSubItem = 3;
+	lvc.cx = 80;
+	lvc.pszText = GetString(ID_STR_TOTALMS);
+	ListView_InsertColumn(item, 3, &lvc);
+	lvc.iSubItem = 4;
+	lvc.cx = 80;
+	lvc.pszText = GetString(ID_STR_MAXMS);
+	ListView_InsertColumn(item, 4, &lvc);
+
+	// Start 1st column at max width
+	RECT rc;
+	GetClientRect(m_Window, &rc);
+	Resize(rc.right, rc.bottom);
+
+	UpdateSkinList();
+
+	m_Initialized = true;
+}
+
+/*
+** Resizes window and repositions controls.
+**
+*/
+void DialogAbout::TabProfiler::Resize(int w, int h)
+{
+	SetWindowPos(m_Window, nullptr, 0, 0, w, h, SWP_NOMOVE | SWP_NOZORDER);
+
+	HWND item = GetControl(Id_SkinsListBox);
+	SetWindowPos(item, nullptr, 0, 0, 265, h, SWP_NOMOVE | SWP_NOZORDER);
+
+	item = GetControl(Id_ProfileListView);
+	SetWindowPos(item, nullptr, 275, 0, w - 275, h, SWP_NOZORDER);
+
+	// Adjust 1st column
+	LVCOLUMN lvc;
+	lvc.mask = LVCF_WIDTH;
+	lvc.cx = w - 275 - 20 -
+		(ListView_GetColumnWidth(item, 1) +
+		 ListView_GetColumnWidth(item, 2) +
+		 ListView_GetColumnWidth(item, 3) +
+		 ListView_GetColumnWidth(item, 4));
+	ListView_SetColumn(item, 0, &lvc);
+}
+
+/*
+** Updates the list of skins.
+**
+*/
+void DialogAbout::TabProfiler::UpdateSkinList()
+{
+	// Delete all entries
+	HWND item = GetControl(Id_SkinsListBox);
+	ListBox_ResetContent(item);
+
+	// Add entries for each skin
+	std::wstring::size_type maxLength = 0;
+	const std::map<std::wstring, Skin*>& windows = GetRainmeter().GetAllSkins();
+	bool found = false;
+	for (auto iter = windows.cbegin(); iter != windows.cend(); ++iter)
+	{
+		const std::wstring& skinName = (*iter).first;
+		if (skinName.length() > maxLength)
+		{
+			maxLength = skinName.length();
+		}
+
+		int index = ListBox_AddString(item, skinName.c_str());
+		if (!found && m_SkinWindow == (*iter).second)
+		{
+			found = true;
+			ListBox_SetCurSel(item, index);
+		}
+	}
+
+	ListBox_SetHorizontalExtent(item, 6 * maxLength);
+
+	if (!found)
+	{
+		if (windows.empty())
+		{
+			m_SkinWindow = nullptr;
+			item = GetControl(Id_ProfileListView);
+			ListView_DeleteAllItems(item);
+		}
+		else
+		{
+			// Default to first skin
+			m_SkinWindow = (*windows.begin()).second;
+			ListBox_SetCurSel(item, 0);
+			UpdateProfileList(m_SkinWindow);
+		}
+	}
+}
+
+/*
+** Updates the timings of the selected skin. The slowest activities (in total) are listed first.
+**
+*/
+void DialogAbout::TabProfiler::UpdateProfileList(Skin* skin)
+{
+	if (!skin)
+	{
+		// Find selected skin
+		HWND item = GetControl(Id_SkinsListBox);
+		int selected = (int)SendMessage(item, LB_GETCURSEL, 0, 0);
+
+		const std::map<std::wstring, Skin*>& windows = GetRainmeter().GetAllSkins();
+		std::map<std::wstring, Skin*>::const_iterator iter = windows.begin();
+		while (selected && iter != windows.end())
+		{
+			++iter;
+			--selected;
+		}
+
+		if (iter == windows.end()) return;
+
+		m_SkinWindow = (*iter).second;
+	}
+	else if (skin != m_SkinWindow)
+	{
+		// Called by a skin other than currently visible one, so return
+		return;
+	}
+
+	HWND item = GetControl(Id_ProfileListView);
+	SendMessage(item, WM_SETREDRAW, FALSE, 0);
+	int count = ListView_GetItemCount(item);
+
+	LVITEM lvi;
+	lvi.mask = LVIF_TEXT;
+	lvi.iSubItem = 0;
+	lvi.iItem = 0;
+
+	WCHAR buffer[64];
+	const std::vector<Profiler::Entry> entries = Profiler::GetEntries(m_SkinWindow);
+	for (auto iter = entries.cbegin(); iter != entries.cend(); ++iter)
+	{
+		lvi.pszText = (WCHAR*)(*iter).name.c_str();
+
+		if (lvi.iItem < count)
+		{
+			ListView_SetItem(item, &lvi);
+		}
+		else
+		{
+			ListView_InsertItem(item, &lvi);
+		}
+
+		ListView_SetItemText(item, lvi.iItem, 1, (WCHAR*)(*iter).activity);
+		_snwprintf_s(buffer, _TRUNCATE, L"%llu", (*iter).stats.count);
+		ListView_SetItemText(item, lvi.iItem, 2, buffer);
+		_snwprintf_s(buffer, _TRUNCATE, L"%.3f", Profiler::ToMilliseconds((*iter).stats.total));
+		ListView_SetItemText(item, lvi.iItem, 3, buffer);
+		_snwprintf_s(buffer, _TRUNCATE, L"%.3f", Profiler::ToMilliseconds((*iter).stats.max));
+		ListView_SetItemText(item, lvi.iItem, 4, buffer);
+		++lvi.iItem;
+	}
+
+	// The caches are shared by all skins, so they are listed after the entries of the skin.
+	const ImageCachePool::Stats& imageStats = ImageCachePool::GetStats();
+	const struct
+	{
+		const WCHAR* name;
+		const WCHAR* activity;
+		UINT64 value;
+	} cacheStats[] =
+	{
+		{ GetString(ID_STR_TEXTLAYOUTCACHE), GetString(ID_STR_HIT), Gfx::TextFormatD2D::GetLayoutCacheHits() },
+		{ GetString(ID_STR_TEXTLAYOUTCACHE), GetString(ID_STR_MISS), Gfx::TextFormatD2D::GetLayoutCacheMisses() },
+		{ GetString(ID_STR_IMAGECACHE), GetString(ID_STR_HIT), imageStats.hits },
+		{ GetString(ID_STR_IMAGECACHE), GetString(ID_STR_MISS), imageStats.misses },
+		{ GetString(ID_STR_IMAGECACHE), GetString(ID_STR_IMAGES), imageStats.count },
+		{ GetString(ID_STR_IMAGECACHE), GetString(ID_STR_KB), imageStats.size / 1024 },
+		{ GetString(ID_STR_IMAGECACHE), GetString(ID_STR_UNUSEDKB), imageStats.unusedSize / 1024 }
+	};
+	for (const auto& stats : cacheStats)
+	{
+		lvi.pszText = (WCHAR*)stats.name;
+
+		if (lvi.iItem < count)
+		{
+			ListView_SetItem(item, &lvi);
+		}
+		else
+		{
+			ListView_InsertItem(item, &lvi);
+		}
+
+		ListView_SetItemText(item, lvi.iItem, 1, (WCHAR*)stats.activity);
+		_snwprintf_s(buffer, _TRUNCATE, L"%llu", stats.value);
+		ListView_SetItemText(item, lvi.iItem, 2, buffer);
+		ListView_SetItemText(item, lvi.iItem, 3, (WCHAR*)L"");
+		ListView_SetItemText(item, lvi.iItem, 4, (WCHAR*)L"");
+		++lvi.iItem;
+	}
+
+	// Delete unnecessary items
+	while (count > lvi.iItem)
+	{
+		ListView_DeleteItem(item, lvi.iItem);
+		--count;
+	}
+
+	SendMessage(item, WM_SETREDRAW, TRUE, 0);
+}
+
+INT_PTR DialogAbout::TabProfiler::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	switch (uMsg)
+	{
+	case WM_COMMAND:
+		return OnCommand(wParam, lParam);
+	}
+
+	return FALSE;
+}
+
+INT_PTR DialogAbout::TabProfiler::OnCommand(WPARAM wParam, LPARAM lParam)
+{
+	switch (LOWORD(wParam))
+	{
+	case Id_SkinsListBox:
+		if (HIWORD(wParam) == LBN_SELCHANGE)
+		{
+			UpdateProfileList(nullptr);
+		}
+		break;
+
+	default:
+		return 1;
+	}
+
+	return 0;
+}
+
 // -----------------------------------------------------------------------------------------------
 //
 //                                Plugins tab
@@ -105,6 +105,33 @@ private:
 		Skin* m_SkinWindow;
 	};
 
+	// Profiler tab
+	class TabProfiler : public Tab
+	{
+	public:
+		enum Id
+		{
+			Id_SkinsListBox = 600,
+			Id_ProfileListView
+		};
+
+		TabProfiler();
+
+		void Create(HWND owner);
+		virtual void Initialize();
+		virtual void Resize(int w, int h);
+
+		void UpdateSkinList();
+		void UpdateProfileList(Skin* skin);
+
+	protected:
+		virtual INT_PTR HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
+		INT_PTR OnCommand(WPARAM wParam, LPARAM lParam);
+
+	private:
+		Skin* m_SkinWindow;
+	};
+
 	// Plugins tab
 	class TabPlugins : public Tab
 	{
@@ -169,6 +196,7 @@ private:
 
 	TabLog m_TabLog;
 	TabSkins m_TabSkins;
+	TabProfiler m_TabProfiler;
 	TabPlugins m_TabPlugins;
 	TabVersion m_TabVersion;
 
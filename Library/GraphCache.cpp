@@ -0,0 +1,158 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "GraphCache.h"
+
+GraphCache::GraphCache() :
+	m_W(),
+	m_H(),
+	m_Rows(false),
+	m_Reverse(false),
+	m_AntiAlias(false),
+	m_Valid(false)
+{
+}
+
+GraphCache::~GraphCache()
+{
+}
+
+int GraphCache::Prepare(int w, int h, bool rows, bool reverse, bool antiAlias, int margin,
+	const std::vector<double>& scales, const std::vector<UINT64>& addCounts)
+{
+	const int size = rows ? h : w;
+	int first = 0;
+
+	if (!m_Bitmap || w != m_W || h != m_H)
+	{
+		Create(w, h);
+	}
+	else
+	{
+		// Finish drawing the previous values before moving the pixels.
+		m_Graphics->Flush(Gdiplus::FlushIntentionSync);
+
+		if (m_Valid && rows == m_Rows && reverse == m_Reverse && antiAlias == m_AntiAlias &&
+			scales == m_Scales && addCounts.size() == m_AddCounts.size())
+		{
+			// All of the histories must have moved by the same number of values.
+			UINT64 count = addCounts.empty() ? 0 : addCounts[0] - m_AddCounts[0];
+			for (size_t i = 1; i < addCounts.size(); ++i)
+			{
+				if (addCounts[i] - m_AddCounts[i] != count)
+				{
+					count = size;
+					break;
+				}
+			}
+
+			if (count == 0)
+			{
+				first = size;
+			}
+			else if (count < (UINT64)size)
+			{
+				Scroll((int)count);
+				first = max(0, size - (int)count - margin);
+			}
+		}
+	}
+
+	m_Rows = rows;
+	m_Reverse = reverse;
+	m_AntiAlias = antiAlias;
+	m_Valid = true;
+	m_Scales = scales;
+	m_AddCounts = addCounts;
+
+	Clear(first);
+
+	// Same settings as Gfx::Canvas::SetAntiAliasing().
+	m_Graphics->SetSmoothingMode(
+		antiAlias ? Gdiplus::SmoothingModeHighQuality : Gdiplus::SmoothingModeNone);
+	m_Graphics->SetPixelOffsetMode(
+		antiAlias ? Gdiplus::PixelOffsetModeHighQuality : Gdiplus::PixelOffsetModeDefault);
+
+	const int start = reverse ? 0 : first;
+	const int length = size - first;
+	m_Graphics->SetClip(rows ? Gdiplus::Rect(0, start, w, length) : Gdiplus::Rect(start, 0, length, h));
+
+	return first;
+}
+
+void GraphCache::Create(int w, int h)
+{
+	m_Graphics.reset();
+	m_Bitmap.reset();
+
+	m_W = w;
+	m_H = h;
+	m_Pixels.assign((size_t)w * h, 0);
+	m_Bitmap.reset(new Gdiplus::Bitmap(w, h, w * 4, PixelFormat32bppPARGB, (BYTE*)m_Pixels.data()));
+	m_Graphics.reset(new Gdiplus::Graphics(m_Bitmap.get()));
+}
+
+/*
+** Moves the pixels of each slot to the slot |count| slots before it.
+**
+*/
+void GraphCache::Scroll(int count)
+{
+	UINT32* pixels = m_Pixels.data();
+	if (m_Rows)
+	{
+		const size_t length = (size_t)(m_H - count) * m_W * sizeof(UINT32);
+		if (m_Reverse)
+		{
+			memmove(pixels + count * m_W, pixels, length);
+		}
+		else
+		{
+			memmove(pixels, pixels + count * m_W, length);
+		}
+	}
+	else
+	{
+		const size_t length = (size_t)(m_W - count) * sizeof(UINT32);
+		for (int y = 0; y < m_H; ++y, pixels += m_W)
+		{
+			if (m_Reverse)
+			{
+				memmove(pixels + count, pixels, length);
+			}
+			else
+			{
+				memmove(pixels, pixels + count, length);
+			}
+		}
+	}
+}
+
+/*
+** Clears the slots from |first| to the newest.
+**
+*/
+void GraphCache::Clear(int first)
+{
+	const int size = m_Rows ? m_H : m_W;
+	const int start = m_Reverse ? 0 : first;
+	const int length = size - first;
+	if (length <= 0) return;
+
+	if (m_Rows)
+	{
+		std::fill_n(m_Pixels.begin() + (size_t)start * m_W, (size_t)length * m_W, 0);
+	}
+	else
+	{
+		for (int y = 0; y < m_H; ++y)
+		{
+			std::fill_n(m_Pixels.begin() + (size_t)y * m_W + start, length, 0);
+		}
+	}
+}
@@ -0,0 +1,71 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_GRAPHCACHE_H_
+#define RM_LIBRARY_GRAPHCACHE_H_
+
+#include <windows.h>
+#include <ole2.h>  // For Gdiplus.h.
+#include <gdiplus.h>
+#include <memory>
+#include <vector>
+
+// Offscreen copy of the graph drawn by MeterHistogram and MeterLine. The graphs have a slot for
+// each column (or row) of pixels and the newest value is in the last slot. When values are added,
+// the cached pixels are scrolled by the number of new values so that only the slots of the new
+// values need to be drawn again.
+class GraphCache
+{
+public:
+	GraphCache();
+	~GraphCache();
+
+	GraphCache(const GraphCache& other) = delete;
+	GraphCache& operator=(GraphCache other) = delete;
+
+	// Forces the next Prepare() to redraw the whole graph, e.g. after the options have changed.
+	void Invalidate() { m_Valid = false; }
+
+	// Prepares the cache for a |w|x|h| graph with a slot for each column (or each row with |rows|).
+	// Slot i is at pixel i if |reverse| is false and at the opposite end otherwise.
+	//
+	// |scales| are the values that the graph is scaled with. |addCounts| are the
+	// ValueHistory::GetAddCount() of the drawn histories. If the scales are unchanged and all of the
+	// histories have the same number of new values, the cached pixels are scrolled. Otherwise the
+	// whole cache is cleared. |margin| extra slots are cleared to redraw the parts of lines that
+	// extend to neighboring slots.
+	//
+	// Returns the first slot that needs to be drawn. The graphics of the cache is clipped to the
+	// cleared slots.
+	int Prepare(int w, int h, bool rows, bool reverse, bool antiAlias, int margin,
+		const std::vector<double>& scales, const std::vector<UINT64>& addCounts);
+
+	Gdiplus::Graphics& GetGraphics() { return *m_Graphics; }
+	Gdiplus::Bitmap* GetBitmap() { return m_Bitmap.get(); }
+
+private:
+	void Create(int w, int h);
+	void Scroll(int count);
+	void Clear(int first);
+
+	int m_W;
+	int m_H;
+	bool m_Rows;
+	bool m_Reverse;
+	bool m_AntiAlias;
+	bool m_Valid;
+
+	std::vector<double> m_Scales;
+	std::vector<UINT64> m_AddCounts;
+
+	// Premultiplied pixels shared with |m_Bitmap| so that they can be moved without LockBits().
+	std::vector<UINT32> m_Pixels;
+	std::unique_ptr<Gdiplus::Bitmap> m_Bitmap;
+	std::unique_ptr<Gdiplus::Graphics> m_Graphics;
+};
+
+#endif
@@ -0,0 +1,140 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "GraphCache.h"
+#include "../Common/UnitTest.h"
+
+TEST_CLASS(Library_GraphCache_Test)
+{
+public:
+	Library_GraphCache_Test()
+	{
+		Gdiplus::GdiplusStartupInput gdiplusStartupInput;
+		Gdiplus::GdiplusStartup(&m_GdiplusToken, &gdiplusStartupInput, nullptr);
+	}
+
+	~Library_GraphCache_Test()
+	{
+		Gdiplus::GdiplusShutdown(m_GdiplusToken);
+	}
+
+	TEST_METHOD(TestScroll)
+	{
+		GraphCache cache;
+		const std::vector<double> scales(1, 1.0);
+		std::vector<UINT64> addCounts(2, 0);
+
+		Assert::AreEqual(0, cache.Prepare(4, 2, false, false, false, 0, scales, addCounts));
+		DrawSlots(cache, false, 0, 4);
+
+		// Nothing to draw without new values.
+		Assert::AreEqual(4, cache.Prepare(4, 2, false, false, false, 0, scales, addCounts));
+		Assert::AreEqual(GetColor(3), GetPixel(cache, 3, 1));
+
+		addCounts[0] += 1;
+		addCounts[1] += 1;
+		Assert::AreEqual(3, cache.Prepare(4, 2, false, false, false, 0, scales, addCounts));
+		Assert::AreEqual(GetColor(1), GetPixel(cache, 0, 0));
+		Assert::AreEqual(GetColor(3), GetPixel(cache, 2, 1));
+		Assert::AreEqual(0u, GetPixel(cache, 3, 1));
+
+		// The margin is cleared as well.
+		addCounts[0] += 1;
+		addCounts[1] += 1;
+		Assert::AreEqual(2, cache.Prepare(4, 2, false, false, false, 1, scales, addCounts));
+		Assert::AreEqual(GetColor(2), GetPixel(cache, 0, 1));
+		Assert::AreEqual(GetColor(3), GetPixel(cache, 1, 1));
+		Assert::AreEqual(0u, GetPixel(cache, 2, 1));
+	}
+
+	TEST_METHOD(TestScrollReverse)
+	{
+		GraphCache cache;
+		const std::vector<double> scales(1, 1.0);
+		std::vector<UINT64> addCounts(1, 0);
+
+		Assert::AreEqual(0, cache.Prepare(2, 4, true, true, false, 0, scales, addCounts));
+		DrawSlots(cache, true, 0, 4);
+
+		// Slot 0 is at the bottom and the rows move down.
+		addCounts[0] += 2;
+		Assert::AreEqual(2, cache.Prepare(2, 4, true, true, false, 0, scales, addCounts));
+		Assert::AreEqual(GetColor(2), GetPixel(cache, 1, 3));
+		Assert::AreEqual(GetColor(3), GetPixel(cache, 0, 2));
+		Assert::AreEqual(0u, GetPixel(cache, 0, 1));
+		Assert::AreEqual(0u, GetPixel(cache, 1, 0));
+	}
+
+	TEST_METHOD(TestRedraw)
+	{
+		GraphCache cache;
+		std::vector<double> scales(1, 1.0);
+		std::vector<UINT64> addCounts(2, 0);
+
+		Assert::AreEqual(0, cache.Prepare(4, 2, false, false, false, 0, scales, addCounts));
+		DrawSlots(cache, false, 0, 4);
+
+		// The histories have moved by a different number of values.
+		addCounts[0] += 1;
+		addCounts[1] += 2;
+		Assert::AreEqual(0, cache.Prepare(4, 2, false, false, false, 0, scales, addCounts));
+		Assert::AreEqual(0u, GetPixel(cache, 0, 0));
+		DrawSlots(cache, false, 0, 4);
+
+		// The scale has changed.
+		addCounts[0] += 1;
+		addCounts[1] += 1;
+		scales[0] = 2.0;
+		Assert::AreEqual(0, cache.Prepare(4, 2, false, false, false, 0, scales, addCounts));
+		DrawSlots(cache, false, 0, 4);
+
+		// More new values than slots.
+		addCounts[0] += 4;
+		addCounts[1] += 4;
+		Assert::AreEqual(0, cache.Prepare(4, 2, false, false, false, 0, scales, addCounts));
+		DrawSlots(cache, false, 0, 4);
+
+		cache.Invalidate();
+		Assert::AreEqual(0, cache.Prepare(4, 2, false, false, false, 0, scales, addCounts));
+		DrawSlots(cache, false, 0, 4);
+
+		// Resized.
+		Assert::AreEqual(0, cache.Prepare(5, 2, false, false, false, 0, scales, addCounts));
+	}
+
+private:
+	static UINT32 GetColor(int slot)
+	{
+		return 0xFF000000 | (slot * 0x40);
+	}
+
+	// Fills the slots from |first| to |last| with the color of the slot.
+	static void DrawSlots(GraphCache& cache, bool rows, int first, int last)
+	{
+		Gdiplus::Graphics& graphics = cache.GetGraphics();
+		Gdiplus::Bitmap* bitmap = cache.GetBitmap();
+		const int w = (int)bitmap->GetWidth();
+		const int h = (int)bitmap->GetHeight();
+		for (int slot = first; slot < last; ++slot)
+		{
+			const int pos = rows ? h - 1 - slot : slot;
+			Gdiplus::SolidBrush brush(Gdiplus::Color(GetColor(slot)));
+			graphics.FillRectangle(&brush, rows ? Gdiplus::Rect(0, pos, w, 1) : Gdiplus::Rect(pos, 0, 1, h));
+		}
+		graphics.Flush(Gdiplus::FlushIntentionSync);
+	}
+
+	static UINT32 GetPixel(GraphCache& cache, int x, int y)
+	{
+		Gdiplus::Color color;
+		cache.GetBitmap()->GetPixel(x, y, &color);
+		return color.GetValue();
+	}
+
+	ULONG_PTR m_GdiplusToken;
+};
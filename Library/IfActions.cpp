@@ -10,8 +10,6 @@
 #include "IfActions.h"
 #include "Rainmeter.h"
 #include "../Common/MathParser.h"
-#include "pcre/config.h"
-#include "pcre/pcre.h"
 
 IfActions::IfActions() :
 	m_AboveValue(0.0),
@@ -200,9 +198,24 @@ void IfActions::DoIfActions(Measure& measure, double value)
 		++i;
 		if (!item.value.empty() && (!item.tAction.empty() || !item.fAction.empty()))
 		{
+			if (item.value != item.program.GetFormula())
+			{
+				item.compileError = MathParser::Compile(item.value.c_str(), &item.program);
+				if (!item.compileError)
+				{
+					MathParser::Bind(
+						&item.program, measure.GetMeasureHandle, measure.GetMeasureHandleValue, &measure);
+				}
+			}
+
 			double result = 0.0;
-			const WCHAR* errMsg = MathParser::Parse(
-				item.value.c_str(), &result, measure.GetCurrentMeasureValue, &measure);
+			const WCHAR* errMsg = item.compileError;
+			if (!errMsg)
+			{
+				errMsg = MathParser::Evaluate(
+					item.program, &result, measure.GetCurrentMeasureValue, &measure);
+			}
+
 			if (errMsg != nullptr)
 			{
 				if (!item.parseError)
@@ -253,27 +266,23 @@ void IfActions::DoIfActions(Measure& measure, double value)
 		++i;
 		if (!item.value.empty() && (!item.tAction.empty() || !item.fAction.empty()))
 		{
-			const char* error;
-			int errorOffset;
-
-			pcre16* re = pcre16_compile(
-				(PCRE_SPTR16)item.value.c_str(),
-				PCRE_UTF16,
-				&error,
-				&errorOffset,
-				nullptr);
+			if (!item.regExp || item.regExp->GetPattern() != item.value)
+			{
+				item.regExp = RegExp::Compile(item.value);
+			}
 
-			if (!re)
+			const RegExp& re = *item.regExp;
+			if (!re.IsValid())
 			{
 				if (!item.parseError)
 				{
 					if (i == 1)
 					{
-						LogErrorF(&measure, L"Error: \"%S\" in IfMatch=%s", error, item.value.c_str());
+						LogErrorF(&measure, L"Error: \"%S\" in IfMatch=%s", re.GetError(), item.value.c_str());
 					}
 					else
 					{
-						LogErrorF(&measure, L"Error: \"%S\" in IfMatch%i=%s", error, i, item.value.c_str());
+						LogErrorF(&measure, L"Error: \"%S\" in IfMatch%i=%s", re.GetError(), i, item.value.c_str());
 					}
 
 					item.parseError = true;
@@ -286,11 +295,9 @@ void IfActions::DoIfActions(Measure& measure, double value)
 				const WCHAR* str = measure.GetStringValue();
 				int strLen = str ? (int)wcslen(str) : 0;
 				int ovector[300];
-				int rc = pcre16_exec(
-					re,
-					nullptr,
-					(PCRE_SPTR16)str,
-					(int)strLen,
+				int rc = re.Exec(
+					str,
+					strLen,
 					0,
 					0,
 					ovector,
@@ -317,9 +324,6 @@ void IfActions::DoIfActions(Measure& measure, double value)
 					}
 				}
 			}
-
-			// Release memory used for the compiled pattern
-			pcre16_free(re);
 		}
 	}
 }
@@ -11,6 +11,8 @@
 #include <windows.h>
 #include <string>
 #include <vector>
+#include "../Common/MathParser.h"
+#include "RegExp.h"
 
 class ConfigParser;
 class Measure;
@@ -24,6 +26,9 @@ public:
 		value(),
 		tAction(),
 		fAction(),
+		program(),
+		compileError(),
+		regExp(),
 		parseError(false),
 		tCommitted(false),
 		fCommitted(false)
@@ -41,6 +46,9 @@ public:
 	std::wstring value;			// IfCondition/IfMatch
 	std::wstring tAction;		// IfTrueAction/IfMatchAction
 	std::wstring fAction;		// IfFalseAction/IfNotMatchAction
+	MathParser::Program program;	// Compiled IfCondition, rebuilt when |value| changes
+	const WCHAR* compileError;
+	std::shared_ptr<const RegExp> regExp;	// Compiled IfMatch, rebuilt when |value| changes
 	bool parseError;
 	bool tCommitted;
 	bool fCommitted;
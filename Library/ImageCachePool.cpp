@@ -0,0 +1,147 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "ImageCachePool.h"
+#include "../Common/Gfx/BitmapCache.h"
+
+using namespace Gdiplus;
+
+std::unordered_map<std::wstring, ImageCachePool::Entry> ImageCachePool::c_Entries;
+std::list<std::wstring> ImageCachePool::c_Unused;
+UINT64 ImageCachePool::c_MaxUnusedSize = 64ULL * 1024ULL * 1024ULL;
+ImageCachePool::Stats ImageCachePool::c_Stats = {};
+
+std::wstring ImageCachePool::CreateKey(const std::wstring& name, ULONGLONG time, DWORD size, const WCHAR* exifOrientation)
+{
+	std::wstring key;
+
+	WCHAR buffer[MAX_PATH];
+	if (PathCanonicalize(buffer, name.c_str()))
+	{
+		key = buffer;
+	}
+	else
+	{
+		key = name;
+	}
+	_wcsupr(&key[0]);
+
+	size_t len = _snwprintf_s(buffer, _TRUNCATE, L":%llx:%x:%s", time, size, exifOrientation);
+	key.append(buffer, len);
+
+	return key;
+}
+
+Bitmap* ImageCachePool::Get(const std::wstring& key, UINT* generation)
+{
+	auto iter = c_Entries.find(key);
+	if (iter == c_Entries.end())
+	{
+		++c_Stats.misses;
+		return nullptr;
+	}
+
+	Entry& entry = (*iter).second;
+	if (entry.ref == 0)
+	{
+		c_Unused.erase(entry.unused);
+		c_Stats.unusedSize -= entry.size;
+	}
+
+	++entry.ref;
+	++c_Stats.hits;
+	if (generation) *generation = entry.generation;
+	return entry.bitmap;
+}
+
+UINT ImageCachePool::Add(const std::wstring& key, Bitmap* bitmap, HGLOBAL hBuffer)
+{
+	Entry entry = {};
+	entry.bitmap = bitmap;
+	entry.hBuffer = hBuffer;
+	entry.size = (UINT64)bitmap->GetWidth() * bitmap->GetHeight() * 4;
+	if (hBuffer)
+	{
+		entry.size += ::GlobalSize(hBuffer);
+	}
+	entry.ref = 1;
+
+	entry.generation = Gfx::BitmapCache::NewGeneration();
+
+	auto result = c_Entries.insert(std::make_pair(key, entry));
+	if (!result.second)
+	{
+		// Two images were decoded from the same file at the same time. Keep the cached one.
+		Delete(entry);
+		++(*result.first).second.ref;
+		return (*result.first).second.generation;
+	}
+
+	c_Stats.size += entry.size;
+	++c_Stats.count;
+	return entry.generation;
+}
+
+void ImageCachePool::Release(const std::wstring& key)
+{
+	auto iter = c_Entries.find(key);
+	if (iter == c_Entries.end()) return;
+
+	Entry& entry = (*iter).second;
+	if (entry.ref > 0 && --entry.ref == 0)
+	{
+		c_Unused.push_front(key);
+		entry.unused = c_Unused.begin();
+		c_Stats.unusedSize += entry.size;
+		Trim();
+	}
+}
+
+/*
+** Sets the maximum size (in bytes) of the unreferenced entries. With 0, entries are deleted as
+** soon as they are no longer used.
+**
+*/
+void ImageCachePool::SetMaxUnusedSize(UINT64 size)
+{
+	c_MaxUnusedSize = size;
+	Trim();
+}
+
+void ImageCachePool::Delete(Entry& entry)
+{
+	delete entry.bitmap;
+	entry.bitmap = nullptr;
+
+	if (entry.hBuffer)
+	{
+		::GlobalFree(entry.hBuffer);
+		entry.hBuffer = nullptr;
+	}
+}
+
+/*
+** Deletes the least recently used unreferenced entries until they fit in the budget.
+**
+*/
+void ImageCachePool::Trim()
+{
+	while (c_Stats.unusedSize > c_MaxUnusedSize && !c_Unused.empty())
+	{
+		auto iter = c_Entries.find(c_Unused.back());
+		c_Unused.pop_back();
+
+		Entry& entry = (*iter).second;
+		c_Stats.unusedSize -= entry.size;
+		c_Stats.size -= entry.size;
+		--c_Stats.count;
+
+		Delete(entry);
+		c_Entries.erase(iter);
+	}
+}
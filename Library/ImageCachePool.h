@@ -0,0 +1,80 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_IMAGECACHEPOOL_H_
+#define RM_LIBRARY_IMAGECACHEPOOL_H_
+
+#include <windows.h>
+#include <ole2.h>  // For Gdiplus.h.
+#include <gdiplus.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// Bitmaps decoded (and cropped, tinted or transformed) by TintedImage, shared by all skins.
+// Entries are reference counted. When the last reference is released, the entry is kept so that
+// the image is not decoded again when it is used later, e.g. by a MeterImage that cycles through
+// a set of files. The least recently used of these unreferenced entries are deleted when their
+// total size exceeds the budget set with SetMaxUnusedSize().
+class ImageCachePool
+{
+public:
+	struct Stats
+	{
+		UINT64 hits;
+		UINT64 misses;
+		UINT64 size;		// In bytes, including the unreferenced entries.
+		UINT64 unusedSize;
+		size_t count;
+	};
+
+	// Returns the key of the decoded file. The file time and size identify the version of the file.
+	static std::wstring CreateKey(const std::wstring& name, ULONGLONG time, DWORD size, const WCHAR* exifOrientation);
+
+	// Returns the bitmap of |key| and adds a reference to it, or nullptr if it is not cached.
+	// |generation| is set to the value that identifies the bitmap (see Add()).
+	static Gdiplus::Bitmap* Get(const std::wstring& key, UINT* generation = nullptr);
+
+	// Adds |bitmap| with a single reference. The pool takes the ownership of |bitmap| and
+	// |hBuffer|, which is the memory that |bitmap| was decoded from (if still needed). Returns a
+	// generation that is unique to the entry so that copies of the bitmap (e.g. Direct2D bitmaps)
+	// can be told apart from those of a bitmap that is later allocated at the same address.
+	static UINT Add(const std::wstring& key, Gdiplus::Bitmap* bitmap, HGLOBAL hBuffer = nullptr);
+
+	static void Release(const std::wstring& key);
+
+	static void SetMaxUnusedSize(UINT64 size);
+	static UINT64 GetMaxUnusedSize() { return c_MaxUnusedSize; }
+
+	static const Stats& GetStats() { return c_Stats; }
+
+private:
+	struct Entry
+	{
+		Gdiplus::Bitmap* bitmap;
+		HGLOBAL hBuffer;
+		UINT64 size;
+		UINT ref;
+		UINT generation;
+
+		// Position in |c_Unused| when |ref| is 0.
+		std::list<std::wstring>::iterator unused;
+	};
+
+	static void Delete(Entry& entry);
+	static void Trim();
+
+	static std::unordered_map<std::wstring, Entry> c_Entries;
+
+	// Keys of the unreferenced entries, most recently released first.
+	static std::list<std::wstring> c_Unused;
+
+	static UINT64 c_MaxUnusedSize;
+	static Stats c_Stats;
+};
+
+#endif
@@ -0,0 +1,91 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "ImageCachePool.h"
+#include "../Common/UnitTest.h"
+
+TEST_CLASS(Library_ImageCachePool_Test)
+{
+public:
+	Library_ImageCachePool_Test()
+	{
+		Gdiplus::GdiplusStartupInput gdiplusStartupInput;
+		Gdiplus::GdiplusStartup(&m_GdiplusToken, &gdiplusStartupInput, nullptr);
+		m_MaxUnusedSize = ImageCachePool::GetMaxUnusedSize();
+	}
+
+	~Library_ImageCachePool_Test()
+	{
+		ImageCachePool::SetMaxUnusedSize(0);
+		ImageCachePool::SetMaxUnusedSize(m_MaxUnusedSize);
+		Gdiplus::GdiplusShutdown(m_GdiplusToken);
+	}
+
+	TEST_METHOD(TestReuse)
+	{
+		ImageCachePool::SetMaxUnusedSize(1024);
+		const ImageCachePool::Stats stats = ImageCachePool::GetStats();
+
+		Assert::IsNull(ImageCachePool::Get(L"REUSE"));
+		Gdiplus::Bitmap* bitmap = CreateBitmap(8, 8);
+		ImageCachePool::Add(L"REUSE", bitmap);
+		Assert::IsTrue(bitmap == ImageCachePool::Get(L"REUSE"));
+		Assert::AreEqual(stats.size + 256, ImageCachePool::GetStats().size);
+
+		// The bitmap is kept after the last reference is released.
+		ImageCachePool::Release(L"REUSE");
+		ImageCachePool::Release(L"REUSE");
+		Assert::AreEqual(stats.unusedSize + 256, ImageCachePool::GetStats().unusedSize);
+		Assert::IsTrue(bitmap == ImageCachePool::Get(L"REUSE"));
+		Assert::AreEqual(stats.unusedSize, ImageCachePool::GetStats().unusedSize);
+
+		Assert::AreEqual(stats.hits + 2, ImageCachePool::GetStats().hits);
+		Assert::AreEqual(stats.misses + 1, ImageCachePool::GetStats().misses);
+		ImageCachePool::Release(L"REUSE");
+	}
+
+	TEST_METHOD(TestEviction)
+	{
+		ImageCachePool::SetMaxUnusedSize(512);
+		const size_t count = ImageCachePool::GetStats().count;
+
+		ImageCachePool::Add(L"EVICT1", CreateBitmap(8, 8));
+		ImageCachePool::Add(L"EVICT2", CreateBitmap(8, 8));
+		ImageCachePool::Add(L"EVICT3", CreateBitmap(8, 8));
+		ImageCachePool::Release(L"EVICT1");
+		ImageCachePool::Release(L"EVICT2");
+
+		// EVICT1 is the least recently used when EVICT3 no longer fits.
+		Assert::IsNotNull(ImageCachePool::Get(L"EVICT1"));
+		ImageCachePool::Release(L"EVICT1");
+		ImageCachePool::Release(L"EVICT3");
+		Assert::AreEqual(count + 2, ImageCachePool::GetStats().count);
+		Assert::IsNull(ImageCachePool::Get(L"EVICT2"));
+		Assert::IsNotNull(ImageCachePool::Get(L"EVICT1"));
+		ImageCachePool::Release(L"EVICT1");
+
+		// Referenced entries are never deleted.
+		Gdiplus::Bitmap* bitmap = CreateBitmap(16, 16);
+		ImageCachePool::Add(L"EVICT4", bitmap);
+		ImageCachePool::SetMaxUnusedSize(0);
+		Assert::AreEqual(count + 1, ImageCachePool::GetStats().count);
+		Assert::IsTrue(bitmap == ImageCachePool::Get(L"EVICT4"));
+		ImageCachePool::Release(L"EVICT4");
+		ImageCachePool::Release(L"EVICT4");
+		Assert::AreEqual(count, ImageCachePool::GetStats().count);
+	}
+
+private:
+	static Gdiplus::Bitmap* CreateBitmap(int w, int h)
+	{
+		return new Gdiplus::Bitmap(w, h, PixelFormat32bppPARGB);
+	}
+
+	ULONG_PTR m_GdiplusToken;
+	UINT64 m_MaxUnusedSize;
+};
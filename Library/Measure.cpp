@@ -27,10 +27,9 @@
 #include "MeasureScript.h"
 #include "MeasureLoop.h"
 #include "MeasureWebParser.h"
+#include "MeasureWorkerPool.h"
 #include "Rainmeter.h"
 #include "Util.h"
-#include "pcre/config.h"
-#include "pcre/pcre.h"
 
 #define OVECCOUNT 300	// Should be a multiple of 3
 
@@ -64,14 +63,19 @@ Measure::Measure(Skin* skin, const WCHAR* name) : Section(skin, name),
 	m_MaxValue(1.0),
 	m_Value(),
 	m_RegExpSubstitute(false),
-	m_MedianPos(),
-	m_AveragePos(),
+	m_MedianFilter(MEDIAN_SIZE),
 	m_AverageSize(),
 	m_Disabled(false),
 	m_Paused(false),
 	m_Initialized(false),
 	m_OldValue(),
-	m_ValueAssigned(false)
+	m_ValueAssigned(false),
+	m_Async(false),
+	m_AsyncState(ASYNC_IDLE),
+	m_AsyncValue(),
+	m_AsyncMinValue(),
+	m_AsyncMaxValue(1.0),
+	m_AsyncHasString(false)
 {
 }
 
@@ -89,6 +93,19 @@ void Measure::Initialize()
 	m_Initialized = true;
 }
 
+/*
+** Reads the options and records what they depend on.
+**
+*/
+void Measure::ReadOptions(ConfigParser& parser)
+{
+	PROFILE_SCOPE(m_Profile.readOptions);
+
+	parser.BeginDependencies(m_Dependencies);
+	ReadOptions(parser, GetName());
+	parser.EndDependencies();
+}
+
 /*
 ** Read the common options specified in the ini file. The inherited classes must
 ** call this base implementation if they overwrite this method.
@@ -111,6 +128,8 @@ void Measure::ReadOptions(ConfigParser& parser, const WCHAR* section)
 	m_Disabled = parser.ReadBool(section, L"Disabled", false);
 	m_Paused = parser.ReadBool(section, L"Paused", false);
 
+	m_Async = CanUpdateAsync() && parser.ReadBool(section, L"Async", false);
+
 	m_MinValue = parser.ReadFloat(section, L"MinValue", m_MinValue);
 	m_MaxValue = parser.ReadFloat(section, L"MaxValue", m_MaxValue);
 
@@ -126,6 +145,8 @@ void Measure::ReadOptions(ConfigParser& parser, const WCHAR* section)
 	m_OnChangeAction = parser.ReadString(section, L"OnChangeAction", L"", false);
 
 	m_AverageSize = parser.ReadUInt(section, L"AverageSize", 0U);
+	m_SmoothingFilter.SetFactor(parser.ReadFloat(section, L"SmoothingFactor", 0.0));
+	m_MinMaxWindow.SetSize(parser.ReadUInt(section, L"MinMaxWindowSize", 0U));
 
 	m_RegExpSubstitute = parser.ReadBool(section, L"RegExpSubstitute", false);
 	std::wstring subs = parser.ReadString(section, L"Substitute", L"");
@@ -144,6 +165,30 @@ void Measure::ReadOptions(ConfigParser& parser, const WCHAR* section)
 		}
 	}
 
+	if (m_RegExpSubstitute)
+	{
+		// Only recompile the patterns that have changed since the last read.
+		const size_t count = m_Substitute.size() / 2;
+		m_SubstituteRegExps.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const std::wstring& pattern = m_Substitute[i * 2];
+			auto& regExp = m_SubstituteRegExps[i];
+			if (!regExp || regExp->GetPattern() != pattern)
+			{
+				regExp = RegExp::Compile(pattern);
+				if (!regExp->IsValid())
+				{
+					LogNoticeF(this, L"Substitute: %S", regExp->GetError());
+				}
+			}
+		}
+	}
+	else
+	{
+		m_SubstituteRegExps.clear();
+	}
+
 	if (m_Initialized &&
 		oldOnChangeActionEmpty && !m_OnChangeAction.empty())
 	{
@@ -237,29 +282,19 @@ const WCHAR* Measure::CheckSubstitute(const WCHAR* buffer)
 		int ovector[300];
 		for (size_t i = 0, isize = m_Substitute.size(); i < isize; i += 2)
 		{
-			const char* error;
-			int errorOffset;
 			int offset = 0;
-			pcre16* re = pcre16_compile(
-				(PCRE_SPTR16)m_Substitute[i].c_str(),
-				PCRE_UTF16,
-				&error,
-				&errorOffset,
-				nullptr);  // Use default character tables.
-			if (!re)
+			const RegExp& re = *m_SubstituteRegExps[i / 2];
+			if (!re.IsValid())
 			{
 				MakePlainSubstitute(str, i);
-				LogNoticeF(this, L"Substitute: %S", error);
 			}
 			else
 			{
 				do
 				{
 					const int options = str.empty() ? 0 : PCRE_NOTEMPTY;
-					const int rc = pcre16_exec(
-						re,
-						nullptr,
-						(PCRE_SPTR16)str.c_str(),
+					const int rc = re.Exec(
+						str.c_str(),
 						(int)str.length(),
 						offset,
 						options,               // Empty string is not a valid match
@@ -304,8 +339,6 @@ const WCHAR* Measure::CheckSubstitute(const WCHAR* buffer)
 					offset = start + (int)result.length();
 				}
 				while (true);
-
-				pcre16_free(re);
 			}
 		}
 	}
@@ -416,7 +449,11 @@ std::wstring Measure::ExtractWord(std::wstring& buffer)
 
 bool Measure::Update(bool rereadOptions)
 {
-	if (rereadOptions)
+	// With Async=1, the options are not read again until the worker thread has finished since
+	// UpdateValue() may be using them.
+	if (m_AsyncState == ASYNC_PENDING) return false;
+
+	if (rereadOptions && (!CanSkipReadOptions() || m_Skin->GetParser().HasChanged(m_Dependencies)))
 	{
 		ReadOptions(m_Skin->GetParser());
 	}
@@ -427,63 +464,73 @@ bool Measure::Update(bool rereadOptions)
 	if (!m_Disabled)
 	{
 		// Only update the counter if the divider
-		if (!UpdateCounter()) return false;
+		const bool due = UpdateCounter();
 
-		// Call derived method to update value
-		UpdateValue();
+		if (m_AsyncState == ASYNC_DONE)
+		{
+			// Apply the value of the update queued on the previous due update. The measure is then
+			// queued again below if it is due now.
+			m_AsyncState = ASYNC_IDLE;
+		}
+		else if (!due)
+		{
+			return false;
+		}
+		else if (m_Async)
+		{
+			// Keep the current values until the first update on the worker thread has finished.
+			SetAsyncValues();
+			MeasureWorkerPool::Queue(this);
+			return false;
+		}
+		else
+		{
+			// Call derived method to update value
+			UpdateValue();
+		}
 
 		if (m_AverageSize > 0)
 		{
-			size_t averageValuesSize = m_AverageValues.size();
-
-			if (m_AverageSize != averageValuesSize)
-			{
-				m_AverageValues.resize(m_AverageSize, m_Value);
-				averageValuesSize = m_AverageValues.size();
-				if (m_AveragePos >= averageValuesSize) m_AveragePos = 0;
-			}
-			m_AverageValues[m_AveragePos] = m_Value;
-
-			++m_AveragePos;
-			m_AveragePos %= averageValuesSize;
-
-			// Calculate the average value
-			double value = 0;
-			for (size_t i = 0; i < averageValuesSize; ++i)
-			{
-				value += m_AverageValues[i];
-			}
-			m_Value = value / (double)averageValuesSize;
+			m_AverageFilter.SetSize(m_AverageSize, m_Value);
+			m_Value = m_AverageFilter.Apply(m_Value);
 		}
 
+		m_Value = m_SmoothingFilter.Apply(m_Value);
+
 		// If we're logging the maximum value of the measure, check if
 		// the new value is greater than the old one, and update if necessary.
 		if (m_LogMaxValue)
 		{
-			if (m_MedianValues.empty())
-			{
-				m_MedianValues.resize(MEDIAN_SIZE, 0);
-			}
-
-			m_MedianValues[m_MedianPos] = m_Value;
-			++m_MedianPos;
-			m_MedianPos %= MEDIAN_SIZE;
-
-			auto medianArray = m_MedianValues;
-			std::sort(&medianArray.data()[0], &medianArray.data()[MEDIAN_SIZE]);  // Workaround for "Debug" build mode
-
-			double medianValue = medianArray[MEDIAN_SIZE / 2];
+			double medianValue = m_MedianFilter.Apply(m_Value);
 			m_MaxValue = max(m_MaxValue, medianValue);
 			m_MinValue = min(m_MinValue, medianValue);
 		}
 
+		if (m_MinMaxWindow.GetSize() > 0)
+		{
+			m_MinMaxWindow.Add(m_Value);
+			if (!m_MinMaxWindow.IsEmpty())
+			{
+				m_MinValue = m_MinMaxWindow.GetMin();
+				m_MaxValue = m_MinMaxWindow.GetMax();
+			}
+		}
+
 		m_ValueAssigned = true;
 
+		if (m_Async)
+		{
+			SetAsyncValues();
+		}
+
 		// For the conditional options to work with the current measure value when using
 		// [MeasureName], we need to read the options after m_Value has been changed.
-		if (rereadOptions)
+		ConfigParser& parser = m_Skin->GetParser();
+		if (rereadOptions && parser.HasChanged(m_ConditionDependencies))
 		{
-			m_IfActions.ReadConditionOptions(m_Skin->GetParser(), GetName());
+			parser.BeginDependencies(m_ConditionDependencies);
+			m_IfActions.ReadConditionOptions(parser, GetName());
+			parser.EndDependencies();
 		}
 
 		if (m_Skin)
@@ -491,10 +538,18 @@ bool Measure::Update(bool rereadOptions)
 			m_IfActions.DoIfActions(*this, m_Value);
 		}
 
+		if (m_Async && due)
+		{
+			MeasureWorkerPool::Queue(this);
+		}
+
 		return true;
 	}
 	else
 	{
+		// The value of an update finished after disabling is discarded.
+		m_AsyncState = ASYNC_IDLE;
+
 		// Disabled measures have 0 as value
 		m_Value = 0.0;
 
@@ -504,19 +559,45 @@ bool Measure::Update(bool rereadOptions)
 	}
 }
 
+/*
+** Copies the values that are returned by the getters while a worker thread is updating the
+** measure.
+**
+*/
+void Measure::SetAsyncValues()
+{
+	m_AsyncValue = m_Value;
+	m_AsyncMinValue = m_MinValue;
+	m_AsyncMaxValue = m_MaxValue;
+
+	const WCHAR* stringValue = GetStringValue();
+	m_AsyncHasString = stringValue != nullptr;
+	m_AsyncString = m_AsyncHasString ? stringValue : L"";
+}
+
+void Measure::FinishAsyncUpdate()
+{
+	if (m_AsyncState == ASYNC_PENDING)
+	{
+		MeasureWorkerPool::Cancel(this);
+	}
+}
+
 /*
 ** Returns the value of the measure.
 **
 */
 double Measure::GetValue()
 {
+	const double value = IsUpdatingAsync() ? m_AsyncValue : m_Value;
+
 	// Invert if so requested
 	if (m_Invert)
 	{
-		return m_MaxValue - m_Value + m_MinValue;
+		return GetMaxValue() - value + GetMinValue();
 	}
 
-	return m_Value;
+	return value;
 }
 
 /*
@@ -531,10 +612,10 @@ double Measure::GetRelativeValue()
 	{
 		double value = GetValue();
 
-		value = min(m_MaxValue, value);
-		value = max(m_MinValue, value);
+		value = min(GetMaxValue(), value);
+		value = max(GetMinValue(), value);
 
-		value -= m_MinValue;
+		value -= GetMinValue();
 
 		return value / range;
 	}
@@ -548,7 +629,7 @@ double Measure::GetRelativeValue()
 */
 double Measure::GetValueRange()
 {
-	return m_MaxValue - m_MinValue;
+	return GetMaxValue() - GetMinValue();
 }
 
 /*
@@ -715,6 +796,38 @@ void Measure::DoChangeAction(bool execute)
 	}
 }
 
+/*
+** Returns the history of the values shared by the meters that update with |updateDivider|.
+** Meters with another UpdateDivider add the values at different rates and get their own history.
+**
+*/
+std::shared_ptr<ValueHistory> Measure::GetHistory(int updateDivider)
+{
+	std::shared_ptr<ValueHistory> history;
+	for (auto it = m_Histories.begin(); it != m_Histories.end(); )
+	{
+		if (it->second.expired())
+		{
+			it = m_Histories.erase(it);
+			continue;
+		}
+
+		if (it->first == updateDivider)
+		{
+			history = it->second.lock();
+		}
+		++it;
+	}
+
+	if (!history)
+	{
+		history = std::make_shared<ValueHistory>();
+		m_Histories.emplace_back(updateDivider, history);
+	}
+
+	return history;
+}
+
 /*
 ** Creates the given measure. This is the factory method for the measures.
 ** If new measures are implemented this method needs to be updated.
@@ -840,3 +953,31 @@ bool Measure::GetCurrentMeasureValue(const WCHAR* str, int len, double* value, v
 
 	return false;
 }
+
+/*
+** Returns the measure referenced in a formula, used by MathParser::Bind. Measures are only
+** added or removed when the skin is refreshed, which also recreates the compiled formulas, so the
+** returned pointer remains valid for the lifetime of the program.
+**
+*/
+void* Measure::GetMeasureHandle(const WCHAR* str, int len, void* context)
+{
+	auto measure = (Measure*)context;
+	const std::vector<Measure*>& measures = measure->m_Skin->GetMeasures();
+
+	for (const auto& iter : measures)
+	{
+		if (iter->GetOriginalName().length() == len &&
+			_wcsnicmp(str, iter->GetName(), len) == 0)
+		{
+			return iter;
+		}
+	}
+
+	return nullptr;
+}
+
+double Measure::GetMeasureHandleValue(void* handle)
+{
+	return ((Measure*)handle)->GetValue();
+}
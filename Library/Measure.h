@@ -12,8 +12,10 @@
 #include <vector>
 #include <string>
 #include "IfActions.h"
+#include "RegExp.h"
 #include "Util.h"
 #include "Section.h"
+#include "ValueFilter.h"
 
 enum AUTOSCALE
 {
@@ -49,7 +51,7 @@ public:
 
 	Measure(const Measure& other) = delete;
 
-	void ReadOptions(ConfigParser& parser) { ReadOptions(parser, GetName()); }
+	void ReadOptions(ConfigParser& parser);
 
 	virtual void Initialize();
 	bool Update(bool rereadOptions = false);
@@ -64,11 +66,15 @@ public:
 
 	virtual void Command(const std::wstring& command);
 
+	// Waits for the update on a worker thread, if any, to finish. Must be called before accessing
+	// what UpdateValue() uses from the UI thread (e.g. in Command()) or deleting the measure.
+	void FinishAsyncUpdate();
+
 	double GetValue();
 	double GetRelativeValue();
 	double GetValueRange();
-	double GetMinValue() { return m_MinValue; }
-	double GetMaxValue() { return m_MaxValue; }
+	double GetMinValue() { return IsUpdatingAsync() ? m_AsyncMinValue : m_MinValue; }
+	double GetMaxValue() { return IsUpdatingAsync() ? m_AsyncMaxValue : m_MaxValue; }
 
 	virtual const WCHAR* GetStringValue();
 	const WCHAR* GetStringOrFormattedValue(AUTOSCALE autoScale, double scale, int decimals, bool percentual);
@@ -80,8 +86,12 @@ public:
 	const std::wstring& GetOnChangeAction() { return m_OnChangeAction; }
 	void DoChangeAction(bool execute = true);
 
+	std::shared_ptr<ValueHistory> GetHistory(int updateDivider);
+
 	static Measure* Create(const WCHAR* measure, Skin* skin, const WCHAR* name);
 	static bool GetCurrentMeasureValue(const WCHAR* str, int len, double* value, void* context);
+	static void* GetMeasureHandle(const WCHAR* str, int len, void* context);
+	static double GetMeasureHandleValue(void* handle);
 
 protected:
 	Measure(Skin* skin, const WCHAR* name);
@@ -89,6 +99,19 @@ protected:
 	virtual void ReadOptions(ConfigParser& parser, const WCHAR* section);
 	virtual void UpdateValue() = 0;
 
+	// Derived classes return true if UpdateValue() can run on a worker thread with Async=1, i.e. it
+	// only blocks on I/O and does not use the skin, the parser or other measures.
+	virtual bool CanUpdateAsync() { return false; }
+
+	// Derived classes return true if reading the options again with the same inputs has no effect,
+	// so that DynamicVariables=1 only reads them when the inputs have changed.
+	virtual bool CanSkipReadOptions() { return false; }
+
+	// True while a worker thread may be using the values of the measure. The getters return the
+	// values of the last completed update (see GetAsyncStringValue()) during that time.
+	bool IsUpdatingAsync() { return m_AsyncState != ASYNC_IDLE; }
+	const WCHAR* GetAsyncStringValue() { return m_AsyncHasString ? m_AsyncString.c_str() : nullptr; }
+
 	bool ParseSubstitute(std::wstring buffer);
 	std::wstring ExtractWord(std::wstring& buffer);
 	const WCHAR* CheckSubstitute(const WCHAR* buffer);
@@ -101,16 +124,22 @@ protected:
 	double m_Value;					// The current value
 
 	std::vector<std::wstring> m_Substitute;	// Vec of substitute strings
+	std::vector<std::shared_ptr<const RegExp>> m_SubstituteRegExps;	// Compiled patterns if RegExpSubstitute=1
 	bool m_RegExpSubstitute;
 
-	std::vector<double> m_MedianValues;	// The values for the median filtering
-	UINT m_MedianPos;				// Position in the median array, where the new value is placed
+	MedianFilter m_MedianFilter;	// Filters the values for m_LogMaxValue
 
-	std::vector<double> m_AverageValues;
-	UINT m_AveragePos;
+	AverageFilter m_AverageFilter;
 	UINT m_AverageSize;
+	SmoothingFilter m_SmoothingFilter;
+	MinMaxWindow m_MinMaxWindow;	// Sets MinValue/MaxValue to the range of the recent values
+
+	// Histories of the graph meters bound to this measure by the UpdateDivider of the meters.
+	std::vector<std::pair<int, std::weak_ptr<ValueHistory>>> m_Histories;
 
 	IfActions m_IfActions;
+	ConfigParser::Dependencies m_ConditionDependencies;
+
 	bool m_Disabled;				// Status of the measure
 	bool m_Paused;
 	bool m_Initialized;
@@ -118,6 +147,28 @@ protected:
 	std::wstring m_OnChangeAction;
 	MeasureValueSet* m_OldValue;
 	bool m_ValueAssigned;
+
+private:
+	friend class MeasureWorkerPool;
+
+	enum ASYNC_STATE
+	{
+		ASYNC_IDLE,		// Only used by the UI thread
+		ASYNC_PENDING,	// Queued or being updated by a worker thread
+		ASYNC_DONE		// Updated, but the new values have not been applied yet
+	};
+
+	void SetAsyncValues();
+
+	bool m_Async;
+	volatile LONG m_AsyncState;
+
+	// Values of the last completed update while IsUpdatingAsync() is true.
+	double m_AsyncValue;
+	double m_AsyncMinValue;
+	double m_AsyncMaxValue;
+	std::wstring m_AsyncString;
+	bool m_AsyncHasString;
 };
 
 #endif
@@ -22,10 +22,12 @@ std::mt19937& GetRandomEngine()
 }
 
 MeasureCalc::MeasureCalc(Skin* skin, const WCHAR* name) : Measure(skin, name),
+	m_CompileError(),
 	m_ParseError(false),
 	m_LowBound(DEFAULT_LOWER_BOUND),
 	m_HighBound(DEFAULT_UPPER_BOUND),
 	m_UpdateRandom(false),
+	m_HasRandom(false),
 	m_UniqueRandom(false)
 {
 }
@@ -40,7 +42,12 @@ MeasureCalc::~MeasureCalc()
 */
 void MeasureCalc::UpdateValue()
 {
-	const WCHAR* errMsg = MathParser::Parse(m_Formula.c_str(), &m_Value, GetMeasureValue, this);
+	const WCHAR* errMsg = m_CompileError;
+	if (!errMsg)
+	{
+		errMsg = MathParser::Evaluate(m_Program, &m_Value, GetMeasureValue, this);
+	}
+
 	if (errMsg != nullptr)
 	{
 		if (!m_ParseError)
@@ -107,7 +114,7 @@ void MeasureCalc::ReadOptions(ConfigParser& parser, const WCHAR* section)
 
 		if (!m_UpdateRandom)
 		{
-			FormulaReplace();
+			m_HasRandom = FormulaReplace();
 		}
 
 		const WCHAR* errMsg = MathParser::Check(m_Formula.c_str());
@@ -117,14 +124,28 @@ void MeasureCalc::ReadOptions(ConfigParser& parser, const WCHAR* section)
 			m_Formula.clear();
 		}
 	}
+
+	// The formula is compiled once and evaluated on each update until it changes. Measure names
+	// are bound directly to the measures while "Counter" and "Random" are still resolved in
+	// GetMeasureValue.
+	if (m_Formula != m_Program.GetFormula())
+	{
+		m_CompileError = MathParser::Compile(m_Formula.c_str(), &m_Program);
+		if (!m_CompileError)
+		{
+			MathParser::Bind(&m_Program, GetMeasureHandle, GetMeasureHandleValue, this);
+		}
+	}
 }
 
 /*
-** This replaces the word Random in the formula with a random number
+** This replaces the word Random in the formula with a random number. Returns true if the formula
+** contained Random.
 **
 */
-void MeasureCalc::FormulaReplace()
+bool MeasureCalc::FormulaReplace()
 {
+	bool replaced = false;
 	size_t start = 0, pos;
 	do
 	{
@@ -143,6 +164,7 @@ void MeasureCalc::FormulaReplace()
 
 				m_Formula.replace(pos, 6, buffer, len);
 				start = pos + len;
+				replaced = true;
 			}
 			else
 			{
@@ -151,6 +173,8 @@ void MeasureCalc::FormulaReplace()
 		}
 	}
 	while (pos != std::wstring::npos);
+
+	return replaced;
 }
 
 bool MeasureCalc::GetMeasureValue(const WCHAR* str, int len, double* value, void* context)
@@ -9,6 +9,7 @@
 #define __MEASURECALC_H__
 
 #include "Measure.h"
+#include "../Common/MathParser.h"
 
 class MeasureCalc : public Measure
 {
@@ -25,19 +26,25 @@ protected:
 	virtual void ReadOptions(ConfigParser& parser, const WCHAR* section);
 	virtual void UpdateValue();
 
+	// Reading the options again replaces Random with a new number unless UpdateRandom=1.
+	virtual bool CanSkipReadOptions() { return m_UpdateRandom || !m_HasRandom; }
+
 private:
 	static bool GetMeasureValue(const WCHAR* str, int len, double* value, void* context);
 
-	void FormulaReplace();
+	bool FormulaReplace();
 	int GetRandom();
 
 	std::wstring m_Formula;
+	MathParser::Program m_Program;
+	const WCHAR* m_CompileError;
 	bool m_ParseError;
 
 	int m_LowBound;
 	int m_HighBound;
 
 	bool m_UpdateRandom;
+	bool m_HasRandom;
 	bool m_UniqueRandom;
 
 	std::vector<int> m_UniqueNumbers;
@@ -148,6 +148,8 @@ void MeasureDiskSpace::UpdateValue()
 */
 const WCHAR* MeasureDiskSpace::GetStringValue()
 {
+	if (IsUpdatingAsync()) return GetAsyncStringValue();
+
 	return (m_Type || m_Label) ? CheckSubstitute(m_StringValue.c_str()) : nullptr;
 }
 
@@ -26,6 +26,7 @@ public:
 protected:
 	virtual void ReadOptions(ConfigParser& parser, const WCHAR* section);
 	virtual void UpdateValue();
+	virtual bool CanUpdateAsync() { return true; }
 
 private:
 	std::wstring m_Drive;
@@ -323,7 +323,7 @@ void MeasureNet::ReadOptions(ConfigParser& parser, const WCHAR* section)
 		{
 			m_MaxValue = 1.0;
 			m_LogMaxValue = true;
-			m_MedianValues.clear();
+			m_MedianFilter.Reset();
 		}
 	}
 	else
@@ -173,7 +173,7 @@ void MeasurePlugin::ReadOptions(ConfigParser& parser, const WCHAR* section)
 		{
 			m_MaxValue = 1.0;
 			m_LogMaxValue = true;
-			m_MedianValues.clear();
+			m_MedianFilter.Reset();
 		}
 		else
 		{
@@ -26,6 +26,7 @@ public:
 protected:
 	void ReadOptions(ConfigParser& parser, const WCHAR* section) override;
 	void UpdateValue() override;
+	bool CanSkipReadOptions() override { return true; }
 
 private:
 	enum class Type;
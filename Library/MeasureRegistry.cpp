@@ -139,6 +139,8 @@ void MeasureRegistry::ReadOptions(ConfigParser& parser, const WCHAR* section)
 */
 const WCHAR* MeasureRegistry::GetStringValue()
 {
+	if (IsUpdatingAsync()) return GetAsyncStringValue();
+
 	return !m_StringValue.empty() ? CheckSubstitute(m_StringValue.c_str()) : nullptr;
 }
 
@@ -9,14 +9,57 @@
 #include "MeasureWebParser.h"
 #include "Rainmeter.h"
 #include "System.h"
-#include "pcre/config.h"
-#include "pcre/pcre.h"
+#include "RegExp.h"
+#include "WebFetchPool.h"
+#include "WebParserChildren.h"
 #include "../Common/CharacterEntityReference.h"
 #include "../Common/StringUtil.h"
 #include "../Common/FileUtil.h"
 
 void ShowError(MeasureWebParser* measure, WCHAR* description);
 
+// Aborts URLDownloadToFile() when the download is cancelled.
+class DownloadCallback : public IBindStatusCallback
+{
+public:
+	DownloadCallback(const volatile bool& cancelled) : m_Cancelled(cancelled) {}
+
+	DownloadCallback(const DownloadCallback& other) = delete;
+	DownloadCallback& operator=(DownloadCallback other) = delete;
+
+	// The callback is only used during URLDownloadToFile() so reference counting is not needed.
+	STDMETHOD(QueryInterface)(REFIID riid, void** ppvObject)
+	{
+		if (riid == IID_IUnknown || riid == IID_IBindStatusCallback)
+		{
+			*ppvObject = this;
+			return S_OK;
+		}
+
+		*ppvObject = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	STDMETHOD_(ULONG, AddRef)() { return 1; }
+	STDMETHOD_(ULONG, Release)() { return 1; }
+
+	STDMETHOD(OnProgress)(ULONG ulProgress, ULONG ulProgressMax, ULONG ulStatusCode, LPCWSTR szStatusText)
+	{
+		return m_Cancelled ? E_ABORT : S_OK;
+	}
+
+	STDMETHOD(OnStartBinding)(DWORD dwReserved, IBinding* pib) { return E_NOTIMPL; }
+	STDMETHOD(GetPriority)(LONG* pnPriority) { return E_NOTIMPL; }
+	STDMETHOD(OnLowResource)(DWORD reserved) { return E_NOTIMPL; }
+	STDMETHOD(OnStopBinding)(HRESULT hresult, LPCWSTR szError) { return E_NOTIMPL; }
+	STDMETHOD(GetBindInfo)(DWORD* grfBINDF, BINDINFO* pbindinfo) { return E_NOTIMPL; }
+	STDMETHOD(OnDataAvailable)(DWORD grfBSCF, DWORD dwSize, FORMATETC* pformatetc, STGMEDIUM* pstgmed) { return E_NOTIMPL; }
+	STDMETHOD(OnObjectAvailable)(REFIID riid, IUnknown* punk) { return E_NOTIMPL; }
+
+private:
+	const volatile bool& m_Cancelled;
+};
+
 class ProxyCachePool
 {
 public:
@@ -192,13 +235,30 @@ private:
 	std::wstring m_GlobalUserAgent;
 };
 
-BYTE* DownloadUrl(HINTERNET handle, std::wstring& url, std::wstring& headers, DWORD* dataSize, bool forceReload);
-
 CRITICAL_SECTION g_CriticalSection;
 ProxyCachePool* g_ProxyCachePool = nullptr;
 UINT g_InstanceCount = 0;
 
-static std::vector<MeasureWebParser*> g_Measures;
+// Incremented when the options that affect the results of parsing change. A page is not parsed
+// again if neither it nor the generation has changed since it was last parsed.
+UINT g_ParseGeneration = 1;
+
+// Maintained by ReadOptions. Only accessed in g_CriticalSection.
+static WebParserChildren g_Children;
+
+// Runs a FinishAction when the last reference is released, i.e. after the children of a parent
+// have been parsed on the worker threads (or cancelled).
+struct PendingFinishAction
+{
+	PendingFinishAction(const std::wstring& action, Skin* skin) : action(action), skin(skin) {}
+	~PendingFinishAction() { GetRainmeter().DelayedExecuteCommand(action.c_str(), skin); }
+
+	PendingFinishAction(const PendingFinishAction& other) = delete;
+	PendingFinishAction& operator=(PendingFinishAction other) = delete;
+
+	std::wstring action;
+	Skin* skin;
+};
 
 #define OVECCOUNT 300    // should be a multiple of 3
 
@@ -245,8 +305,12 @@ void ClearProxySetting(ProxySetting& setting)
 }
 
 MeasureWebParser::MeasureWebParser(Skin* skin, const WCHAR* name) : Measure(skin, name),
-	m_ThreadHandle(),
-	m_DlThreadHandle(),
+	m_Fetching(false),
+	m_Downloading(false),
+	m_ParsedHash(),
+	m_ParsedGeneration(),
+	m_ParseSequence(),
+	m_ParseResult(PARSE_NONE),
 	m_Codepage(),
 	m_StringIndex(),
 	m_StringIndex2(),
@@ -258,8 +322,6 @@ MeasureWebParser::MeasureWebParser(Skin* skin, const WCHAR* name) : Measure(skin
 	m_Download(),
 	m_ForceReload()
 {
-	g_Measures.push_back(this);
-
 	if (g_InstanceCount == 0)
 	{
 		System::InitializeCriticalSection(&g_CriticalSection);
@@ -277,27 +339,14 @@ MeasureWebParser::MeasureWebParser(Skin* skin, const WCHAR* name) : Measure(skin
 
 MeasureWebParser::~MeasureWebParser()
 {
-	if (m_ThreadHandle)
-	{
-		// Thread is killed inside critical section so that itself is not inside one when it is terminated
-		EnterCriticalSection(&g_CriticalSection);
-
-		TerminateThread(m_ThreadHandle, 0);
-		m_ThreadHandle = nullptr;
-
-		LeaveCriticalSection(&g_CriticalSection);
-	}
-
-	if (m_DlThreadHandle)
-	{
-		// Thread is killed inside critical section so that itself is not inside one when it is terminated
-		EnterCriticalSection(&g_CriticalSection);
-
-		TerminateThread(m_DlThreadHandle, 0);
-		m_DlThreadHandle = nullptr;
+	// Parents no longer queue the parsing of their results for this measure.
+	EnterCriticalSection(&g_CriticalSection);
+	g_Children.Remove(this);
+	LeaveCriticalSection(&g_CriticalSection);
 
-		LeaveCriticalSection(&g_CriticalSection);
-	}
+	// Aborts the transfers that are no longer needed by other measures and waits for the running
+	// callbacks of this measure.
+	WebFetchPool::Cancel(this);
 
 	if (m_DownloadFile.empty())  // cache mode
 	{
@@ -310,9 +359,6 @@ MeasureWebParser::~MeasureWebParser()
 
 	ClearProxySetting(m_Proxy);
 
-	auto iter = std::find(g_Measures.begin(), g_Measures.end(), this);
-	g_Measures.erase(iter);
-
 	--g_InstanceCount;
 	if (g_InstanceCount == 0)
 	{
@@ -328,6 +374,16 @@ void MeasureWebParser::ReadOptions(ConfigParser& parser, const WCHAR* section)
 {
 	EnterCriticalSection(&g_CriticalSection);
 
+	const std::wstring oldUrl = m_Url;
+	const std::wstring oldRegExp = m_RegExp;
+	const std::wstring oldErrorString = m_ErrorString;
+	const std::wstring oldDownloadFile = m_DownloadFile;
+	const int oldStringIndex = m_StringIndex;
+	const int oldStringIndex2 = m_StringIndex2;
+	const int oldDecodeCharacterReference = m_DecodeCharacterReference;
+	const int oldCodepage = m_Codepage;
+	const bool oldDownload = m_Download;
+
 	Measure::ReadOptions(parser, section);
 
 	std::wstring url = parser.ReadString(section, L"Url", L"", false);
@@ -349,6 +405,10 @@ void MeasureWebParser::ReadOptions(ConfigParser& parser, const WCHAR* section)
 	}
 
 	m_Url = url;
+	if (m_Url != oldUrl)
+	{
+		g_Children.Set(GetSkin(), this, m_Url);
+	}
 
 	m_Headers.clear();
 	size_t hNum = 1;
@@ -367,6 +427,11 @@ void MeasureWebParser::ReadOptions(ConfigParser& parser, const WCHAR* section)
 	}
 
 	m_RegExp = parser.ReadString(section, L"RegExp", L"");
+	if (!m_CompiledRegExp || m_CompiledRegExp->GetPattern() != m_RegExp)
+	{
+		m_CompiledRegExp = RegExp::Compile(m_RegExp);
+	}
+
 	m_FinishAction = parser.ReadString(section, L"FinishAction", L"", false);
 	m_OnRegExpErrAction = parser.ReadString(section, L"OnRegExpErrorAction", L"", false);
 	m_OnConnectErrAction = parser.ReadString(section, L"OnConnectErrorAction", L"", false);
@@ -409,6 +474,15 @@ void MeasureWebParser::ReadOptions(ConfigParser& parser, const WCHAR* section)
 		LogNoticeF(this, L"Debug file: %s", m_DebugFileLocation.c_str());
 	}
 
+	// The results of this measure and of the measures that reference it need to be parsed again.
+	if (m_Url != oldUrl || m_RegExp != oldRegExp || m_ErrorString != oldErrorString ||
+		m_DownloadFile != oldDownloadFile || m_StringIndex != oldStringIndex ||
+		m_StringIndex2 != oldStringIndex2 || m_DecodeCharacterReference != oldDecodeCharacterReference ||
+		m_Codepage != oldCodepage || m_Download != oldDownload)
+	{
+		++g_ParseGeneration;
+	}
+
 	LeaveCriticalSection(&g_CriticalSection);
 }
 
@@ -417,17 +491,11 @@ void MeasureWebParser::UpdateValue()
 	if (m_Download && m_RegExp.empty() && m_Url.find(L'[') == std::wstring::npos)
 	{
 		// If RegExp is empty download the file that is pointed by the Url
-		if (m_DlThreadHandle == 0)
+		if (!m_Downloading)
 		{
 			if (m_UpdateCounter == 0)
 			{
-				// Launch a new thread to fetch the web data
-				unsigned int id;
-				HANDLE threadHandle = (HANDLE)_beginthreadex(nullptr, 0, NetworkDownloadThreadProc, this, 0, &id);
-				if (threadHandle)
-				{
-					m_DlThreadHandle = threadHandle;
-				}
+				StartDownload();
 			}
 
 			m_UpdateCounter++;
@@ -454,17 +522,11 @@ void MeasureWebParser::UpdateValue()
 		if (m_Url.size() > 0 && m_Url.find(L'[') == std::wstring::npos)
 		{
 			// This is not a reference; need to update.
-			if (m_ThreadHandle == 0 && m_DlThreadHandle == 0)
+			if (!m_Fetching && !m_Downloading)
 			{
 				if (m_UpdateCounter == 0)
 				{
-					// Launch a new thread to fetch the web data
-					unsigned int id;
-					HANDLE threadHandle = (HANDLE)_beginthreadex(nullptr, 0, NetworkThreadProc, this, 0, &id);
-					if (threadHandle)
-					{
-						m_ThreadHandle = threadHandle;
-					}
+					StartFetch();
 				}
 
 				m_UpdateCounter++;
@@ -495,19 +557,54 @@ const WCHAR* MeasureWebParser::GetStringValue()
 	return CheckSubstitute(s_ResultString.c_str());
 }
 
-// Fetches the data from the net and parses the page
-unsigned __stdcall MeasureWebParser::NetworkThreadProc(void* pParam)
+/*
+** Queues the fetch of the Url. Identical requests of other measures share the response.
+**
+*/
+void MeasureWebParser::StartFetch()
 {
-	auto* measure = (MeasureWebParser*)pParam;
-	DWORD dwSize = 0;
-
 	if (GetRainmeter().GetDebug())
 	{
-		LogDebugF(measure, L"Fetching: %s", measure->m_Url.c_str());
+		LogDebugF(this, L"Fetching: %s", m_Url.c_str());
 	}
-	BYTE* data = DownloadUrl(measure->m_Proxy.handle, measure->m_Url, measure->m_Headers, &dwSize, measure->m_ForceReload);
+
+	m_Fetching = true;
+
+	WebFetchPool::Request request = { m_Url, m_Headers, m_Proxy.handle, m_ForceReload };
+	WebFetchPool::Fetch(this, request, [this](const WebFetchPool::Response& response)
+	{
+		FetchFinished(this, response);
+	});
+}
+
+/*
+** Queues the download of the Url or of the result of the measure to a file.
+**
+*/
+void MeasureWebParser::StartDownload()
+{
+	m_Downloading = true;
+
+	// The URL is only used to limit the connections to the host.
+	EnterCriticalSection(&g_CriticalSection);
+	const std::wstring url = m_ResultString.empty() ? m_Url : m_ResultString;
+	LeaveCriticalSection(&g_CriticalSection);
+
+	WebFetchPool::Download(this, url, [this](const volatile bool& cancelled)
+	{
+		Download(this, cancelled);
+	});
+}
+
+// Parses the page fetched by the pool
+void MeasureWebParser::FetchFinished(MeasureWebParser* measure, const WebFetchPool::Response& response)
+{
+	BYTE* data = response.data;
+	DWORD dwSize = response.size;
+
 	if (!data)
 	{
+		SetLastError(response.error);
 		ShowError(measure, L"Fetch error");
 
 		if (!measure->m_OnConnectErrAction.empty())
@@ -517,53 +614,76 @@ unsigned __stdcall MeasureWebParser::NetworkThreadProc(void* pParam)
 	}
 	else
 	{
-		if (measure->m_Debug == 2)
-		{
-			// Dump to a file
+		EnterCriticalSection(&g_CriticalSection);
+		const UINT generation = g_ParseGeneration;
+		const bool unchanged =
+			measure->m_ParsedGeneration == generation && measure->m_ParsedHash == response.hash;
+		LeaveCriticalSection(&g_CriticalSection);
 
-			FILE* file = _wfopen(measure->m_DebugFileLocation.c_str(), L"wb");
-			if (file)
+		if (unchanged)
+		{
+			// The results of this measure and of the measures that reference it are still valid.
+			if (GetRainmeter().GetDebug())
 			{
-				fwrite(data, sizeof(BYTE), dwSize, file);
-				fclose(file);
+				LogDebugF(measure, L"Unchanged%s: %s",
+					response.notModified ? L" (304)" : L"", measure->m_Url.c_str());
 			}
-			else
+
+			measure->RepeatParseActions();
+		}
+		else
+		{
+			if (measure->m_Debug == 2)
 			{
-				LogErrorF(measure, L"Failed to dump debug data");
+				// Dump to a file
+
+				FILE* file = _wfopen(measure->m_DebugFileLocation.c_str(), L"wb");
+				if (file)
+				{
+					fwrite(data, sizeof(BYTE), dwSize, file);
+					fclose(file);
+				}
+				else
+				{
+					LogErrorF(measure, L"Failed to dump debug data");
+				}
 			}
-		}
 
-		measure->ParseData(data, dwSize);
+			measure->ParseData(data, dwSize, measure->m_StringIndex);
 
-		free(data);
+			// Only a successful parse is skipped when the same page is fetched again. A failed
+			// download increments g_ParseGeneration.
+			EnterCriticalSection(&g_CriticalSection);
+			measure->m_ParsedGeneration = generation;
+			measure->m_ParsedHash = (measure->m_ParseResult == PARSE_OK) ? response.hash : 0;
+			LeaveCriticalSection(&g_CriticalSection);
+		}
 	}
 
 	EnterCriticalSection(&g_CriticalSection);
-	CloseHandle(measure->m_ThreadHandle);
-	measure->m_ThreadHandle = 0;
+	measure->m_Fetching = false;
 	LeaveCriticalSection(&g_CriticalSection);
-
-	return 0;   // thread completed successfully
 }
 
-void MeasureWebParser::ParseData(const BYTE* rawData, DWORD rawSize, bool utf16Data)
+void MeasureWebParser::ParseData(const BYTE* rawData, DWORD rawSize, int stringIndex, bool utf16Data, UINT sequence)
 {
 	const int UTF16_CODEPAGE = 1200;
 	if (m_Codepage == UTF16_CODEPAGE) {
 		utf16Data = true;
 	}
 
-	const char* error;
-	int erroffset;
 	int ovector[OVECCOUNT];
 	int rc;
 	bool doErrorAction = false;
+	std::shared_ptr<PendingFinishAction> finishAction;
+
+	// The compiled pattern is replaced in ReadOptions when RegExp changes so keep a reference to
+	// the current one while parsing.
+	EnterCriticalSection(&g_CriticalSection);
+	std::shared_ptr<const RegExp> re = m_CompiledRegExp;
+	LeaveCriticalSection(&g_CriticalSection);
 
-	// Compile the regular expression in the first argument
-	pcre16* re = pcre16_compile(
-		(PCRE_SPTR16)m_RegExp.c_str(),
-		PCRE_UTF16, &error, &erroffset, nullptr);
-	if (re != nullptr)
+	if (re->IsValid())
 	{
 		// Compilation succeeded: match the subject in the second argument
 		std::wstring buffer;
@@ -571,12 +691,12 @@ void MeasureWebParser::ParseData(const BYTE* rawData, DWORD rawSize, bool utf16D
 		DWORD dataLength = rawSize / 2;
 		if (!utf16Data)
 		{
-			buffer = StringUtil::Widen((LPCSTR)rawData, rawSize, m_Codepage);
+			StringUtil::Widen((LPCSTR)rawData, (int)rawSize, m_Codepage, buffer);
 			data = buffer.c_str();
 			dataLength = (DWORD)buffer.length();
 		}
 
-		rc = pcre16_exec(re, nullptr, (PCRE_SPTR16)data, dataLength, 0, 0, ovector, OVECCOUNT);
+		rc = re->Exec(data, dataLength, 0, 0, ovector, OVECCOUNT);
 		if (rc >= 0)
 		{
 			if (rc == 0)
@@ -586,168 +706,199 @@ void MeasureWebParser::ParseData(const BYTE* rawData, DWORD rawSize, bool utf16D
 			}
 			else
 			{
-				if (m_StringIndex < rc)
+				if (stringIndex < rc && GetRainmeter().GetDebug() && m_Debug != 0)
 				{
-					if (GetRainmeter().GetDebug() && m_Debug != 0)
+					for (int i = 0; i < rc; ++i)
 					{
-						for (int i = 0; i < rc; ++i)
-						{
-							const WCHAR* match = data + ovector[2 * i];
-							const int matchLen = min(ovector[2 * i + 1] - ovector[2 * i], 256);
-							LogDebugF(this, L"Index %2d: %.*s", i, matchLen, match);
-						}
+						const WCHAR* match = data + ovector[2 * i];
+						const int matchLen = min(ovector[2 * i + 1] - ovector[2 * i], 256);
+						LogDebugF(this, L"Index %2d: %.*s", i, matchLen, match);
 					}
+				}
 
-					const WCHAR* match = data + ovector[2 * m_StringIndex];
-					int matchLen = ovector[2 * m_StringIndex + 1] - ovector[2 * m_StringIndex];
-					EnterCriticalSection(&g_CriticalSection);
+				// The result and the references are updated together so that a newer parse of a
+				// child is not overwritten by an older one that finishes later.
+				EnterCriticalSection(&g_CriticalSection);
+				if (sequence != 0 && sequence != m_ParseSequence)
+				{
+					LeaveCriticalSection(&g_CriticalSection);
+					return;
+				}
+
+				if (stringIndex < rc)
+				{
+					const WCHAR* match = data + ovector[2 * stringIndex];
+					int matchLen = ovector[2 * stringIndex + 1] - ovector[2 * stringIndex];
 					m_ResultString.assign(match, matchLen);
 					CharacterEntityReference::Decode(m_ResultString, m_DecodeCharacterReference);
-					LeaveCriticalSection(&g_CriticalSection);
 				}
 				else
 				{
 					if (m_LogSubstringErrors) LogWarningF(this, L"Not enough substrings");
 
 					// Clear the old result
-					EnterCriticalSection(&g_CriticalSection);
-					m_ResultString.clear();
-					if (m_Download)
-					{
-						if (m_DownloadFile.empty())  // cache mode
-						{
-							if (!m_DownloadedFile.empty())
-							{
-								// Delete old downloaded file
-								DeleteFile(m_DownloadedFile.c_str());
-							}
-						}
-						m_DownloadedFile.clear();
-					}
-					LeaveCriticalSection(&g_CriticalSection);
+					ClearResult();
 				}
 
 				// Update the references
-				auto i = g_Measures.begin();
-				std::wstring compareStr = L"[";
-				compareStr += GetOriginalName();
-				compareStr += L']';
-				for ( ; i != g_Measures.end(); ++i)
+				if (const auto* children = g_Children.Find(GetSkin(), GetOriginalName()))
 				{
-					if (GetSkin() == (*i)->GetSkin() &&
-						StringUtil::CaseInsensitiveFind((*i)->m_Url, compareStr) != std::wstring::npos)
+					const size_t referenceLength = GetOriginalName().length() + 2;  // [Name]
+					for (const auto& reference : *children)
 					{
-						if ((*i)->m_StringIndex < rc)
+						// Pending parses of the child are outdated.
+						MeasureWebParser* child = reference.measure;
+						const UINT childSequence = ++child->m_ParseSequence;
+						child->m_ParseResult = PARSE_NONE;
+						if (child->m_StringIndex < rc)
 						{
-							const WCHAR* match = data + ovector[2 * (*i)->m_StringIndex];
-							int matchLen = ovector[2 * (*i)->m_StringIndex + 1] - ovector[2 * (*i)->m_StringIndex];
-							if (!(*i)->m_RegExp.empty())
+							const WCHAR* match = data + ovector[2 * child->m_StringIndex];
+							int matchLen = ovector[2 * child->m_StringIndex + 1] - ovector[2 * child->m_StringIndex];
+							if (!child->m_RegExp.empty())
 							{
-								// Change the index and parse the substring
-								int index = (*i)->m_StringIndex;
-								(*i)->m_StringIndex = (*i)->m_StringIndex2;
-								(*i)->ParseData((BYTE*)match, matchLen * 2, true);
-								(*i)->m_StringIndex = index;
+								// Parse the substring with the second index on a worker thread. The
+								// FinishAction of this measure is run after all of the children.
+								if (!finishAction && !m_Download && !m_FinishAction.empty())
+								{
+									finishAction = std::make_shared<PendingFinishAction>(m_FinishAction, GetSkin());
+								}
+
+								std::wstring substring(match, matchLen);
+								WebFetchPool::Run(child,
+									[child, childSequence, substring = std::move(substring), finishAction](const volatile bool& cancelled)
+								{
+									if (cancelled) return;
+
+									child->ParseData((const BYTE*)substring.c_str(), (DWORD)substring.length() * 2,
+										child->m_StringIndex2, true, childSequence);
+								});
 							}
 							else
 							{
-								// Set the result
-								EnterCriticalSection(&g_CriticalSection);
-
 								// Substitude the [measure] with result
-								(*i)->m_ResultString = (*i)->m_Url;
-								(*i)->m_ResultString.replace(
-									StringUtil::CaseInsensitiveFind((*i)->m_ResultString, compareStr),
-									compareStr.size(), match, matchLen);
-								CharacterEntityReference::Decode((*i)->m_ResultString, (*i)->m_DecodeCharacterReference);
-
-								// Start download threads for the references
-								if ((*i)->m_Download)
+								child->m_ResultString = child->m_Url;
+								child->m_ResultString.replace(reference.offset, referenceLength, match, matchLen);
+								CharacterEntityReference::Decode(child->m_ResultString, child->m_DecodeCharacterReference);
+
+								// Start downloads for the references
+								if (child->m_Download)
 								{
-									// Start the download thread
-									unsigned int id;
-									HANDLE threadHandle = (HANDLE)_beginthreadex(nullptr, 0, NetworkDownloadThreadProc, (*i), 0, &id);
-									if (threadHandle)
-									{
-										(*i)->m_DlThreadHandle = threadHandle;
-									}
+									child->StartDownload();
 								}
-
-								LeaveCriticalSection(&g_CriticalSection);
 							}
 						}
 						else
 						{
-							if (m_LogSubstringErrors) LogWarningF(*i, L"Not enough substrings");
+							if (m_LogSubstringErrors) LogWarningF(child, L"Not enough substrings");
 
 							// Clear the old result
-							EnterCriticalSection(&g_CriticalSection);
-							(*i)->m_ResultString.clear();
-							if ((*i)->m_Download)
-							{
-								if ((*i)->m_DownloadFile.empty())  // cache mode
-								{
-									if (!(*i)->m_DownloadedFile.empty())
-									{
-										// Delete old downloaded file
-										DeleteFile((*i)->m_DownloadedFile.c_str());
-									}
-								}
-								(*i)->m_DownloadedFile.clear();
-							}
-							LeaveCriticalSection(&g_CriticalSection);
+							child->ClearResult();
 						}
 					}
 				}
+				LeaveCriticalSection(&g_CriticalSection);
 			}
 		}
 		else
 		{
 			// Matching failed: handle error cases
 			LogErrorF(this, L"RegExp matching error (%d)", rc);
-			doErrorAction = true;
 
 			EnterCriticalSection(&g_CriticalSection);
+			if (sequence != 0 && sequence != m_ParseSequence)
+			{
+				LeaveCriticalSection(&g_CriticalSection);
+				return;
+			}
+
+			doErrorAction = true;
 			m_ResultString = m_ErrorString;
 
 			// Update the references
-			auto i = g_Measures.begin();
-			std::wstring compareStr = L"[";
-			compareStr += GetOriginalName();
-			compareStr += L']';
-			for ( ; i != g_Measures.end(); ++i)
+			if (const auto* children = g_Children.Find(GetSkin(), GetOriginalName()))
 			{
-				if ((StringUtil::CaseInsensitiveFind((*i)->m_Url, compareStr) != std::wstring::npos) &&
-					(GetSkin() == (*i)->GetSkin()))
+				for (const auto& reference : *children)
 				{
-					(*i)->m_ResultString = (*i)->m_ErrorString;
+					++reference.measure->m_ParseSequence;
+					reference.measure->m_ParseResult = PARSE_NONE;
+					reference.measure->m_ResultString = reference.measure->m_ErrorString;
 				}
 			}
 			LeaveCriticalSection(&g_CriticalSection);
 		}
-
-		// Release memory used for the compiled pattern
-		pcre16_free(re);
 	}
 	else
 	{
 		// Compilation failed.
-		LogErrorF(this, L"RegExp error at offset %d: %S", erroffset, error);
+		LogErrorF(this, L"RegExp error at offset %d: %S", re->GetErrorOffset(), re->GetError());
 		doErrorAction = true;
 	}
 
+	EnterCriticalSection(&g_CriticalSection);
+	m_ParseResult = doErrorAction ? PARSE_ERROR : PARSE_OK;
+	LeaveCriticalSection(&g_CriticalSection);
+
 	if (m_Download)
 	{
-		// Start the download thread
-		unsigned int id;
-		HANDLE threadHandle = (HANDLE)_beginthreadex(nullptr, 0, NetworkDownloadThreadProc, this, 0, &id);
-		if (threadHandle)
+		StartDownload();
+	}
+
+	if (doErrorAction && !m_OnRegExpErrAction.empty())
+	{
+		GetRainmeter().DelayedExecuteCommand(m_OnRegExpErrAction.c_str(), GetSkin());
+	}
+	else if (!m_Download && !m_FinishAction.empty() && !finishAction)
+	{
+		GetRainmeter().DelayedExecuteCommand(m_FinishAction.c_str(), GetSkin());
+	}
+}
+
+/*
+** Runs the actions and starts the downloads of the last ParseData() of this measure and of the
+** measures that reference it again. Used instead of parsing when the page has not changed. The
+** FinishAction of this measure is run after those of the children.
+**
+*/
+void MeasureWebParser::RepeatParseActions()
+{
+	std::vector<MeasureWebParser*> parsedChildren;
+	std::vector<MeasureWebParser*> downloadChildren;
+
+	EnterCriticalSection(&g_CriticalSection);
+	const PARSE_RESULT result = m_ParseResult;
+	if (const auto* children = g_Children.Find(GetSkin(), GetOriginalName()))
+	{
+		for (const auto& reference : *children)
 		{
-			m_DlThreadHandle = threadHandle;
+			MeasureWebParser* child = reference.measure;
+			if (!child->m_RegExp.empty())
+			{
+				if (child->m_ParseResult != PARSE_NONE) parsedChildren.push_back(child);
+			}
+			else if (child->m_Download && !child->m_ResultString.empty())
+			{
+				downloadChildren.push_back(child);
+			}
 		}
 	}
+	LeaveCriticalSection(&g_CriticalSection);
 
-	if (doErrorAction && !m_OnRegExpErrAction.empty())
+	for (MeasureWebParser* child : parsedChildren)
+	{
+		child->RepeatParseActions();
+	}
+
+	for (MeasureWebParser* child : downloadChildren)
+	{
+		child->StartDownload();
+	}
+
+	if (m_Download)
+	{
+		StartDownload();
+	}
+
+	if (result == PARSE_ERROR && !m_OnRegExpErrAction.empty())
 	{
 		GetRainmeter().DelayedExecuteCommand(m_OnRegExpErrAction.c_str(), GetSkin());
 	}
@@ -757,10 +908,31 @@ void MeasureWebParser::ParseData(const BYTE* rawData, DWORD rawSize, bool utf16D
 	}
 }
 
+/*
+** Clears the result and deletes the downloaded file in cache mode. Must be called in the critical
+** section.
+**
+*/
+void MeasureWebParser::ClearResult()
+{
+	m_ResultString.clear();
+	if (m_Download)
+	{
+		if (m_DownloadFile.empty())  // cache mode
+		{
+			if (!m_DownloadedFile.empty())
+			{
+				// Delete old downloaded file
+				DeleteFile(m_DownloadedFile.c_str());
+			}
+		}
+		m_DownloadedFile.clear();
+	}
+}
+
 // Downloads file from the net
-unsigned __stdcall MeasureWebParser::NetworkDownloadThreadProc(void* pParam)
+void MeasureWebParser::Download(MeasureWebParser* measure, const volatile bool& cancelled)
 {
-	auto* measure = (MeasureWebParser*)pParam;
 	const bool download = !measure->m_DownloadFile.empty();
 	bool ready = false;
 
@@ -990,7 +1162,8 @@ unsigned __stdcall MeasureWebParser::NetworkDownloadThreadProc(void* pParam)
 			HRESULT resultCoInitialize = CoInitialize(nullptr);  // requires before calling URLDownloadToFile function
 
 			// Download the file
-			HRESULT result = URLDownloadToFile(nullptr, url.c_str(), fullpath.c_str(), 0, nullptr);
+			DownloadCallback callback(cancelled);
+			HRESULT result = URLDownloadToFile(nullptr, url.c_str(), fullpath.c_str(), 0, &callback);
 			if (result == S_OK)
 			{
 				EnterCriticalSection(&g_CriticalSection);
@@ -1079,90 +1252,15 @@ unsigned __stdcall MeasureWebParser::NetworkDownloadThreadProc(void* pParam)
 		// Clear old downloaded filename
 		measure->m_DownloadedFile.clear();
 
+		// Parse the page again on the next fetch to retry the download.
+		++g_ParseGeneration;
+
 		LeaveCriticalSection(&g_CriticalSection);
 	}
 
 	EnterCriticalSection(&g_CriticalSection);
-	CloseHandle(measure->m_DlThreadHandle);
-	measure->m_DlThreadHandle = 0;
+	measure->m_Downloading = false;
 	LeaveCriticalSection(&g_CriticalSection);
-
-	return 0;   // thread completed successfully
-}
-
-/*
-	Downloads the given url and returns the webpage as dynamically allocated string.
-	You need to free the returned string after use!
-*/
-BYTE* DownloadUrl(HINTERNET handle, std::wstring& url, std::wstring& headers, DWORD* dataSize, bool forceReload)
-{
-	if (_wcsnicmp(url.c_str(), L"file://", 7) == 0)  // Local file
-	{
-		WCHAR path[MAX_PATH];
-		DWORD pathLength = _countof(path);
-		HRESULT hr = PathCreateFromUrl(url.c_str(), path, &pathLength, 0);
-		if (FAILED(hr))
-		{
-			return nullptr;
-		}
-		
-		size_t fileSize = 0;
-		BYTE* buffer = FileUtil::ReadFullFile(path, &fileSize).release();
-		*dataSize = (DWORD)fileSize;
-
-		return buffer;
-	}
-
-	DWORD flags = INTERNET_FLAG_RESYNCHRONIZE;
-	if (forceReload)
-	{
-		flags = INTERNET_FLAG_RELOAD;
-	}
-
-	HINTERNET hUrlDump = InternetOpenUrl(handle, url.c_str(), headers.c_str(), -1L, flags, 0);
-	if (!hUrlDump)
-	{
-		return nullptr;
-	}
-
-	// Allocate buffer with 3 extra bytes for triple null termination in case the string is
-	// invalid (e.g. when incorrectly using the UTF-16LE codepage for the data).
-	const int CHUNK_SIZE = 8192;
-	DWORD bufferSize = CHUNK_SIZE;
-	BYTE* buffer = (BYTE*)malloc(bufferSize + 3);
-	*dataSize = 0;
-
-	// Read the data.
-	do
-	{
-		DWORD readSize;
-		if (!InternetReadFile(hUrlDump, buffer + *dataSize, bufferSize - *dataSize, &readSize))
-		{
-			free(buffer);
-			InternetCloseHandle(hUrlDump);
-			return nullptr;
-		}
-		else if (readSize == 0)
-		{
-			// All data read.
-			break;
-		}
-
-		*dataSize += readSize;
-
-		bufferSize += CHUNK_SIZE;
-		buffer = (BYTE*)realloc(buffer, bufferSize + 3);
-	}
-	while (true);
-
-	InternetCloseHandle(hUrlDump);
-
-	// Triple null terminate the buffer.
-	buffer[*dataSize] = 0;
-	buffer[*dataSize + 1] = 0;
-	buffer[*dataSize + 2] = 0;
-
-	return buffer;
 }
 
 /*
@@ -1213,30 +1311,12 @@ void MeasureWebParser::Command(const std::wstring& command)
 {
 	const WCHAR* args = command.c_str();
 
-	// Kill the threads (if any) and reset the update counter
+	// Cancel the transfers (if any) and reset the update counter
 	if (_wcsicmp(args, L"UPDATE") == 0)
 	{
-		if (m_ThreadHandle)
-		{
-			// Thread is killed inside critical section so that itself is not inside one when it is terminated
-			EnterCriticalSection(&g_CriticalSection);
-
-			TerminateThread(m_ThreadHandle, 0);
-			m_ThreadHandle = nullptr;
-
-			LeaveCriticalSection(&g_CriticalSection);
-		}
-
-		if (m_DlThreadHandle)
-		{
-			// Thread is killed inside critical section so that itself is not inside one when it is terminated
-			EnterCriticalSection(&g_CriticalSection);
-
-			TerminateThread(m_DlThreadHandle, 0);
-			m_DlThreadHandle = nullptr;
-
-			LeaveCriticalSection(&g_CriticalSection);
-		}
+		WebFetchPool::Cancel(this);
+		m_Fetching = false;
+		m_Downloading = false;
 
 		m_UpdateCounter = 0;
 	}
@@ -1247,18 +1327,17 @@ void MeasureWebParser::Command(const std::wstring& command)
 
 		EnterCriticalSection(&g_CriticalSection);
 
+		// Parse the next response even if it has not changed.
+		++g_ParseGeneration;
+
 		// Update the references
-		auto i = g_Measures.begin();
-		std::wstring compareStr = L"[";
-		compareStr += GetOriginalName();
-		compareStr += L']';
-		for (; i != g_Measures.end(); ++i)
+		if (const auto* children = g_Children.Find(GetSkin(), GetOriginalName()))
 		{
-			if ((StringUtil::CaseInsensitiveFind((*i)->m_Url, compareStr) != std::wstring::npos) &&
-				(GetSkin() == (*i)->GetSkin()))
+			for (const auto& reference : *children)
 			{
-				(*i)->m_ResultString.clear();
-				(*i)->m_DownloadedFile.clear();
+				++reference.measure->m_ParseSequence;
+				reference.measure->m_ResultString.clear();
+				reference.measure->m_DownloadedFile.clear();
 			}
 		}
 		LeaveCriticalSection(&g_CriticalSection);
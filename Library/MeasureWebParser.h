@@ -9,6 +9,8 @@
 #define RM_LIBRARY_MEASUREWEBPARSER_H_
 
 #include "Measure.h"
+#include "RegExp.h"
+#include "WebFetchPool.h"
 
 struct ProxySetting
 {
@@ -38,12 +40,24 @@ protected:
 	void Command(const std::wstring& command) override;
 
 private:
-	static unsigned __stdcall NetworkThreadProc(void* pParam);
-	static unsigned __stdcall NetworkDownloadThreadProc(void* pParam);
-	void ParseData(const BYTE* rawData, DWORD rawSize, bool utf16Data = false);
+	enum PARSE_RESULT
+	{
+		PARSE_NONE,		// Not parsed, e.g. the parent did not have enough substrings
+		PARSE_OK,
+		PARSE_ERROR		// OnRegExpErrorAction was due
+	};
+
+	void StartFetch();
+	void StartDownload();
+	static void FetchFinished(MeasureWebParser* measure, const WebFetchPool::Response& response);
+	static void Download(MeasureWebParser* measure, const volatile bool& cancelled);
+	void ParseData(const BYTE* rawData, DWORD rawSize, int stringIndex, bool utf16Data = false, UINT sequence = 0);
+	void RepeatParseActions();
+	void ClearResult();
 
 	std::wstring m_Url;
 	std::wstring m_RegExp;
+	std::shared_ptr<const RegExp> m_CompiledRegExp;
 	std::wstring m_ResultString;
 	std::wstring m_ErrorString;
 	std::wstring m_FinishAction;
@@ -56,8 +70,12 @@ private:
 	std::wstring m_DebugFileLocation;
 	std::wstring m_Headers;
 	ProxySetting m_Proxy;
-	HANDLE m_ThreadHandle;
-	HANDLE m_DlThreadHandle;
+	bool m_Fetching;
+	bool m_Downloading;
+	UINT64 m_ParsedHash;
+	UINT m_ParsedGeneration;
+	UINT m_ParseSequence;	// Incremented by the parent to discard its older results
+	PARSE_RESULT m_ParseResult;
 	int m_Codepage;
 	int m_StringIndex;
 	int m_StringIndex2;
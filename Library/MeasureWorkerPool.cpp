@@ -0,0 +1,141 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "MeasureWorkerPool.h"
+#include "Measure.h"
+#include "System.h"
+
+namespace {
+
+// Measures are mostly waiting for I/O, so a few threads are enough even with many skins.
+const DWORD MAX_WORKER_THREADS = 4;
+
+}  // namespace
+
+CRITICAL_SECTION MeasureWorkerPool::c_CriticalSection;
+CONDITION_VARIABLE MeasureWorkerPool::c_QueueChanged;
+CONDITION_VARIABLE MeasureWorkerPool::c_UpdateFinished;
+std::deque<Measure*> MeasureWorkerPool::c_Queue;
+std::vector<Measure*> MeasureWorkerPool::c_Running;
+std::vector<HANDLE> MeasureWorkerPool::c_Threads;
+bool MeasureWorkerPool::c_Exit = false;
+
+void MeasureWorkerPool::InitializeStatic()
+{
+	System::InitializeCriticalSection(&c_CriticalSection);
+	InitializeConditionVariable(&c_QueueChanged);
+	InitializeConditionVariable(&c_UpdateFinished);
+}
+
+/*
+** Stops the worker threads. All measures must have been cancelled (i.e. deleted) before this.
+**
+*/
+void MeasureWorkerPool::FinalizeStatic()
+{
+	EnterCriticalSection(&c_CriticalSection);
+	c_Exit = true;
+	c_Queue.clear();
+	WakeAllConditionVariable(&c_QueueChanged);
+	LeaveCriticalSection(&c_CriticalSection);
+
+	for (HANDLE thread : c_Threads)
+	{
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+	c_Threads.clear();
+
+	DeleteCriticalSection(&c_CriticalSection);
+}
+
+void MeasureWorkerPool::Queue(Measure* measure)
+{
+	EnterCriticalSection(&c_CriticalSection);
+
+	measure->m_AsyncState = Measure::ASYNC_PENDING;
+	c_Queue.push_back(measure);
+
+	// Start another thread if all of the threads are busy.
+	if (c_Threads.size() < MAX_WORKER_THREADS && c_Running.size() + c_Queue.size() > c_Threads.size())
+	{
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+		if (c_Threads.size() < systemInfo.dwNumberOfProcessors)
+		{
+			HANDLE thread = (HANDLE)_beginthreadex(nullptr, 0, WorkerThreadProc, nullptr, 0, nullptr);
+			if (thread)
+			{
+				c_Threads.push_back(thread);
+			}
+		}
+	}
+
+	WakeConditionVariable(&c_QueueChanged);
+	LeaveCriticalSection(&c_CriticalSection);
+}
+
+void MeasureWorkerPool::Cancel(Measure* measure)
+{
+	EnterCriticalSection(&c_CriticalSection);
+
+	auto iter = std::find(c_Queue.begin(), c_Queue.end(), measure);
+	if (iter != c_Queue.end())
+	{
+		c_Queue.erase(iter);
+		measure->m_AsyncState = Measure::ASYNC_IDLE;
+	}
+
+	while (std::find(c_Running.cbegin(), c_Running.cend(), measure) != c_Running.cend())
+	{
+		// Sent messages are processed while waiting in case the update sends a message to the UI
+		// thread, which would otherwise deadlock.
+		LeaveCriticalSection(&c_CriticalSection);
+		MSG msg;
+		PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+		EnterCriticalSection(&c_CriticalSection);
+
+		SleepConditionVariableCS(&c_UpdateFinished, &c_CriticalSection, 10);
+	}
+
+	LeaveCriticalSection(&c_CriticalSection);
+}
+
+unsigned __stdcall MeasureWorkerPool::WorkerThreadProc(void* param)
+{
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	EnterCriticalSection(&c_CriticalSection);
+	while (true)
+	{
+		while (!c_Exit && c_Queue.empty())
+		{
+			SleepConditionVariableCS(&c_QueueChanged, &c_CriticalSection, INFINITE);
+		}
+
+		if (c_Exit) break;
+
+		Measure* measure = c_Queue.front();
+		c_Queue.pop_front();
+		c_Running.push_back(measure);
+		LeaveCriticalSection(&c_CriticalSection);
+
+		measure->UpdateValue();
+
+		EnterCriticalSection(&c_CriticalSection);
+		c_Running.erase(std::find(c_Running.begin(), c_Running.end(), measure));
+
+		// The UI thread applies the new value on the next Measure::Update() after this.
+		measure->m_AsyncState = Measure::ASYNC_DONE;
+		WakeAllConditionVariable(&c_UpdateFinished);
+	}
+	LeaveCriticalSection(&c_CriticalSection);
+
+	CoUninitialize();
+	return 0;
+}
@@ -0,0 +1,50 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_MEASUREWORKERPOOL_H_
+#define RM_LIBRARY_MEASUREWORKERPOOL_H_
+
+#include <windows.h>
+#include <deque>
+#include <vector>
+
+class Measure;
+
+// Threads shared by all skins that call Measure::UpdateValue() of the measures with Async=1. The
+// threads are created when the first measure is queued. Measure::Update() queues a measure and
+// applies the result of the update on the next call after the worker has finished, so the UI
+// thread never waits for a slow measure.
+class MeasureWorkerPool
+{
+public:
+	static void InitializeStatic();
+	static void FinalizeStatic();
+
+	// Queues |measure| to be updated on a worker thread.
+	static void Queue(Measure* measure);
+
+	// Removes |measure| from the queue or, if it is being updated, waits for the update to finish.
+	static void Cancel(Measure* measure);
+
+private:
+	static unsigned __stdcall WorkerThreadProc(void* param);
+
+	static CRITICAL_SECTION c_CriticalSection;
+
+	// Signaled when a measure is queued or the threads need to exit.
+	static CONDITION_VARIABLE c_QueueChanged;
+
+	// Signaled when a worker has finished updating a measure.
+	static CONDITION_VARIABLE c_UpdateFinished;
+
+	static std::deque<Measure*> c_Queue;
+	static std::vector<Measure*> c_Running;
+	static std::vector<HANDLE> c_Threads;
+	static bool c_Exit;
+};
+
+#endif
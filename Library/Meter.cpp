@@ -47,7 +47,9 @@ Meter::Meter(Skin* skin, const WCHAR* name) : Section(skin, name),
 	m_SolidAngle(),
 	m_Padding(),
 	m_AntiAlias(false),
-	m_Initialized(false)
+	m_Initialized(false),
+	m_DrawnBounds(),
+	m_Damaged(true)
 {
 }
 
@@ -165,6 +167,46 @@ Gdiplus::Rect Meter::GetMeterRectPadding()
 	return meterRect;
 }
 
+/*
+** Returns the area painted by Draw(). A margin is included for antialiasing and text effects.
+**
+*/
+Gdiplus::Rect Meter::GetDrawBounds()
+{
+	if (IsHidden() || m_W <= 0 || m_H <= 0) return Rect();
+
+	const int margin = 2;
+	Rect bounds(GetX() - margin, GetY() - margin, m_W + margin * 2, m_H + margin * 2);
+
+	if (m_Transformation && !m_Transformation->IsIdentity())
+	{
+		PointF points[4] =
+		{
+			PointF((REAL)bounds.GetLeft(), (REAL)bounds.GetTop()),
+			PointF((REAL)bounds.GetRight(), (REAL)bounds.GetTop()),
+			PointF((REAL)bounds.GetLeft(), (REAL)bounds.GetBottom()),
+			PointF((REAL)bounds.GetRight(), (REAL)bounds.GetBottom())
+		};
+		m_Transformation->TransformPoints(points, 4);
+
+		REAL left = points[0].X, top = points[0].Y, right = points[0].X, bottom = points[0].Y;
+		for (int i = 1; i < 4; ++i)
+		{
+			left = min(left, points[i].X);
+			top = min(top, points[i].Y);
+			right = max(right, points[i].X);
+			bottom = max(bottom, points[i].Y);
+		}
+
+		bounds.X = (int)floor(left);
+		bounds.Y = (int)floor(top);
+		bounds.Width = (int)ceil(right) - bounds.X;
+		bounds.Height = (int)ceil(bottom) - bounds.Y;
+	}
+
+	return bounds;
+}
+
 /*
 ** Checks if the given point is inside the meter.
 ** This function doesn't check Hidden state, so check it before calling this function if needed.
@@ -213,6 +255,24 @@ void Meter::Hide()
 	}
 }
 
+/*
+** Reads the options and records what they depend on.
+**
+*/
+void Meter::ReadOptions(ConfigParser& parser)
+{
+	PROFILE_SCOPE(m_Profile.readOptions);
+
+	parser.BeginDependencies(m_Dependencies);
+	ReadOptions(parser, GetName());
+	parser.EndDependencies();
+
+	parser.ClearStyleTemplate();
+
+	// Any of the colors or other options may have changed.
+	SetDamaged();
+}
+
 /*
 ** Read the common options specified in the ini file. The inherited classes must
 ** call this base implementation if they overwrite this method.
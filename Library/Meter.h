@@ -28,7 +28,7 @@ public:
 
 	Meter(const Meter& other) = delete;
 
-	void ReadOptions(ConfigParser& parser) { ReadOptions(parser, GetName()); parser.ClearStyleTemplate(); }
+	void ReadOptions(ConfigParser& parser);
 
 	virtual void Initialize();
 	virtual bool Update();
@@ -69,6 +69,22 @@ public:
 
 	const Gdiplus::Matrix* GetTransformationMatrix() { return m_Transformation; }
 
+	// Returns the area painted by Draw() in skin coordinates. Empty if the meter is hidden.
+	Gdiplus::Rect GetDrawBounds();
+
+	// Meters that may paint outside of GetDrawBounds() are drawn on every redraw and a change to
+	// them causes the whole skin to be redrawn.
+	virtual bool IsDrawnWithinBounds() { return true; }
+
+	// The contents are damaged when the options have been read or Update() has changed the output
+	// after the last draw. Changes of the position, size and visibility are found by comparing the
+	// drawn bounds.
+	void SetDamaged() { m_Damaged = true; }
+	bool IsDamaged() { return m_Damaged; }
+
+	const Gdiplus::Rect& GetDrawnBounds() { return m_DrawnBounds; }
+	void SetDrawnBounds(const Gdiplus::Rect& bounds) { m_DrawnBounds = bounds; m_Damaged = false; }
+
 	virtual bool HitTest(int x, int y);
 
 	void SetMouseOver(bool over) { m_MouseOver = over; }
@@ -147,6 +163,9 @@ protected:
 	Gdiplus::Rect m_Padding;
 	bool m_AntiAlias;
 	bool m_Initialized;
+
+	Gdiplus::Rect m_DrawnBounds;
+	bool m_Damaged;
 };
 
 #endif
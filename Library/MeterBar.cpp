@@ -127,7 +127,12 @@ bool MeterBar::Update()
 {
 	if (Meter::Update() && !m_Measures.empty())
 	{
-		m_Value = m_Measures[0]->GetRelativeValue();
+		const double value = m_Measures[0]->GetRelativeValue();
+		if (value != m_Value)
+		{
+			m_Value = value;
+			SetDamaged();
+		}
 		return true;
 	}
 	return false;
@@ -159,26 +164,26 @@ bool MeterBar::Draw(Gfx::Canvas& canvas)
 				if (m_Border > 0)
 				{
 					Rect r2(meterRect.X, meterRect.Y, meterRect.Width, m_Border);
-					canvas.DrawBitmap(drawBitmap, r2, Rect(0, 0, meterRect.Width, m_Border));
+					canvas.DrawBitmap(drawBitmap, r2, Rect(0, 0, meterRect.Width, m_Border), m_Image.GetGeneration());
 					r2.Y = meterRect.Y + size + m_Border;
-					canvas.DrawBitmap(drawBitmap, r2, Rect(0, meterRect.Height - m_Border, meterRect.Width, m_Border));
+					canvas.DrawBitmap(drawBitmap, r2, Rect(0, meterRect.Height - m_Border, meterRect.Width, m_Border), m_Image.GetGeneration());
 				}
 
 				Rect r(meterRect.X, meterRect.Y + m_Border, meterRect.Width, size);
-				canvas.DrawBitmap(drawBitmap, r, Rect(0, m_Border, meterRect.Width, size));
+				canvas.DrawBitmap(drawBitmap, r, Rect(0, m_Border, meterRect.Width, size), m_Image.GetGeneration());
 			}
 			else
 			{
 				if (m_Border > 0)
 				{
 					Rect r2(meterRect.X, meterRect.Y + meterRect.Height - size - 2 * m_Border, meterRect.Width, m_Border);
-					canvas.DrawBitmap(drawBitmap, r2, Rect(0, 0, meterRect.Width, m_Border));
+					canvas.DrawBitmap(drawBitmap, r2, Rect(0, 0, meterRect.Width, m_Border), m_Image.GetGeneration());
 					r2.Y = meterRect.Y + meterRect.Height - m_Border;
-					canvas.DrawBitmap(drawBitmap, r2, Rect(0, meterRect.Height - m_Border, meterRect.Width, m_Border));
+					canvas.DrawBitmap(drawBitmap, r2, Rect(0, meterRect.Height - m_Border, meterRect.Width, m_Border), m_Image.GetGeneration());
 				}
 
 				Rect r(meterRect.X, meterRect.Y + meterRect.Height - size - m_Border, meterRect.Width, size);
-				canvas.DrawBitmap(drawBitmap, r, Rect(0, meterRect.Height - size - m_Border, meterRect.Width, size));
+				canvas.DrawBitmap(drawBitmap, r, Rect(0, meterRect.Height - size - m_Border, meterRect.Width, size), m_Image.GetGeneration());
 			}
 		}
 		else
@@ -210,26 +215,26 @@ bool MeterBar::Draw(Gfx::Canvas& canvas)
 				if (m_Border > 0)
 				{
 					Rect r2(meterRect.X + meterRect.Width - size - 2 * m_Border, meterRect.Y, m_Border, meterRect.Height);
-					canvas.DrawBitmap(drawBitmap, r2, Rect(0, 0, m_Border, meterRect.Height));
+					canvas.DrawBitmap(drawBitmap, r2, Rect(0, 0, m_Border, meterRect.Height), m_Image.GetGeneration());
 					r2.X = meterRect.X + meterRect.Width - m_Border;
-					canvas.DrawBitmap(drawBitmap, r2, Rect(meterRect.Width - m_Border, 0, m_Border, meterRect.Height));
+					canvas.DrawBitmap(drawBitmap, r2, Rect(meterRect.Width - m_Border, 0, m_Border, meterRect.Height), m_Image.GetGeneration());
 				}
 
 				Rect r(meterRect.X + meterRect.Width - size - m_Border, meterRect.Y, size, meterRect.Height);
-				canvas.DrawBitmap(drawBitmap, r, Rect(meterRect.Width - size - m_Border, 0, size, meterRect.Height));
+				canvas.DrawBitmap(drawBitmap, r, Rect(meterRect.Width - size - m_Border, 0, size, meterRect.Height), m_Image.GetGeneration());
 			}
 			else
 			{
 				if (m_Border > 0)
 				{
 					Rect r2(meterRect.X, meterRect.Y, m_Border, meterRect.Height);
-					canvas.DrawBitmap(drawBitmap, r2, Rect(0, 0, m_Border, meterRect.Height));
+					canvas.DrawBitmap(drawBitmap, r2, Rect(0, 0, m_Border, meterRect.Height), m_Image.GetGeneration());
 					r2.X = meterRect.X + size + m_Border;
-					canvas.DrawBitmap(drawBitmap, r2, Rect(meterRect.Width - m_Border, 0, m_Border, meterRect.Height));
+					canvas.DrawBitmap(drawBitmap, r2, Rect(meterRect.Width - m_Border, 0, m_Border, meterRect.Height), m_Image.GetGeneration());
 				}
 
 				Rect r(meterRect.X + m_Border, meterRect.Y, size, meterRect.Height);
-				canvas.DrawBitmap(drawBitmap, r, Rect(m_Border, 0, size, meterRect.Height));
+				canvas.DrawBitmap(drawBitmap, r, Rect(m_Border, 0, size, meterRect.Height), m_Image.GetGeneration());
 			}
 		}
 		else
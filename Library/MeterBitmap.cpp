@@ -243,7 +243,11 @@ bool MeterBitmap::Update()
 			}
 		}
 
-		m_Value = value;
+		if (value != m_Value)
+		{
+			m_Value = value;
+			SetDamaged();
+		}
 
 		return true;
 	}
@@ -275,7 +279,9 @@ bool MeterBitmap::Draw(Gfx::Canvas& canvas)
 
 	if (m_FrameCount == 0 || !m_Image.IsLoaded()) return false;	// Unable to continue
 
+	// The frames are drawn as parts of the whole image so that it is only uploaded once.
 	Bitmap* bitmap = m_Image.GetImage();
+	const UINT generation = m_Image.GetGeneration();
 
 	Gdiplus::Rect meterRect = GetMeterRectPadding();
 
@@ -390,7 +396,7 @@ bool MeterBitmap::Draw(Gfx::Canvas& canvas)
 				newY = 0;
 			}
 
-			canvas.DrawBitmap(bitmap, Rect(meterRect.X + offset, meterRect.Y, meterRect.Width, meterRect.Height), Rect(newX, newY, meterRect.Width, meterRect.Height));
+			canvas.DrawBitmap(bitmap, Rect(meterRect.X + offset, meterRect.Y, meterRect.Width, meterRect.Height), Rect(newX, newY, meterRect.Width, meterRect.Height), generation);
 			if (m_FrameCount == 1)
 			{
 				value /= 2;
@@ -459,7 +465,7 @@ bool MeterBitmap::Draw(Gfx::Canvas& canvas)
 			newY = 0;
 		}
 
-		canvas.DrawBitmap(bitmap, Rect(meterRect.X, meterRect.Y, meterRect.Width, meterRect.Height), Rect(newX, newY, meterRect.Width, meterRect.Height));
+		canvas.DrawBitmap(bitmap, Rect(meterRect.X, meterRect.Y, meterRect.Width, meterRect.Height), Rect(newX, newY, meterRect.Width, meterRect.Height), generation);
 	}
 
 	return true;
@@ -23,7 +23,6 @@ enum BUTTON_STATE
 MeterButton::MeterButton(Skin* skin, const WCHAR* name) : Meter(skin, name),
 	m_Image(L"ButtonImage", nullptr, true, skin),
 	m_NeedsReload(false),
-	m_Bitmaps(),
 	m_State(BUTTON_STATE_NORMAL),
 	m_Clicked(false),
 	m_Focus(false)
@@ -32,10 +31,6 @@ MeterButton::MeterButton(Skin* skin, const WCHAR* name) : Meter(skin, name),
 
 MeterButton::~MeterButton()
 {
-	for (int i = 0; i < BUTTON_FRAMES; ++i)
-	{
-		delete m_Bitmaps[i];
-	}
 }
 
 /*
@@ -46,12 +41,6 @@ void MeterButton::Initialize()
 {
 	Meter::Initialize();
 
-	for (int i = 0; i < BUTTON_FRAMES; ++i)
-	{
-		delete m_Bitmaps[i];
-		m_Bitmaps[i] = nullptr;
-	}
-
 	// Load the bitmaps if defined
 	if (!m_ImageName.empty())
 	{
@@ -67,6 +56,7 @@ void MeterButton::Initialize()
 			m_W = bitmapW;
 			m_H = bitmapH;
 
+			// The frames are drawn directly from the image in Draw().
 			if (m_H > m_W)
 			{
 				m_H /= BUTTON_FRAMES;
@@ -76,24 +66,6 @@ void MeterButton::Initialize()
 				m_W /= BUTTON_FRAMES;
 			}
 
-			// Separate the frames
-			for (int i = 0; i < BUTTON_FRAMES; ++i)
-			{
-				Bitmap bitmapPart(m_W, m_H, PixelFormat32bppPARGB);
-				Graphics graphics(&bitmapPart);
-				Rect r(0, 0, m_W, m_H);
-
-				if (bitmapH > bitmapW)
-				{
-					graphics.DrawImage(bitmap, r, 0, m_H * i, m_W, m_H, UnitPixel);
-				}
-				else
-				{
-					graphics.DrawImage(bitmap, r, m_W * i, 0, m_W, m_H, UnitPixel);
-				}
-				m_Bitmaps[i] = new CachedBitmap(&bitmapPart, &graphics);
-			}
-
 			m_W += GetWidthPadding();
 			m_H += GetHeightPadding();
 		}
@@ -165,16 +137,29 @@ bool MeterButton::Draw(Gfx::Canvas& canvas)
 {
 	if (!Meter::Draw(canvas)) return false;
 
-	if (m_Bitmaps[m_State] == nullptr) return false;	// Unable to continue
+	if (!m_Image.IsLoaded()) return false;	// Unable to continue
 
-	Gdiplus::Graphics& graphics = canvas.BeginGdiplusContext();
+	Bitmap* bitmap = m_Image.GetImage();
+	const int bitmapW = bitmap->GetWidth();
+	const int bitmapH = bitmap->GetHeight();
 
 	Gdiplus::Rect meterRect = GetMeterRectPadding();
+	const int frameW = (bitmapH > bitmapW) ? bitmapW : bitmapW / BUTTON_FRAMES;
+	const int frameH = (bitmapH > bitmapW) ? bitmapH / BUTTON_FRAMES : bitmapH;
+	if (frameW == 0 || frameH == 0) return false;
 
-	// Blit the image
-	graphics.DrawCachedBitmap(m_Bitmaps[m_State], meterRect.X, meterRect.Y);
+	// Blit the frame of the current state
+	Rect srcRect(0, 0, frameW, frameH);
+	if (bitmapH > bitmapW)
+	{
+		srcRect.Y = frameH * m_State;
+	}
+	else
+	{
+		srcRect.X = frameW * m_State;
+	}
 
-	canvas.EndGdiplusContext();
+	canvas.DrawBitmap(bitmap, Rect(meterRect.X, meterRect.Y, frameW, frameH), srcRect, m_Image.GetGeneration());
 
 	return true;
 }
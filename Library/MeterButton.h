@@ -47,7 +47,6 @@ private:
 	std::wstring m_ImageName;
 	bool m_NeedsReload;
 
-	Gdiplus::CachedBitmap* m_Bitmaps[BUTTON_FRAMES];	// Cached bitmaps
 	std::wstring m_Command;
 	int m_State;
 	bool m_Clicked;
@@ -21,7 +21,6 @@ MeterHistogram::MeterHistogram(Skin* skin, const WCHAR* name) : Meter(skin, name
 	m_PrimaryColor(Color::Green),
 	m_SecondaryColor(Color::Red),
 	m_OverlapColor(Color::Yellow),
-	m_MeterPos(),
 	m_Autoscale(false),
 	m_Flip(false),
 	m_PrimaryImage(L"PrimaryImage", c_PrimaryOptionArray, false, skin),
@@ -30,8 +29,9 @@ MeterHistogram::MeterHistogram(Skin* skin, const WCHAR* name) : Meter(skin, name
 	m_PrimaryNeedsReload(false),
 	m_SecondaryNeedsReload(false),
 	m_OverlapNeedsReload(false),
-	m_PrimaryValues(),
-	m_SecondaryValues(),
+	m_PrimaryCursor(),
+	m_SecondaryCursor(),
+	m_BufferSize(),
 	m_MaxPrimaryValue(1.0),
 	m_MinPrimaryValue(),
 	m_MaxSecondaryValue(1.0),
@@ -48,40 +48,25 @@ MeterHistogram::~MeterHistogram()
 }
 
 /*
-** Disposes the buffers.
+** Stops drawing the values.
 **
 */
 void MeterHistogram::DisposeBuffer()
 {
-	// Reset current position
-	m_MeterPos = 0;
-
-	// Delete buffers
-	delete [] m_PrimaryValues;
-	m_PrimaryValues = nullptr;
-
-	delete [] m_SecondaryValues;
-	m_SecondaryValues = nullptr;
+	m_BufferSize = 0;
 }
 
 /*
-** Creates the buffers.
+** Grows the histories to hold a value for each pixel.
 **
 */
 void MeterHistogram::CreateBuffer()
 {
-	DisposeBuffer();
-
-	// Create buffers for values
 	int maxSize = m_GraphHorizontalOrientation ? m_H : m_W;
-	if (maxSize > 0)
-	{
-		m_PrimaryValues = new double[maxSize]();
-		if (m_Measures.size() >= 2)
-		{
-			m_SecondaryValues = new double[maxSize]();
-		}
-	}
+	m_BufferSize = max(0, maxSize);
+
+	if (m_PrimaryHistory) m_PrimaryHistory->Grow(m_BufferSize);
+	if (m_SecondaryHistory) m_SecondaryHistory->Grow(m_BufferSize);
 }
 
 /*
@@ -186,6 +171,9 @@ void MeterHistogram::ReadOptions(ConfigParser& parser, const WCHAR* section)
 
 	Meter::ReadOptions(parser, section);
 
+	// The cached graph may not match the options anymore.
+	m_Cache.Invalidate();
+
 	m_PrimaryColor = parser.ReadColor(section, L"PrimaryColor", Color::Green);
 	m_SecondaryColor = parser.ReadColor(section, L"SecondaryColor", Color::Red);
 	m_OverlapColor = parser.ReadColor(section, L"BothColor", Color::Yellow);
@@ -302,24 +290,20 @@ bool MeterHistogram::Update()
 {
 	if (Meter::Update() && !m_Measures.empty())
 	{
-		int maxSize = m_GraphHorizontalOrientation ? m_H : m_W;
-
-		if (m_PrimaryValues && maxSize > 0)  // m_PrimaryValues must not be nullptr
+		if (m_PrimaryHistory && m_BufferSize > 0)
 		{
 			Measure* measure = m_Measures[0];
 			Measure* secondaryMeasure = (m_Measures.size() >= 2) ? m_Measures[1] : nullptr;
 
-			// Gather values
-			m_PrimaryValues[m_MeterPos] = measure->GetValue();
+			// Gather values. The graph scrolls with every new value.
+			m_PrimaryHistory->AddShared(measure->GetValue(), m_PrimaryCursor);
+			SetDamaged();
 
-			if (secondaryMeasure && m_SecondaryValues)
+			if (secondaryMeasure && m_SecondaryHistory)
 			{
-				m_SecondaryValues[m_MeterPos] = secondaryMeasure->GetValue();
+				m_SecondaryHistory->AddShared(secondaryMeasure->GetValue(), m_SecondaryCursor);
 			}
 
-			++m_MeterPos;
-			m_MeterPos %= maxSize;
-
 			m_MaxPrimaryValue = measure->GetMaxValue();
 			m_MinPrimaryValue = measure->GetMinValue();
 			m_MaxSecondaryValue = 0.0;
@@ -332,13 +316,7 @@ bool MeterHistogram::Update()
 
 			if (m_Autoscale)
 			{
-				// Go through all values and find the max
-
-				double newValue = 0.0;
-				for (int i = 0; i < maxSize; ++i)
-				{
-					newValue = max(newValue, m_PrimaryValues[i]);
-				}
+				double newValue = max(0.0, m_PrimaryHistory->GetMax(m_BufferSize));
 
 				// Scale the value up to nearest power of 2
 				if (newValue > DBL_MAX / 2.0)
@@ -354,12 +332,9 @@ bool MeterHistogram::Update()
 					}
 				}
 
-				if (secondaryMeasure && m_SecondaryValues)
+				if (secondaryMeasure && m_SecondaryHistory)
 				{
-					for (int i = 0; i < maxSize; ++i)
-					{
-						newValue = max(newValue, m_SecondaryValues[i]);
-					}
+					newValue = max(newValue, m_SecondaryHistory->GetMax(m_BufferSize));
 
 					// Scale the value up to nearest power of 2
 					if (newValue > DBL_MAX / 2.0)
@@ -388,12 +363,58 @@ bool MeterHistogram::Update()
 */
 bool MeterHistogram::Draw(Gfx::Canvas& canvas)
 {
-	if (!Meter::Draw(canvas) ||
-		(m_Measures.size() >= 1 && !m_PrimaryValues) ||
-		(m_Measures.size() >= 2 && !m_SecondaryValues)) return false;
+	if (!Meter::Draw(canvas) || m_BufferSize <= 0 ||
+		(m_Measures.size() >= 1 && !m_PrimaryHistory) ||
+		(m_Measures.size() >= 2 && !m_SecondaryHistory)) return false;
 
-	Gdiplus::Graphics& graphics = canvas.BeginGdiplusContext();
+	Gdiplus::Rect meterRect = GetMeterRectPadding();
 
+	// The images are painted at the current position of each column, so columns drawn with an
+	// image cannot be scrolled.
+	const bool hasImage =
+		m_PrimaryImage.IsLoaded() || m_SecondaryImage.IsLoaded() || m_OverlapImage.IsLoaded();
+
+	if (!m_Transformation && !hasImage && meterRect.Width > 0 && meterRect.Height > 0 && m_PrimaryHistory)
+	{
+		// Draw only the new values unless the scale has changed.
+		std::vector<double> scales;
+		scales.push_back(m_MaxPrimaryValue);
+		scales.push_back(m_MinPrimaryValue);
+		scales.push_back(m_MaxSecondaryValue);
+		scales.push_back(m_MinSecondaryValue);
+
+		std::vector<UINT64> addCounts;
+		addCounts.push_back(m_PrimaryHistory->GetAddCount());
+		if (m_SecondaryHistory)
+		{
+			addCounts.push_back(m_SecondaryHistory->GetAddCount());
+		}
+
+		const bool reverse = m_GraphHorizontalOrientation ? m_Flip : m_GraphStartLeft;
+		const int first = m_Cache.Prepare(meterRect.Width, meterRect.Height,
+			m_GraphHorizontalOrientation, reverse, m_AntiAlias, 0, scales, addCounts);
+
+		const Rect cacheRect(0, 0, meterRect.Width, meterRect.Height);
+		DrawValues(m_Cache.GetGraphics(), cacheRect, first);
+		canvas.DrawBitmap(m_Cache.GetBitmap(), meterRect, cacheRect);
+	}
+	else
+	{
+		Gdiplus::Graphics& graphics = canvas.BeginGdiplusContext();
+		DrawValues(graphics, meterRect, 0);
+		canvas.EndGdiplusContext();
+	}
+
+	return true;
+}
+
+/*
+** Draws the values from slot |first| to the newest value into |meterRect|. The value of slot i is
+** drawn at startValue + step * i.
+**
+*/
+void MeterHistogram::DrawValues(Gdiplus::Graphics& graphics, const Gdiplus::Rect& meterRect, int first)
+{
 	Measure* secondaryMeasure = (m_Measures.size() >= 2) ? m_Measures[1] : nullptr;
 
 	GraphicsPath primaryPath;
@@ -404,50 +425,28 @@ bool MeterHistogram::Draw(Gfx::Canvas& canvas)
 	Bitmap* secondaryBitmap = m_SecondaryImage.GetImage();
 	Bitmap* bothBitmap = m_OverlapImage.GetImage();
 
-	Gdiplus::Rect meterRect = GetMeterRectPadding();
-
 	// Default values (GraphStart=Right, GraphOrientation=Vertical)
-	int i;
+	const int size = m_GraphHorizontalOrientation ? meterRect.Height : meterRect.Width;
 	int startValue = 0;
-	int* endValueLHS = &i;
-	int* endValueRHS = &meterRect.Width;
 	int step = 1;
-	int endValue = -1; //(should be 0, but need to simulate <=)
 
-	// GraphStart=Left, GraphOrientation=Vertical
-	if (!m_GraphHorizontalOrientation)
-	{
-		if (m_GraphStartLeft)
-		{
-			startValue = meterRect.Width - 1;
-			endValueLHS = &endValue;
-			endValueRHS = &i;
-			step = -1;
-		}
-	}
-	else
+	// GraphStart=Left, GraphOrientation=Vertical or Flip=1, GraphOrientation=Horizontal
+	if (m_GraphHorizontalOrientation ? m_Flip : m_GraphStartLeft)
 	{
-		if (!m_Flip)
-		{
-			endValueRHS = &meterRect.Height;
-		}
-		else
-		{
-			startValue = meterRect.Height - 1;
-			endValueLHS = &endValue;
-			endValueRHS = &i;
-			step = -1;
-		}
+		startValue = size - 1;
+		step = -1;
 	}
 
+	if (first >= size) return;
+
 	// Horizontal or Vertical graph
 	if (m_GraphHorizontalOrientation)
 	{
-		for (i = startValue; *endValueLHS < *endValueRHS; i += step)
+		for (int i = first; i < size; ++i)
 		{
 			double value = (m_MaxPrimaryValue == 0.0) ?
 				  0.0
-				: m_PrimaryValues[(i + (m_MeterPos % meterRect.Height)) % meterRect.Height] / m_MaxPrimaryValue;
+				: m_PrimaryHistory->Get(meterRect.Height - 1 - i) / m_MaxPrimaryValue;
 			value -= m_MinPrimaryValue;
 			int primaryBarHeight = (int)(meterRect.Width * value);
 			primaryBarHeight = min(meterRect.Width, primaryBarHeight);
@@ -457,7 +456,7 @@ bool MeterHistogram::Draw(Gfx::Canvas& canvas)
 			{
 				value = (m_MaxSecondaryValue == 0.0) ?
 					  0.0
-					: m_SecondaryValues[(i + m_MeterPos) % meterRect.Height] / m_MaxSecondaryValue;
+					: m_SecondaryHistory->Get(meterRect.Height - 1 - i) / m_MaxSecondaryValue;
 				value -= m_MinSecondaryValue;
 				int secondaryBarHeight = (int)(meterRect.Width * value);
 				secondaryBarHeight = min(meterRect.Width, secondaryBarHeight);
@@ -505,11 +504,11 @@ bool MeterHistogram::Draw(Gfx::Canvas& canvas)
 	}
 	else	// GraphOrientation=Vertical
 	{
-		for (i = startValue; *endValueLHS < *endValueRHS; i += step)
+		for (int i = first; i < size; ++i)
 		{
 			double value = (m_MaxPrimaryValue == 0.0) ?
 				  0.0
-				: m_PrimaryValues[(i + m_MeterPos) % meterRect.Width] / m_MaxPrimaryValue;
+				: m_PrimaryHistory->Get(meterRect.Width - 1 - i) / m_MaxPrimaryValue;
 			value -= m_MinPrimaryValue;
 			int primaryBarHeight = (int)(meterRect.Height * value);
 			primaryBarHeight = min(meterRect.Height, primaryBarHeight);
@@ -519,7 +518,7 @@ bool MeterHistogram::Draw(Gfx::Canvas& canvas)
 			{
 				value = (m_MaxSecondaryValue == 0.0) ?
 					  0.0
-					: m_SecondaryValues[(i + m_MeterPos) % meterRect.Width] / m_MaxSecondaryValue;
+					: m_SecondaryHistory->Get(meterRect.Width - 1 - i) / m_MaxSecondaryValue;
 				value -= m_MinSecondaryValue;
 				int secondaryBarHeight = (int)(meterRect.Height * value);
 				secondaryBarHeight = min(meterRect.Height, secondaryBarHeight);
@@ -609,10 +608,6 @@ bool MeterHistogram::Draw(Gfx::Canvas& canvas)
 			graphics.FillPath(&brush, &bothPath);
 		}
 	}
-
-	canvas.EndGdiplusContext();
-
-	return true;
 }
 
 /*
@@ -636,4 +631,11 @@ void MeterHistogram::BindMeasures(ConfigParser& parser, const WCHAR* section)
 			m_Measures.push_back(measure);
 		}
 	}
+
+	// Meters bound to the same measure share the values.
+	const int updateDivider = GetUpdateDivider();
+	m_PrimaryHistory = (m_Measures.size() >= 1) ? m_Measures[0]->GetHistory(updateDivider) : nullptr;
+	m_SecondaryHistory = (m_Measures.size() >= 2) ? m_Measures[1]->GetHistory(updateDivider) : nullptr;
+	if (m_PrimaryHistory) m_PrimaryHistory->Grow(m_BufferSize);
+	if (m_SecondaryHistory) m_SecondaryHistory->Grow(m_BufferSize);
 }
@@ -9,6 +9,7 @@
 #define __METERHISTOGRAM_H__
 
 #include "Meter.h"
+#include "GraphCache.h"
 #include "TintedImage.h"
 
 class MeterHistogram : public Meter
@@ -35,12 +36,12 @@ protected:
 private:
 	void DisposeBuffer();
 	void CreateBuffer();
+	void DrawValues(Gdiplus::Graphics& graphics, const Gdiplus::Rect& meterRect, int first);
 
 	Gdiplus::Color m_PrimaryColor;
 	Gdiplus::Color m_SecondaryColor;
 	Gdiplus::Color m_OverlapColor;
 
-	int m_MeterPos;							// New value placement position
 	bool m_Autoscale;
 	bool m_Flip;
 
@@ -56,8 +57,13 @@ private:
 	bool m_SecondaryNeedsReload;
 	bool m_OverlapNeedsReload;
 
-	double* m_PrimaryValues;
-	double* m_SecondaryValues;
+	std::shared_ptr<ValueHistory> m_PrimaryHistory;
+	std::shared_ptr<ValueHistory> m_SecondaryHistory;
+	UINT64 m_PrimaryCursor;
+	UINT64 m_SecondaryCursor;
+	int m_BufferSize;						// Number of values used; 0 if the images failed to load
+
+	GraphCache m_Cache;
 
 	double m_MaxPrimaryValue;
 	double m_MinPrimaryValue;
@@ -176,13 +176,20 @@ bool MeterImage::Update()
 				m_ImageNameResult = m_ImageName;
 			}
 
+			// The image is also loaded again if the file has been modified.
+			const UINT oldGeneration = m_Image.GetGeneration();
 			LoadImage(m_ImageNameResult, (wcscmp(oldResult.c_str(), m_ImageNameResult.c_str()) != 0));
+			if (m_Image.GetGeneration() != oldGeneration)
+			{
+				SetDamaged();
+			}
 
 			return true;
 		}
 		else if (m_NeedsRedraw)
 		{
 			m_NeedsRedraw = false;
+			SetDamaged();
 			return true;
 		}
 	}
@@ -243,13 +250,14 @@ bool MeterImage::Draw(Gfx::Canvas& canvas)
 				}
 			}
 
-			canvas.DrawMaskedBitmap(drawBitmap, maskBitmap, meterRect, Rect(0, 0, imageW, imageH), Gdiplus::Rect(cropX, cropY, cropW, cropH));
+			canvas.DrawMaskedBitmap(drawBitmap, maskBitmap, meterRect, Rect(0, 0, imageW, imageH), Gdiplus::Rect(cropX, cropY, cropW, cropH),
+				m_Image.GetGeneration(), m_MaskImage.GetGeneration());
 		}
 
 		else if (drawW == imageW && drawH == imageH &&
 			m_ScaleMargins.left == 0 && m_ScaleMargins.top == 0 && m_ScaleMargins.right == 0 && m_ScaleMargins.bottom == 0)
 		{
-			canvas.DrawBitmap(drawBitmap, Rect(meterRect.X, meterRect.Y, drawW, drawH), Rect(0, 0, imageW, imageH));
+			canvas.DrawBitmap(drawBitmap, Rect(meterRect.X, meterRect.Y, drawW, drawH), Rect(0, 0, imageW, imageH), m_Image.GetGeneration());
 		}
 		else if (m_DrawMode == DRAWMODE_TILE)
 		{
@@ -307,7 +315,7 @@ bool MeterImage::Draw(Gfx::Canvas& canvas)
 			}
 
 			Rect r(meterRect.X, meterRect.Y, drawW, drawH);
-			canvas.DrawBitmap(drawBitmap, r, Rect(cropX, cropY, cropW, cropH));
+			canvas.DrawBitmap(drawBitmap, r, Rect(cropX, cropY, cropW, cropH), m_Image.GetGeneration());
 		}
 		else
 		{
@@ -319,18 +327,18 @@ bool MeterImage::Draw(Gfx::Canvas& canvas)
 				{
 					// Top-Left
 					Rect r(meterRect.X, meterRect.Y, m.left, m.top);
-					canvas.DrawBitmap(drawBitmap, r, Rect(0, 0, m.left, m.top));
+					canvas.DrawBitmap(drawBitmap, r, Rect(0, 0, m.left, m.top), m_Image.GetGeneration());
 				}
 
 				// Top
 				Rect r(meterRect.X + m.left, meterRect.Y, drawW - m.left - m.right, m.top);
-				canvas.DrawBitmap(drawBitmap, r, Rect(m.left, 0, imageW - m.left - m.right, m.top));
+				canvas.DrawBitmap(drawBitmap, r, Rect(m.left, 0, imageW - m.left - m.right, m.top), m_Image.GetGeneration());
 
 				if (m.right > 0)
 				{
 					// Top-Right
 					Rect r(meterRect.X + drawW - m.right, meterRect.Y, m.right, m.top);
-					canvas.DrawBitmap(drawBitmap, r, Rect(imageW - m.right, 0, m.right, m.top));
+					canvas.DrawBitmap(drawBitmap, r, Rect(imageW - m.right, 0, m.right, m.top), m_Image.GetGeneration());
 				}
 			}
 
@@ -338,18 +346,18 @@ bool MeterImage::Draw(Gfx::Canvas& canvas)
 			{
 				// Left
 				Rect r(meterRect.X, meterRect.Y + m.top, m.left, drawH - m.top - m.bottom);
-				canvas.DrawBitmap(drawBitmap, r, Rect(0, m.top, m.left, imageH - m.top - m.bottom));
+				canvas.DrawBitmap(drawBitmap, r, Rect(0, m.top, m.left, imageH - m.top - m.bottom), m_Image.GetGeneration());
 			}
 
 			// Center
 			Rect r(meterRect.X + m.left, meterRect.Y + m.top, drawW - m.left - m.right, drawH - m.top - m.bottom);
-			canvas.DrawBitmap(drawBitmap, r, Rect(m.left, m.top, imageW - m.left - m.right, imageH - m.top - m.bottom));
+			canvas.DrawBitmap(drawBitmap, r, Rect(m.left, m.top, imageW - m.left - m.right, imageH - m.top - m.bottom), m_Image.GetGeneration());
 
 			if (m.right > 0)
 			{
 				// Right
 				Rect r(meterRect.X + drawW - m.right, meterRect.Y + m.top, m.right, drawH - m.top - m.bottom);
-				canvas.DrawBitmap(drawBitmap, r, Rect(imageW - m.right, m.top, m.right, imageH - m.top - m.bottom));
+				canvas.DrawBitmap(drawBitmap, r, Rect(imageW - m.right, m.top, m.right, imageH - m.top - m.bottom), m_Image.GetGeneration());
 			}
 
 			if (m.bottom > 0)
@@ -358,18 +366,18 @@ bool MeterImage::Draw(Gfx::Canvas& canvas)
 				{
 					// Bottom-Left
 					Rect r(meterRect.X, meterRect.Y + drawH - m.bottom, m.left, m.bottom);
-					canvas.DrawBitmap(drawBitmap, r, Rect(0, imageH - m.bottom, m.left, m.bottom));
+					canvas.DrawBitmap(drawBitmap, r, Rect(0, imageH - m.bottom, m.left, m.bottom), m_Image.GetGeneration());
 				}
 
 				// Bottom
 				Rect r(meterRect.X + m.left, meterRect.Y + drawH - m.bottom, drawW - m.left - m.right, m.bottom);
-				canvas.DrawBitmap(drawBitmap, r, Rect(m.left, imageH - m.bottom, imageW - m.left - m.right, m.bottom));
+				canvas.DrawBitmap(drawBitmap, r, Rect(m.left, imageH - m.bottom, imageW - m.left - m.right, m.bottom), m_Image.GetGeneration());
 
 				if (m.right > 0)
 				{
 					// Bottom-Right
 					Rect r(meterRect.X + drawW - m.right, meterRect.Y + drawH - m.bottom, m.right, m.bottom);
-					canvas.DrawBitmap(drawBitmap, r, Rect(imageW - m.right, imageH - m.bottom, m.right, m.bottom));
+					canvas.DrawBitmap(drawBitmap, r, Rect(imageW - m.right, imageH - m.bottom, m.right, m.bottom), m_Image.GetGeneration());
 				}
 			}
 		}
@@ -19,7 +19,6 @@ MeterLine::MeterLine(Skin* skin, const WCHAR* name) : Meter(skin, name),
 	m_Flip(false),
 	m_LineWidth(1.0),
 	m_HorizontalColor(Color::Black),
-	m_CurrentPos(),
 	m_GraphStartLeft(false),
 	m_GraphHorizontalOrientation(false)
 {
@@ -30,49 +29,42 @@ MeterLine::~MeterLine()
 }
 
 /*
-** create the buffer for the lines
+** Gets the histories for the lines.
 **
 */
 void MeterLine::Initialize()
 {
 	Meter::Initialize();
 
-	size_t colorsSize = m_Colors.size();
-	size_t allValuesSize = m_AllValues.size();
-	size_t num = (allValuesSize > 0) ? m_AllValues[0].size() : 0;
-	int maxSize = m_GraphHorizontalOrientation ? m_H : m_W;
+	BindHistories();
+}
+
+/*
+** Gets the value histories of the measures for the lines. The histories are shared with the
+** other meters bound to the same measures. Lines without a measure use an empty history, which
+** draws zeros.
+**
+*/
+void MeterLine::BindHistories()
+{
+	const size_t lineCount = m_Colors.size();
+	const int maxSize = m_GraphHorizontalOrientation ? m_H : m_W;
 
-	if (colorsSize != allValuesSize)
+	m_Histories.resize(lineCount);
+	m_Cursors.resize(lineCount, 0);
+	for (size_t i = 0; i < lineCount; ++i)
 	{
-		if (colorsSize > allValuesSize)
+		if (i < m_Measures.size())
 		{
-			for (size_t i = allValuesSize; i < colorsSize; ++i)
+			m_Histories[i] = m_Measures[i]->GetHistory(GetUpdateDivider());
+			if (maxSize > 0)
 			{
-				m_AllValues.push_back(std::vector<double>());
-
-				if (maxSize > 0)
-				{
-					m_AllValues.back().assign(maxSize, 0.0);
-				}
+				m_Histories[i]->Grow(maxSize);
 			}
 		}
 		else
 		{
-			m_AllValues.resize(colorsSize);
-		}
-	}
-
-	if (maxSize < 0 || num != (size_t)maxSize)
-	{
-		if (m_CurrentPos >= maxSize) m_CurrentPos = 0;
-
-		num = (maxSize < 0) ? 0 : maxSize;
-		for (size_t i = 0; i < allValuesSize; ++i)
-		{
-			if (num != m_AllValues[i].size())
-			{
-				m_AllValues[i].resize(num, 0.0);
-			}
+			m_Histories[i] = std::make_shared<ValueHistory>();
 		}
 	}
 }
@@ -85,13 +77,11 @@ void MeterLine::ReadOptions(ConfigParser& parser, const WCHAR* section)
 {
 	WCHAR tmpName[64];
 
-	// Store the current number of lines so we know if the buffer needs to be updated
-	int oldLineCount = (int)m_Colors.size();
-	int oldSize = m_GraphHorizontalOrientation ? m_H : m_W;
-	bool oldGraphHorizontalOrientation = m_GraphHorizontalOrientation;
-
 	Meter::ReadOptions(parser, section);
 
+	// The cached graph may not match the options anymore.
+	m_Cache.Invalidate();
+
 	int lineCount = parser.ReadInt(section, L"LineCount", 1);
 
 	m_Colors.clear();
@@ -159,13 +149,8 @@ void MeterLine::ReadOptions(ConfigParser& parser, const WCHAR* section)
 
 	if (m_Initialized)
 	{
-		int maxSize = m_GraphHorizontalOrientation ? m_H : m_W;
-		if (oldLineCount != lineCount || oldSize != maxSize || oldGraphHorizontalOrientation != m_GraphHorizontalOrientation)
-		{
-			m_AllValues.clear();
-			m_CurrentPos = 0;
-			Initialize();
-		}
+		// The measures, the number of lines, or the size may have changed.
+		BindHistories();
 	}
 }
 
@@ -177,20 +162,15 @@ bool MeterLine::Update()
 {
 	if (Meter::Update() && !m_Measures.empty())
 	{
-		int maxSize = m_GraphHorizontalOrientation ? m_H : m_W;
-
-		if (maxSize > 0)
+		int historiesSize = (int)m_Histories.size();
+		int counter = 0;
+		for (auto i = m_Measures.cbegin(); counter < historiesSize && i != m_Measures.cend(); ++i, ++counter)
 		{
-			int allValuesSize = (int)m_AllValues.size();
-			int counter = 0;
-			for (auto i = m_Measures.cbegin(); counter < allValuesSize && i != m_Measures.cend(); ++i, ++counter)
-			{
-				m_AllValues[counter][m_CurrentPos] = (*i)->GetValue();
-			}
-
-			++m_CurrentPos;
-			m_CurrentPos %= maxSize;
+			m_Histories[counter]->AddShared((*i)->GetValue(), m_Cursors[counter]);
 		}
+
+		// The graph scrolls with every new value.
+		if (counter > 0) SetDamaged();
 		return true;
 	}
 	return false;
@@ -204,8 +184,6 @@ bool MeterLine::Draw(Gfx::Canvas& canvas)
 {
 	int maxSize = m_GraphHorizontalOrientation ? m_H : m_W;
 	if (!Meter::Draw(canvas) || maxSize <= 0) return false;
-	
-	Gdiplus::Graphics& graphics = canvas.BeginGdiplusContext();
 
 	double maxValue = 0.0;
 	int counter = 0;
@@ -215,14 +193,12 @@ bool MeterLine::Draw(Gfx::Canvas& canvas)
 	{
 		double newValue = 0;
 		counter = 0;
-		for (auto i = m_AllValues.cbegin(); i != m_AllValues.cend(); ++i)
+		for (auto i = m_Histories.cbegin(); i != m_Histories.cend(); ++i)
 		{
-			double scale = m_ScaleValues[counter];
-			for (auto j = (*i).cbegin(); j != (*i).cend(); ++j)
-			{
-				double val = (*j) * scale;
-				newValue = max(newValue, val);
-			}
+			// With a negative scale, the smallest value is the largest when scaled.
+			const double scale = m_ScaleValues[counter];
+			const double val = scale * ((scale >= 0.0) ? (*i)->GetMax(maxSize) : (*i)->GetMin(maxSize));
+			newValue = max(newValue, val);
 			++counter;
 		}
 
@@ -256,6 +232,45 @@ bool MeterLine::Draw(Gfx::Canvas& canvas)
 
 	Gdiplus::Rect meterRect = GetMeterRectPadding();
 
+	if (!m_Transformation && meterRect.Width > 0 && meterRect.Height > 0)
+	{
+		// Draw only the new values unless the scale has changed.
+		std::vector<double> scales(1, maxValue);
+		std::vector<UINT64> addCounts;
+		for (size_t i = 0, isize = min(m_Histories.size(), m_Measures.size()); i < isize; ++i)
+		{
+			addCounts.push_back(m_Histories[i]->GetAddCount());
+		}
+
+		// The lines between the values and their width extend to the neighboring slots.
+		const int margin = (int)ceil(m_LineWidth) + 1;
+		const bool reverse = m_GraphHorizontalOrientation ? m_Flip : m_GraphStartLeft;
+		const int first = m_Cache.Prepare(meterRect.Width, meterRect.Height,
+			m_GraphHorizontalOrientation, reverse, m_AntiAlias, margin, scales, addCounts);
+
+		const Rect cacheRect(0, 0, meterRect.Width, meterRect.Height);
+		if (first < (m_GraphHorizontalOrientation ? meterRect.Height : meterRect.Width))
+		{
+			DrawLines(m_Cache.GetGraphics(), cacheRect, maxValue, max(0, first - margin));
+		}
+		canvas.DrawBitmap(m_Cache.GetBitmap(), meterRect, cacheRect);
+	}
+	else
+	{
+		Gdiplus::Graphics& graphics = canvas.BeginGdiplusContext();
+		DrawLines(graphics, meterRect, maxValue, 0);
+		canvas.EndGdiplusContext();
+	}
+
+	return true;
+}
+
+/*
+** Draws the lines from the value in slot |first| to the newest value into |meterRect|.
+**
+*/
+void MeterLine::DrawLines(Gdiplus::Graphics& graphics, const Gdiplus::Rect& meterRect, double maxValue, int first)
+{
 	// Draw the horizontal lines
 	if (m_HorizontalLines)
 	{
@@ -284,60 +299,33 @@ bool MeterLine::Draw(Gfx::Canvas& canvas)
 	}
 
 	// Draw all the lines
-
+	int counter = 0;
 	if (m_GraphHorizontalOrientation)
 	{
 		const REAL W = meterRect.Width - 1.0f;
-		counter = 0;
-		for (auto i = m_AllValues.cbegin(); i != m_AllValues.cend(); ++i)
+		const int size = meterRect.Height;
+		for (auto i = m_Histories.cbegin(); i != m_Histories.cend(); ++i)
 		{
-			// Draw a line
-			REAL X, oldX;
-
 			const double scale = m_ScaleValues[counter] * W / maxValue;
 
-			int pos = m_CurrentPos;
-
-			auto calcX = [&](REAL& _x)
+			auto getPoint = [&](int slot)
 			{
-				_x = (REAL)((*i)[pos] * scale);
-				_x = min(_x, W);
-				_x = max(_x, 0.0f);
-				_x = meterRect.X + (m_GraphStartLeft ? _x : W - _x);
+				REAL x = (REAL)((*i)->Get(size - 1 - slot) * scale);
+				x = min(x, W);
+				x = max(x, 0.0f);
+				x = meterRect.X + (m_GraphStartLeft ? x : W - x);
+				const int y = m_Flip ? size - 1 - slot : slot;
+				return PointF(x, (REAL)(meterRect.Y + y));
 			};
 
-			calcX(oldX);
-
 			// Cache all lines
 			GraphicsPath path;
-		
-			if (!m_Flip)
+			PointF oldPoint = getPoint(first);
+			for (int slot = first + 1; slot < size; ++slot)
 			{
-				for (int j = meterRect.Y + 1, R = meterRect.Y + meterRect.Height; j < R; ++j)
-				{
-					++pos;
-					pos %= meterRect.Height;
-
-					calcX(X);
-
-					path.AddLine(oldX, (REAL)(j - 1), X, (REAL)j);
-
-					oldX = X;
-				}
-			}
-			else
-			{
-				for (int j = meterRect.Y + meterRect.Height, R = meterRect.Y + 1; j > R; --j)
-				{
-					++pos;
-					pos %= meterRect.Height;
-
-					calcX(X);
-
-					path.AddLine(oldX, (REAL)(j - 1), X, (REAL)(j - 2));
-
-					oldX = X;
-				}
+				const PointF point = getPoint(slot);
+				path.AddLine(oldPoint, point);
+				oldPoint = point;
 			}
 
 			// Draw cached lines
@@ -351,56 +339,29 @@ bool MeterLine::Draw(Gfx::Canvas& canvas)
 	else
 	{
 		const REAL H = meterRect.Height - 1.0f;
-		counter = 0;
-		for (auto i = m_AllValues.cbegin(); i != m_AllValues.cend(); ++i)
+		const int size = meterRect.Width;
+		for (auto i = m_Histories.cbegin(); i != m_Histories.cend(); ++i)
 		{
-			// Draw a line
-			REAL Y, oldY;
-
 			const double scale = m_ScaleValues[counter] * H / maxValue;
 
-			int pos = m_CurrentPos;
-
-			auto calcY = [&](REAL& _y)
+			auto getPoint = [&](int slot)
 			{
-				_y = (REAL)((*i)[pos] * scale);
-				_y = min(_y, H);
-				_y = max(_y, 0.0f);
-				_y = meterRect.Y + (m_Flip ? _y : H - _y);
+				REAL y = (REAL)((*i)->Get(size - 1 - slot) * scale);
+				y = min(y, H);
+				y = max(y, 0.0f);
+				y = meterRect.Y + (m_Flip ? y : H - y);
+				const int x = m_GraphStartLeft ? size - 1 - slot : slot;
+				return PointF((REAL)(meterRect.X + x), y);
 			};
 
-			calcY(oldY);
-
 			// Cache all lines
 			GraphicsPath path;
-		
-			if (!m_GraphStartLeft)
-			{
-				for (int j = meterRect.X + 1, R = meterRect.X + meterRect.Width; j < R; ++j)
-				{
-					++pos;
-					pos %= meterRect.Width;
-
-					calcY(Y);
-
-					path.AddLine((REAL)(j - 1), oldY, (REAL)j, Y);
-
-					oldY = Y;
-				}
-			}
-			else
+			PointF oldPoint = getPoint(first);
+			for (int slot = first + 1; slot < size; ++slot)
 			{
-				for (int j = meterRect.X + meterRect.Width, R = meterRect.X + 1; j > R; --j)
-				{
-					++pos;
-					pos %= meterRect.Width;
-
-					calcY(Y);
-
-					path.AddLine((REAL)(j - 1), oldY, (REAL)(j - 2), Y);
-
-					oldY = Y;
-				}
+				const PointF point = getPoint(slot);
+				path.AddLine(oldPoint, point);
+				oldPoint = point;
 			}
 
 			// Draw cached lines
@@ -411,10 +372,6 @@ bool MeterLine::Draw(Gfx::Canvas& canvas)
 			++counter;
 		}
 	}
-
-	canvas.EndGdiplusContext();
-
-	return true;
 }
 
 /*
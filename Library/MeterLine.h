@@ -9,6 +9,7 @@
 #define __METERLINE_H__
 
 #include "Meter.h"
+#include "GraphCache.h"
 
 class MeterLine : public Meter
 {
@@ -30,6 +31,9 @@ protected:
 	virtual void BindMeasures(ConfigParser& parser, const WCHAR* section);
 
 private:
+	void BindHistories();
+	void DrawLines(Gdiplus::Graphics& graphics, const Gdiplus::Rect& meterRect, double maxValue, int first);
+
 	std::vector<Gdiplus::Color> m_Colors;
 	std::vector<double> m_ScaleValues;
 
@@ -39,8 +43,10 @@ private:
 	double m_LineWidth;
 	Gdiplus::Color m_HorizontalColor;
 
-	std::vector< std::vector<double> > m_AllValues;
-	int m_CurrentPos;
+	std::vector<std::shared_ptr<ValueHistory>> m_Histories;	// For each line
+	std::vector<UINT64> m_Cursors;
+
+	GraphCache m_Cache;
 
 	bool m_GraphStartLeft;
 	bool m_GraphHorizontalOrientation;
@@ -102,6 +102,8 @@ bool MeterRotator::Update()
 {
 	if (Meter::Update() && !m_Measures.empty())
 	{
+		const double oldValue = m_Value;
+
 		Measure* measure = m_Measures[0];
 		if (m_ValueRemainder > 0)
 		{
@@ -113,6 +115,8 @@ bool MeterRotator::Update()
 		{
 			m_Value = measure->GetRelativeValue();
 		}
+
+		if (m_Value != oldValue) SetDamaged();
 		return true;
 	}
 	return false;
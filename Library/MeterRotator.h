@@ -26,6 +26,9 @@ public:
 	virtual bool Update();
 	virtual bool Draw(Gfx::Canvas& canvas);
 
+	// The rotated image is not limited to the meter area.
+	virtual bool IsDrawnWithinBounds() { return false; }
+
 protected:
 	virtual void ReadOptions(ConfigParser& parser, const WCHAR* section);
 
@@ -69,23 +69,28 @@ bool MeterRoundLine::Update()
 {
 	if (Meter::Update())
 	{
+		const double oldValue = m_Value;
+
 		if (m_Measures.empty())
 		{
 			m_Value = 1.0;
-			return true;
-		}
-
-		Measure* measure = m_Measures[0];
-		if (m_ValueRemainder > 0)
-		{
-			LONGLONG time = (LONGLONG)measure->GetValue();
-			m_Value = (double)(time % m_ValueRemainder);
-			m_Value /= (double)m_ValueRemainder;
 		}
 		else
 		{
-			m_Value = measure->GetRelativeValue();
+			Measure* measure = m_Measures[0];
+			if (m_ValueRemainder > 0)
+			{
+				LONGLONG time = (LONGLONG)measure->GetValue();
+				m_Value = (double)(time % m_ValueRemainder);
+				m_Value /= (double)m_ValueRemainder;
+			}
+			else
+			{
+				m_Value = measure->GetRelativeValue();
+			}
 		}
+
+		if (m_Value != oldValue) SetDamaged();
 		return true;
 	}
 
@@ -24,6 +24,9 @@ public:
 	virtual bool Update();
 	virtual bool Draw(Gfx::Canvas& canvas);
 
+	// LineLength is not limited to the meter area.
+	virtual bool IsDrawnWithinBounds() { return false; }
+
 protected:
 	virtual void ReadOptions(ConfigParser& parser, const WCHAR* section);
 	virtual void BindMeasures(ConfigParser& parser, const WCHAR* section);
@@ -34,10 +34,52 @@ auto ParseBool = [](auto& var, const WCHAR* value)
 	if (_wcsnicmp(value, L"*", 1) != 0) var = (ConfigParser::ParseInt(value, 0) == 0);
 };
 
+size_t GetShapeId(const WCHAR* shape)
+{
+	int id = _wtoi(shape) - 1;
+	return id < 0 ? (size_t)0 : (size_t)id;
+}
+
+bool IsCombineDefinition(const std::wstring& shape)
+{
+	return _wcsnicmp(shape.c_str(), L"COMBINE", 7) == 0;
+}
+
+// Returns the indices of the shapes that the combined shape |shape| refers to.
+std::vector<size_t> GetCombinedShapeIds(const std::wstring& shape)
+{
+	std::vector<size_t> ids;
+	auto args = ConfigParser::Tokenize2(shape, L'|', PairedPunctuation::Parentheses);
+	if (args.empty() || args[0].length() < 8) return ids;
+
+	std::wstring parentName = args[0].substr(8);  // Remove 'Combine '
+	if (StringUtil::CaseInsensitiveCompareN(parentName, L"SHAPE"))
+	{
+		ids.push_back(GetShapeId(parentName.c_str()));
+	}
+
+	for (size_t i = 1; i < args.size(); ++i)
+	{
+		std::wstring& option = args[i];
+		if (StringUtil::CaseInsensitiveCompareN(option, L"UNION") ||
+			StringUtil::CaseInsensitiveCompareN(option, L"XOR") ||
+			StringUtil::CaseInsensitiveCompareN(option, L"INTERSECT") ||
+			StringUtil::CaseInsensitiveCompareN(option, L"EXCLUDE"))
+		{
+			option.erase(0, 5);  // Remove 'Shape'
+			ids.push_back(GetShapeId(option.c_str()));
+		}
+	}
+
+	return ids;
+}
+
 }  // namespace
 
 MeterShape::MeterShape(Skin* skin, const WCHAR* name) : Meter(skin, name),
-	m_Shapes()
+	m_Shapes(),
+	m_ShapesW(),
+	m_ShapesH()
 {
 	Meter::Initialize();
 }
@@ -55,15 +97,23 @@ void MeterShape::Dispose()
 	}
 
 	m_Shapes.clear();
+	m_ShapeDefinitions.clear();
 }
 
 void MeterShape::ReadOptions(ConfigParser& parser, const WCHAR* section)
 {
 	Meter::ReadOptions(parser, section);
 
-	// Clear any shapes
-	Dispose();
+	// Shapes are only created again if their definition has changed since the options were last
+	// read. This avoids rebuilding every geometry when e.g. DynamicVariables=1 is used to animate
+	// a single shape.
+	std::vector<Gfx::Shape*> oldShapes;
+	std::vector<std::wstring> oldDefinitions;
+	oldShapes.swap(m_Shapes);
+	oldDefinitions.swap(m_ShapeDefinitions);
 
+	// |true| for each shape that was created again.
+	std::vector<bool> created;
 	std::map<size_t, std::wstring> combinedShapes;
 
 	const WCHAR delimiter = L'|';
@@ -72,55 +122,144 @@ void MeterShape::ReadOptions(ConfigParser& parser, const WCHAR* section)
 	size_t i = 1;
 	while (!shape.empty())
 	{
-		auto args = ConfigParser::Tokenize2(shape, delimiter, PairedPunctuation::Parentheses);
+		const size_t id = i - 1;
+		std::wstring definition = GetShapeDefinition(shape, parser, section);
 
-		bool isCombined = false;
-		if (!CreateShape(args, parser, section, isCombined, i - 1)) break;
-
-		// If the shape is combined with another, save the shape definition and
-		// process later. Otherwise, parse any modifiers for the shape.
-		if (isCombined)
+		if (id < oldShapes.size() && definition == oldDefinitions[id])
 		{
-			combinedShapes.insert(std::make_pair(i - 1, shape));
+			m_Shapes.push_back(oldShapes[id]);
+			oldShapes[id] = nullptr;
+			created.push_back(false);
+
+			// Shapes that are still combined are marked again below.
+			m_Shapes.back()->SetCombined(false);
+			if (IsCombineDefinition(shape))
+			{
+				combinedShapes.insert(std::make_pair(id, shape));
+			}
 		}
 		else
 		{
-			args.erase(args.begin());
-			ParseModifiers(args, parser, section);
+			auto args = ConfigParser::Tokenize2(shape, delimiter, PairedPunctuation::Parentheses);
+
+			bool isCombined = false;
+			if (!CreateShape(args, parser, section, isCombined, id)) break;
+
+			created.push_back(true);
+
+			// If the shape is combined with another, save the shape definition and
+			// process later. Otherwise, parse any modifiers for the shape.
+			if (isCombined)
+			{
+				combinedShapes.insert(std::make_pair(id, shape));
+			}
+			else
+			{
+				args.erase(args.begin());
+				ParseModifiers(args, parser, section);
+			}
 		}
 
+		m_ShapeDefinitions.push_back(std::move(definition));
+
 		// Check for Shape2 ... etc.
 		const std::wstring num = std::to_wstring(++i);
 		std::wstring key = L"Shape" + num;
 		shape = parser.ReadString(section, key.c_str(), L"");
 	}
 
+	bool hasChanged = m_Shapes.size() != oldShapes.size();
+	for (auto& oldShape : oldShapes)
+	{
+		if (oldShape)
+		{
+			delete oldShape;
+			hasChanged = true;
+		}
+	}
+
+	// A combined shape needs to be combined again if any of the shapes that it refers to was
+	// created again. Repeat until no more shapes are affected since combined shapes can also
+	// refer to other combined shapes.
+	bool hasCombinedChanged = true;
+	while (hasCombinedChanged)
+	{
+		hasCombinedChanged = false;
+		for (const auto& combined : combinedShapes)
+		{
+			const size_t id = combined.first;
+			if (created[id]) continue;
+
+			for (size_t other : GetCombinedShapeIds(combined.second))
+			{
+				if (other >= created.size() || created[other])
+				{
+					// Replace the previous result with a placeholder as in CreateShape().
+					delete m_Shapes[id];
+					m_Shapes[id] = new Gfx::Rectangle(0.0, 0.0, 0.0, 0.0);
+					m_Shapes[id]->SetCombined();
+					created[id] = true;
+					hasCombinedChanged = true;
+					break;
+				}
+			}
+		}
+	}
+
 	// Process combined shapes
-	for (const auto& shape : combinedShapes)
+	bool hasFailed = false;
+	for (const auto& combined : combinedShapes)
 	{
-		auto args = ConfigParser::Tokenize2(shape.second, delimiter, PairedPunctuation::Parentheses);
-		if (!CreateCombinedShape(shape.first, args)) break;
+		const size_t id = combined.first;
+		if (hasFailed)
+		{
+			// The remaining combined shapes are not processed (and thus not drawn) after a failure.
+			// Their definitions are cleared so that they are processed again next time.
+			m_Shapes[id]->SetCombined();
+			m_ShapeDefinitions[id].clear();
+		}
+		else if (created[id])
+		{
+			hasChanged = true;
+			auto args = ConfigParser::Tokenize2(combined.second, delimiter, PairedPunctuation::Parentheses);
+			if (!CreateCombinedShape(id, args))
+			{
+				m_ShapeDefinitions[id].clear();
+				hasFailed = true;
+			}
+		}
+		else
+		{
+			// The combined shapes are unchanged, so only hide them again.
+			for (size_t other : GetCombinedShapeIds(combined.second))
+			{
+				m_Shapes[other]->SetCombined();
+			}
+		}
 	}
 
 	// Adjust width/height if necessary
 	if (!m_WDefined || !m_HDefined)
 	{
-		int newW = 0;
-		int newH = 0;
-
-		for (const auto& shape : m_Shapes)
+		if (hasChanged || std::find(created.begin(), created.end(), true) != created.end())
 		{
-			if (shape->IsCombined()) continue;
+			m_ShapesW = 0;
+			m_ShapesH = 0;
 
-			D2D1_RECT_F bounds = shape->GetBounds();
-			int shapeW = (int)ceil(bounds.right);  // Account for 'half-pixels'
-			int shapeH = (int)ceil(bounds.bottom);
-			if (newW < shapeW) newW = shapeW;
-			if (newH < shapeH) newH = shapeH;
+			for (const auto& shape : m_Shapes)
+			{
+				if (shape->IsCombined()) continue;
+
+				D2D1_RECT_F bounds = shape->GetBounds();
+				int shapeW = (int)ceil(bounds.right);  // Account for 'half-pixels'
+				int shapeH = (int)ceil(bounds.bottom);
+				if (m_ShapesW < shapeW) m_ShapesW = shapeW;
+				if (m_ShapesH < shapeH) m_ShapesH = shapeH;
+			}
 		}
 
-		m_W = newW + GetWidthPadding();
-		m_H = newH + GetHeightPadding();
+		m_W = m_ShapesW + GetWidthPadding();
+		m_H = m_ShapesH + GetHeightPadding();
 	}
 }
 
@@ -435,12 +574,6 @@ bool MeterShape::CreateCombinedShape(size_t shapeId, std::vector<std::wstring>&
 		LogErrorF(this, L"%s %s \"%s\"", key.c_str(), description, error);
 	};
 
-	auto getShapeId = [=](const WCHAR* shape) -> size_t
-	{
-		int id = _wtoi(shape) - 1;
-		return id < 0 ? (size_t)0 : (size_t)id;
-	};
-
 	size_t parentId = 0;
 
 	if (args[0].length() < 8)
@@ -454,7 +587,7 @@ bool MeterShape::CreateCombinedShape(size_t shapeId, std::vector<std::wstring>&
 	std::wstring parentName = args[0].substr(8);  // Remove 'Combine '
 	if (StringUtil::CaseInsensitiveCompareN(parentName, L"SHAPE"))
 	{
-		parentId = getShapeId(parentName.c_str());
+		parentId = GetShapeId(parentName.c_str());
 		if (parentId == shapeId)
 		{
 			// Cannot use myself as a parent shape
@@ -515,7 +648,7 @@ bool MeterShape::CreateCombinedShape(size_t shapeId, std::vector<std::wstring>&
 		}
 
 		option.erase(0, 5);  // Remove 'Shape'
-		size_t id = getShapeId(option.c_str());
+		size_t id = GetShapeId(option.c_str());
 		if (id == shapeId)
 		{
 			// Cannot combine with myself
@@ -544,6 +677,71 @@ bool MeterShape::CreateCombinedShape(size_t shapeId, std::vector<std::wstring>&
 	return true;
 }
 
+/*
+** Returns |shape| along with the values of the options that it refers to (paths, gradients and
+** extended modifiers) so that a change to any of them can be detected.
+**
+*/
+std::wstring MeterShape::GetShapeDefinition(const std::wstring& shape, ConfigParser& parser, const WCHAR* section)
+{
+	std::wstring definition = shape;
+	auto args = ConfigParser::Tokenize2(shape, L'|', PairedPunctuation::Parentheses);
+	if (!args.empty())
+	{
+		std::wstring shapeName = args[0];
+		if (StringUtil::CaseInsensitiveCompareN(shapeName, L"PATH1") ||
+			StringUtil::CaseInsensitiveCompareN(shapeName, L"PATH"))
+		{
+			definition += L'\n';
+			definition += parser.ReadString(section, shapeName.c_str(), L"");
+		}
+
+		args.erase(args.begin());
+		AppendModifierOptions(definition, args, parser, section);
+	}
+
+	return definition;
+}
+
+/*
+** Appends the values of the gradient and Extend options used in |args| to |definition|.
+**
+*/
+void MeterShape::AppendModifierOptions(std::wstring& definition, std::vector<std::wstring>& args, ConfigParser& parser, const WCHAR* section, bool recursive)
+{
+	for (auto& option : args)
+	{
+		if (StringUtil::CaseInsensitiveCompareN(option, L"FILL") ||
+			StringUtil::CaseInsensitiveCompareN(option, L"STROKE"))
+		{
+			if (StringUtil::CaseInsensitiveCompareN(option, L"LINEARGRADIENT1") ||
+				StringUtil::CaseInsensitiveCompareN(option, L"LINEARGRADIENT") ||
+				StringUtil::CaseInsensitiveCompareN(option, L"RADIALGRADIENT1") ||
+				StringUtil::CaseInsensitiveCompareN(option, L"RADIALGRADIENT"))
+			{
+				definition += L'\n';
+				definition += parser.ReadString(section, option.c_str(), L"");
+			}
+		}
+		else if (!recursive && StringUtil::CaseInsensitiveCompareN(option, L"EXTEND"))
+		{
+			std::vector<std::wstring> extendParameters = ConfigParser::Tokenize(option, L",");
+			for (auto& extend : extendParameters)
+			{
+				std::wstring key = parser.ReadString(section, extend.c_str(), L"");
+				definition += L'\n';
+				definition += key;
+
+				if (!key.empty())
+				{
+					auto newArgs = ConfigParser::Tokenize2(key, L'|', PairedPunctuation::Parentheses);
+					AppendModifierOptions(definition, newArgs, parser, section, true);
+				}
+			}
+		}
+	}
+}
+
 void MeterShape::ParseModifiers(std::vector<std::wstring>& args, ConfigParser& parser, const WCHAR* section, bool recursive)
 {
 	auto parseCap = [this](std::wstring& cap) -> D2D1_CAP_STYLE
@@ -25,6 +25,9 @@ public:
 	virtual bool Update();
 	virtual bool Draw(Gfx::Canvas& canvas);
 
+	// Shapes may extend to negative coordinates or beyond W and H.
+	virtual bool IsDrawnWithinBounds() { return false; }
+
 	bool HitTest(int x, int y);
 
 protected:
@@ -37,12 +40,22 @@ private:
 	bool CreateShape(std::vector<std::wstring>& args, ConfigParser& parser, const WCHAR* section, bool& isCombined, size_t keyId);
 	bool CreateCombinedShape(size_t shapeId, std::vector<std::wstring>& args);
 
+	std::wstring GetShapeDefinition(const std::wstring& shape, ConfigParser& parser, const WCHAR* section);
+	void AppendModifierOptions(std::wstring& definition, std::vector<std::wstring>& args, ConfigParser& parser, const WCHAR* section, bool recursive = false);
+
 	void ParseModifiers(std::vector<std::wstring>& args, ConfigParser& parser, const WCHAR* section, bool recursive = false);
 	bool ParseTransformModifers(Gfx::Shape* shape, std::wstring& transform);
 	bool ParseGradient(Gfx::BrushType type, const WCHAR* options, bool altGamma, bool isStroke);
 	bool ParsePath(std::wstring& options, D2D1_FILL_MODE fillMode);
 
 	std::vector<Gfx::Shape*> m_Shapes;
+
+	// Definition of each shape in |m_Shapes| when it was created.
+	std::vector<std::wstring> m_ShapeDefinitions;
+
+	// Size of the drawn shapes without the padding.
+	int m_ShapesW;
+	int m_ShapesH;
 };
 
 #endif
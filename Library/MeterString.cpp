@@ -320,6 +320,8 @@ bool MeterString::Update()
 		int decimals = (m_NumOfDecimals != -1) ? m_NumOfDecimals : (m_NoDecimals && (m_Percentual || m_AutoScale == AUTOSCALE_OFF)) ? 0 : 1;
 
 		// Create the text
+		std::wstring oldString;
+		oldString.swap(m_String);
 		m_String = m_Prefix;
 		if (!m_Measures.empty())
 		{
@@ -375,6 +377,11 @@ bool MeterString::Update()
 			}
 		}
 
+		if (m_String != oldString)
+		{
+			SetDamaged();
+		}
+
 		m_TextFormat->SetFontWeight(m_FontWeight);
 		m_TextFormat->FindInlineRanges(m_String);
 
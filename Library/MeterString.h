@@ -31,6 +31,12 @@ public:
 	virtual bool Draw(Gfx::Canvas& canvas);
 	Gdiplus::RectF GetRect() { return m_Rect; }
 
+	// Unclipped text can overflow a defined W or H.
+	virtual bool IsDrawnWithinBounds()
+	{
+		return m_Angle == 0.0f && (m_ClipType != CLIP_OFF || (!m_WDefined && !m_HDefined));
+	}
+
 	static void EnumerateInstalledFontFamilies();
 
 	static void InitializeStatic();
@@ -0,0 +1,109 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "Profiler.h"
+#include "Measure.h"
+#include "Meter.h"
+#include "Skin.h"
+#include "Logger.h"
+
+namespace Profiler {
+
+#if RM_PROFILER
+namespace {
+
+void AddEntry(std::vector<Entry>& entries, const std::wstring& name, const WCHAR* activity, const ProfileStats& stats)
+{
+	if (stats.count > 0)
+	{
+		Entry entry = { name, activity, stats };
+		entries.push_back(entry);
+	}
+}
+
+void AddSectionEntries(std::vector<Entry>& entries, Section* section)
+{
+	const SectionProfile& profile = section->GetProfile();
+	AddEntry(entries, section->GetOriginalName(), L"Update", profile.update);
+	AddEntry(entries, section->GetOriginalName(), L"ReadOptions", profile.readOptions);
+	AddEntry(entries, section->GetOriginalName(), L"Draw", profile.draw);
+}
+
+}  // namespace
+#endif
+
+double ToMilliseconds(LONGLONG ticks)
+{
+	static LARGE_INTEGER s_Frequency = []()
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return frequency;
+	} ();
+
+	return ticks * 1000.0 / s_Frequency.QuadPart;
+}
+
+std::vector<Entry> GetEntries(Skin* skin)
+{
+	std::vector<Entry> entries;
+
+#if RM_PROFILER
+	const SkinProfile& profile = skin->GetProfile();
+	AddEntry(entries, L"Rainmeter", L"Update", profile.update);
+	AddEntry(entries, L"Rainmeter", L"Redraw", profile.redraw);
+
+	for (auto* measure : skin->GetMeasures())
+	{
+		AddSectionEntries(entries, measure);
+	}
+
+	for (auto* meter : skin->GetMeters())
+	{
+		AddSectionEntries(entries, meter);
+	}
+
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs)
+	{
+		return lhs.stats.total > rhs.stats.total;
+	});
+#endif
+
+	return entries;
+}
+
+void LogCSV(Skin* skin)
+{
+#if RM_PROFILER
+	LogNoticeF(skin, L"Section,Activity,Count,Total (ms),Average (ms),Max (ms)");
+
+	std::wstring name;
+	for (const auto& entry : GetEntries(skin))
+	{
+		name = entry.name;
+		if (name.find_first_of(L",\"") != std::wstring::npos)
+		{
+			for (size_t pos = 0; (pos = name.find(L'"', pos)) != std::wstring::npos; pos += 2)
+			{
+				name.insert(pos, 1, L'"');
+			}
+			name.insert(0, 1, L'"');
+			name += L'"';
+		}
+
+		const double total = ToMilliseconds(entry.stats.total);
+		LogNoticeF(skin, L"%s,%s,%llu,%.3f,%.4f,%.3f",
+			name.c_str(), entry.activity, entry.stats.count, total,
+			total / entry.stats.count, ToMilliseconds(entry.stats.max));
+	}
+#else
+	LogNoticeF(skin, L"!ProfileDump: Profiler not available in this build");
+#endif
+}
+
+}  // namespace Profiler
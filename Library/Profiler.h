@@ -0,0 +1,109 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_PROFILER_H_
+#define RM_LIBRARY_PROFILER_H_
+
+#include <windows.h>
+#include <string>
+#include <vector>
+
+// Define RM_PROFILER=0 in the preprocessor definitions to compile out the instrumentation of
+// skin updates. PROFILE_SCOPE() then expands to nothing and the timings are not stored.
+#ifndef RM_PROFILER
+#define RM_PROFILER 1
+#endif
+
+class Skin;
+
+// Count, total and maximum duration of a profiled activity.
+struct ProfileStats
+{
+	ProfileStats() : count(), total(), max() {}
+
+	void Add(LONGLONG ticks)
+	{
+		++count;
+		total += ticks;
+		if (ticks > max) max = ticks;
+	}
+
+	UINT64 count;
+	LONGLONG total;		// In QueryPerformanceCounter ticks
+	LONGLONG max;
+};
+
+// Timings of a measure or meter. Update includes the time spent in ReadOptions when the options
+// are read again due to DynamicVariables=1.
+struct SectionProfile
+{
+	ProfileStats update;
+	ProfileStats readOptions;
+	ProfileStats draw;
+};
+
+// Timings of Skin::Update and Skin::Redraw.
+struct SkinProfile
+{
+	ProfileStats update;
+	ProfileStats redraw;
+};
+
+namespace Profiler {
+
+// Row of the results of a skin.
+struct Entry
+{
+	std::wstring name;		// Section name or "Rainmeter" for the skin itself.
+	const WCHAR* activity;	// "Update", "Redraw", "ReadOptions" or "Draw".
+	ProfileStats stats;
+};
+
+double ToMilliseconds(LONGLONG ticks);
+
+// Returns the activities of |skin| that have run at least once, slowest (in total) first.
+std::vector<Entry> GetEntries(Skin* skin);
+
+// Logs the results of |skin| as CSV.
+void LogCSV(Skin* skin);
+
+}  // namespace Profiler
+
+#if RM_PROFILER
+
+// Adds the time from construction to destruction to the stats.
+class ScopedProfile
+{
+public:
+	ScopedProfile(ProfileStats& stats) : m_Stats(stats) { QueryPerformanceCounter(&m_Start); }
+
+	~ScopedProfile()
+	{
+		LARGE_INTEGER stop;
+		QueryPerformanceCounter(&stop);
+		m_Stats.Add(stop.QuadPart - m_Start.QuadPart);
+	}
+
+	ScopedProfile(const ScopedProfile& other) = delete;
+	ScopedProfile& operator=(ScopedProfile other) = delete;
+
+private:
+	ProfileStats& m_Stats;
+	LARGE_INTEGER m_Start;
+};
+
+#define PROFILE_SCOPE_NAME2(line) profileScope##line
+#define PROFILE_SCOPE_NAME(line) PROFILE_SCOPE_NAME2(line)
+#define PROFILE_SCOPE(stats) ScopedProfile PROFILE_SCOPE_NAME(__LINE__)(stats)
+
+#else
+
+#define PROFILE_SCOPE(stats) ((void)0)
+
+#endif
+
+#endif
@@ -17,7 +17,10 @@
 #include "DialogNewSkin.h"
 #include "MeasureNet.h"
 #include "MeasureCPU.h"
+#include "MeasureWorkerPool.h"
+#include "WebFetchPool.h"
 #include "MeterString.h"
+#include "ImageCachePool.h"
 #include "UpdateCheck.h"
 #include "../Version.h"
 
@@ -365,8 +368,15 @@ int Rainmeter::Initialize(LPCWSTR iniPath, LPCWSTR layout)
 
 	MeasureNet::InitializeStatic();
 	MeasureCPU::InitializeStatic();
+	MeasureWorkerPool::InitializeStatic();
+	WebFetchPool::InitializeStatic();
 	MeterString::InitializeStatic();
 
+	// Parsed skins are kept next to the WebParser cache so that they are not read again at logon.
+	WCHAR tempPath[MAX_PATH];
+	GetTempPath(_countof(tempPath), tempPath);
+	ConfigParser::SetParsedSkinDirectory(std::wstring(tempPath) + L"Rainmeter-Cache\\Skins\\");
+
 	// Tray must exist before skins are read
 	m_TrayIcon = new TrayIcon();
 	m_TrayIcon->Initialize();
@@ -430,8 +440,13 @@ void Rainmeter::Finalize()
 
 	MeasureNet::FinalizeStatic();
 	MeasureCPU::FinalizeStatic();
+	MeasureWorkerPool::FinalizeStatic();
+	WebFetchPool::FinalizeStatic();
 	MeterString::FinalizeStatic();
 
+	// Delete the cached images that are no longer used by any skin.
+	ImageCachePool::SetMaxUnusedSize(0);
+
 	Gfx::Canvas::Finalize();
 
 	// Change the work area back
@@ -1328,6 +1343,10 @@ void Rainmeter::ReadGeneralSettings(const std::wstring& iniFile)
 	m_GlobalOptions.netInSpeed = parser.ReadFloat(L"Rainmeter", L"NetInSpeed", 0.0);
 	m_GlobalOptions.netOutSpeed = parser.ReadFloat(L"Rainmeter", L"NetOutSpeed", 0.0);
 
+	// Memory (in MB) of the decoded images that are kept after no skin uses them.
+	const int imageCacheSize = parser.ReadInt(L"Rainmeter", L"ImageCacheSize", 64);
+	ImageCachePool::SetMaxUnusedSize((UINT64)max(0, imageCacheSize) * 1024 * 1024);
+
 	m_DisableDragging = parser.ReadBool(L"Rainmeter", L"DisableDragging", false);
 	m_DisableRDP = parser.ReadBool(L"Rainmeter", L"DisableRDP", false);
 
@@ -0,0 +1,151 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "RegExp.h"
+#include "System.h"
+
+namespace {
+
+// Patterns are compiled from the UI thread (Substitute, IfMatch) as well as from the WebParser
+// threads, so the cache is guarded by a critical section.
+class RegExpCachePool
+{
+public:
+	RegExpCachePool()
+	{
+		System::InitializeCriticalSection(&m_CriticalSection);
+	}
+
+	~RegExpCachePool()
+	{
+		DeleteCriticalSection(&m_CriticalSection);
+	}
+
+	static std::wstring CreateKey(const std::wstring& pattern, int options)
+	{
+		WCHAR buffer[16];
+		size_t len = _snwprintf_s(buffer, _TRUNCATE, L"%x:", options);
+
+		std::wstring key(buffer, len);
+		key += pattern;
+		return key;
+	}
+
+	std::shared_ptr<const RegExp> GetCache(const std::wstring& key)
+	{
+		EnterCriticalSection(&m_CriticalSection);
+		std::shared_ptr<const RegExp> regExp;
+		auto iter = m_CacheMap.find(key);
+		if (iter != m_CacheMap.end())
+		{
+			regExp = iter->second.lock();
+		}
+		LeaveCriticalSection(&m_CriticalSection);
+		return regExp;
+	}
+
+	void AddCache(const std::wstring& key, const std::shared_ptr<const RegExp>& regExp)
+	{
+		EnterCriticalSection(&m_CriticalSection);
+		m_CacheMap[key] = regExp;
+		LeaveCriticalSection(&m_CriticalSection);
+	}
+
+	void RemoveCache(const std::wstring& key)
+	{
+		EnterCriticalSection(&m_CriticalSection);
+		auto iter = m_CacheMap.find(key);
+		if (iter != m_CacheMap.end() && iter->second.expired())
+		{
+			// Only erase if the entry was not replaced by a new instance in the meantime.
+			m_CacheMap.erase(iter);
+		}
+		LeaveCriticalSection(&m_CriticalSection);
+	}
+
+private:
+	std::unordered_map<std::wstring, std::weak_ptr<const RegExp>> m_CacheMap;
+	CRITICAL_SECTION m_CriticalSection;
+};
+
+RegExpCachePool& GetCachePool()
+{
+	static RegExpCachePool s_CachePool;
+	return s_CachePool;
+}
+
+}  // namespace
+
+RegExp::RegExp(const std::wstring& pattern, int options) :
+	m_Pattern(pattern),
+	m_Options(options),
+	m_Code(),
+	m_Extra(),
+	m_Error(),
+	m_ErrorOffset()
+{
+	m_Code = pcre16_compile(
+		(PCRE_SPTR16)m_Pattern.c_str(),
+		m_Options,
+		&m_Error,
+		&m_ErrorOffset,
+		nullptr);  // Use default character tables.
+
+	if (m_Code)
+	{
+#ifdef SUPPORT_JIT
+		const int studyOptions = PCRE_STUDY_JIT_COMPILE;
+#else
+		const int studyOptions = 0;
+#endif
+
+		// Study failures only mean that the pattern is matched without the extra data.
+		const char* studyError;
+		m_Extra = pcre16_study(m_Code, studyOptions, &studyError);
+	}
+}
+
+RegExp::~RegExp()
+{
+	if (m_Extra)
+	{
+		pcre16_free_study(m_Extra);
+	}
+
+	if (m_Code)
+	{
+		pcre16_free(m_Code);
+	}
+}
+
+std::shared_ptr<const RegExp> RegExp::Compile(const std::wstring& pattern, int options)
+{
+	RegExpCachePool& pool = GetCachePool();
+	const std::wstring key = RegExpCachePool::CreateKey(pattern, options);
+
+	std::shared_ptr<const RegExp> regExp = pool.GetCache(key);
+	if (!regExp)
+	{
+		regExp.reset(new RegExp(pattern, options), [key](const RegExp* regExp)
+		{
+			GetCachePool().RemoveCache(key);
+			delete regExp;
+		});
+		pool.AddCache(key, regExp);
+	}
+
+	return regExp;
+}
+
+int RegExp::Exec(
+	const WCHAR* subject, int length, int startOffset, int options, int* ovector, int ovecSize) const
+{
+	if (!m_Code) return PCRE_ERROR_NULL;
+
+	return pcre16_exec(m_Code, m_Extra, (PCRE_SPTR16)subject, length, startOffset, options, ovector, ovecSize);
+}
@@ -0,0 +1,52 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_REGEXP_H_
+#define RM_LIBRARY_REGEXP_H_
+
+#include <windows.h>
+#include <memory>
+#include <string>
+#include "pcre/config.h"
+#include "pcre/pcre.h"
+
+// Compiled and studied PCRE pattern. Instances are shared between all options that use the same
+// pattern and compile options, and are kept alive only as long as some option references them.
+class RegExp
+{
+public:
+	~RegExp();
+
+	RegExp(const RegExp& other) = delete;
+	RegExp& operator=(RegExp other) = delete;
+
+	// Returns the compiled form of |pattern|. The result is never null. If compilation failed,
+	// IsValid() returns false and GetError() describes the error.
+	static std::shared_ptr<const RegExp> Compile(const std::wstring& pattern, int options = PCRE_UTF16);
+
+	bool IsValid() const { return m_Code != nullptr; }
+	const std::wstring& GetPattern() const { return m_Pattern; }
+	int GetOptions() const { return m_Options; }
+	const char* GetError() const { return m_Error; }
+	int GetErrorOffset() const { return m_ErrorOffset; }
+
+	int Exec(
+		const WCHAR* subject, int length, int startOffset, int options,
+		int* ovector, int ovecSize) const;
+
+private:
+	RegExp(const std::wstring& pattern, int options);
+
+	std::wstring m_Pattern;
+	int m_Options;
+	pcre16* m_Code;
+	pcre16_extra* m_Extra;
+	const char* m_Error;
+	int m_ErrorOffset;
+};
+
+#endif
@@ -10,9 +10,10 @@
 
 #include <windows.h>
 #include <string>
+#include "ConfigParser.h"
 #include "Group.h"
+#include "Profiler.h"
 
-class ConfigParser;
 class Skin;
 
 class __declspec(novtable) Section : public Group
@@ -39,6 +40,12 @@ public:
 
 	Skin* GetSkin() { return m_Skin; }
 
+	const ConfigParser::Dependencies& GetDependencies() const { return m_Dependencies; }
+
+#if RM_PROFILER
+	SectionProfile& GetProfile() { return m_Profile; }
+#endif
+
 protected:
 	Section(Skin* skin, const WCHAR* name);
 
@@ -56,6 +63,13 @@ protected:
 
 	std::wstring m_OnUpdateAction;
 
+	// What the options were read from the last time.
+	ConfigParser::Dependencies m_Dependencies;
+
+#if RM_PROFILER
+	SectionProfile m_Profile;
+#endif
+
 	Skin* m_Skin;
 };
 
@@ -24,6 +24,8 @@
 #include "MeterString.h"
 #include "TintedImage.h"
 #include "MeasureScript.h"
+#include "Profiler.h"
+#include "DamageRect.h"
 #include "../Version.h"
 #include "../Common/PathUtil.h"
 
@@ -58,6 +60,7 @@ bool Skin::c_IsInSelectionMode = false;
 Skin::Skin(const std::wstring& folderPath, const std::wstring& file) : m_FolderPath(folderPath), m_FileName(file),
 	m_Canvas(),
 	m_Background(),
+	m_BackgroundGeneration(),
 	m_BackgroundSize(),
 	m_Window(),
 	m_Mouse(this),
@@ -163,6 +166,9 @@ Skin::~Skin()
 
 	Dispose(false);
 
+	// The parsed skin is still restored from the parsed skin directory when loaded again.
+	ConfigParser::RemoveParsedSkin(GetFilePath());
+
 	--c_InstanceCount;
 
 	if (c_InstanceCount == 0)
@@ -203,6 +209,7 @@ void Skin::Dispose(bool refresh)
 	// Destroy the measures
 	for (auto i = m_Measures.begin(); i != m_Measures.end(); ++i)
 	{
+		(*i)->FinishAsyncUpdate();
 		delete (*i);
 	}
 	m_Measures.clear();
@@ -1042,6 +1049,10 @@ void Skin::DoBang(Bang bang, const std::vector<std::wstring>& args)
 	case Bang::SkinCustomMenu:
 		Rainmeter::GetInstance().ShowSkinCustomContextMenu(System::GetCursorPosition(), this);
 		break;
+
+	case Bang::ProfileDump:
+		Profiler::LogCSV(this);
+		break;
 	}
 }
 
@@ -2071,6 +2082,7 @@ bool Skin::ReadSkin()
 	m_Parser.Initialize(iniFile, this, nullptr, &resourcePath);
 
 	m_Canvas.SetAccurateText(m_Parser.ReadBool(L"Rainmeter", L"AccurateText", false));
+	m_Canvas.SetSoftwareRendering(m_Parser.ReadBool(L"Rainmeter", L"SoftwareRendering", false));
 
 	// Gotta have some kind of buffer during initialization
 	CreateDoubleBuffer(1, 1);
@@ -2534,6 +2546,7 @@ bool Skin::ResizeWindow(bool reset)
 			}
 
 			m_Background = background;
+			m_BackgroundGeneration = Gfx::BitmapCache::NewGeneration();
 
 			// Get the size form the background bitmap
 			m_WindowW = m_Background->GetWidth();
@@ -2571,6 +2584,55 @@ void Skin::CreateDoubleBuffer(int cx, int cy)
 */
 void Skin::Redraw()
 {
+	Redraw(nullptr);
+}
+
+/*
+** Redraws the area of the meters that have been updated, moved, resized or hidden since they were
+** last drawn. The whole skin is redrawn if the area cannot be determined.
+**
+*/
+void Skin::RedrawDamaged()
+{
+	if (m_ResizeWindow)
+	{
+		ResizeWindow(m_ResizeWindow == RESIZEMODE_RESET);
+		SetResizeWindowMode(RESIZEMODE_NONE);
+	}
+
+	if (m_WindowW == 0 || m_WindowH == 0 ||
+		m_WindowW != m_Canvas.GetW() || m_WindowH != m_Canvas.GetH())
+	{
+		Redraw(nullptr);
+		return;
+	}
+
+	DamageRect damage;
+	for (auto* meter : m_Meters)
+	{
+		damage.AddMeter(meter->IsDamaged(), meter->GetDrawnBounds(), meter->GetDrawBounds(), meter->IsDrawnWithinBounds());
+		if (damage.IsFull())
+		{
+			Redraw(nullptr);
+			return;
+		}
+	}
+
+	const Rect damaged = damage.GetRect(m_WindowW, m_WindowH);
+	if (!damaged.IsEmptyArea())
+	{
+		Redraw(&damaged);
+	}
+}
+
+/*
+** Redraws the meters within |clip| (or all of them if nullptr) and paints the window.
+**
+*/
+void Skin::Redraw(const Rect* clip)
+{
+	PROFILE_SCOPE(m_Profile.redraw);
+
 	if (m_ResizeWindow)
 	{
 		ResizeWindow(m_ResizeWindow == RESIZEMODE_RESET);
@@ -2600,6 +2662,11 @@ void Skin::Redraw()
 		return;
 	}
 
+	if (clip)
+	{
+		m_Canvas.SetClip(*clip);
+	}
+
 	m_Canvas.Clear();
 
 	if (m_WindowW != 0 && m_WindowH != 0)
@@ -2608,7 +2675,7 @@ void Skin::Redraw()
 		{
 			const Rect dst(0, 0, m_WindowW, m_WindowH);
 			const Rect src(0, 0, m_Background->GetWidth(), m_Background->GetHeight());
-			m_Canvas.DrawBitmap(m_Background, dst, src);
+			m_Canvas.DrawBitmap(m_Background, dst, src, m_BackgroundGeneration);
 		}
 		else if (m_BackgroundMode == BGMODE_SOLID)
 		{
@@ -2654,6 +2721,16 @@ void Skin::Redraw()
 		std::vector<Meter*>::const_iterator j = m_Meters.begin();
 		for ( ; j != m_Meters.end(); ++j)
 		{
+			const Rect bounds = (*j)->GetDrawBounds();
+			(*j)->SetDrawnBounds(bounds);
+
+			if (clip && (*j)->IsDrawnWithinBounds() && !bounds.IntersectsWith(*clip))
+			{
+				continue;
+			}
+
+			PROFILE_SCOPE((*j)->GetProfile().draw);
+
 			const Matrix* matrix = (*j)->GetTransformationMatrix();
 			if (matrix && !matrix->IsIdentity())
 			{
@@ -2675,7 +2752,17 @@ void Skin::Redraw()
 		}
 	}
 
-	UpdateWindow(m_TransparencyValue, true);
+	if (clip)
+	{
+		m_Canvas.ResetClip();
+
+		const RECT dirty = { clip->GetLeft(), clip->GetTop(), clip->GetRight(), clip->GetBottom() };
+		UpdateWindow(m_TransparencyValue, true, &dirty);
+	}
+	else
+	{
+		UpdateWindow(m_TransparencyValue, true);
+	}
 
 	m_Canvas.EndDraw();
 }
@@ -2705,6 +2792,8 @@ void Skin::PostUpdate(bool bActiveTransition)
 */
 bool Skin::UpdateMeasure(Measure* measure, bool force)
 {
+	PROFILE_SCOPE(measure->GetProfile().update);
+
 	bool bUpdate = false;
 
 	if (force)
@@ -2729,6 +2818,8 @@ bool Skin::UpdateMeasure(Measure* measure, bool force)
 */
 bool Skin::UpdateMeter(Meter* meter, bool& bActiveTransition, bool force)
 {
+	PROFILE_SCOPE(meter->GetProfile().update);
+
 	bool bUpdate = false;
 
 	if (force)
@@ -2740,11 +2831,13 @@ bool Skin::UpdateMeter(Meter* meter, bool& bActiveTransition, bool force)
 	if (updateDivider >= 0 || force)
 	{
 		if (meter->HasDynamicVariables() &&
-			(meter->GetUpdateCounter() + 1) >= updateDivider)
+			(meter->GetUpdateCounter() + 1) >= updateDivider &&
+			m_Parser.HasChanged(meter->GetDependencies()))
 		{
 			meter->ReadOptions(m_Parser);
 		}
 
+		// The meters mark themselves as damaged when their output changes.
 		bUpdate = meter->Update();
 	}
 
@@ -2776,6 +2869,8 @@ bool Skin::UpdateMeter(Meter* meter, bool& bActiveTransition, bool force)
 */
 void Skin::Update(bool refresh)
 {
+	PROFILE_SCOPE(m_Profile.update);
+
 	++m_UpdateCounter;
 
 	if (!m_Measures.empty())
@@ -2828,7 +2923,14 @@ void Skin::Update(bool refresh)
 		// Only redraw if we are not in a remote session
 		if (GetRainmeter().IsRedrawable())
 		{
-			Redraw();
+			if (refresh)
+			{
+				Redraw();
+			}
+			else
+			{
+				RedrawDamaged();
+			}
 		}
 	}
 
@@ -2845,7 +2947,7 @@ void Skin::Update(bool refresh)
 ** Updates the window contents
 **
 */
-void Skin::UpdateWindow(int alpha, bool canvasBeginDrawCalled)
+void Skin::UpdateWindow(int alpha, bool canvasBeginDrawCalled, const RECT* dirty)
 {
 	BLENDFUNCTION blendPixelFunction = {AC_SRC_OVER, 0, (BYTE)alpha, AC_SRC_ALPHA};
 	POINT ptWindowScreenPosition = {m_ScreenX, m_ScreenY};
@@ -2855,12 +2957,23 @@ void Skin::UpdateWindow(int alpha, bool canvasBeginDrawCalled)
 	if (!canvasBeginDrawCalled) m_Canvas.BeginDraw();
 
 	HDC dcMemory = m_Canvas.GetDC();
-	if (!UpdateLayeredWindow(m_Window, nullptr, &ptWindowScreenPosition, &szWindow, dcMemory, &ptSrc, 0, &blendPixelFunction, ULW_ALPHA))
-	{
-		// Retry after resetting WS_EX_LAYERED flag.
+
+	UPDATELAYEREDWINDOWINFO info = {sizeof(UPDATELAYEREDWINDOWINFO)};
+	info.pptDst = &ptWindowScreenPosition;
+	info.psize = &szWindow;
+	info.hdcSrc = dcMemory;
+	info.pptSrc = &ptSrc;
+	info.pblend = &blendPixelFunction;
+	info.dwFlags = ULW_ALPHA;
+	info.prcDirty = dirty;  // Only the dirty area is copied to the window when set.
+	if (!UpdateLayeredWindowIndirect(m_Window, &info))
+	{
+		// Retry after resetting WS_EX_LAYERED flag. The whole window is updated since the
+		// previous contents are lost.
 		RemoveWindowExStyle(WS_EX_LAYERED);
 		AddWindowExStyle(WS_EX_LAYERED);
-		UpdateLayeredWindow(m_Window, nullptr, &ptWindowScreenPosition, &szWindow, dcMemory, &ptSrc, 0, &blendPixelFunction, ULW_ALPHA);
+		info.prcDirty = nullptr;
+		UpdateLayeredWindowIndirect(m_Window, &info);
 	}
 	m_Canvas.ReleaseDC(dcMemory);
 
@@ -16,6 +16,7 @@
 #include "ConfigParser.h"
 #include "Group.h"
 #include "Mouse.h"
+#include "Profiler.h"
 #include "../Common/Gfx/Canvas.h"
 
 #define BEGIN_MESSAGEPROC switch (uMsg) {
@@ -207,6 +208,10 @@ public:
 	Meter* GetMeter(const std::wstring& meterName);
 	Measure* GetMeasure(const std::wstring& measureName) { return m_Parser.GetMeasure(measureName); }
 
+#if RM_PROFILER
+	const SkinProfile& GetProfile() { return m_Profile; }
+#endif
+
 	friend class DialogManage;
 
 protected:
@@ -289,7 +294,7 @@ private:
 	bool UpdateMeasure(Measure* measure, bool force);
 	bool UpdateMeter(Meter* meter, bool& bActiveTransition, bool force);
 	void Update(bool refresh);
-	void UpdateWindow(int alpha, bool canvasBeginDrawCalled = false);
+	void UpdateWindow(int alpha, bool canvasBeginDrawCalled = false, const RECT* dirty = nullptr);
 	void UpdateWindowTransparency(int alpha);
 	void ReadOptions();
 	void WriteOptions(INT setting = OPTION_ALL);
@@ -326,12 +331,15 @@ private:
 
 	void Dispose(bool refresh);
 	void CreateDoubleBuffer(int cx, int cy);
+	void Redraw(const Gdiplus::Rect* clip);
+	void RedrawDamaged();
 
 	Gfx::Canvas m_Canvas;
 
 	ConfigParser m_Parser;
 
 	Gdiplus::Bitmap* m_Background;
+	UINT m_BackgroundGeneration;
 	SIZE m_BackgroundSize;
 
 	HWND m_Window;
@@ -439,6 +447,10 @@ private:
 	int m_UpdateCounter;
 	UINT m_MouseMoveCounter;
 
+#if RM_PROFILER
+	SkinProfile m_Profile;
+#endif
+
 	Gfx::FontCollection* m_FontCollection;
 
 	bool m_ToolTipHidden;
@@ -8,6 +8,7 @@
 #include "StdAfx.h"
 #include "../Common/PathUtil.h"
 #include "TintedImage.h"
+#include "ImageCachePool.h"
 #include "ConfigParser.h"
 #include "System.h"
 #include "Logger.h"
@@ -15,101 +16,7 @@
 using namespace Gdiplus;
 
 
-class ImageCachePool
-{
-public:
-	static std::wstring CreateKey(const std::wstring& name, ULONGLONG time, DWORD size, WCHAR* exifOrientation)
-	{
-		std::wstring key;
-
-		WCHAR buffer[MAX_PATH];
-		if (PathCanonicalize(buffer, name.c_str()))
-		{
-			key = buffer;
-		}
-		else
-		{
-			key = name;
-		}
-		_wcsupr(&key[0]);
-
-		size_t len = _snwprintf_s(buffer, _TRUNCATE, L":%llx:%x:%s", time, size, exifOrientation);
-		key.append(buffer, len);
-
-		return key;
-	}
 
-	static Bitmap* GetCache(const std::wstring& key)
-	{
-		std::unordered_map<std::wstring, ImageCache*>::const_iterator iter = c_CacheMap.find(key);
-		if (iter != c_CacheMap.end())
-		{
-			return (*iter).second->GetCache();
-		}
-		return nullptr;
-	}
-
-	static void AddCache(const std::wstring& key, Bitmap* bitmap, HGLOBAL hBuffer)
-	{
-		std::unordered_map<std::wstring, ImageCache*>::const_iterator iter = c_CacheMap.find(key);
-		if (iter != c_CacheMap.end())
-		{
-			(*iter).second->AddRef();
-			//LogDebugF(L"* ADD: key=%s, ref=%i", key.c_str(), (*iter).second->GetRef());
-		}
-		else
-		{
-			c_CacheMap[key] = new ImageCache(bitmap, hBuffer);
-			//LogDebugF(L"* ADD: key=%s, ref=new", key.c_str());
-		}
-	}
-
-	static void RemoveCache(const std::wstring& key)
-	{
-		std::unordered_map<std::wstring, ImageCache*>::const_iterator iter = c_CacheMap.find(key);
-		if (iter != c_CacheMap.end())
-		{
-			ImageCache* cache = (*iter).second;
-			cache->Release();
-			//LogDebugF(L"* REMOVE: key=%s, ref=%i", key.c_str(), cache->GetRef());
-
-			if (cache->IsInvalid())
-			{
-				//LogDebugF(L"* EMPTY-ERASE: key=%s", key.c_str());
-				c_CacheMap.erase(iter);
-				delete cache;
-			}
-		}
-	}
-
-private:
-	class ImageCache
-	{
-	public:
-		ImageCache(Bitmap* bitmap, HGLOBAL hBuffer) : m_Bitmap(bitmap), m_hBuffer(hBuffer), m_Ref(1) {}
-		~ImageCache() { Dispose(); }
-
-		void AddRef() { ++m_Ref; }
-		void Release() { if (m_Ref > 0) { --m_Ref; } if (m_Ref == 0) { Dispose(); } }
-
-		bool IsInvalid() { return m_Ref == 0; }
-		//int GetRef() { return m_Ref; }
-		Bitmap* GetCache() { return m_Bitmap; }
-
-	private:
-		ImageCache() {}
-		ImageCache(const ImageCache& cache) {}
-
-		void Dispose() { delete m_Bitmap; m_Bitmap = nullptr; if (m_hBuffer) { ::GlobalFree(m_hBuffer); m_hBuffer = nullptr; } }
-
-		Bitmap* m_Bitmap;
-		HGLOBAL m_hBuffer;
-		int m_Ref;
-	};
-
-	static std::unordered_map<std::wstring, ImageCache*> c_CacheMap;
-};
-std::unordered_map<std::wstring, ImageCachePool::ImageCache*> ImageCachePool::c_CacheMap;
 
 
 #define PI	(3.14159265f)
@@ -143,6 +50,8 @@ TintedImage::TintedImage(const WCHAR* name, const WCHAR** optionArray, bool disa
 	m_OptionArray(optionArray ? optionArray : c_DefaultOptionArray),
 	m_Bitmap(),
 	m_BitmapTint(),
+	m_BitmapGeneration(),
+	m_BitmapTintGeneration(),
 	m_NeedsCrop(false),
 	m_NeedsTinting(false),
 	m_NeedsTransform(false),
@@ -171,18 +80,34 @@ TintedImage::~TintedImage()
 */
 void TintedImage::DisposeImage()
 {
-	delete m_BitmapTint;
-	m_BitmapTint = nullptr;
+	DisposeTintedImage();
 
 	m_Bitmap = nullptr;
+	m_BitmapGeneration = 0;
 
 	if (!m_CacheKey.empty())
 	{
-		ImageCachePool::RemoveCache(m_CacheKey);
+		ImageCachePool::Release(m_CacheKey);
 		m_CacheKey.clear();
 	}
 }
 
+/*
+** Disposes the cropped, tinted and transformed copy of the image.
+**
+*/
+void TintedImage::DisposeTintedImage()
+{
+	m_BitmapTint = nullptr;
+	m_BitmapTintGeneration = 0;
+
+	if (!m_TintCacheKey.empty())
+	{
+		ImageCachePool::Release(m_TintCacheKey);
+		m_TintCacheKey.clear();
+	}
+}
+
 /*
 ** Loads the image from file handle
 **
@@ -325,17 +250,20 @@ void TintedImage::LoadImage(const std::wstring& imageName, bool bLoadAlways)
 			{
 				DisposeImage();
 
-				Bitmap* bitmap = ImageCachePool::GetCache(key);
-				HGLOBAL hBuffer = nullptr;
-
-				m_Bitmap = (bitmap) ?
-					bitmap :
-					LoadImageFromFileHandle(fileHandle, fileSize, &hBuffer);
+				m_Bitmap = ImageCachePool::Get(key, &m_BitmapGeneration);
+				if (!m_Bitmap)
+				{
+					HGLOBAL hBuffer = nullptr;
+					m_Bitmap = LoadImageFromFileHandle(fileHandle, fileSize, &hBuffer);
+					if (m_Bitmap)
+					{
+						m_BitmapGeneration = ImageCachePool::Add(key, m_Bitmap, hBuffer);
+					}
+				}
 
 				if (m_Bitmap)
 				{
 					m_CacheKey = key;
-					ImageCachePool::AddCache(key, m_Bitmap, hBuffer);
 
 					// Check whether the new image needs tinting (or cropping, flipping, rotating)
 					if (!m_NeedsCrop)
@@ -372,17 +300,31 @@ void TintedImage::LoadImage(const std::wstring& imageName, bool bLoadAlways)
 				// We need a copy of the image if has tinting (or flipping, rotating)
 				if (m_NeedsCrop || m_NeedsTinting || m_NeedsTransform)
 				{
-					delete m_BitmapTint;
-					m_BitmapTint = nullptr;
+					DisposeTintedImage();
 
-					if (m_Bitmap->GetWidth() > 0 && m_Bitmap->GetHeight() > 0)
+					const std::wstring tintKey = CreateTintCacheKey();
+					if (!tintKey.empty() && m_Bitmap->GetWidth() > 0 && m_Bitmap->GetHeight() > 0)
 					{
-						ApplyCrop();
+						m_BitmapTint = ImageCachePool::Get(tintKey, &m_BitmapTintGeneration);
+						if (!m_BitmapTint)
+						{
+							ApplyCrop();
+
+							if (!m_BitmapTint || (m_BitmapTint->GetWidth() > 0 && m_BitmapTint->GetHeight() > 0))
+							{
+								ApplyTint();
+								ApplyTransform();
+							}
+
+							if (m_BitmapTint)
+							{
+								m_BitmapTintGeneration = ImageCachePool::Add(tintKey, m_BitmapTint);
+							}
+						}
 
-						if (!m_BitmapTint || (m_BitmapTint->GetWidth() > 0 && m_BitmapTint->GetHeight() > 0))
+						if (m_BitmapTint)
 						{
-							ApplyTint();
-							ApplyTransform();
+							m_TintCacheKey = tintKey;
 						}
 					}
 
@@ -409,6 +351,49 @@ void TintedImage::LoadImage(const std::wstring& imageName, bool bLoadAlways)
 	}
 }
 
+/*
+** Returns the cache key of the cropped, tinted and transformed image or an empty string if the
+** options do not change the image.
+**
+*/
+std::wstring TintedImage::CreateTintCacheKey()
+{
+	const bool useCrop = m_Crop.Width >= 0 && m_Crop.Height >= 0;
+	const bool useTint = m_GreyScale || !CompareColorMatrix(m_ColorMatrix, &c_IdentityMatrix);
+	const bool useTransform = m_Rotate != 0.0f || m_Flip != RotateNoneFlipNone;
+	if (!useCrop && !useTint && !useTransform) return std::wstring();
+
+	WCHAR buffer[64];
+	std::wstring key = m_CacheKey;
+
+	if (useCrop)
+	{
+		_snwprintf_s(buffer, _TRUNCATE, L"|C%i,%i,%i,%i,%i", m_Crop.X, m_Crop.Y, m_Crop.Width, m_Crop.Height, (int)m_CropMode);
+		key += buffer;
+	}
+
+	if (useTint)
+	{
+		key += m_GreyScale ? L"|G" : L"|M";
+		for (int i = 0; i < 5; ++i)
+		{
+			for (int j = 0; j < 4; ++j)  // The fifth column is reserved.
+			{
+				_snwprintf_s(buffer, _TRUNCATE, L"%.9g,", m_ColorMatrix->m[i][j]);
+				key += buffer;
+			}
+		}
+	}
+
+	if (useTransform)
+	{
+		_snwprintf_s(buffer, _TRUNCATE, L"|T%i,%.9g", (int)m_Flip, m_Rotate);
+		key += buffer;
+	}
+
+	return key;
+}
+
 /*
 ** This will apply the cropping.
 **
@@ -76,6 +76,10 @@ public:
 	Gdiplus::Bitmap* GetTintedImage() { return m_BitmapTint; }
 	Gdiplus::Bitmap* GetImage() { return (m_BitmapTint) ? m_BitmapTint : m_Bitmap; }
 
+	// Identifies the pixels of GetImage() for Gfx::Canvas::DrawBitmap(). Changes whenever another
+	// image is loaded or the image is cropped, tinted or transformed differently.
+	UINT GetGeneration() { return (m_BitmapTint) ? m_BitmapTintGeneration : m_BitmapGeneration; }
+
 	void DisposeImage();
 	void LoadImage(const std::wstring& imageName, bool bLoadAlways);
 
@@ -89,6 +93,9 @@ protected:
 		CROPMODE_C
 	};
 
+	void DisposeTintedImage();
+	std::wstring CreateTintCacheKey();
+
 	void ApplyCrop();
 	void ApplyTint();
 	void ApplyTransform();
@@ -99,7 +106,9 @@ protected:
 	static bool CompareColorMatrix(const Gdiplus::ColorMatrix* a, const Gdiplus::ColorMatrix* b);
 
 	Gdiplus::Bitmap* m_Bitmap;
-	Gdiplus::Bitmap* m_BitmapTint;		// Tinted bitmap
+	Gdiplus::Bitmap* m_BitmapTint;		// Tinted bitmap (owned by ImageCachePool)
+	UINT m_BitmapGeneration;
+	UINT m_BitmapTintGeneration;
 
 	const WCHAR* m_Name;
 	const WCHAR** m_OptionArray;
@@ -121,6 +130,7 @@ protected:
 	bool m_HasPathChanged;
 
 	std::wstring m_CacheKey;
+	std::wstring m_TintCacheKey;
 
 	Skin* m_Skin;
 
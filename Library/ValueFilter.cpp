@@ -0,0 +1,246 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "ValueFilter.h"
+
+AverageFilter::AverageFilter() :
+	m_Pos(),
+	m_Sum()
+{
+}
+
+void AverageFilter::SetSize(UINT size, double value)
+{
+	if (size == m_Values.size()) return;
+
+	m_Values.resize(size, value);
+	if (m_Pos >= size) m_Pos = 0;
+	Resum();
+}
+
+double AverageFilter::Apply(double value)
+{
+	if (m_Values.empty()) return value;
+
+	m_Sum += value - m_Values[m_Pos];
+	m_Values[m_Pos] = value;
+
+	// Sum again once per round so that rounding errors do not accumulate. A NaN or infinity
+	// would otherwise stay in the sum after the value has left the window.
+	if (++m_Pos == m_Values.size())
+	{
+		m_Pos = 0;
+		Resum();
+	}
+	else if (!std::isfinite(m_Sum))
+	{
+		Resum();
+	}
+
+	return m_Sum / (double)m_Values.size();
+}
+
+void AverageFilter::Resum()
+{
+	m_Sum = 0.0;
+	for (double value : m_Values)
+	{
+		m_Sum += value;
+	}
+}
+
+MedianFilter::MedianFilter(UINT size) :
+	m_Values(size),
+	m_Pos()
+{
+	Reset();
+}
+
+void MedianFilter::Reset()
+{
+	std::fill(m_Values.begin(), m_Values.end(), 0.0);
+	m_Pos = 0;
+	m_Sorted.clear();
+	m_Sorted.insert(m_Values.cbegin(), m_Values.cend());
+	m_Median = m_Sorted.cbegin();
+	std::advance(m_Median, m_Values.size() / 2);
+}
+
+double MedianFilter::Apply(double value)
+{
+	if (value == value)  // Not NaN
+	{
+		// Add the new value and then remove the oldest one. The median iterator is moved so that
+		// it stays at index size / 2.
+		const double oldest = m_Values[m_Pos];
+		m_Values[m_Pos] = value;
+		if (++m_Pos == m_Values.size()) m_Pos = 0;
+
+		m_Sorted.insert(value);
+		if (value < *m_Median) --m_Median;
+
+		if (oldest <= *m_Median) ++m_Median;
+		m_Sorted.erase(m_Sorted.lower_bound(oldest));
+	}
+
+	return *m_Median;
+}
+
+SmoothingFilter::SmoothingFilter() :
+	m_Factor(),
+	m_Previous(),
+	m_HasPrevious(false)
+{
+}
+
+void SmoothingFilter::SetFactor(double factor)
+{
+	if (factor <= 0.0 || factor > 1.0)
+	{
+		factor = 0.0;
+		m_HasPrevious = false;
+	}
+
+	m_Factor = factor;
+}
+
+double SmoothingFilter::Apply(double value)
+{
+	if (m_Factor <= 0.0) return value;
+
+	if (m_HasPrevious && std::isfinite(m_Previous))
+	{
+		value = m_Factor * value + (1.0 - m_Factor) * m_Previous;
+	}
+
+	m_Previous = value;
+	m_HasPrevious = true;
+	return value;
+}
+
+MinMaxWindow::MinMaxWindow() :
+	m_Count(),
+	m_Size()
+{
+}
+
+void MinMaxWindow::SetSize(UINT size)
+{
+	if (size == m_Size) return;
+
+	m_Size = size;
+	m_Min.clear();
+	m_Max.clear();
+}
+
+void MinMaxWindow::Add(double value)
+{
+	if (m_Size == 0 || value != value) return;
+
+	const Entry entry = { value, m_Count++ };
+
+	while (!m_Min.empty() && m_Min.back().value >= value) m_Min.pop_back();
+	m_Min.push_back(entry);
+
+	while (!m_Max.empty() && m_Max.back().value <= value) m_Max.pop_back();
+	m_Max.push_back(entry);
+
+	// Drop the values that have left the window.
+	const UINT64 first = (m_Count > m_Size) ? m_Count - m_Size : 0;
+	if (m_Min.front().index < first) m_Min.pop_front();
+	if (m_Max.front().index < first) m_Max.pop_front();
+}
+
+ValueHistory::ValueHistory() :
+	m_Pos(),
+	m_Index(),
+	m_AddCount()
+{
+}
+
+void ValueHistory::Grow(UINT size)
+{
+	const UINT oldSize = (UINT)m_Values.size();
+	if (size <= oldSize) return;
+
+	// Move the values to the end in order from oldest to newest and index them from 0 again.
+	std::vector<double> values(size, 0.0);
+	std::rotate_copy(m_Values.begin(), m_Values.begin() + m_Pos, m_Values.end(), values.end() - oldSize);
+	m_Values.swap(values);
+	m_Pos = 0;
+	m_Index = 0;
+
+	m_Min.clear();
+	m_Max.clear();
+	for (double value : m_Values)
+	{
+		Push(value);
+	}
+}
+
+void ValueHistory::Add(double value)
+{
+	if (m_Values.empty()) return;
+
+	++m_AddCount;
+	m_Values[m_Pos] = value;
+	if (++m_Pos == m_Values.size()) m_Pos = 0;
+
+	Push(value);
+
+	// Drop the value that has left the history.
+	const UINT64 first = m_Index - m_Values.size();
+	if (!m_Min.empty() && m_Min.front().index < first) m_Min.pop_front();
+	if (!m_Max.empty() && m_Max.front().index < first) m_Max.pop_front();
+}
+
+void ValueHistory::AddShared(double value, UINT64& cursor)
+{
+	if (cursor == m_AddCount)
+	{
+		Add(value);
+	}
+	cursor = m_AddCount;
+}
+
+double ValueHistory::Get(UINT age) const
+{
+	const UINT size = (UINT)m_Values.size();
+	if (age >= size) return 0.0;
+
+	UINT pos = m_Pos + size - 1 - age;
+	if (pos >= size) pos -= size;
+	return m_Values[pos];
+}
+
+void ValueHistory::Push(double value)
+{
+	const Entry entry = { value, m_Index++ };
+	if (value != value) return;
+
+	while (!m_Min.empty() && m_Min.back().value >= value) m_Min.pop_back();
+	m_Min.push_back(entry);
+
+	while (!m_Max.empty() && m_Max.back().value <= value) m_Max.pop_back();
+	m_Max.push_back(entry);
+}
+
+double ValueHistory::Find(const std::deque<Entry>& queue, UINT count) const
+{
+	count = min(count, (UINT)m_Values.size());
+	if (count == 0) return 0.0;
+
+	// The values in the queue increase (or decrease) with the index, so the first entry in the
+	// range holds the minimum (or maximum) of the range.
+	const UINT64 first = m_Index - count;
+	auto it = std::lower_bound(queue.cbegin(), queue.cend(), first, [](const Entry& entry, UINT64 index)
+	{
+		return entry.index < index;
+	});
+	return (it != queue.cend()) ? it->value : 0.0;
+}
@@ -0,0 +1,163 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_VALUEFILTER_H_
+#define RM_LIBRARY_VALUEFILTER_H_
+
+#include <windows.h>
+#include <deque>
+#include <set>
+#include <vector>
+
+// Streaming filters for the values of measures. Each value is processed in constant or
+// logarithmic time regardless of the window size.
+
+// Average of the last |size| values (AverageSize).
+class AverageFilter
+{
+public:
+	AverageFilter();
+
+	// Keeps the current values. Added slots are filled with |value|.
+	void SetSize(UINT size, double value);
+	UINT GetSize() const { return (UINT)m_Values.size(); }
+
+	double Apply(double value);
+
+private:
+	void Resum();
+
+	std::vector<double> m_Values;
+	UINT m_Pos;
+	double m_Sum;
+};
+
+// Median of the last |size| values (the element at index size / 2 when sorted).
+class MedianFilter
+{
+public:
+	// The window initially contains |size| zeros. |size| must not be 0.
+	MedianFilter(UINT size);
+
+	MedianFilter(const MedianFilter& other) = delete;
+	MedianFilter& operator=(MedianFilter other) = delete;
+
+	// Fills the window with zeros again.
+	void Reset();
+
+	// NaN values are ignored.
+	double Apply(double value);
+
+private:
+	std::vector<double> m_Values;		// In the order they were added
+	UINT m_Pos;
+	std::multiset<double> m_Sorted;
+	std::multiset<double>::const_iterator m_Median;
+};
+
+// Exponential moving average: result = factor * value + (1 - factor) * previous result.
+class SmoothingFilter
+{
+public:
+	SmoothingFilter();
+
+	// 0 disables the filter, 1 uses the value as is.
+	void SetFactor(double factor);
+	double GetFactor() const { return m_Factor; }
+
+	double Apply(double value);
+
+private:
+	double m_Factor;
+	double m_Previous;
+	bool m_HasPrevious;
+};
+
+// Minimum and maximum of the last |size| values.
+class MinMaxWindow
+{
+public:
+	MinMaxWindow();
+
+	// Clears the window if the size changes.
+	void SetSize(UINT size);
+	UINT GetSize() const { return m_Size; }
+
+	void Add(double value);
+
+	double GetMin() const { return m_Min.front().value; }
+	double GetMax() const { return m_Max.front().value; }
+	bool IsEmpty() const { return m_Min.empty(); }
+
+private:
+	struct Entry
+	{
+		double value;
+		UINT64 index;
+	};
+
+	// Monotonic queues: values that can no longer be the minimum (or maximum) are dropped.
+	std::deque<Entry> m_Min;
+	std::deque<Entry> m_Max;
+	UINT64 m_Count;
+	UINT m_Size;
+};
+
+// Recent values of a measure as drawn by the graph meters. The history initially holds zeros.
+// Like in MinMaxWindow, the minimum and maximum are kept in monotonic queues so that AutoScale
+// does not need to scan the history. Meters bound to the same measure share a history through
+// Measure::GetHistory().
+class ValueHistory
+{
+public:
+	ValueHistory();
+
+	ValueHistory(const ValueHistory& other) = delete;
+	ValueHistory& operator=(ValueHistory other) = delete;
+
+	// Grows the history to hold at least |size| values. The added (oldest) values are zeros.
+	void Grow(UINT size);
+	UINT GetSize() const { return (UINT)m_Values.size(); }
+
+	void Add(double value);
+
+	// Adds |value| unless another of the meters sharing the history has added a value since the
+	// previous call with |cursor|. This way the value of the measure is added once per update.
+	void AddShared(double value, UINT64& cursor);
+
+	// Returns the number of values added so far.
+	UINT64 GetAddCount() const { return m_AddCount; }
+
+	// Returns the value added |age| updates ago or 0 if the history does not go back that far.
+	double Get(UINT age) const;
+
+	// Returns the minimum or maximum of the newest |count| values. NaN values are skipped and 0 is
+	// returned if all of them are NaN.
+	double GetMin(UINT count) const { return Find(m_Min, count); }
+	double GetMax(UINT count) const { return Find(m_Max, count); }
+
+private:
+	struct Entry
+	{
+		double value;
+		UINT64 index;
+	};
+
+	void Push(double value);
+	double Find(const std::deque<Entry>& queue, UINT count) const;
+
+	std::vector<double> m_Values;
+	UINT m_Pos;						// Position of the oldest value
+	UINT64 m_Index;					// Index of the next value in the queues
+	UINT64 m_AddCount;
+
+	// Ordered by index. The values decrease in m_Max and increase in m_Min.
+	std::deque<Entry> m_Min;
+	std::deque<Entry> m_Max;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "ValueFilter.h"
+#include "../Common/Timer.h"
+#include "../Common/UnitTest.h"
+
+TEST_CLASS(Library_ValueFilter_Benchmark)
+{
+public:
+	TEST_METHOD(BenchmarkValueHistory)
+	{
+		const UINT size = 1920;
+		const int iterations = 100000;
+
+		std::vector<double> values(size, 0.0);
+		UINT pos = 0;
+		double scanResult = 0.0;
+
+		// Scanning the whole buffer on every update like MeterHistogram::Update used to.
+		Timer timer;
+		timer.Start();
+		for (int i = 0; i < iterations; ++i)
+		{
+			values[pos] = (double)(i % 1000);
+			pos = (pos + 1) % size;
+
+			double value = 0.0;
+			for (UINT j = 0; j < size; ++j)
+			{
+				value = max(value, values[j]);
+			}
+			scanResult = value;
+		}
+		timer.Stop();
+		const double scanTime = timer.GetElapsed();
+
+		ValueHistory history;
+		history.Grow(size);
+		double historyResult = 0.0;
+
+		timer.Start();
+		for (int i = 0; i < iterations; ++i)
+		{
+			history.Add((double)(i % 1000));
+			historyResult = max(0.0, history.GetMax(size));
+		}
+		timer.Stop();
+		const double historyTime = timer.GetElapsed();
+
+		Assert::AreEqual(scanResult, historyResult);
+
+		WCHAR buffer[256];
+		_snwprintf_s(buffer, _TRUNCATE,
+			L"ValueHistory: %i updates, size %u. Scan: %.2f ms, Monotonic queue: %.2f ms (%.1fx)\n",
+			iterations, size, scanTime, historyTime, scanTime / historyTime);
+		Logger::WriteMessage(buffer);
+	}
+
+	TEST_METHOD(BenchmarkAverageFilter)
+	{
+		const UINT size = 100;
+		const int iterations = 1000000;
+
+		std::vector<double> values(size, 0.0);
+		UINT pos = 0;
+		double sumResult = 0.0;
+
+		// Summing the whole window on every update like Measure::Update used to.
+		Timer timer;
+		timer.Start();
+		for (int i = 0; i < iterations; ++i)
+		{
+			values[pos] = (double)(i % 100);
+			pos = (pos + 1) % size;
+
+			double value = 0.0;
+			for (UINT j = 0; j < size; ++j)
+			{
+				value += values[j];
+			}
+			sumResult = value / (double)size;
+		}
+		timer.Stop();
+		const double sumTime = timer.GetElapsed();
+
+		AverageFilter filter;
+		filter.SetSize(size, 0.0);
+		double filterResult = 0.0;
+
+		timer.Start();
+		for (int i = 0; i < iterations; ++i)
+		{
+			filterResult = filter.Apply((double)(i % 100));
+		}
+		timer.Stop();
+		const double filterTime = timer.GetElapsed();
+
+		Assert::AreEqual(sumResult, filterResult, 1e-9);
+
+		WCHAR buffer[256];
+		_snwprintf_s(buffer, _TRUNCATE,
+			L"AverageFilter: %i updates, size %u. Sum: %.2f ms, Running sum: %.2f ms (%.1fx)\n",
+			iterations, size, sumTime, filterTime, sumTime / filterTime);
+		Logger::WriteMessage(buffer);
+	}
+};
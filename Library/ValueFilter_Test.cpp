@@ -0,0 +1,187 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "ValueFilter.h"
+#include "../Common/UnitTest.h"
+
+TEST_CLASS(Library_ValueFilter_Test)
+{
+public:
+	TEST_METHOD(TestAverageFilter)
+	{
+		AverageFilter filter;
+		filter.SetSize(4, 2.0);
+		Assert::AreEqual(2.0, filter.Apply(2.0));
+		Assert::AreEqual(3.0, filter.Apply(6.0));
+		Assert::AreEqual(3.0, filter.Apply(2.0));
+		Assert::AreEqual(4.0, filter.Apply(6.0));
+		Assert::AreEqual(5.0, filter.Apply(6.0));
+
+		// Growing keeps the values and fills the new slots.
+		filter.SetSize(6, 0.0);
+		Assert::AreEqual((6.0 + 12.0 + 2.0 + 6.0 + 0.0 + 0.0) / 6.0, filter.Apply(12.0));
+
+		// A NaN only affects the average while it is in the window.
+		filter.SetSize(2, 0.0);
+		Assert::IsTrue(std::isnan(filter.Apply(NAN)));
+		Assert::IsTrue(std::isnan(filter.Apply(1.0)));
+		Assert::AreEqual(1.0, filter.Apply(1.0));
+	}
+
+	TEST_METHOD(TestMedianFilter)
+	{
+		MedianFilter filter(3);
+		Assert::AreEqual(0.0, filter.Apply(5.0));
+		Assert::AreEqual(4.0, filter.Apply(4.0));
+		Assert::AreEqual(4.0, filter.Apply(1.0));
+		Assert::AreEqual(4.0, filter.Apply(4.0));
+		Assert::AreEqual(4.0, filter.Apply(NAN));
+		Assert::AreEqual(1.0, filter.Apply(-3.0));
+		filter.Reset();
+		Assert::AreEqual(0.0, filter.Apply(5.0));
+
+		// Compare with sorting the window.
+		const UINT sizes[] = { 1, 2, 5, 64 };
+		for (UINT size : sizes)
+		{
+			MedianFilter median(size);
+			std::vector<double> window(size, 0.0);
+			srand(size);
+			for (UINT i = 0; i < 1000; ++i)
+			{
+				const double value = (double)(rand() % 20);
+				window[i % size] = value;
+
+				std::vector<double> sorted = window;
+				std::sort(sorted.begin(), sorted.end());
+				Assert::AreEqual(sorted[size / 2], median.Apply(value));
+			}
+		}
+	}
+
+	TEST_METHOD(TestSmoothingFilter)
+	{
+		SmoothingFilter filter;
+		Assert::AreEqual(3.0, filter.Apply(3.0));
+
+		filter.SetFactor(0.5);
+		Assert::AreEqual(4.0, filter.Apply(4.0));
+		Assert::AreEqual(6.0, filter.Apply(8.0));
+		Assert::AreEqual(3.0, filter.Apply(0.0));
+
+		filter.SetFactor(0.0);
+		Assert::AreEqual(8.0, filter.Apply(8.0));
+	}
+
+	TEST_METHOD(TestMinMaxWindow)
+	{
+		MinMaxWindow window;
+		window.SetSize(3);
+		Assert::IsTrue(window.IsEmpty());
+
+		const double values[] = { 5.0, 1.0, 3.0, 4.0, 4.0, 2.0, 9.0 };
+		const double mins[] = { 5.0, 1.0, 1.0, 1.0, 3.0, 2.0, 2.0 };
+		const double maxs[] = { 5.0, 5.0, 5.0, 4.0, 4.0, 4.0, 9.0 };
+		for (int i = 0; i < (int)_countof(values); ++i)
+		{
+			window.Add(values[i]);
+			Assert::AreEqual(mins[i], window.GetMin());
+			Assert::AreEqual(maxs[i], window.GetMax());
+		}
+
+		window.SetSize(2);
+		Assert::IsTrue(window.IsEmpty());
+	}
+
+	TEST_METHOD(TestValueHistory)
+	{
+		ValueHistory history;
+		history.Grow(3);
+		Assert::AreEqual(0.0, history.Get(0));
+		Assert::AreEqual(0.0, history.GetMax(3));
+
+		history.Add(5.0);
+		history.Add(-1.0);
+		Assert::AreEqual(-1.0, history.Get(0));
+		Assert::AreEqual(5.0, history.Get(1));
+		Assert::AreEqual(0.0, history.Get(2));
+		Assert::AreEqual(0.0, history.Get(3));
+		Assert::AreEqual(5.0, history.GetMax(3));
+		Assert::AreEqual(-1.0, history.GetMin(3));
+		Assert::AreEqual(-1.0, history.GetMax(1));
+
+		history.Add(2.0);
+		history.Add(1.0);
+		Assert::AreEqual(2.0, history.GetMax(3));
+		Assert::AreEqual(-1.0, history.GetMin(3));
+
+		// Growing keeps the values and adds older zeros.
+		history.Grow(5);
+		Assert::AreEqual(1.0, history.Get(0));
+		Assert::AreEqual(-1.0, history.Get(2));
+		Assert::AreEqual(0.0, history.Get(4));
+		Assert::AreEqual(2.0, history.GetMax(5));
+		Assert::AreEqual(-1.0, history.GetMin(5));
+
+		// Compare with scanning the newest values.
+		const UINT sizes[] = { 1, 2, 7, 100 };
+		for (UINT size : sizes)
+		{
+			ValueHistory random;
+			random.Grow(size);
+			std::deque<double> values(size, 0.0);
+			srand(size);
+			for (UINT i = 0; i < 1000; ++i)
+			{
+				const double value = (i % 97 == 0) ? NAN : (double)(rand() % 50 - 25);
+				random.Add(value);
+				values.push_front(value);
+				values.pop_back();
+
+				const UINT count = rand() % (size + 1);
+				double minValue = 0.0;
+				double maxValue = 0.0;
+				bool found = false;
+				for (UINT j = 0; j < count; ++j)
+				{
+					if (std::isnan(values[j])) continue;
+					minValue = found ? min(minValue, values[j]) : values[j];
+					maxValue = found ? max(maxValue, values[j]) : values[j];
+					found = true;
+				}
+				Assert::AreEqual(minValue, random.GetMin(count));
+				Assert::AreEqual(maxValue, random.GetMax(count));
+			}
+		}
+	}
+
+	TEST_METHOD(TestValueHistoryShared)
+	{
+		ValueHistory history;
+		history.Grow(4);
+		UINT64 cursor1 = 0;
+		UINT64 cursor2 = 0;
+
+		// Both meters add the value once per update.
+		history.AddShared(1.0, cursor1);
+		history.AddShared(1.0, cursor2);
+		history.AddShared(2.0, cursor1);
+		history.AddShared(2.0, cursor2);
+		Assert::AreEqual(2.0, history.Get(0));
+		Assert::AreEqual(1.0, history.Get(1));
+		Assert::AreEqual(0.0, history.Get(2));
+
+		// The second meter is updated with !UpdateMeter.
+		history.AddShared(3.0, cursor2);
+		history.AddShared(4.0, cursor1);
+		history.AddShared(4.0, cursor2);
+		Assert::AreEqual(4.0, history.Get(0));
+		Assert::AreEqual(3.0, history.Get(1));
+		Assert::AreEqual(2.0, history.Get(2));
+	}
+};
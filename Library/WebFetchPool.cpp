@@ -0,0 +1,671 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "WebFetchPool.h"
+#include "WebResponseCache.h"
+#include "System.h"
+
+namespace {
+
+const size_t MAX_THREADS = 4;
+
+// Same as the limit recommended for HTTP/1.1 clients and the default of WinINet.
+const UINT MAX_CONNECTIONS_PER_HOST = 2;
+
+// Reads are at least MIN_READ_SIZE bytes and double up to MAX_READ_SIZE as more data arrives.
+const DWORD MIN_READ_SIZE = 16 * 1024;
+const DWORD MAX_READ_SIZE = 1024 * 1024;
+
+// Larger size hints are ignored to avoid allocating a huge buffer due to a bogus Content-Length.
+const DWORD MAX_SIZE_HINT = 256 * 1024 * 1024;
+
+/*
+** Reads all data with |read| into a triple null terminated buffer allocated with malloc(). The
+** data is read into a list of segments that are joined once at the end so that the data is copied
+** at most once regardless of the size. If the size is known in advance (|sizeHint|), the first
+** segment has room for all data (and one more byte to detect the end without another segment)
+** and is returned as is.
+**
+*/
+template<typename Read>
+BYTE* ReadSegments(Read read, DWORD sizeHint, DWORD* dataSize, const volatile bool* cancelled)
+{
+	struct Segment
+	{
+		BYTE* data;
+		DWORD size;
+	};
+
+	std::vector<Segment> segments;
+	auto freeSegments = [&segments]()
+	{
+		for (const auto& segment : segments)
+		{
+			free(segment.data);
+		}
+	};
+
+	// Allocate segments with 3 extra bytes for triple null termination in case the string is
+	// invalid (e.g. when incorrectly using the UTF-16LE codepage for the data).
+	if (sizeHint > MAX_SIZE_HINT) sizeHint = 0;
+
+	DWORD totalSize = 0;
+	DWORD segmentSize = (sizeHint > 0) ? sizeHint + 1 : MIN_READ_SIZE;
+	bool done = false;
+	while (!done)
+	{
+		Segment segment = { (BYTE*)malloc(segmentSize + 3), 0 };
+		if (!segment.data)
+		{
+			freeSegments();
+			SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+			return nullptr;
+		}
+
+		segments.push_back(segment);
+
+		// Fill the segment.
+		while (segments.back().size < segmentSize)
+		{
+			Segment& current = segments.back();
+			DWORD readSize;
+			if (cancelled && *cancelled)
+			{
+				freeSegments();
+				SetLastError(ERROR_INTERNET_OPERATION_CANCELLED);
+				return nullptr;
+			}
+			else if (!read(current.data + current.size, segmentSize - current.size, &readSize))
+			{
+				const DWORD error = GetLastError();
+				freeSegments();
+				SetLastError(error);
+				return nullptr;
+			}
+			else if (readSize == 0)
+			{
+				// All data read.
+				done = true;
+				break;
+			}
+
+			current.size += readSize;
+		}
+
+		totalSize += segments.back().size;
+		if (segments.back().size == 0 && segments.size() > 1)
+		{
+			free(segments.back().data);
+			segments.pop_back();
+		}
+
+		segmentSize = min(max(segmentSize * 2, MIN_READ_SIZE), MAX_READ_SIZE);
+	}
+
+	BYTE* buffer;
+	if (segments.size() == 1)
+	{
+		buffer = segments[0].data;
+	}
+	else
+	{
+		buffer = (BYTE*)malloc(totalSize + 3);
+		if (buffer)
+		{
+			BYTE* pos = buffer;
+			for (const auto& segment : segments)
+			{
+				memcpy(pos, segment.data, segment.size);
+				pos += segment.size;
+			}
+		}
+
+		freeSegments();
+		if (!buffer)
+		{
+			SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+			return nullptr;
+		}
+	}
+
+	// Triple null terminate the buffer.
+	buffer[totalSize] = 0;
+	buffer[totalSize + 1] = 0;
+	buffer[totalSize + 2] = 0;
+
+	*dataSize = totalSize;
+	return buffer;
+}
+
+std::wstring QueryHeader(HINTERNET request, DWORD infoLevel)
+{
+	WCHAR buffer[256];
+	DWORD size = sizeof(buffer);
+	if (HttpQueryInfo(request, infoLevel, buffer, &size, nullptr))
+	{
+		return std::wstring(buffer, size / sizeof(WCHAR));
+	}
+
+	// Longer values, e.g. some ETags, are read again with the size returned by WinINet.
+	if (GetLastError() == ERROR_INSUFFICIENT_BUFFER && size > 0)
+	{
+		std::wstring value(size / sizeof(WCHAR) + 1, L'\0');
+		if (HttpQueryInfo(request, infoLevel, &value[0], &size, nullptr))
+		{
+			value.resize(size / sizeof(WCHAR));
+			return value;
+		}
+	}
+
+	return std::wstring();
+}
+
+}  // namespace
+
+CRITICAL_SECTION WebFetchPool::c_CriticalSection;
+CONDITION_VARIABLE WebFetchPool::c_QueueChanged;
+CONDITION_VARIABLE WebFetchPool::c_JobFinished;
+std::list<std::shared_ptr<WebFetchPool::Job>> WebFetchPool::c_Queue;
+std::vector<std::shared_ptr<WebFetchPool::Job>> WebFetchPool::c_Running;
+std::unordered_map<std::wstring, UINT> WebFetchPool::c_HostConnections;
+std::vector<HANDLE> WebFetchPool::c_Threads;
+WebFetchPool::Fetcher WebFetchPool::c_Fetcher;
+WebFetchPool::Stats WebFetchPool::c_Stats = {};
+bool WebFetchPool::c_Exit = false;
+
+void WebFetchPool::InitializeStatic()
+{
+	System::InitializeCriticalSection(&c_CriticalSection);
+	InitializeConditionVariable(&c_QueueChanged);
+	InitializeConditionVariable(&c_JobFinished);
+	c_Fetcher = DefaultFetch;
+	c_Exit = false;
+
+	WebResponseCache::InitializeStatic();
+}
+
+/*
+** Stops the worker threads. The owners of the requests must have been cancelled before this.
+**
+*/
+void WebFetchPool::FinalizeStatic()
+{
+	EnterCriticalSection(&c_CriticalSection);
+	c_Exit = true;
+	c_Queue.clear();
+	for (const auto& job : c_Running)
+	{
+		job->cancelled = true;
+	}
+	WakeAllConditionVariable(&c_QueueChanged);
+	LeaveCriticalSection(&c_CriticalSection);
+
+	for (HANDLE thread : c_Threads)
+	{
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+	c_Threads.clear();
+
+	DeleteCriticalSection(&c_CriticalSection);
+
+	WebResponseCache::FinalizeStatic();
+}
+
+void WebFetchPool::Fetch(void* owner, const Request& request, Callback callback)
+{
+	std::wstring key = request.url;
+	key += L'\n';
+	key += request.headers;
+
+	WCHAR buffer[32];
+	_snwprintf_s(buffer, _TRUNCATE, L"\n%p\n%i", request.handle, (int)request.forceReload);
+	key += buffer;
+
+	Subscriber subscriber = { owner, std::move(callback) };
+
+	EnterCriticalSection(&c_CriticalSection);
+	++c_Stats.requests;
+
+	// Share the response of an identical request that has not been cancelled. Jobs that are
+	// already passing the response to the callbacks can still be joined since the new callback is
+	// called before the job is removed.
+	auto join = [&](const std::shared_ptr<Job>& job)
+	{
+		if (job->cancelled || job->key != key) return false;
+
+		job->subscribers.push_back(std::move(subscriber));
+		++c_Stats.coalesced;
+		return true;
+	};
+
+	if (std::none_of(c_Queue.cbegin(), c_Queue.cend(), join) &&
+		std::none_of(c_Running.cbegin(), c_Running.cend(), join))
+	{
+		auto job = std::make_shared<Job>();
+		job->key = std::move(key);
+		job->host = GetHost(request.url);
+		job->request = request;
+		job->subscribers.push_back(std::move(subscriber));
+		job->running = nullptr;
+		job->cancelled = false;
+		Queue(std::move(job));
+	}
+
+	LeaveCriticalSection(&c_CriticalSection);
+}
+
+void WebFetchPool::Download(void* owner, const std::wstring& url, Task task)
+{
+	auto job = std::make_shared<Job>();
+	job->host = GetHost(url);
+	job->task = std::move(task);
+	job->subscribers.push_back({ owner, nullptr });
+	job->running = nullptr;
+	job->cancelled = false;
+
+	EnterCriticalSection(&c_CriticalSection);
+	Queue(std::move(job));
+	LeaveCriticalSection(&c_CriticalSection);
+}
+
+void WebFetchPool::Run(void* owner, Task task)
+{
+	// Jobs without a host are not limited by MAX_CONNECTIONS_PER_HOST.
+	Download(owner, std::wstring(), std::move(task));
+}
+
+void WebFetchPool::Cancel(void* owner)
+{
+	auto removeOwner = [owner](Job& job)
+	{
+		auto& subscribers = job.subscribers;
+		subscribers.erase(
+			std::remove_if(subscribers.begin(), subscribers.end(),
+				[owner](const Subscriber& subscriber) { return subscriber.owner == owner; }),
+			subscribers.end());
+		return subscribers.empty();
+	};
+
+	EnterCriticalSection(&c_CriticalSection);
+
+	for (auto iter = c_Queue.begin(); iter != c_Queue.end(); )
+	{
+		iter = removeOwner(**iter) ? c_Queue.erase(iter) : std::next(iter);
+	}
+
+	// The requests that no longer have a requester are aborted, but identical requests that are
+	// made later are not coalesced with them.
+	for (const auto& job : c_Running)
+	{
+		if (removeOwner(*job))
+		{
+			job->cancelled = true;
+		}
+	}
+
+	auto isRunning = [owner]()
+	{
+		return std::any_of(c_Running.cbegin(), c_Running.cend(),
+			[owner](const std::shared_ptr<Job>& job) { return job->running == owner; });
+	};
+
+	while (isRunning())
+	{
+		// The callbacks execute bangs with DelayedExecuteCommand(), but process sent messages
+		// anyway in case a callback logs or otherwise waits for the UI thread.
+		LeaveCriticalSection(&c_CriticalSection);
+		MSG msg;
+		PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+		EnterCriticalSection(&c_CriticalSection);
+
+		SleepConditionVariableCS(&c_JobFinished, &c_CriticalSection, 10);
+	}
+
+	LeaveCriticalSection(&c_CriticalSection);
+}
+
+WebFetchPool::Stats WebFetchPool::GetStats()
+{
+	EnterCriticalSection(&c_CriticalSection);
+	Stats stats = c_Stats;
+	LeaveCriticalSection(&c_CriticalSection);
+	return stats;
+}
+
+void WebFetchPool::SetFetcher(Fetcher fetcher)
+{
+	EnterCriticalSection(&c_CriticalSection);
+	if (fetcher)
+	{
+		c_Fetcher = std::move(fetcher);
+	}
+	else
+	{
+		c_Fetcher = DefaultFetch;
+	}
+	LeaveCriticalSection(&c_CriticalSection);
+}
+
+/*
+** Returns the lowercase host (and port) of |url| or an empty string if the URL is not remote.
+**
+*/
+std::wstring WebFetchPool::GetHost(const std::wstring& url)
+{
+	const size_t schemeEnd = url.find(L"://");
+	if (schemeEnd == std::wstring::npos || (schemeEnd == 4 && _wcsnicmp(url.c_str(), L"file", 4) == 0))
+	{
+		return std::wstring();
+	}
+
+	size_t start = schemeEnd + 3;
+	size_t end = url.find_first_of(L"/?#", start);
+	if (end == std::wstring::npos) end = url.length();
+
+	const size_t userInfoEnd = url.rfind(L'@', end);
+	if (userInfoEnd != std::wstring::npos && userInfoEnd >= start)
+	{
+		start = userInfoEnd + 1;
+	}
+
+	std::wstring host(url, start, end - start);
+	_wcslwr(&host[0]);
+	return host;
+}
+
+/*
+** Adds |job| to the queue and starts another thread if all of the threads are busy. Must be
+** called within the critical section.
+**
+*/
+void WebFetchPool::Queue(std::shared_ptr<Job> job)
+{
+	c_Queue.push_back(std::move(job));
+
+	if (c_Threads.size() < MAX_THREADS && c_Queue.size() + c_Running.size() > c_Threads.size())
+	{
+		HANDLE thread = (HANDLE)_beginthreadex(nullptr, 0, WorkerThreadProc, nullptr, 0, nullptr);
+		if (thread)
+		{
+			c_Threads.push_back(thread);
+		}
+	}
+
+	WakeConditionVariable(&c_QueueChanged);
+}
+
+/*
+** Moves the first queued job whose host has a free connection to the running jobs. Must be
+** called within the critical section.
+**
+*/
+std::shared_ptr<WebFetchPool::Job> WebFetchPool::TakeNextJob()
+{
+	for (auto iter = c_Queue.begin(); iter != c_Queue.end(); ++iter)
+	{
+		const std::wstring& host = (*iter)->host;
+		if (host.empty() || c_HostConnections[host] < MAX_CONNECTIONS_PER_HOST)
+		{
+			std::shared_ptr<Job> job = std::move(*iter);
+			c_Queue.erase(iter);
+
+			if (!host.empty())
+			{
+				++c_HostConnections[host];
+			}
+
+			if (job->task)
+			{
+				job->running = job->subscribers.front().owner;
+			}
+
+			c_Running.push_back(job);
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+/*
+** Runs |job| and passes the response to each of the callbacks. Called outside of the critical
+** section.
+**
+*/
+void WebFetchPool::RunJob(Job& job)
+{
+	if (job.task)
+	{
+		job.task(job.cancelled);
+
+		EnterCriticalSection(&c_CriticalSection);
+		job.running = nullptr;
+	}
+	else
+	{
+		EnterCriticalSection(&c_CriticalSection);
+		++c_Stats.fetches;
+		Fetcher fetcher = c_Fetcher;
+		LeaveCriticalSection(&c_CriticalSection);
+
+		Response response;
+		fetcher(job.request, response, job.cancelled);
+
+		EnterCriticalSection(&c_CriticalSection);
+		if (response.notModified)
+		{
+			++c_Stats.notModified;
+		}
+
+		while (!job.subscribers.empty())
+		{
+			Subscriber subscriber = std::move(job.subscribers.front());
+			job.subscribers.erase(job.subscribers.begin());
+			job.running = subscriber.owner;
+			LeaveCriticalSection(&c_CriticalSection);
+
+			subscriber.callback(response);
+
+			EnterCriticalSection(&c_CriticalSection);
+			job.running = nullptr;
+			WakeAllConditionVariable(&c_JobFinished);
+		}
+	}
+
+	if (!job.host.empty() && --c_HostConnections[job.host] == 0)
+	{
+		c_HostConnections.erase(job.host);
+	}
+
+	c_Running.erase(std::find_if(c_Running.begin(), c_Running.end(),
+		[&job](const std::shared_ptr<Job>& running) { return running.get() == &job; }));
+
+	// Wake Cancel() and the threads that are waiting for a connection to the host.
+	WakeAllConditionVariable(&c_JobFinished);
+	WakeAllConditionVariable(&c_QueueChanged);
+	LeaveCriticalSection(&c_CriticalSection);
+}
+
+unsigned __stdcall WebFetchPool::WorkerThreadProc(void* param)
+{
+	EnterCriticalSection(&c_CriticalSection);
+	while (true)
+	{
+		std::shared_ptr<Job> job;
+		while (!c_Exit && !(job = TakeNextJob()))
+		{
+			SleepConditionVariableCS(&c_QueueChanged, &c_CriticalSection, INFINITE);
+		}
+
+		if (c_Exit) break;
+
+		LeaveCriticalSection(&c_CriticalSection);
+		RunJob(*job);
+		EnterCriticalSection(&c_CriticalSection);
+	}
+	LeaveCriticalSection(&c_CriticalSection);
+
+	return 0;
+}
+
+/*
+** Fetches the URL with a conditional request if the cache has validators for it. A 304 Not
+** Modified response is replaced with the cached body.
+**
+*/
+void WebFetchPool::DefaultFetch(const Request& request, Response& response, const volatile bool& cancelled)
+{
+	const bool http = _wcsnicmp(request.url.c_str(), L"http", 4) == 0;
+	const std::wstring cacheKey = request.url + L'\n' + request.headers;
+	std::shared_ptr<const WebResponseCache::Entry> cached;
+	std::wstring headers = request.headers;
+	if (http && (cached = WebResponseCache::Get(cacheKey)))
+	{
+		// The headers are separated by "\r\n". The custom headers already end with the terminator.
+		std::wstring conditionalHeaders;
+		if (!cached->etag.empty())
+		{
+			conditionalHeaders += L"If-None-Match: ";
+			conditionalHeaders += cached->etag;
+		}
+
+		if (!cached->lastModified.empty())
+		{
+			if (!conditionalHeaders.empty()) conditionalHeaders += L"\r\n";
+			conditionalHeaders += L"If-Modified-Since: ";
+			conditionalHeaders += cached->lastModified;
+		}
+
+		if (!request.headers.empty()) conditionalHeaders += L"\r\n";
+		headers.insert(0, conditionalHeaders);
+	}
+
+	// The WinINet cache is bypassed for conditional requests so that the 304 response is returned
+	// as is.
+	HttpInfo info = {};
+	response.data = DownloadUrl(request.handle, request.url, headers, &response.size,
+		request.forceReload || cached, &cancelled, http ? &info : nullptr);
+	if (!response.data)
+	{
+		response.error = GetLastError();
+		return;
+	}
+
+	if (info.status == HTTP_STATUS_NOT_MODIFIED && cached)
+	{
+		const DWORD size = (DWORD)cached->body.size();
+		BYTE* data = (BYTE*)realloc(response.data, size + 3);
+		if (data)
+		{
+			memcpy(data, cached->body.data(), size);
+			data[size] = data[size + 1] = data[size + 2] = 0;
+			response.data = data;
+			response.size = size;
+			response.hash = cached->hash;
+			response.notModified = true;
+		}
+		return;
+	}
+
+	response.hash = WebResponseCache::Hash(response.data, response.size);
+
+	if (info.status == HTTP_STATUS_OK && (!info.etag.empty() || !info.lastModified.empty()) &&
+		(!cached || cached->hash != response.hash ||
+			cached->etag != info.etag || cached->lastModified != info.lastModified))
+	{
+		auto entry = std::make_shared<WebResponseCache::Entry>();
+		entry->etag = std::move(info.etag);
+		entry->lastModified = std::move(info.lastModified);
+		entry->hash = response.hash;
+		entry->body.assign(response.data, response.data + response.size);
+		WebResponseCache::Put(cacheKey, std::move(entry));
+	}
+}
+
+/*
+** Downloads the given url and returns the webpage as dynamically allocated string. The last error
+** is set if nullptr is returned. You need to free the returned string after use!
+**
+*/
+BYTE* WebFetchPool::DownloadUrl(HINTERNET handle, const std::wstring& url, const std::wstring& headers,
+	DWORD* dataSize, bool forceReload, const volatile bool* cancelled, HttpInfo* info)
+{
+	if (_wcsnicmp(url.c_str(), L"file://", 7) == 0)  // Local file
+	{
+		WCHAR path[MAX_PATH];
+		DWORD pathLength = _countof(path);
+		HRESULT hr = PathCreateFromUrl(url.c_str(), path, &pathLength, 0);
+		if (FAILED(hr))
+		{
+			SetLastError(ERROR_INVALID_PARAMETER);
+			return nullptr;
+		}
+
+		HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER fileSize;
+		const DWORD sizeHint = (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart < MAXDWORD) ? (DWORD)fileSize.QuadPart : 0;
+		BYTE* buffer = ReadSegments([file](BYTE* data, DWORD size, DWORD* readSize)
+		{
+			return ReadFile(file, data, size, readSize, nullptr) != FALSE;
+		}, sizeHint, dataSize, cancelled);
+
+		const DWORD error = GetLastError();
+		CloseHandle(file);
+		SetLastError(error);
+		return buffer;
+	}
+
+	DWORD flags = INTERNET_FLAG_RESYNCHRONIZE;
+	if (forceReload)
+	{
+		flags = INTERNET_FLAG_RELOAD;
+	}
+
+	HINTERNET hUrlDump = InternetOpenUrl(handle, url.c_str(), headers.c_str(), -1L, flags, 0);
+	if (!hUrlDump)
+	{
+		return nullptr;
+	}
+
+	if (info)
+	{
+		DWORD size = sizeof(info->status);
+		if (!HttpQueryInfo(hUrlDump, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER, &info->status, &size, nullptr))
+		{
+			info->status = 0;
+		}
+
+		info->etag = QueryHeader(hUrlDump, HTTP_QUERY_ETAG);
+		info->lastModified = QueryHeader(hUrlDump, HTTP_QUERY_LAST_MODIFIED);
+	}
+
+	// The Content-Length (if any) is only a hint since the body may be compressed or the header
+	// may be wrong.
+	DWORD contentLength = 0;
+	DWORD size = sizeof(contentLength);
+	if (!HttpQueryInfo(hUrlDump, HTTP_QUERY_CONTENT_LENGTH | HTTP_QUERY_FLAG_NUMBER, &contentLength, &size, nullptr))
+	{
+		contentLength = 0;
+	}
+
+	BYTE* buffer = ReadSegments([hUrlDump](BYTE* data, DWORD size, DWORD* readSize)
+	{
+		return InternetReadFile(hUrlDump, data, size, readSize) != FALSE;
+	}, contentLength, dataSize, cancelled);
+
+	const DWORD error = GetLastError();
+	InternetCloseHandle(hUrlDump);
+	SetLastError(error);
+	return buffer;
+}
@@ -0,0 +1,143 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_WEBFETCHPOOL_H_
+#define RM_LIBRARY_WEBFETCHPOOL_H_
+
+#include <windows.h>
+#include <Wininet.h>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Fixed set of threads that fetch the URLs of all WebParser measures. Identical requests that are
+// queued or in progress at the same time are coalesced so that the URL is fetched only once and
+// the response is passed to each requester. At most MAX_CONNECTIONS_PER_HOST requests to the same
+// host run at the same time. HTTP responses with validators are kept in WebResponseCache and
+// fetched again with a conditional request.
+//
+// The callbacks are called on a worker thread. Requesters are identified by an opaque |owner|
+// pointer that must be passed to Cancel() before the owner is deleted.
+class WebFetchPool
+{
+public:
+	struct Request
+	{
+		std::wstring url;
+		std::wstring headers;
+		HINTERNET handle;	// From InternetOpen() with the proxy settings of the requester.
+		bool forceReload;
+	};
+
+	struct Response
+	{
+		Response() : data(), size(), error(), hash(), notModified(false) {}
+		~Response() { free(data); }
+
+		Response(const Response& other) = delete;
+		Response& operator=(Response other) = delete;
+
+		BYTE* data;		// Triple null terminated or nullptr if the fetch failed.
+		DWORD size;
+		DWORD error;	// GetLastError() of the failed fetch.
+		UINT64 hash;	// WebResponseCache::Hash() of the body
+		bool notModified;	// The body is from the cache after a 304 Not Modified response.
+	};
+
+	// Status and validators of an HTTP response.
+	struct HttpInfo
+	{
+		DWORD status;
+		std::wstring etag;
+		std::wstring lastModified;
+	};
+
+	typedef std::function<void(const Response& response)> Callback;
+
+	// Transfers a file or parses a response. |cancelled| becomes true when the owner is cancelled
+	// while the task is running.
+	typedef std::function<void(const volatile bool& cancelled)> Task;
+
+	// Fetches the response. Replaceable to test the pool without a network.
+	typedef std::function<void(const Request& request, Response& response, const volatile bool& cancelled)> Fetcher;
+
+	struct Stats
+	{
+		UINT64 requests;	// Calls to Fetch()
+		UINT64 fetches;		// Requests actually sent
+		UINT64 coalesced;	// Requests that shared the response of an identical request
+		UINT64 notModified;	// Fetches answered with 304 Not Modified
+	};
+
+	static void InitializeStatic();
+	static void FinalizeStatic();
+
+	static void Fetch(void* owner, const Request& request, Callback callback);
+
+	// Runs |task| like a fetch to |url|, but without coalescing. Used for downloads to a file.
+	static void Download(void* owner, const std::wstring& url, Task task);
+
+	// Runs |task| on a worker thread without a connection limit.
+	static void Run(void* owner, Task task);
+
+	// Removes the requests of |owner|. Waits if a callback or task of |owner| is running.
+	static void Cancel(void* owner);
+
+	static Stats GetStats();
+
+	// Replaces the default fetcher, which uses DownloadUrl(). Pass nullptr to restore it.
+	static void SetFetcher(Fetcher fetcher);
+
+	// Reads |url| into a triple null terminated buffer allocated with malloc(). Also handles file://
+	// URLs. Returns nullptr on failure. |info| is set for HTTP URLs.
+	static BYTE* DownloadUrl(HINTERNET handle, const std::wstring& url, const std::wstring& headers,
+		DWORD* dataSize, bool forceReload, const volatile bool* cancelled = nullptr, HttpInfo* info = nullptr);
+
+	static std::wstring GetHost(const std::wstring& url);
+
+private:
+	struct Subscriber
+	{
+		void* owner;
+		Callback callback;
+	};
+
+	struct Job
+	{
+		std::wstring key;	// Empty if the job is not coalesced.
+		std::wstring host;
+		Request request;
+		Task task;
+		std::vector<Subscriber> subscribers;
+		void* running;		// Owner whose callback or task is running
+		volatile bool cancelled;
+	};
+
+	static unsigned __stdcall WorkerThreadProc(void* param);
+
+	static void Queue(std::shared_ptr<Job> job);
+	static std::shared_ptr<Job> TakeNextJob();
+	static void RunJob(Job& job);
+	static void DefaultFetch(const Request& request, Response& response, const volatile bool& cancelled);
+
+	static CRITICAL_SECTION c_CriticalSection;
+	static CONDITION_VARIABLE c_QueueChanged;
+	static CONDITION_VARIABLE c_JobFinished;
+
+	static std::list<std::shared_ptr<Job>> c_Queue;
+	static std::vector<std::shared_ptr<Job>> c_Running;
+	static std::unordered_map<std::wstring, UINT> c_HostConnections;
+	static std::vector<HANDLE> c_Threads;
+	static Fetcher c_Fetcher;
+	static Stats c_Stats;
+	static bool c_Exit;
+};
+
+#endif
@@ -0,0 +1,120 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "WebFetchPool.h"
+#include "../Common/StringUtil.h"
+#include "../Common/Timer.h"
+#include "../Common/UnitTest.h"
+
+TEST_CLASS(Library_WebFetchPool_Benchmark)
+{
+public:
+	TEST_METHOD(BenchmarkDownloadUrl)
+	{
+		// Feed-like UTF-8 body with some multi-byte characters.
+		const char item[] = "<item><title>Entry \xc3\xa9t\xc3\xa9 \xe2\x82\xac 12345</title><link>http://example.com/</link></item>\n";
+		const int sizes[] = { 1, 10, 50 };
+		const int iterations = 3;
+
+		for (int sizeMB : sizes)
+		{
+			const size_t size = sizeMB * 1024 * 1024;
+			std::string body;
+			body.reserve(size + sizeof(item));
+			while (body.size() < size)
+			{
+				body += item;
+			}
+
+			WCHAR path[MAX_PATH];
+			GetTempPath(_countof(path), path);
+			GetTempFileName(path, L"rm", 0, path);
+
+			FILE* file;
+			Assert::AreEqual(0, (int)_wfopen_s(&file, path, L"wb"));
+			fwrite(body.data(), 1, body.size(), file);
+			fclose(file);
+
+			WCHAR url[INTERNET_MAX_URL_LENGTH];
+			DWORD urlLength = _countof(url);
+			Assert::IsTrue(SUCCEEDED(UrlCreateFromPath(path, url, &urlLength, 0)));
+
+			Timer timer;
+			double readTime = 0.0;
+			double oldReadTime = 0.0;
+			double decodeTime = 0.0;
+			double oldDecodeTime = 0.0;
+			std::wstring text;
+			for (int i = 0; i < iterations; ++i)
+			{
+				DWORD dataSize = 0;
+				timer.Start();
+				BYTE* data = WebFetchPool::DownloadUrl(nullptr, url, L"", &dataSize, false);
+				timer.Stop();
+				readTime += timer.GetElapsed();
+
+				Assert::IsNotNull(data);
+				Assert::AreEqual((DWORD)body.size(), dataSize);
+
+				timer.Start();
+				BYTE* oldData = ReadGrowing(path, &dataSize);
+				timer.Stop();
+				oldReadTime += timer.GetElapsed();
+				free(oldData);
+
+				timer.Start();
+				StringUtil::Widen((const char*)data, (int)dataSize, CP_UTF8, text);
+				timer.Stop();
+				decodeTime += timer.GetElapsed();
+
+				timer.Start();
+				const std::wstring oldText = StringUtil::Widen((const char*)data, (int)dataSize, CP_UTF8);
+				timer.Stop();
+				oldDecodeTime += timer.GetElapsed();
+
+				Assert::IsTrue(text == oldText);
+				free(data);
+			}
+
+			DeleteFile(path);
+
+			// MB/s from the total time in milliseconds.
+			auto throughput = [&](double time) { return sizeMB * iterations * 1000.0 / time; };
+
+			WCHAR buffer[256];
+			_snwprintf_s(buffer, _TRUNCATE,
+				L"DownloadUrl: %i MB. Read: %.0f MB/s (8 KB realloc: %.0f MB/s), Decode: %.0f MB/s (two-pass: %.0f MB/s)\n",
+				sizeMB, throughput(readTime), throughput(oldReadTime),
+				throughput(decodeTime), throughput(oldDecodeTime));
+			Logger::WriteMessage(buffer);
+		}
+	}
+
+private:
+	// Reads the file like DownloadUrl() used to read responses: the buffer grows by 8 KB after
+	// each read.
+	static BYTE* ReadGrowing(const WCHAR* path, DWORD* dataSize)
+	{
+		HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+		const DWORD CHUNK_SIZE = 8192;
+		DWORD bufferSize = CHUNK_SIZE;
+		BYTE* buffer = (BYTE*)malloc(bufferSize + 3);
+		*dataSize = 0;
+
+		DWORD readSize;
+		while (ReadFile(file, buffer + *dataSize, bufferSize - *dataSize, &readSize, nullptr) && readSize > 0)
+		{
+			*dataSize += readSize;
+			bufferSize += CHUNK_SIZE;
+			buffer = (BYTE*)realloc(buffer, bufferSize + 3);
+		}
+
+		CloseHandle(file);
+		return buffer;
+	}
+};
@@ -0,0 +1,382 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "WebFetchPool.h"
+#include "WebResponseCache.h"
+#include "../Common/UnitTest.h"
+
+#pragma comment(lib, "ws2_32.lib")
+
+namespace {
+
+// Minimal HTTP server on 127.0.0.1 that answers each request with the requested path as the body
+// after |delay| milliseconds. The ETag of the response is the quoted path. Each connection is
+// handled by its own thread so that the number of concurrent requests can be measured.
+class LoopbackServer
+{
+public:
+	LoopbackServer(DWORD delay) :
+		m_Delay(delay), m_Requests(), m_NotModified(), m_Connections(), m_MaxConnections()
+	{
+		m_Socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		bind(m_Socket, (sockaddr*)&address, sizeof(address));
+		listen(m_Socket, SOMAXCONN);
+
+		int length = sizeof(address);
+		getsockname(m_Socket, (sockaddr*)&address, &length);
+		m_Port = ntohs(address.sin_port);
+
+		m_Thread = (HANDLE)_beginthreadex(nullptr, 0, AcceptThreadProc, this, 0, nullptr);
+	}
+
+	~LoopbackServer()
+	{
+		closesocket(m_Socket);
+		WaitForSingleObject(m_Thread, INFINITE);
+		CloseHandle(m_Thread);
+
+		for (HANDLE thread : m_ConnectionThreads)
+		{
+			WaitForSingleObject(thread, INFINITE);
+			CloseHandle(thread);
+		}
+	}
+
+	LoopbackServer(const LoopbackServer& other) = delete;
+	LoopbackServer& operator=(LoopbackServer other) = delete;
+
+	std::wstring GetUrl(const WCHAR* path) const
+	{
+		return L"http://127.0.0.1:" + std::to_wstring(m_Port) + path;
+	}
+
+	LONG GetRequests() const { return m_Requests; }
+	LONG GetNotModified() const { return m_NotModified; }
+	LONG GetMaxConnections() const { return m_MaxConnections; }
+
+private:
+	struct Connection
+	{
+		LoopbackServer* server;
+		SOCKET socket;
+	};
+
+	static unsigned __stdcall AcceptThreadProc(void* param)
+	{
+		auto* server = (LoopbackServer*)param;
+
+		SOCKET socket;
+		while ((socket = accept(server->m_Socket, nullptr, nullptr)) != INVALID_SOCKET)
+		{
+			auto* connection = new Connection{ server, socket };
+			HANDLE thread = (HANDLE)_beginthreadex(nullptr, 0, ConnectionThreadProc, connection, 0, nullptr);
+			server->m_ConnectionThreads.push_back(thread);
+		}
+
+		return 0;
+	}
+
+	static unsigned __stdcall ConnectionThreadProc(void* param)
+	{
+		std::unique_ptr<Connection> connection((Connection*)param);
+		LoopbackServer* server = connection->server;
+
+		const LONG connections = InterlockedIncrement(&server->m_Connections);
+		LONG maxConnections = server->m_MaxConnections;
+		while (connections > maxConnections &&
+			InterlockedCompareExchange(&server->m_MaxConnections, connections, maxConnections) != maxConnections)
+		{
+			maxConnections = server->m_MaxConnections;
+		}
+
+		std::string request;
+		char buffer[1024];
+		int size;
+		while (request.find("\r\n\r\n") == std::string::npos &&
+			(size = recv(connection->socket, buffer, sizeof(buffer), 0)) > 0)
+		{
+			request.append(buffer, size);
+		}
+
+		// "GET /path HTTP/1.1"
+		const size_t start = request.find(' ') + 1;
+		const std::string path = request.substr(start, request.find(' ', start) - start);
+		InterlockedIncrement(&server->m_Requests);
+
+		Sleep(server->m_Delay);
+
+		const std::string etag = '"' + path + '"';
+		std::string response;
+		if (request.find("If-None-Match: " + etag + "\r\n") != std::string::npos)
+		{
+			InterlockedIncrement(&server->m_NotModified);
+			response = "HTTP/1.1 304 Not Modified\r\nETag: " + etag;
+			response += "\r\nConnection: close\r\n\r\n";
+		}
+		else
+		{
+			response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(path.length());
+			response += "\r\nETag: " + etag;
+			response += "\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n";
+			response += path;
+		}
+		send(connection->socket, response.c_str(), (int)response.length(), 0);
+
+		shutdown(connection->socket, SD_BOTH);
+		closesocket(connection->socket);
+		InterlockedDecrement(&server->m_Connections);
+		return 0;
+	}
+
+	SOCKET m_Socket;
+	USHORT m_Port;
+	HANDLE m_Thread;
+	std::vector<HANDLE> m_ConnectionThreads;
+	DWORD m_Delay;
+	volatile LONG m_Requests;
+	volatile LONG m_NotModified;
+	volatile LONG m_Connections;
+	volatile LONG m_MaxConnections;
+};
+
+// Counts the responses and signals when |expected| responses have been received.
+class Responses
+{
+public:
+	Responses(LONG expected) :
+		m_Expected(expected), m_Count(), m_Mismatches(), m_NotModified(),
+		m_Event(CreateEvent(nullptr, TRUE, FALSE, nullptr)) {}
+	~Responses() { CloseHandle(m_Event); }
+
+	Responses(const Responses& other) = delete;
+	Responses& operator=(Responses other) = delete;
+
+	WebFetchPool::Callback Expect(const char* body)
+	{
+		return [this, body](const WebFetchPool::Response& response)
+		{
+			if (!response.data || strcmp((const char*)response.data, body) != 0)
+			{
+				InterlockedIncrement(&m_Mismatches);
+			}
+
+			if (response.notModified)
+			{
+				InterlockedIncrement(&m_NotModified);
+			}
+
+			if (InterlockedIncrement(&m_Count) == m_Expected)
+			{
+				SetEvent(m_Event);
+			}
+		};
+	}
+
+	bool Wait() { return WaitForSingleObject(m_Event, 10000) == WAIT_OBJECT_0; }
+
+	LONG GetCount() const { return m_Count; }
+	LONG GetMismatches() const { return m_Mismatches; }
+	LONG GetNotModified() const { return m_NotModified; }
+
+private:
+	LONG m_Expected;
+	volatile LONG m_Count;
+	volatile LONG m_Mismatches;
+	volatile LONG m_NotModified;
+	HANDLE m_Event;
+};
+
+}  // namespace
+
+TEST_CLASS(Library_WebFetchPool_Test)
+{
+public:
+	Library_WebFetchPool_Test()
+	{
+		WSADATA data;
+		WSAStartup(MAKEWORD(2, 2), &data);
+		m_Internet = InternetOpen(L"Rainmeter Test", INTERNET_OPEN_TYPE_DIRECT, nullptr, nullptr, 0);
+		WebFetchPool::InitializeStatic();
+		WebResponseCache::SetDirectory(L"");
+	}
+
+	~Library_WebFetchPool_Test()
+	{
+		WebFetchPool::FinalizeStatic();
+		InternetCloseHandle(m_Internet);
+		WSACleanup();
+	}
+
+	TEST_METHOD(TestCoalescing)
+	{
+		LoopbackServer server(200);
+		const WebFetchPool::Stats stats = WebFetchPool::GetStats();
+
+		const int count = 8;
+		int owners[count];
+		Responses responses(count);
+		for (int i = 0; i < count; ++i)
+		{
+			WebFetchPool::Fetch(&owners[i], GetRequest(server.GetUrl(L"/same")), responses.Expect("/same"));
+		}
+
+		Assert::IsTrue(responses.Wait());
+		Assert::AreEqual(0L, responses.GetMismatches());
+		Assert::AreEqual(1L, server.GetRequests());
+
+		const WebFetchPool::Stats newStats = WebFetchPool::GetStats();
+		Assert::AreEqual(stats.requests + count, newStats.requests);
+		Assert::AreEqual(stats.fetches + 1, newStats.fetches);
+		Assert::AreEqual(stats.coalesced + count - 1, newStats.coalesced);
+
+		// Different headers are not coalesced.
+		Responses responses2(2);
+		WebFetchPool::Request request = GetRequest(server.GetUrl(L"/headers"));
+		WebFetchPool::Fetch(&owners[0], request, responses2.Expect("/headers"));
+		request.headers = L"Accept: text/plain\r\n\r\n";
+		WebFetchPool::Fetch(&owners[1], request, responses2.Expect("/headers"));
+		Assert::IsTrue(responses2.Wait());
+		Assert::AreEqual(3L, server.GetRequests());
+	}
+
+	TEST_METHOD(TestHostLimit)
+	{
+		LoopbackServer server(100);
+
+		const WCHAR* paths[] = { L"/1", L"/2", L"/3", L"/4", L"/5", L"/6" };
+		const char* bodies[] = { "/1", "/2", "/3", "/4", "/5", "/6" };
+		int owner;
+		Responses responses(_countof(paths));
+		for (int i = 0; i < _countof(paths); ++i)
+		{
+			WebFetchPool::Fetch(&owner, GetRequest(server.GetUrl(paths[i])), responses.Expect(bodies[i]));
+		}
+
+		Assert::IsTrue(responses.Wait());
+		Assert::AreEqual(0L, responses.GetMismatches());
+		Assert::AreEqual((LONG)_countof(paths), server.GetRequests());
+		Assert::IsTrue(server.GetMaxConnections() <= 2);
+	}
+
+	TEST_METHOD(TestCancel)
+	{
+		LoopbackServer server(300);
+
+		// The remaining requester still receives the shared response.
+		int owner1, owner2, owner3;
+		Responses cancelled(1);
+		Responses responses(1);
+		WebFetchPool::Fetch(&owner1, GetRequest(server.GetUrl(L"/shared")), cancelled.Expect("/shared"));
+		WebFetchPool::Fetch(&owner2, GetRequest(server.GetUrl(L"/shared")), responses.Expect("/shared"));
+		WebFetchPool::Fetch(&owner3, GetRequest(server.GetUrl(L"/alone")), cancelled.Expect("/alone"));
+		WebFetchPool::Cancel(&owner1);
+		WebFetchPool::Cancel(&owner3);
+
+		Assert::IsTrue(responses.Wait());
+		Assert::AreEqual(0L, responses.GetMismatches());
+		Sleep(500);
+		Assert::AreEqual(0L, cancelled.GetCount());
+	}
+
+	TEST_METHOD(TestRun)
+	{
+		// Tasks are not limited to MAX_CONNECTIONS_PER_HOST and Cancel() waits for them to finish.
+		volatile LONG running = 0;
+		volatile LONG maxRunning = 0;
+		volatile LONG started = 0;
+		volatile LONG finished = 0;
+		int owners[6];
+		for (auto& owner : owners)
+		{
+			WebFetchPool::Run(&owner, [&](const volatile bool&)
+			{
+				InterlockedIncrement(&started);
+				const LONG count = InterlockedIncrement(&running);
+				for (LONG max = maxRunning; count > max; max = maxRunning)
+				{
+					InterlockedCompareExchange(&maxRunning, count, max);
+				}
+
+				Sleep(300);
+				InterlockedDecrement(&running);
+				InterlockedIncrement(&finished);
+			});
+		}
+
+		Sleep(100);
+		for (auto& owner : owners)
+		{
+			WebFetchPool::Cancel(&owner);
+		}
+
+		Assert::AreEqual(0L, (LONG)running);
+		Assert::AreEqual((LONG)started, (LONG)finished);
+		Assert::IsTrue(maxRunning > 2);
+
+		// The queued tasks were removed.
+		Sleep(500);
+		Assert::AreEqual((LONG)started, (LONG)finished);
+		Assert::IsTrue(finished < (LONG)_countof(owners));
+	}
+
+	TEST_METHOD(TestConditionalGet)
+	{
+		LoopbackServer server(0);
+		const WebFetchPool::Stats stats = WebFetchPool::GetStats();
+		int owner;
+
+		Responses first(1);
+		WebFetchPool::Fetch(&owner, GetRequest(server.GetUrl(L"/etag")), first.Expect("/etag"));
+		Assert::IsTrue(first.Wait());
+		Assert::AreEqual(0L, first.GetNotModified());
+
+		// The second response is the cached body since the server answers with 304.
+		Responses second(1);
+		WebFetchPool::Fetch(&owner, GetRequest(server.GetUrl(L"/etag")), second.Expect("/etag"));
+		Assert::IsTrue(second.Wait());
+		Assert::AreEqual(0L, second.GetMismatches());
+		Assert::AreEqual(1L, second.GetNotModified());
+
+		// The validators are separated from custom headers.
+		WebFetchPool::Request request = GetRequest(server.GetUrl(L"/etag-headers"));
+		request.headers = L"Accept: text/plain\r\n\r\n";
+		Responses third(1);
+		WebFetchPool::Fetch(&owner, request, third.Expect("/etag-headers"));
+		Assert::IsTrue(third.Wait());
+		Responses fourth(1);
+		WebFetchPool::Fetch(&owner, request, fourth.Expect("/etag-headers"));
+		Assert::IsTrue(fourth.Wait());
+		Assert::AreEqual(0L, fourth.GetMismatches());
+		Assert::AreEqual(1L, fourth.GetNotModified());
+
+		Assert::AreEqual(4L, server.GetRequests());
+		Assert::AreEqual(2L, server.GetNotModified());
+		Assert::AreEqual(stats.notModified + 2, WebFetchPool::GetStats().notModified);
+	}
+
+	TEST_METHOD(TestGetHost)
+	{
+		Assert::AreEqual(L"example.com", WebFetchPool::GetHost(L"http://Example.com/path?q").c_str());
+		Assert::AreEqual(L"example.com:8080", WebFetchPool::GetHost(L"https://user@example.com:8080#x").c_str());
+		Assert::AreEqual(L"", WebFetchPool::GetHost(L"file://C:/file.txt").c_str());
+		Assert::AreEqual(L"", WebFetchPool::GetHost(L"[MeasureParent]").c_str());
+	}
+
+private:
+	WebFetchPool::Request GetRequest(const std::wstring& url)
+	{
+		WebFetchPool::Request request = { url, L"", m_Internet, true };
+		return request;
+	}
+
+	HINTERNET m_Internet;
+};
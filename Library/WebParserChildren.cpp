@@ -0,0 +1,78 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "WebParserChildren.h"
+#include "../Common/StringUtil.h"
+
+WebParserChildren::WebParserChildren()
+{
+}
+
+WebParserChildren::~WebParserChildren()
+{
+}
+
+void WebParserChildren::Set(Skin* skin, MeasureWebParser* measure, const std::wstring& url)
+{
+	Remove(measure);
+
+	std::vector<Key> parents;
+	std::wstring::size_type start = 0;
+	while ((start = url.find(L'[', start)) != std::wstring::npos)
+	{
+		const std::wstring::size_type end = url.find_first_of(L"[]", start + 1);
+		if (end == std::wstring::npos) break;
+
+		if (url[end] == L']' && end > start + 1)
+		{
+			Key key(skin, url.substr(start + 1, end - start - 1));
+			StringUtil::ToLowerCase(key.second);
+			if (std::find(parents.cbegin(), parents.cend(), key) == parents.cend())
+			{
+				m_Children[key].push_back({ measure, start });
+				parents.push_back(std::move(key));
+			}
+		}
+
+		start = end;
+	}
+
+	if (!parents.empty())
+	{
+		m_Parents[measure] = std::move(parents);
+	}
+}
+
+void WebParserChildren::Remove(MeasureWebParser* measure)
+{
+	auto parentsIter = m_Parents.find(measure);
+	if (parentsIter == m_Parents.end()) return;
+
+	for (const auto& key : parentsIter->second)
+	{
+		auto iter = m_Children.find(key);
+		auto& children = iter->second;
+		children.erase(
+			std::remove_if(children.begin(), children.end(),
+				[measure](const Child& child) { return child.measure == measure; }),
+			children.end());
+		if (children.empty())
+		{
+			m_Children.erase(iter);
+		}
+	}
+
+	m_Parents.erase(parentsIter);
+}
+
+const std::vector<WebParserChildren::Child>* WebParserChildren::Find(Skin* skin, std::wstring name) const
+{
+	StringUtil::ToLowerCase(name);
+	auto iter = m_Children.find(Key(skin, std::move(name)));
+	return (iter != m_Children.end()) ? &iter->second : nullptr;
+}
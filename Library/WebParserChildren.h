@@ -0,0 +1,56 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_WEBPARSERCHILDREN_H_
+#define RM_LIBRARY_WEBPARSERCHILDREN_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class MeasureWebParser;
+class Skin;
+
+// Index of the WebParser measures whose Url references another measure of the same skin, so that
+// the results of a parent are passed only to its actual children. Names are case insensitive.
+// Not thread safe.
+class WebParserChildren
+{
+public:
+	// Child measure and the position of the reference in its Url.
+	struct Child
+	{
+		MeasureWebParser* measure;
+		std::wstring::size_type offset;
+	};
+
+	WebParserChildren();
+	~WebParserChildren();
+
+	WebParserChildren(const WebParserChildren& other) = delete;
+	WebParserChildren& operator=(WebParserChildren other) = delete;
+
+	// Replaces the references of |measure| with the [Name] references in |url|. Only the first
+	// reference to each name is added.
+	void Set(Skin* skin, MeasureWebParser* measure, const std::wstring& url);
+
+	void Remove(MeasureWebParser* measure);
+
+	// Returns the children of the measure |name| in |skin| or nullptr if it has none.
+	const std::vector<Child>* Find(Skin* skin, std::wstring name) const;
+
+	bool IsEmpty() const { return m_Children.empty(); }
+
+private:
+	typedef std::pair<Skin*, std::wstring> Key;	// Skin and lowercase name of the parent
+
+	std::map<Key, std::vector<Child>> m_Children;
+	std::map<MeasureWebParser*, std::vector<Key>> m_Parents;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "WebParserChildren.h"
+#include "../Common/UnitTest.h"
+
+TEST_CLASS(Library_WebParserChildren_Test)
+{
+public:
+	// The index only compares the pointers.
+	Library_WebParserChildren_Test() :
+		m_Skin1((Skin*)&m_Dummy[0]),
+		m_Skin2((Skin*)&m_Dummy[1]),
+		m_Child1((MeasureWebParser*)&m_Dummy[2]),
+		m_Child2((MeasureWebParser*)&m_Dummy[3])
+	{
+	}
+
+	TEST_METHOD(TestSet)
+	{
+		WebParserChildren children;
+		children.Set(m_Skin1, m_Child1, L"[Parent]");
+		children.Set(m_Skin1, m_Child2, L"http://[parent]/[Other]?[PARENT]&[]&[Open[Nested]");
+
+		// Names are case insensitive and only the first reference is added.
+		const auto* parent = children.Find(m_Skin1, L"PARENT");
+		Assert::IsNotNull(parent);
+		Assert::AreEqual(2, (int)parent->size());
+		AssertChild((*parent)[0], m_Child1, 0);
+		AssertChild((*parent)[1], m_Child2, 7);
+
+		const auto* other = children.Find(m_Skin1, L"Other");
+		Assert::IsNotNull(other);
+		Assert::AreEqual(1, (int)other->size());
+		AssertChild((*other)[0], m_Child2, 16);
+
+		const auto* nested = children.Find(m_Skin1, L"Nested");
+		Assert::IsNotNull(nested);
+		AssertChild((*nested)[0], m_Child2, 41);
+
+		Assert::IsNull(children.Find(m_Skin1, L"Open"));
+		Assert::IsNull(children.Find(m_Skin1, L""));
+
+		// Measures of other skins are not children.
+		Assert::IsNull(children.Find(m_Skin2, L"Parent"));
+	}
+
+	TEST_METHOD(TestChangedUrl)
+	{
+		WebParserChildren children;
+		children.Set(m_Skin1, m_Child1, L"[Parent1]");
+		children.Set(m_Skin1, m_Child2, L"[Parent1]");
+
+		// The old references are removed, the other child remains.
+		children.Set(m_Skin1, m_Child1, L"x[Parent2][Parent3]");
+		const auto* parent1 = children.Find(m_Skin1, L"Parent1");
+		Assert::IsNotNull(parent1);
+		Assert::AreEqual(1, (int)parent1->size());
+		AssertChild((*parent1)[0], m_Child2, 0);
+
+		const auto* parent2 = children.Find(m_Skin1, L"Parent2");
+		Assert::IsNotNull(parent2);
+		AssertChild((*parent2)[0], m_Child1, 1);
+
+		// No longer a child.
+		children.Set(m_Skin1, m_Child1, L"http://example.com");
+		Assert::IsNull(children.Find(m_Skin1, L"Parent2"));
+		Assert::IsNull(children.Find(m_Skin1, L"Parent3"));
+		Assert::IsNotNull(children.Find(m_Skin1, L"Parent1"));
+
+		children.Remove(m_Child2);
+		Assert::IsTrue(children.IsEmpty());
+
+		// Removing a measure without references does nothing.
+		children.Remove(m_Child2);
+		Assert::IsTrue(children.IsEmpty());
+	}
+
+	TEST_METHOD(TestSkins)
+	{
+		WebParserChildren children;
+		children.Set(m_Skin1, m_Child1, L"[Parent]");
+		children.Set(m_Skin2, m_Child2, L"[Parent]");
+
+		const auto* parent = children.Find(m_Skin2, L"Parent");
+		Assert::IsNotNull(parent);
+		Assert::AreEqual(1, (int)parent->size());
+		AssertChild((*parent)[0], m_Child2, 0);
+
+		children.Remove(m_Child1);
+		Assert::IsNull(children.Find(m_Skin1, L"Parent"));
+		Assert::IsNotNull(children.Find(m_Skin2, L"Parent"));
+	}
+
+	static void AssertChild(const WebParserChildren::Child& child, MeasureWebParser* measure, size_t offset)
+	{
+		Assert::IsTrue(child.measure == measure);
+		Assert::AreEqual((int)offset, (int)child.offset);
+	}
+
+private:
+	int m_Dummy[4];
+	Skin* m_Skin1;
+	Skin* m_Skin2;
+	MeasureWebParser* m_Child1;
+	MeasureWebParser* m_Child2;
+};
@@ -0,0 +1,420 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "WebResponseCache.h"
+#include "System.h"
+
+namespace {
+
+const UINT32 FILE_MAGIC = 0x43524D52;	// "RMRC"
+const UINT32 FILE_VERSION = 2;
+
+// Larger responses are only stored in the directory.
+const size_t MAX_ENTRY_MEMORY_SIZE = 1024 * 1024;
+
+// Larger responses are not stored in the directory.
+const UINT32 MAX_ENTRY_FILE_SIZE = 16 * 1024 * 1024;
+
+const size_t DEFAULT_MAX_MEMORY_SIZE = 8 * 1024 * 1024;
+const UINT64 DEFAULT_MAX_DISK_SIZE = 64 * 1024 * 1024;
+
+bool WriteString(FILE* file, const std::wstring& str)
+{
+	const UINT32 length = (UINT32)str.length();
+	return fwrite(&length, sizeof(length), 1, file) == 1 &&
+		fwrite(str.c_str(), sizeof(WCHAR), length, file) == length;
+}
+
+bool ReadString(FILE* file, std::wstring& str)
+{
+	UINT32 length;
+	if (fread(&length, sizeof(length), 1, file) != 1 || length > 64 * 1024) return false;
+
+	str.resize(length);
+	return fread(&str[0], sizeof(WCHAR), length, file) == length;
+}
+
+UINT64 ToUINT64(DWORD high, DWORD low)
+{
+	return ((UINT64)high << 32) | low;
+}
+
+}  // namespace
+
+CRITICAL_SECTION WebResponseCache::c_CriticalSection;
+std::unordered_map<std::wstring, WebResponseCache::CachedEntry> WebResponseCache::c_Entries;
+std::list<std::wstring> WebResponseCache::c_LRU;
+std::wstring WebResponseCache::c_Directory;
+size_t WebResponseCache::c_MemorySize = 0;
+size_t WebResponseCache::c_MaxMemorySize = DEFAULT_MAX_MEMORY_SIZE;
+UINT64 WebResponseCache::c_DiskSize = 0;
+UINT64 WebResponseCache::c_MaxDiskSize = DEFAULT_MAX_DISK_SIZE;
+bool WebResponseCache::c_Trimming = false;
+
+void WebResponseCache::InitializeStatic()
+{
+	System::InitializeCriticalSection(&c_CriticalSection);
+	c_MaxMemorySize = DEFAULT_MAX_MEMORY_SIZE;
+	c_MaxDiskSize = DEFAULT_MAX_DISK_SIZE;
+
+	// Next to the files downloaded by WebParser in cache mode.
+	WCHAR buffer[MAX_PATH];
+	GetTempPath(_countof(buffer), buffer);
+	c_Directory = buffer;
+	c_Directory += L"Rainmeter-Cache\\Responses\\";
+
+	// Also deletes the files left by interrupted writes.
+	TrimDirectory(c_Directory, true);
+}
+
+void WebResponseCache::FinalizeStatic()
+{
+	c_Entries.clear();
+	c_LRU.clear();
+	c_MemorySize = 0;
+
+	DeleteCriticalSection(&c_CriticalSection);
+}
+
+void WebResponseCache::SetDirectory(const std::wstring& directory)
+{
+	EnterCriticalSection(&c_CriticalSection);
+	c_Directory = directory;
+	if (!c_Directory.empty() && c_Directory.back() != L'\\')
+	{
+		c_Directory += L'\\';
+	}
+	const std::wstring newDirectory = c_Directory;
+	LeaveCriticalSection(&c_CriticalSection);
+
+	if (!newDirectory.empty())
+	{
+		TrimDirectory(newDirectory, true);
+	}
+}
+
+void WebResponseCache::SetMaxMemorySize(size_t maxMemorySize)
+{
+	EnterCriticalSection(&c_CriticalSection);
+	c_MaxMemorySize = maxMemorySize;
+	TrimMemory();
+	LeaveCriticalSection(&c_CriticalSection);
+}
+
+void WebResponseCache::SetMaxDiskSize(UINT64 maxDiskSize)
+{
+	EnterCriticalSection(&c_CriticalSection);
+	c_MaxDiskSize = maxDiskSize;
+	const std::wstring directory = c_Directory;
+	LeaveCriticalSection(&c_CriticalSection);
+
+	if (!directory.empty())
+	{
+		TrimDirectory(directory, false);
+	}
+}
+
+std::shared_ptr<const WebResponseCache::Entry> WebResponseCache::Get(const std::wstring& key)
+{
+	EnterCriticalSection(&c_CriticalSection);
+
+	std::shared_ptr<const Entry> entry;
+	auto iter = c_Entries.find(key);
+	if (iter != c_Entries.end())
+	{
+		entry = iter->second.entry;
+		c_LRU.splice(c_LRU.begin(), c_LRU, iter->second.lruIter);
+	}
+	const std::wstring directory = c_Directory;
+
+	LeaveCriticalSection(&c_CriticalSection);
+
+	if (!entry && !directory.empty())
+	{
+		entry = Load(directory, key);
+		if (entry)
+		{
+			EnterCriticalSection(&c_CriticalSection);
+			if (c_Entries.find(key) == c_Entries.end())
+			{
+				AddToMemory(key, entry);
+			}
+			LeaveCriticalSection(&c_CriticalSection);
+		}
+	}
+
+	return entry;
+}
+
+void WebResponseCache::Put(const std::wstring& key, std::shared_ptr<const Entry> entry)
+{
+	EnterCriticalSection(&c_CriticalSection);
+
+	auto iter = c_Entries.find(key);
+	if (iter != c_Entries.end())
+	{
+		c_MemorySize -= iter->second.entry->body.size();
+		c_LRU.erase(iter->second.lruIter);
+		c_Entries.erase(iter);
+	}
+
+	AddToMemory(key, entry);
+	const std::wstring directory = c_Directory;
+
+	LeaveCriticalSection(&c_CriticalSection);
+
+	if (!directory.empty())
+	{
+		const UINT64 size = Save(directory, key, *entry);
+
+		EnterCriticalSection(&c_CriticalSection);
+		c_DiskSize += size;
+		const bool trim = c_DiskSize > c_MaxDiskSize;
+		LeaveCriticalSection(&c_CriticalSection);
+
+		if (trim)
+		{
+			TrimDirectory(directory, false);
+		}
+	}
+}
+
+UINT64 WebResponseCache::Hash(const BYTE* data, size_t size)
+{
+	UINT64 hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/*
+** Must be called within the critical section.
+**
+*/
+void WebResponseCache::AddToMemory(const std::wstring& key, std::shared_ptr<const Entry> entry)
+{
+	const size_t size = entry->body.size();
+	if (size > MAX_ENTRY_MEMORY_SIZE) return;
+
+	c_LRU.push_front(key);
+	CachedEntry cached = { std::move(entry), c_LRU.begin() };
+	c_Entries.insert(std::make_pair(key, std::move(cached)));
+	c_MemorySize += size;
+
+	TrimMemory();
+}
+
+/*
+** Removes the least recently used entries from memory until the size is within the limit. Must be
+** called within the critical section.
+**
+*/
+void WebResponseCache::TrimMemory()
+{
+	while (c_MemorySize > c_MaxMemorySize && !c_LRU.empty())
+	{
+		auto iter = c_Entries.find(c_LRU.back());
+		c_MemorySize -= iter->second.entry->body.size();
+		c_Entries.erase(iter);
+		c_LRU.pop_back();
+	}
+}
+
+std::wstring WebResponseCache::GetFilePath(const std::wstring& directory, UINT64 keyHash)
+{
+	WCHAR buffer[32];
+	_snwprintf_s(buffer, _TRUNCATE, L"%016llx.bin", keyHash);
+	return directory + buffer;
+}
+
+/*
+** Reads the file of |key|. The key itself is not stored, so the hash and the length of the key are
+** compared instead.
+**
+*/
+std::shared_ptr<const WebResponseCache::Entry> WebResponseCache::Load(const std::wstring& directory, const std::wstring& key)
+{
+	const UINT64 keyHash = HashKey(key);
+	const std::wstring path = GetFilePath(directory, keyHash);
+	FILE* file = _wfopen(path.c_str(), L"rb");
+	if (!file) return nullptr;
+
+	auto entry = std::make_shared<Entry>();
+	UINT32 header[2];
+	UINT64 fileKeyHash;
+	UINT32 fileKeyLength;
+	UINT32 bodySize;
+	bool valid =
+		fread(header, sizeof(header), 1, file) == 1 &&
+		header[0] == FILE_MAGIC && header[1] == FILE_VERSION &&
+		fread(&fileKeyHash, sizeof(fileKeyHash), 1, file) == 1 && fileKeyHash == keyHash &&
+		fread(&fileKeyLength, sizeof(fileKeyLength), 1, file) == 1 && fileKeyLength == key.length() &&
+		ReadString(file, entry->etag) &&
+		ReadString(file, entry->lastModified) &&
+		fread(&entry->hash, sizeof(entry->hash), 1, file) == 1 &&
+		fread(&bodySize, sizeof(bodySize), 1, file) == 1;
+
+	if (valid)
+	{
+		// The body must fit in the rest of the file.
+		const __int64 position = _ftelli64(file);
+		valid = bodySize <= MAX_ENTRY_FILE_SIZE &&
+			_fseeki64(file, 0, SEEK_END) == 0 && _ftelli64(file) - position == bodySize &&
+			_fseeki64(file, position, SEEK_SET) == 0;
+	}
+
+	if (valid)
+	{
+		entry->body.resize(bodySize);
+		valid = fread(entry->body.data(), 1, bodySize, file) == bodySize &&
+			Hash(entry->body.data(), bodySize) == entry->hash;
+	}
+
+	fclose(file);
+
+	if (!valid)
+	{
+		DeleteFile(path.c_str());
+		return nullptr;
+	}
+
+	// Mark the file as recently used for TrimDirectory().
+	HANDLE handle = CreateFile(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (handle != INVALID_HANDLE_VALUE)
+	{
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+		SetFileTime(handle, nullptr, nullptr, &now);
+		CloseHandle(handle);
+	}
+
+	return entry;
+}
+
+/*
+** Writes the file of |key| and returns its size or 0 if it was not written.
+**
+*/
+UINT64 WebResponseCache::Save(const std::wstring& directory, const std::wstring& key, const Entry& entry)
+{
+	if (entry.body.size() > MAX_ENTRY_FILE_SIZE) return 0;
+
+	CreateDirectory(directory.c_str(), nullptr);
+
+	// Write to a temporary file first so that a partially written file is never loaded. The name
+	// is unique to the thread since the same key may be saved by several threads.
+	const UINT64 keyHash = HashKey(key);
+	const std::wstring path = GetFilePath(directory, keyHash);
+	WCHAR suffix[32];
+	_snwprintf_s(suffix, _TRUNCATE, L".%lu.tmp", GetCurrentThreadId());
+	const std::wstring tempPath = path + suffix;
+	FILE* file = _wfopen(tempPath.c_str(), L"wb");
+	if (!file) return 0;
+
+	const UINT32 header[2] = { FILE_MAGIC, FILE_VERSION };
+	const UINT32 keyLength = (UINT32)key.length();
+	const UINT32 bodySize = (UINT32)entry.body.size();
+	const bool written =
+		fwrite(header, sizeof(header), 1, file) == 1 &&
+		fwrite(&keyHash, sizeof(keyHash), 1, file) == 1 &&
+		fwrite(&keyLength, sizeof(keyLength), 1, file) == 1 &&
+		WriteString(file, entry.etag) &&
+		WriteString(file, entry.lastModified) &&
+		fwrite(&entry.hash, sizeof(entry.hash), 1, file) == 1 &&
+		fwrite(&bodySize, sizeof(bodySize), 1, file) == 1 &&
+		fwrite(entry.body.data(), 1, bodySize, file) == bodySize;
+	const __int64 size = _ftelli64(file);
+	fclose(file);
+
+	if (!written || !MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFile(tempPath.c_str());
+		return 0;
+	}
+
+	return (UINT64)size;
+}
+
+/*
+** Deletes the least recently used files until the directory is within 3/4 of the size limit if it
+** is over the limit. Files of interrupted writes are deleted with |deleteTemporary|, which must only
+** be used when no other thread writes to the directory.
+**
+*/
+void WebResponseCache::TrimDirectory(const std::wstring& directory, bool deleteTemporary)
+{
+	EnterCriticalSection(&c_CriticalSection);
+	const bool trimming = c_Trimming;
+	c_Trimming = true;
+	const UINT64 maxSize = c_MaxDiskSize;
+	LeaveCriticalSection(&c_CriticalSection);
+
+	if (trimming) return;
+
+	struct CacheFile
+	{
+		std::wstring name;
+		UINT64 size;
+		UINT64 writeTime;
+	};
+	std::vector<CacheFile> files;
+	UINT64 size = 0;
+
+	WIN32_FIND_DATA findData;
+	HANDLE find = FindFirstFile((directory + L'*').c_str(), &findData);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+
+			const size_t length = wcslen(findData.cFileName);
+			if (length > 4 && _wcsicmp(findData.cFileName + length - 4, L".bin") == 0)
+			{
+				CacheFile cacheFile;
+				cacheFile.name = findData.cFileName;
+				cacheFile.size = ToUINT64(findData.nFileSizeHigh, findData.nFileSizeLow);
+				cacheFile.writeTime = ToUINT64(findData.ftLastWriteTime.dwHighDateTime, findData.ftLastWriteTime.dwLowDateTime);
+				size += cacheFile.size;
+				files.push_back(std::move(cacheFile));
+			}
+			else if (deleteTemporary)
+			{
+				DeleteFile((directory + findData.cFileName).c_str());
+			}
+		}
+		while (FindNextFile(find, &findData));
+		FindClose(find);
+	}
+
+	if (size > maxSize)
+	{
+		// Oldest first. Load() updates the write time of the files that are used.
+		std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b)
+		{
+			return a.writeTime < b.writeTime;
+		});
+
+		for (auto iter = files.cbegin(); iter != files.cend() && size > maxSize / 4 * 3; ++iter)
+		{
+			if (DeleteFile((directory + iter->name).c_str()))
+			{
+				size -= iter->size;
+			}
+		}
+	}
+
+	EnterCriticalSection(&c_CriticalSection);
+	c_DiskSize = size;
+	c_Trimming = false;
+	LeaveCriticalSection(&c_CriticalSection);
+}
@@ -0,0 +1,82 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#ifndef RM_LIBRARY_WEBRESPONSECACHE_H_
+#define RM_LIBRARY_WEBRESPONSECACHE_H_
+
+#include <windows.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Last response of the URLs that have an ETag or Last-Modified validator. WebFetchPool sends the
+// validators in a conditional request and uses the cached body when the server answers with
+// 304 Not Modified. The most recently used responses are kept in memory and also stored in a
+// directory so that they survive restarts. The files are named by a hash of the key, which is not
+// stored since the headers may contain credentials.
+class WebResponseCache
+{
+public:
+	struct Entry
+	{
+		std::wstring etag;
+		std::wstring lastModified;
+		UINT64 hash;			// Hash() of the body
+		std::vector<BYTE> body;
+	};
+
+	static void InitializeStatic();
+	static void FinalizeStatic();
+
+	// Sets the directory of the cache files. An empty |directory| keeps the responses in memory
+	// only.
+	static void SetDirectory(const std::wstring& directory);
+
+	static void SetMaxMemorySize(size_t maxMemorySize);
+
+	// The least recently used files are deleted when the directory is larger than |maxDiskSize|.
+	static void SetMaxDiskSize(UINT64 maxDiskSize);
+
+	// Returns the entry of |key| from memory or from the directory or nullptr.
+	static std::shared_ptr<const Entry> Get(const std::wstring& key);
+
+	static void Put(const std::wstring& key, std::shared_ptr<const Entry> entry);
+
+	// FNV-1a hash of |size| bytes of |data|.
+	static UINT64 Hash(const BYTE* data, size_t size);
+
+private:
+	struct CachedEntry
+	{
+		std::shared_ptr<const Entry> entry;
+		std::list<std::wstring>::iterator lruIter;
+	};
+
+	static void AddToMemory(const std::wstring& key, std::shared_ptr<const Entry> entry);
+	static void TrimMemory();
+
+	// The files are read and written outside of the critical section.
+	static UINT64 HashKey(const std::wstring& key) { return Hash((const BYTE*)key.c_str(), key.length() * sizeof(WCHAR)); }
+	static std::wstring GetFilePath(const std::wstring& directory, UINT64 keyHash);
+	static std::shared_ptr<const Entry> Load(const std::wstring& directory, const std::wstring& key);
+	static UINT64 Save(const std::wstring& directory, const std::wstring& key, const Entry& entry);
+	static void TrimDirectory(const std::wstring& directory, bool deleteTemporary);
+
+	static CRITICAL_SECTION c_CriticalSection;
+	static std::unordered_map<std::wstring, CachedEntry> c_Entries;
+	static std::list<std::wstring> c_LRU;	// Most recently used first
+	static std::wstring c_Directory;
+	static size_t c_MemorySize;
+	static size_t c_MaxMemorySize;
+	static UINT64 c_DiskSize;	// Estimated from the files written since the last trim
+	static UINT64 c_MaxDiskSize;
+	static bool c_Trimming;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/* Copyright (C) 2016 Rainmeter Project Developers
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public
+ * License; either version 2 of the License, or (at your option) any later
+ * version. If a copy of the GPL was not distributed with this file, You can
+ * obtain one at <https://www.gnu.org/licenses/gpl-2.0.html>. */
+
+#include "StdAfx.h"
+#include "WebResponseCache.h"
+#include "../Common/UnitTest.h"
+
+TEST_CLASS(Library_WebResponseCache_Test)
+{
+public:
+	Library_WebResponseCache_Test()
+	{
+		WebResponseCache::InitializeStatic();
+
+		WCHAR path[MAX_PATH];
+		GetTempPath(_countof(path), path);
+		m_Directory = path;
+		m_Directory += L"RainmeterResponseCacheTest\\";
+		WebResponseCache::SetDirectory(m_Directory);
+	}
+
+	~Library_WebResponseCache_Test()
+	{
+		WebResponseCache::FinalizeStatic();
+
+		WIN32_FIND_DATA findData;
+		HANDLE find = FindFirstFile((m_Directory + L"*.bin").c_str(), &findData);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				DeleteFile((m_Directory + findData.cFileName).c_str());
+			}
+			while (FindNextFile(find, &findData));
+			FindClose(find);
+		}
+		RemoveDirectory(m_Directory.c_str());
+	}
+
+	TEST_METHOD(TestMemory)
+	{
+		WebResponseCache::SetDirectory(L"");
+		WebResponseCache::SetMaxMemorySize(8);
+
+		WebResponseCache::Put(L"A", CreateEntry("12345", L"\"a\""));
+		WebResponseCache::Put(L"B", CreateEntry("123", L"\"b\""));
+		Assert::IsNotNull(WebResponseCache::Get(L"A").get());
+		Assert::AreEqual(L"\"b\"", WebResponseCache::Get(L"B")->etag.c_str());
+
+		// A is the least recently used when C no longer fits.
+		WebResponseCache::Put(L"C", CreateEntry("12", L"\"c\""));
+		Assert::IsNull(WebResponseCache::Get(L"A").get());
+		Assert::IsNotNull(WebResponseCache::Get(L"B").get());
+		Assert::IsNotNull(WebResponseCache::Get(L"C").get());
+	}
+
+	TEST_METHOD(TestDirectory)
+	{
+		const char body[] = "<rss>feed</rss>";
+		WebResponseCache::Put(L"http://example.com/feed\n", CreateEntry(body, L"\"v1\""));
+
+		// Drop the in-memory copy so that the entry is loaded from the file.
+		WebResponseCache::SetMaxMemorySize(0);
+		WebResponseCache::SetMaxMemorySize(1024);
+
+		auto entry = WebResponseCache::Get(L"http://example.com/feed\n");
+		Assert::IsNotNull(entry.get());
+		Assert::AreEqual(L"\"v1\"", entry->etag.c_str());
+		Assert::AreEqual(L"Wed, 21 Oct 2015 07:28:00 GMT", entry->lastModified.c_str());
+		Assert::AreEqual(sizeof(body) - 1, entry->body.size());
+		Assert::AreEqual(0, memcmp(body, entry->body.data(), entry->body.size()));
+		Assert::IsTrue(WebResponseCache::Hash((const BYTE*)body, sizeof(body) - 1) == entry->hash);
+
+		// Keys without a file are not found.
+		Assert::IsNull(WebResponseCache::Get(L"http://example.com/other\n").get());
+	}
+
+	TEST_METHOD(TestKeyNotStored)
+	{
+		const WCHAR key[] = L"http://example.com/api\nAuthorization: Bearer secret\n";
+		WebResponseCache::Put(key, CreateEntry("{}", L"\"v1\""));
+
+		std::vector<BYTE> data;
+		Assert::AreEqual(1, ReadFiles(data));
+		const BYTE* secret = (const BYTE*)L"secret";
+		const size_t secretSize = wcslen(L"secret") * sizeof(WCHAR);
+		Assert::IsTrue(std::search(data.begin(), data.end(), secret, secret + secretSize) == data.end());
+
+		// The key is still matched when loaded.
+		WebResponseCache::SetMaxMemorySize(0);
+		WebResponseCache::SetMaxMemorySize(1024);
+		Assert::IsNotNull(WebResponseCache::Get(key).get());
+		Assert::IsNull(WebResponseCache::Get(L"http://example.com/api\nAuthorization: Bearer other\n").get());
+	}
+
+	TEST_METHOD(TestMaxDiskSize)
+	{
+		WebResponseCache::Put(L"A", CreateEntry("1234567890", L"\"a\""));
+		WebResponseCache::Put(L"B", CreateEntry("1234567890", L"\"b\""));
+		std::vector<BYTE> data;
+		Assert::AreEqual(2, ReadFiles(data));
+
+		// Trimming leaves the directory within 3/4 of the limit.
+		WebResponseCache::SetMaxDiskSize(data.size() - 1);
+		Assert::AreEqual(1, ReadFiles(data));
+
+		WebResponseCache::SetMaxDiskSize(0);
+		Assert::AreEqual(0, ReadFiles(data));
+
+		// Files that exceed the limit are deleted after they are written.
+		WebResponseCache::Put(L"C", CreateEntry("1234567890", L"\"c\""));
+		Assert::AreEqual(0, ReadFiles(data));
+	}
+
+private:
+	std::shared_ptr<const WebResponseCache::Entry> CreateEntry(const char* body, const WCHAR* etag)
+	{
+		auto entry = std::make_shared<WebResponseCache::Entry>();
+		entry->etag = etag;
+		entry->lastModified = L"Wed, 21 Oct 2015 07:28:00 GMT";
+		entry->body.assign((const BYTE*)body, (const BYTE*)body + strlen(body));
+		entry->hash = WebResponseCache::Hash(entry->body.data(), entry->body.size());
+		return entry;
+	}
+
+	// Returns the number of cache files and their contents in |data|.
+	int ReadFiles(std::vector<BYTE>& data)
+	{
+		data.clear();
+		int count = 0;
+		WIN32_FIND_DATA findData;
+		HANDLE find = FindFirstFile((m_Directory + L"*.bin").c_str(), &findData);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				FILE* file = _wfopen((m_Directory + findData.cFileName).c_str(), L"rb");
+				Assert::IsNotNull(file);
+				BYTE buffer[4096];
+				size_t read;
+				while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+				{
+					data.insert(data.end(), buffer, buffer + read);
+				}
+				fclose(file);
+				++count;
+			}
+			while (FindNextFile(find, &findData));
+			FindClose(find);
+		}
+		return count;
+	}
+
+	std::wstring m_Directory;
+};
@@ -232,6 +232,18 @@
 #define ID_STR_STRING                                2148
 #define ID_STR_EXTERNALPLUGINS                       2149
 #define ID_STR_BUILTINPLUGINS                        2150
+#define ID_STR_PROFILER                              2151
+#define ID_STR_ACTIVITY                              2152
+#define ID_STR_COUNT                                 2153
+#define ID_STR_TOTALMS                               2154
+#define ID_STR_MAXMS                                 2155
+#define ID_STR_TEXTLAYOUTCACHE                       2156
+#define ID_STR_HIT                                   2157
+#define ID_STR_MISS                                  2158
+#define ID_STR_IMAGECACHE                            2159
+#define ID_STR_IMAGES                                2160
+#define ID_STR_KB                                    2161
+#define ID_STR_UNUSEDKB                              2162
 
 #define ID_STR_CREATENEWSKIN                         2999
 #define ID_STR_NEWSKIN                               3000